@@ -35,6 +35,69 @@ void Parameters::initYAxis(int yAxisIndex) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void getIndexFilePath(const char *filePath, char *indexFilePath) {
+    const char *fileName = strrchr(filePath, '/');
+    fileName = fileName ? fileName + 1 : filePath;
+
+    size_t dirLength = fileName - filePath;
+    memcpy(indexFilePath, filePath, dirLength);
+    indexFilePath[dirLength] = '.';
+    strcpy(indexFilePath + dirLength + 1, fileName);
+    strcat(indexFilePath, ".idx");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+uint32_t getFrameNumRows(uint32_t numFloatsPerRow) {
+    uint32_t numRows = FRAME_MAX_DATA_SIZE / (numFloatsPerRow * 4);
+    return numRows > 0 ? numRows : 1;
+}
+
+void encodeFrameData(const uint8_t *rows, uint32_t numRows, uint32_t numFloatsPerRow, uint8_t *encoded) {
+    uint32_t numValues = numRows * numFloatsPerRow;
+
+    uint32_t i = 0;
+    for (uint32_t column = 0; column < numFloatsPerRow; column++) {
+        uint32_t previous = 0;
+        const uint8_t *p = rows + column * 4;
+        for (uint32_t row = 0; row < numRows; row++, i++, p += numFloatsPerRow * 4) {
+            uint32_t value = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+            uint32_t delta = value ^ previous;
+            previous = value;
+
+            encoded[i] = delta & 0xFF;
+            encoded[numValues + i] = (delta >> 8) & 0xFF;
+            encoded[2 * numValues + i] = (delta >> 16) & 0xFF;
+            encoded[3 * numValues + i] = delta >> 24;
+        }
+    }
+}
+
+void decodeFrameData(const uint8_t *encoded, uint32_t numRows, uint32_t numFloatsPerRow, uint8_t *rows) {
+    uint32_t numValues = numRows * numFloatsPerRow;
+
+    uint32_t i = 0;
+    for (uint32_t column = 0; column < numFloatsPerRow; column++) {
+        uint32_t previous = 0;
+        uint8_t *p = rows + column * 4;
+        for (uint32_t row = 0; row < numRows; row++, i++, p += numFloatsPerRow * 4) {
+            uint32_t delta = encoded[i] |
+                (encoded[numValues + i] << 8) |
+                (encoded[2 * numValues + i] << 16) |
+                ((uint32_t)encoded[3 * numValues + i] << 24);
+            uint32_t value = delta ^ previous;
+            previous = value;
+
+            p[0] = value & 0xFF;
+            p[1] = (value >> 8) & 0xFF;
+            p[2] = (value >> 16) & 0xFF;
+            p[3] = value >> 24;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 Writer::Writer(uint8_t *buffer, uint32_t bufferSize)
     : m_buffer(buffer)
     , m_bufferSize(bufferSize)
@@ -54,11 +117,11 @@ void Writer::reset() {
 	m_dataOffset = 0;
 }
 
-void Writer::writeFileHeaderAndMetaFields(const Parameters &parameters) {
+void Writer::writeFileHeaderAndMetaFields(const Parameters &parameters, bool compressed) {
     // header
     writeUint32(MAGIC1);
     writeUint32(MAGIC2);
-    writeUint16(VERSION2);
+    writeUint16(compressed ? VERSION3 : VERSION2);
     writeUint16(parameters.numYAxes);
     uint32_t savedBufferIndex = m_bufferIndex;
     writeUint32(0);
@@ -247,7 +310,7 @@ bool Reader::readFileHeaderAndMetaFields(Parameters &parameters, uint32_t &heade
 	uint32_t magic2 = readUint32();
 	m_version = readUint16();
 
-	if (!(magic1 == MAGIC1 && magic2 == MAGIC2 && (m_version == VERSION1 || m_version == VERSION2))) {
+	if (!(magic1 == MAGIC1 && magic2 == MAGIC2 && (m_version == VERSION1 || m_version == VERSION2 || m_version == VERSION3))) {
 		return false;
 	}
 
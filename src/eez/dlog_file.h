@@ -48,6 +48,61 @@ OFFSET    TYPE    WIDTH    DESCRIPTION
 28+(n*N+m)*4    Float   4        n-th row and m-th column value, N - number of columns
 */
 
+/* DLOG File Format V3 (compressed)
+
+Header and meta fields are the same as in V2, only VERSION is 0x0003L.
+Data section, starting at data offset, is a sequence of independently
+compressed frames. All frames, except the last one, hold the same number
+of rows, so frame of the n-th row is found by counting frames.
+
+OFFSET    TYPE    WIDTH    DESCRIPTION
+----------------------------------------------------------------------
+0               U32     4        Frame index, 0 for the first frame
+
+4               U16     2        Number of rows in this frame, R
+
+6               U16     2        Reserved
+
+8               U32     4        Compressed size, C
+
+12              U8      C        LZ4 block, followed by padding to 4 bytes
+
+Before compression, rows are split into columns, each value is XOR-ed with
+the previous value in the same column (first value with 0) and the result
+is stored as 4 byte planes: all the lowest bytes, then all the second
+bytes, etc. (see encodeFrameData).
+*/
+
+/* DLOG Index File Format
+
+Min/max pyramid of the DLOG file data, stored next to the DLOG file
+as hidden file "<dir>/.<name>.idx" (see getIndexFilePath).
+
+OFFSET    TYPE    WIDTH    DESCRIPTION
+----------------------------------------------------------------------
+0               U32     4        MAGIC = 0x58444C44L
+
+4               U16     2        VERSION = 0x0001L
+
+6               U16     2        Number of levels, L
+
+8               U32     4        Size of the DLOG file this index was built from
+
+12              U32     4        Number of rows (samples) in the DLOG file
+
+16              U16     2        Number of values per row, N
+
+18              U16     2        Reserved
+
+20              U32     4        Decimation of the level 0, D0
+
+24              U32     4        Decimation factor between levels, F
+
+28              Float   4*2*N    Levels 0 .. L-1 one after another, level l has
+                                 ceil(rows / (D0 * F^l)) rows and each row holds
+                                 (min, max) pair for each of the N values
+*/
+
 #include <stdint.h>
 
 #include "./unit.h"
@@ -57,12 +112,23 @@ namespace dlog_file {
 
 static const uint16_t VERSION1 = 1;
 static const uint16_t VERSION2 = 2;
+static const uint16_t VERSION3 = 3;
 static const uint32_t DLOG_VERSION1_HEADER_SIZE = 28;
 
 static const int MAX_COMMENT_LENGTH = 128;
 static const int MAX_NUM_OF_Y_AXES = 18;
 static const int MAX_NUM_OF_CHANNELS = 6;
 
+static const uint32_t INDEX_MAGIC = 0x58444C44;
+static const uint16_t INDEX_VERSION1 = 1;
+static const uint32_t INDEX_HEADER_SIZE = 28;
+static const int INDEX_MAX_NUM_OF_LEVELS = 16;
+static const int INDEX_FILE_PATH_EXTRA_LENGTH = 5; // "." prefix and ".idx" suffix
+
+static const uint32_t FRAME_HEADER_SIZE = 12;
+static const uint32_t FRAME_MAX_DATA_SIZE = 16 * 1024; // uncompressed
+static const uint32_t FRAME_MAX_COMPRESSED_SIZE = FRAME_MAX_DATA_SIZE + FRAME_MAX_DATA_SIZE / 255 + 16; // LZ4_COMPRESSBOUND
+
 enum Fields {
     FIELD_ID_COMMENT = 1,
 
@@ -135,13 +201,47 @@ struct Parameters {
 	void initYAxis(int yAxisIndex);
 };
 
+struct IndexHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t numLevels;
+    uint32_t fileSize;
+    uint32_t numRows;
+    uint16_t numValues;
+    uint16_t reserved;
+    uint32_t firstDecimation;
+    uint32_t decimationFactor;
+};
+
+// index file path is "<dir>/.<name>.idx" for the "<dir>/<name>" DLOG file
+void getIndexFilePath(const char *filePath, char *indexFilePath);
+
+struct FrameHeader {
+    uint32_t frameIndex;
+    uint16_t numRows;
+    uint16_t reserved;
+    uint32_t compressedSize;
+};
+
+// number of rows in all but the last frame
+uint32_t getFrameNumRows(uint32_t numFloatsPerRow);
+
+// size of the frame in the file, including header and padding
+inline uint32_t getFrameSize(uint32_t compressedSize) {
+    return FRAME_HEADER_SIZE + 4 * ((compressedSize + 3) / 4);
+}
+
+// delta/XOR + byte planes encoding of the frame data, see "DLOG File Format V3"
+void encodeFrameData(const uint8_t *rows, uint32_t numRows, uint32_t numFloatsPerRow, uint8_t *encoded);
+void decodeFrameData(const uint8_t *encoded, uint32_t numRows, uint32_t numFloatsPerRow, uint8_t *rows);
+
 struct Writer {
 public:
     Writer(uint8_t *buffer, uint32_t bufferSize);
 
 	void reset();
 
-    void writeFileHeaderAndMetaFields(const Parameters &parameters);
+    void writeFileHeaderAndMetaFields(const Parameters &parameters, bool compressed = false);
 
 	void writeFloat(float value);
 	void writeBit(int bit);
@@ -609,18 +609,35 @@ static const int L = 7;
 static const int W = 20;
 static const int H = 20;
 
+static const Rect *g_shadowClipRect;
+
 void drawShadowGlyph(char glyph, int x, int y, int xClip = -1, int yClip = -1) {
+    int xClip1 = x;
+    int yClip1 = y;
     if (xClip == -1) {
         xClip = x + W - 1;
     }
     if (yClip == -1) {
         yClip = y + H - 1;
     }
+
+    if (g_shadowClipRect) {
+        xClip1 = MAX(xClip1, g_shadowClipRect->x);
+        yClip1 = MAX(yClip1, g_shadowClipRect->y);
+        xClip = MIN(xClip, g_shadowClipRect->x + g_shadowClipRect->w - 1);
+        yClip = MIN(yClip, g_shadowClipRect->y + g_shadowClipRect->h - 1);
+        if (xClip1 > xClip || yClip1 > yClip) {
+            return;
+        }
+    }
+
     font::Font font(getFontData(FONT_ID_SHADOW));
-    eez::mcu::display::drawStr(&glyph, 1, x, y, x, y, xClip, yClip, font, -1);
+    eez::mcu::display::drawStr(&glyph, 1, x, y, xClip1, yClip1, xClip, yClip, font, -1);
 }
 
-void drawShadow(int x1, int y1, int x2, int y2) {
+void drawShadow(int x1, int y1, int x2, int y2, const Rect *clipRect) {
+    g_shadowClipRect = clipRect;
+
     mcu::display::setColor(64, 64, 64);
 
     int left = x1 - L;
@@ -652,6 +669,8 @@ void drawShadow(int x1, int y1, int x2, int y2) {
     }
 
     drawShadowGlyph(39, right, bottom);
+
+    g_shadowClipRect = nullptr;
 }
 
 void expandRectWithShadow(int &x1, int &y1, int &x2, int &y2) {
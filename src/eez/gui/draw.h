@@ -33,7 +33,7 @@ void drawMultilineText(const char *text, int x, int y, int w, int h, const Style
 int measureMultilineText(const char *text, int x, int y, int w, int h, const Style *style, int firstLineIndent, int hangingIndent);
 void drawBitmap(Image *image, int x, int y, int w, int h, const Style *style, bool active);
 void drawRectangle(int x, int y, int w, int h, const Style *style, bool active, bool ignoreLuminocity, bool invertColors);
-void drawShadow(int x1, int y1, int x2, int y2);
+void drawShadow(int x1, int y1, int x2, int y2, const Rect *clipRect = nullptr);
 void expandRectWithShadow(int &x1, int &y1, int &x2, int &y2);
 void drawLine(int x1, int y1, int x2, int y2);
 void drawAntialiasedLine(int x1, int y1, int x2, int y2);
@@ -37,7 +37,7 @@ namespace eez {
 namespace gui {
 
 bool g_isBlinkTime;
-static bool g_wasBlinkTime;
+bool g_wasBlinkTime;
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -179,6 +179,14 @@ void sendMessageToGuiThread(uint8_t messageType, uint32_t messageParam, uint32_t
 
 #endif
 
+bool isGuiThread() {
+#if OPTION_GUI_THREAD
+    return osThreadGetId() == g_guiTaskHandle;
+#else
+    return true;
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 bool isPageInternal(int pageId) {
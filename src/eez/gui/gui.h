@@ -77,9 +77,12 @@ void onGuiQueueMessageHook(uint8_t type, int16_t param);
 
 #endif
 
+bool isGuiThread();
+
 ////////////////////////////////////////////////////////////////////////////////
 
 extern bool g_isBlinkTime;
+extern bool g_wasBlinkTime;
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -156,6 +159,10 @@ float getDefaultAnimationDurationHook();
 void executeExternalActionHook(int32_t actionId);
 void externalDataHook(int16_t id, DataOperationEnum operation, Cursor cursor, Value &value);
 
+// Returns the counter which is incremented every time the value of the data can change,
+// or nullptr if the data is not versioned, i.e. it can change at any time.
+const uint32_t *getDataVersionHook(int16_t id);
+
 OnTouchFunctionType getWidgetTouchFunctionHook(const WidgetCursor &widgetCursor);
 
 ////////////////////////////////////////////////////////////////////////////////
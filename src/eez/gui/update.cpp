@@ -18,9 +18,13 @@
 
 #if OPTION_DISPLAY
 
+#include <string.h>
+
 #include <eez/debug.h>
+#include <eez/system.h>
 
 #include <eez/gui/gui.h>
+#include <eez/gui/widgets/container.h>
 
 namespace eez {
 namespace gui {
@@ -29,6 +33,11 @@ static uint8_t g_stateBuffer[2][CONF_MAX_STATE_SIZE];
 static WidgetState *g_previousState;
 static WidgetState *g_currentState;
 
+static UpdateScreenStatistics g_statistics;
+static uint32_t g_numSkippedSubtrees;
+static uint32_t g_numSkippedWidgets;
+static uint32_t g_numDrawnWidgets;
+
 int getCurrentStateBufferIndex() {
     return (uint8_t *)g_currentState == &g_stateBuffer[0][0] ? 0 : 1;
 }
@@ -39,9 +48,15 @@ uint32_t getCurrentStateBufferSize(const WidgetCursor &widgetCursor) {
 
 void refreshScreen() {
     g_currentState = 0;
+    invalidateSkippableSubtrees();
 }
 
 void updateScreen() {
+    uint32_t startTime = micros();
+    g_numSkippedSubtrees = 0;
+    g_numSkippedWidgets = 0;
+    g_numDrawnWidgets = 0;
+
     g_isActiveWidget = false;
     g_previousState = g_currentState;
     g_currentState = (WidgetState *)(&g_stateBuffer[getCurrentStateBufferIndex() == 0 ? 1 : 0][0]);
@@ -52,6 +67,41 @@ void updateScreen() {
 	widgetCursor.currentState = g_currentState;
 
     widgetCursor.appContext->updateAppView(widgetCursor);
+
+    uint32_t frameTime = micros() - startTime;
+    g_statistics.lastFrameTime = frameTime;
+    if (frameTime > g_statistics.maxFrameTime) {
+        g_statistics.maxFrameTime = frameTime;
+    }
+    // exponential moving average, weight of the last frame is 1/16
+    if (g_statistics.numFrames == 0) {
+        g_statistics.avgFrameTime = frameTime;
+    } else {
+        g_statistics.avgFrameTime = (15 * g_statistics.avgFrameTime + frameTime) / 16;
+    }
+    g_statistics.numFrames++;
+    g_statistics.numSkippedSubtrees = g_numSkippedSubtrees;
+    g_statistics.numSkippedWidgets = g_numSkippedWidgets;
+    g_statistics.numDrawnWidgets = g_numDrawnWidgets;
+    uint32_t numWidgets = g_numSkippedWidgets + g_numDrawnWidgets;
+    g_statistics.skipRate = numWidgets > 0 ? 100 * g_numSkippedWidgets / numWidgets : 0;
+}
+
+void onSubtreeSkipped(uint32_t numWidgets) {
+    g_numSkippedSubtrees++;
+    g_numSkippedWidgets += numWidgets;
+}
+
+void onWidgetDrawn() {
+    g_numDrawnWidgets++;
+}
+
+void getUpdateScreenStatistics(UpdateScreenStatistics &statistics) {
+    statistics = g_statistics;
+}
+
+void resetUpdateScreenStatistics() {
+    memset(&g_statistics, 0, sizeof(g_statistics));
 }
 
 } // namespace gui
@@ -18,10 +18,32 @@
 
 #pragma once
 
+#include <stdint.h>
+
 namespace eez {
 namespace gui {
 
 void updateScreen();
 
+struct UpdateScreenStatistics {
+    uint32_t numFrames;
+    uint32_t lastFrameTime; // in microseconds
+    uint32_t maxFrameTime;
+    uint32_t avgFrameTime;
+    uint32_t numSkippedSubtrees; // in the last frame
+    uint32_t numSkippedWidgets; // in the last frame
+    uint32_t numDrawnWidgets; // in the last frame
+    uint32_t skipRate; // percentage of the skipped widgets in the last frame
+};
+
+void getUpdateScreenStatistics(UpdateScreenStatistics &statistics);
+void resetUpdateScreenStatistics();
+
+// called by the container widget when it reuses previous state of the skippable subtree
+void onSubtreeSkipped(uint32_t numWidgets);
+
+// called for every widget which is not skipped
+void onWidgetDrawn();
+
 } // namespace gui
 } // namespace eez
\ No newline at end of file
@@ -117,6 +117,8 @@ void drawWidgetCallback(const WidgetCursor &widgetCursor_) {
 
     widgetCursor.currentState->flags.active = g_isActiveWidget;
 
+    onWidgetDrawn();
+
     const Widget *widget = widgetCursor.widget;
     if (*g_drawWidgetFunctions[widget->type]) {
         (*g_drawWidgetFunctions[widget->type])(widgetCursor);
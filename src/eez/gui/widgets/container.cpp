@@ -18,11 +18,14 @@
 
 #if OPTION_DISPLAY
 
+#include <string.h>
+
 #include <eez/system.h>
 #include <eez/debug.h>
 
 #include <eez/gui/gui.h>
 #include <eez/gui/widgets/container.h>
+#include <eez/gui/widgets/display_data.h>
 #include <eez/gui/widgets/layout_view.h>
 
 namespace eez {
@@ -39,6 +42,155 @@ FixPointersFunctionType CONTAINER_fixPointers = [](Widget *widget, Assets *asset
     WidgetList_fixPointers(containerWidget->widgets);
 };
 
+////////////////////////////////////////////////////////////////////////////////
+
+// Skippable subtree is a non-overlay container with only rectangles, bitmaps, texts,
+// display data and other skippable containers inside, all with the non-blinking
+// style, where every data used inside is versioned (see getDataVersionHook).
+// Nothing inside such subtree can change while the versions of its data stay the
+// same and nothing is touched, so the previous state of the whole subtree can be
+// reused and its drawing skipped.
+
+static const int SKIPPABLE_SUBTREE_CACHE_SIZE = 64;
+static const int SKIPPABLE_SUBTREE_MAX_DATA = 8;
+
+struct SkippableSubtreeCacheEntry {
+    const Widget *widget;
+    uint16_t numWidgets; // 0 if not skippable
+    uint16_t stateSize;
+    uint8_t numDataVersions;
+    const uint32_t *dataVersions[SKIPPABLE_SUBTREE_MAX_DATA];
+};
+
+static SkippableSubtreeCacheEntry g_skippableSubtreeCache[SKIPPABLE_SUBTREE_CACHE_SIZE];
+
+static bool addDataVersion(SkippableSubtreeCacheEntry &entry, int16_t dataId) {
+    const uint32_t *dataVersion = getDataVersionHook(dataId);
+    if (!dataVersion) {
+        return false;
+    }
+
+    for (int i = 0; i < entry.numDataVersions; i++) {
+        if (entry.dataVersions[i] == dataVersion) {
+            return true;
+        }
+    }
+
+    if (entry.numDataVersions == SKIPPABLE_SUBTREE_MAX_DATA) {
+        return false;
+    }
+
+    entry.dataVersions[entry.numDataVersions++] = dataVersion;
+    return true;
+}
+
+static bool getSkippableSubtreeInfo(const Widget *widget, SkippableSubtreeCacheEntry &entry, uint16_t &numWidgets, uint16_t &stateSize) {
+    const ContainerWidget *containerWidget = GET_WIDGET_PROPERTY(widget, specific, const ContainerWidget *);
+    if (containerWidget->overlay || widget->data) {
+        return false;
+    }
+
+    numWidgets = 0;
+    stateSize = sizeof(ContainerWidgetState);
+
+    for (uint32_t index = 0; index < containerWidget->widgets.count; ++index) {
+        const Widget *childWidget = GET_WIDGET_LIST_ELEMENT(containerWidget->widgets, index);
+
+        if (childWidget->type == WIDGET_TYPE_CONTAINER) {
+            uint16_t childNumWidgets;
+            uint16_t childStateSize;
+            if (!getSkippableSubtreeInfo(childWidget, entry, childNumWidgets, childStateSize)) {
+                return false;
+            }
+            numWidgets += childNumWidgets + 1;
+            stateSize += childStateSize;
+        } else if (
+            childWidget->type == WIDGET_TYPE_TEXT ||
+            childWidget->type == WIDGET_TYPE_DISPLAY_DATA ||
+            childWidget->type == WIDGET_TYPE_RECTANGLE ||
+            childWidget->type == WIDGET_TYPE_BITMAP
+        ) {
+            if (styleIsBlink(getStyle(childWidget->style))) {
+                return false;
+            }
+            if (childWidget->data && !addDataVersion(entry, childWidget->data)) {
+                return false;
+            }
+            numWidgets++;
+            stateSize += childWidget->type == WIDGET_TYPE_DISPLAY_DATA ? sizeof(DisplayDataState) : sizeof(WidgetState);
+        } else {
+            return false;
+        }
+    }
+
+    return numWidgets > 0;
+}
+
+static SkippableSubtreeCacheEntry &getSkippableSubtreeCacheEntry(const Widget *widget) {
+    auto &entry = g_skippableSubtreeCache[(((uintptr_t)widget) >> 2) % SKIPPABLE_SUBTREE_CACHE_SIZE];
+    if (entry.widget != widget) {
+        entry.widget = widget;
+        entry.numDataVersions = 0;
+        if (!getSkippableSubtreeInfo(widget, entry, entry.numWidgets, entry.stateSize)) {
+            entry.numWidgets = 0;
+            entry.stateSize = 0;
+        }
+    }
+    return entry;
+}
+
+void invalidateSkippableSubtrees() {
+    memset(g_skippableSubtreeCache, 0, sizeof(g_skippableSubtreeCache));
+}
+
+static bool skipSubtree(WidgetCursor &widgetCursor, EnumWidgetsCallback callback) {
+    auto currentState = widgetCursor.currentState;
+    auto previousState = widgetCursor.previousState;
+    if (callback != drawWidgetCallback || !currentState) {
+        return false;
+    }
+
+    // widgets active flag is following the touch point, so the subtree drawn while
+    // touched must not be reused in the next frame
+    if (touch::getEventType() != EVENT_TYPE_TOUCH_NONE) {
+        currentState->data = Value();
+        return false;
+    }
+
+    auto &entry = getSkippableSubtreeCacheEntry(widgetCursor.widget);
+    if (entry.numWidgets == 0) {
+        return false;
+    }
+
+    // sum of the data versions is remembered in the otherwise unused container data
+    uint32_t dataVersion = 0;
+    for (int i = 0; i < entry.numDataVersions; i++) {
+        dataVersion += *entry.dataVersions[i];
+    }
+    currentState->data = Value(dataVersion, VALUE_TYPE_UINT32);
+
+    if (
+        !previousState ||
+        previousState->size != entry.stateSize ||
+        previousState->flags.active != currentState->flags.active ||
+        previousState->data != currentState->data ||
+        // data inside can blink
+        g_isBlinkTime != g_wasBlinkTime
+    ) {
+        return false;
+    }
+
+    // previous state of the children is still valid and already drawn
+    memcpy(((ContainerWidgetState *)currentState) + 1, ((ContainerWidgetState *)previousState) + 1, entry.stateSize - sizeof(ContainerWidgetState));
+    currentState->size = entry.stateSize;
+
+    onSubtreeSkipped(entry.numWidgets);
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 void enumContainer(WidgetCursor &widgetCursor, EnumWidgetsCallback callback, const WidgetList &widgets) {
     auto savedCurrentState = widgetCursor.currentState;
 	auto savedPreviousState = widgetCursor.previousState;
@@ -152,6 +304,8 @@ EnumFunctionType CONTAINER_enum = [](WidgetCursor &widgetCursor, EnumWidgetsCall
             }
             return;
         }
+    } else if (skipSubtree(widgetCursor, callback)) {
+        return;
     }
 
     const ContainerWidget *containerWidget = GET_WIDGET_PROPERTY(widgetCursor.widget, specific, const ContainerWidget *);
@@ -29,5 +29,9 @@ struct ContainerWidget {
 
 void enumContainer(WidgetCursor &widgetCursor, EnumWidgetsCallback callback, const WidgetList &widgets);
 
+// Forget which containers are known to have a skippable subtree,
+// must be called when assets are changed.
+void invalidateSkippableSubtrees();
+
 } // namespace gui
 } // namespace eez
\ No newline at end of file
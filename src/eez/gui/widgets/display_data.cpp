@@ -24,6 +24,7 @@
 #include <eez/util.h>
 
 #include <eez/gui/gui.h>
+#include <eez/gui/widgets/display_data.h>
 
 #define CONF_GUI_TEXT_CURSOR_BLINK_TIME_MS 500
 
@@ -43,17 +44,6 @@ struct DisplayDataWidget {
     uint8_t displayOption;
 };
 
-struct DisplayDataState {
-    WidgetState genericState;
-    uint16_t color;
-    uint16_t backgroundColor;
-    uint16_t activeColor;
-    uint16_t activeBackgroundColor;
-    uint32_t dataRefreshLastTime;
-    int16_t cursorPosition;
-    uint8_t xScroll;
-};
-
 FixPointersFunctionType DISPLAY_DATA_fixPointers = nullptr;
 
 EnumFunctionType DISPLAY_DATA_enum = nullptr;
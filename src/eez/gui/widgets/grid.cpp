@@ -62,11 +62,12 @@ EnumFunctionType GRID_enum = [](WidgetCursor &widgetCursor, EnumWidgetsCallback
 
     int startPosition = ytDataGetPosition(((WidgetCursor &)widgetCursor).cursor, widgetCursor.widget->data);
 
-    // refresh when startPosition changes
-    if (widgetCursor.currentState) {
-		widgetCursor.currentState->data = startPosition;
+    // refresh when startPosition changes, it is remembered in the state of the
+    // grid itself, the state of the first item is already used by the item
+    if (savedCurrentState) {
+		savedCurrentState->data = startPosition;
 
-        if (widgetCursor.previousState && widgetCursor.previousState->data != widgetCursor.currentState->data) {
+        if (savedPreviousState && savedPreviousState->data != savedCurrentState->data) {
             widgetCursor.previousState = 0;
         }
     }
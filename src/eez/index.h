@@ -198,6 +198,10 @@ struct Module {
     char label[SLOT_LABEL_MAX_LENGTH + 1] = { 0 };
     uint8_t color = 0;
 
+    // Increase when the layout of the module (or power channel) profile parameters changes,
+    // binary profile sections stored with the other version are not used.
+    uint16_t profileParametersVersion = 1;
+
     virtual void setEnabled(bool value);
 
     virtual Module *createModule() = 0;
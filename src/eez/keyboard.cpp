@@ -162,7 +162,7 @@ void onKeyboardEvent(USBH_HandleTypeDef *phost) {
 }
 #endif
 
-#if defined(EEZ_PLATFORM_SIMULATOR)
+#if defined(EEZ_PLATFORM_SIMULATOR) && !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
 void onKeyboardEvent(SDL_KeyboardEvent *key) {
     uint8_t mod = 
         (key->keysym.mod & KMOD_LCTRL ? KEY_MOD_LCTRL : 0) |
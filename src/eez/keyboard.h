@@ -24,7 +24,7 @@
 #include <usbh_hid.h>
 #endif
 
-#if defined(EEZ_PLATFORM_SIMULATOR)
+#if defined(EEZ_PLATFORM_SIMULATOR) && !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
 #include <SDL.h>
 #endif
 
@@ -42,7 +42,7 @@ void onKeyDown(uint16_t param);
 void onKeyboardEvent(USBH_HandleTypeDef *phost);
 #endif
 
-#if defined(EEZ_PLATFORM_SIMULATOR)
+#if defined(EEZ_PLATFORM_SIMULATOR) && !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
 void onKeyboardEvent(SDL_KeyboardEvent *key);
 #endif
 
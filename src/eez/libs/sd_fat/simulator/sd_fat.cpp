@@ -299,13 +299,16 @@ bool File::open(const char *path, uint8_t mode) {
 
     if (mode == (FILE_OPEN_EXISTING | FILE_READ)) {
         fmode = "rb";
-    } else if (mode == (FILE_OPEN_ALWAYS | FILE_WRITE)) {
+    } else if (mode == (FILE_OPEN_EXISTING | FILE_WRITE) || mode == (FILE_OPEN_EXISTING | FILE_READ | FILE_WRITE)) {
+        fmode = "r+b";
+    } else if (mode == (FILE_OPEN_ALWAYS | FILE_WRITE) || mode == (FILE_OPEN_ALWAYS | FILE_READ | FILE_WRITE)) {
         fmode = "r+b";
         m_fp = fopen(getRealPath(path).c_str(), fmode);
         if (m_fp) {
+            m_isOpen = true;
             return true;
         }
-        fmode = "wb";
+        fmode = "w+b";
     } else if (mode == (FILE_OPEN_APPEND | FILE_WRITE)) {
         fmode = "ab";
     } else if (mode == (FILE_CREATE_ALWAYS | FILE_WRITE)) {
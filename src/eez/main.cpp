@@ -18,6 +18,7 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 #if defined(EEZ_PLATFORM_STM32)
 #include <main.h>
@@ -144,6 +145,16 @@ int main(int argc, char **argv) {
 
     osKernelStart();
 
+#if defined(EEZ_PLATFORM_SIMULATOR)
+    // enabled after osKernelStart, which registers this thread, so that the
+    // virtual time doesn't advance while this thread is still running
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--virtual-time") == 0) {
+            osKernelSetVirtualTime(true);
+        }
+    }
+#endif
+
 #if defined(EEZ_PLATFORM_SIMULATOR)
     while (!eez::g_shutdown) {
 #else
@@ -250,7 +261,9 @@ void consoleInputTask(const void *) {
     sendMessageToLowPriorityThread(SERIAL_LINE_STATE_CHANGED, 1);
 
     while (1) {
+        osThreadEnterExternalWait();
         int ch = getchar();
+        osThreadExitExternalWait();
         if (ch == EOF) {
             break;
         }
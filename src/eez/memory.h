@@ -46,7 +46,15 @@ static const uint32_t DECOMPRESSED_ASSETS_SIZE = 8 * 1024 * 1024;
 static uint8_t * const DLOG_RECORD_BUFFER = DECOMPRESSED_ASSETS_START_ADDRESS + DECOMPRESSED_ASSETS_SIZE;
 static const uint32_t DLOG_RECORD_BUFFER_SIZE = 128 * 1024;
 
-static uint8_t * const FILE_VIEW_BUFFER = DLOG_RECORD_BUFFER + DLOG_RECORD_BUFFER_SIZE;
+// used for DLOG V3 frames compression (LZ4 state, frame data and compressed frame)
+static uint8_t * const DLOG_RECORD_FRAME_BUFFER = DLOG_RECORD_BUFFER + DLOG_RECORD_BUFFER_SIZE;
+static const uint32_t DLOG_RECORD_FRAME_BUFFER_SIZE = 80 * 1024;
+
+// used for DLOG V3 frames decompression (compressed frame and frame data)
+static uint8_t * const DLOG_VIEW_FRAME_BUFFER = DLOG_RECORD_FRAME_BUFFER + DLOG_RECORD_FRAME_BUFFER_SIZE;
+static const uint32_t DLOG_VIEW_FRAME_BUFFER_SIZE = 64 * 1024;
+
+static uint8_t * const FILE_VIEW_BUFFER = DLOG_VIEW_FRAME_BUFFER + DLOG_VIEW_FRAME_BUFFER_SIZE;
 #if defined(EEZ_PLATFORM_STM32)
 static const uint32_t FILE_VIEW_BUFFER_SIZE = 1024 * 1024;
 #endif
@@ -105,4 +113,9 @@ static uint8_t * const VRAM_AUX_BUFFER6_START_ADDRESS = VRAM_AUX_BUFFER5_START_A
 
 static uint8_t * const VRAM_AUX_BUFFER7_START_ADDRESS = VRAM_AUX_BUFFER6_START_ADDRESS + VRAM_BUFFER_SIZE;
 
-static uint8_t * const MEMORY_END = VRAM_AUX_BUFFER7_START_ADDRESS + VRAM_BUFFER_SIZE;
+// used by MMEM:DOWNload and MMEM:UPLoad?, first half is for download and second half for upload
+static uint8_t * const SD_CARD_TRANSFER_BUFFER = VRAM_AUX_BUFFER7_START_ADDRESS + VRAM_BUFFER_SIZE;
+static const uint32_t SD_CARD_TRANSFER_BLOCK_SIZE = 32 * 1024; // the usual FAT32 cluster size
+static const uint32_t SD_CARD_TRANSFER_BUFFER_SIZE = 2 * SD_CARD_TRANSFER_BLOCK_SIZE;
+
+static uint8_t * const MEMORY_END = SD_CARD_TRANSFER_BUFFER + SD_CARD_TRANSFER_BUFFER_SIZE;
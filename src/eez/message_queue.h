@@ -0,0 +1,219 @@
+/*
+ * EEZ Modular Firmware
+ * Copyright (C) 2015-present, Envox d.o.o.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <string.h>
+
+#include <eez/system.h>
+
+namespace eez {
+
+struct MessageQueueStatistics {
+    uint32_t capacity;
+    uint32_t numWaiting;
+    uint32_t highWaterMark;
+    uint32_t numPut;
+    uint32_t numStalled; // put had to wait because the queue was full
+    uint32_t numDropped; // queue was full until the timeout
+};
+
+// Fixed capacity, lock free message queue (bounded queue by Dmitry Vyukov).
+// Any number of producers, including interrupt handlers, can put messages
+// and consumer waits on semaphore which is released after every put,
+// so it is woken up immediately instead of polling the queue.
+// Several queues can share the semaphore, then consumer checks all of them
+// with tryGet and calls wait only when all are empty.
+// CAPACITY must be power of 2.
+template <typename T, uint32_t CAPACITY>
+class MessageQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be power of 2");
+
+public:
+    MessageQueue() : m_semaphore(nullptr) {
+        memset(&m_semaphoreDef, 0, sizeof(m_semaphoreDef));
+        for (uint32_t i = 0; i < CAPACITY; i++) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_enqueuePos.store(0, std::memory_order_relaxed);
+        m_dequeuePos.store(0, std::memory_order_relaxed);
+        resetStatistics();
+    }
+
+    void init() {
+        m_semaphore = osSemaphoreCreate(&m_semaphoreDef, 1);
+    }
+
+    void init(osSemaphoreId semaphore) {
+        m_semaphore = semaphore;
+    }
+
+    osSemaphoreId getSemaphore() {
+        return m_semaphore;
+    }
+
+    bool isInitialized() {
+        return m_semaphore != nullptr;
+    }
+
+    // If queue is full, waits at most timeoutMillisec for the free slot.
+    // Use timeoutMillisec 0 from the interrupt handler or the consumer thread.
+    bool put(const T &message, uint32_t timeoutMillisec) {
+        if (!tryPut(message)) {
+            m_numStalled.fetch_add(1, std::memory_order_relaxed);
+
+            do {
+                if (timeoutMillisec == 0) {
+                    m_numDropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+
+                osDelay(1);
+
+                if (timeoutMillisec != osWaitForever) {
+                    timeoutMillisec--;
+                }
+            } while (!tryPut(message));
+        }
+
+        m_numPut.fetch_add(1, std::memory_order_relaxed);
+
+        updateHighWaterMark();
+
+        osSemaphoreRelease(m_semaphore);
+
+        return true;
+    }
+
+    // Waits at most timeoutMillisec for the message.
+    bool get(T &message, uint32_t timeoutMillisec) {
+        while (!tryGet(message)) {
+            if (osSemaphoreWait(m_semaphore, timeoutMillisec) != osOK) {
+                return tryGet(message);
+            }
+        }
+        return true;
+    }
+
+    // Doesn't wait, use it when semaphore is shared with other queues.
+    bool tryGet(T &message) {
+        Cell *cell;
+        uint32_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &m_cells[pos & MASK];
+            uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(sequence - (pos + 1));
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // empty
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        message = cell->data;
+        cell->sequence.store(pos + MASK + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Waits at most timeoutMillisec for the put into this or any other queue sharing the semaphore.
+    bool wait(uint32_t timeoutMillisec) {
+        return osSemaphoreWait(m_semaphore, timeoutMillisec) == osOK;
+    }
+
+    uint32_t getNumWaiting() {
+        // dequeue position is read first, so it can't be ahead of the enqueue position
+        uint32_t dequeuePos = m_dequeuePos.load(std::memory_order_acquire);
+        return m_enqueuePos.load(std::memory_order_acquire) - dequeuePos;
+    }
+
+    void getStatistics(MessageQueueStatistics &statistics) {
+        statistics.capacity = CAPACITY;
+        statistics.numWaiting = getNumWaiting();
+        statistics.highWaterMark = m_highWaterMark.load(std::memory_order_relaxed);
+        statistics.numPut = m_numPut.load(std::memory_order_relaxed);
+        statistics.numStalled = m_numStalled.load(std::memory_order_relaxed);
+        statistics.numDropped = m_numDropped.load(std::memory_order_relaxed);
+    }
+
+    void resetStatistics() {
+        m_highWaterMark.store(0, std::memory_order_relaxed);
+        m_numPut.store(0, std::memory_order_relaxed);
+        m_numStalled.store(0, std::memory_order_relaxed);
+        m_numDropped.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static const uint32_t MASK = CAPACITY - 1;
+
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        T data;
+    };
+
+    Cell m_cells[CAPACITY];
+    std::atomic<uint32_t> m_enqueuePos;
+    std::atomic<uint32_t> m_dequeuePos;
+
+    osSemaphoreDef_t m_semaphoreDef;
+    osSemaphoreId m_semaphore;
+
+    std::atomic<uint32_t> m_highWaterMark;
+    std::atomic<uint32_t> m_numPut;
+    std::atomic<uint32_t> m_numStalled;
+    std::atomic<uint32_t> m_numDropped;
+
+    bool tryPut(const T &message) {
+        Cell *cell;
+        uint32_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &m_cells[pos & MASK];
+            uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+            int32_t diff = (int32_t)(sequence - pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; // full
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = message;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    void updateHighWaterMark() {
+        uint32_t numWaiting = getNumWaiting();
+        uint32_t highWaterMark = m_highWaterMark.load(std::memory_order_relaxed);
+        while (numWaiting > highWaterMark && !m_highWaterMark.compare_exchange_weak(highWaterMark, numWaiting, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+} // namespace eez
@@ -500,6 +500,8 @@ void uploadHexFile() {
 		while (!eofReached && readHexRecord(bufferedFile, hexRecord)) {
 			size_t currentPosition = file.tell();
 
+			yieldLowPriorityThread();
+
 	#if OPTION_DISPLAY
 			psu::gui::updateProgressPage(currentPosition, totalSize);
 	#endif
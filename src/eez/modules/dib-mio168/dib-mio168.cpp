@@ -49,6 +49,7 @@
 #include "eez/modules/psu/gui/labels_and_colors.h"
 #include "eez/modules/psu/gui/edit_mode.h"
 #include "eez/modules/psu/gui/animations.h"
+#include "eez/modules/psu/gui/data.h"
 #include <eez/modules/bp3c/comm.h>
 #include <eez/modules/bp3c/flash_slave.h>
 
@@ -1520,14 +1521,23 @@ public:
 
 			auto &data = response.getState;
 
+            bool changed = dinChannel.m_pinStates != data.dinStates || ainFaultStatus != data.ainFaultStatus;
+
             dinChannel.m_pinStates = data.dinStates;
 
             for (int i = 0; i < 4; i++) {
                 auto &channel = ainChannels[i];
+                if (channel.m_value != data.ainValues[i]) {
+                    changed = true;
+                }
                 channel.addValue(data.ainValues[i]);
             }
             ainFaultStatus = data.ainFaultStatus;
 
+            if (changed) {
+                incrementDataVersions(DATA_VERSION_SOURCE_SLOT);
+            }
+
             if (data.flags & GET_STATE_COMMAND_FLAG_SD_CARD_PRESENT) {
                 if (!fs_driver::isDriverLinked(slotIndex)) {
                     sendMessageToLowPriorityThread(THREAD_MESSAGE_FS_DRIVER_LINK, slotIndex, 0);
@@ -1923,6 +1933,8 @@ public:
                         response->getInfo.afeVersion = 1;
                     } else if (currentCommand->command == COMMAND_GET_STATE) {
                         response->getState.flags |= GET_STATE_COMMAND_FLAG_SD_CARD_PRESENT;
+                    } else if (currentCommand->command == COMMAND_SET_PARAMS) {
+                        response->setParams.result = 1;
                     }
 
                     stateTransition(EVENT_DMA_TRANSFER_COMPLETED);
@@ -1963,6 +1975,8 @@ public:
                     SetParams params;
                     fillSetParams(params);
                     if (memcmp(&params, &lastTransferredParams, sizeof(SetParams)) != 0) {
+                        // ranges, modes and output states shown by the GUI are changed
+                        incrementDataVersions(DATA_VERSION_SOURCE_SLOT);
                         executeCommand(&setParams_command);
                     }
                 }
@@ -2128,6 +2142,8 @@ public:
         }
 
         selectedPage = parameters->selectedPage;
+
+        incrementDataVersions(DATA_VERSION_SOURCE_SLOT);
     }
     
     bool writeProfileProperties(psu::profile::WriteContext &ctx, const uint8_t *buffer) override {
@@ -2227,6 +2243,8 @@ public:
         }
 
         selectedPage = 0;
+
+        incrementDataVersions(DATA_VERSION_SOURCE_SLOT);
     }
 
     size_t getChannelLabelMaxLength(int subchannelIndex) override {
@@ -2317,6 +2335,8 @@ public:
     }
 
     eez_err_t setChannelLabel(int subchannelIndex, const char *label, int length) override {
+        incrementDataVersions(DATA_VERSION_SOURCE_SLOT);
+
         if (subchannelIndex == DIN_SUBCHANNEL_INDEX) {
             if (length != -1) {
                 return SCPI_ERROR_HARDWARE_MISSING;
@@ -2395,6 +2415,8 @@ public:
     }
 
     eez_err_t setChannelPinLabel(int subchannelIndex, int pin, const char *label, int length) override {
+        incrementDataVersions(DATA_VERSION_SOURCE_SLOT);
+
         if (subchannelIndex == DIN_SUBCHANNEL_INDEX || subchannelIndex == DOUT_SUBCHANNEL_INDEX) {
             if (pin >= 1 && pin <= 8) {
                 if (length == -1) {
@@ -282,67 +282,141 @@ uint8_t getOpacity() {
     return g_opacity;
 }
 
-// static int g_prevDirtyX1;
-// static int g_prevDirtyY1;
-// static int g_prevDirtyX2;
-// static int g_prevDirtyY2;
+// Display buffers are swapped after each frame, so the area that has to be
+// composed is the union of the area changed in this frame (next) and the area
+// changed in the previous frame (prev), which is missing in the other buffer.
+static DirtyRects g_prevDirtyRects;
+static DirtyRects g_nextDirtyRects;
+static DirtyRects g_dirtyRects;
 
-// static int g_nextDirtyX1 = getDisplayWidth();
-// static int g_nextDirtyY1 = getDisplayHeight();
-// static int g_nextDirtyX2 = -1;
-// static int g_nextDirtyY2 = -1;
+// while composing buffers, drawing is done to the display buffer directly
+static bool g_composing;
 
-// static int g_dirtyX1;
-// static int g_dirtyY1;
-// static int g_dirtyX2;
-// static int g_dirtyY2;
+static int g_selectedBufferIndex = -1;
 
-bool g_dirty;
+static int getDirtyRectArea(int x1, int y1, int x2, int y2) {
+    return (x2 - x1 + 1) * (y2 - y1 + 1);
+}
+
+static void addDirtyRect(DirtyRects &dirtyRects, int x1, int y1, int x2, int y2) {
+    if (x1 < 0) {
+        x1 = 0;
+    }
+    if (y1 < 0) {
+        y1 = 0;
+    }
+    if (x2 > getDisplayWidth() - 1) {
+        x2 = getDisplayWidth() - 1;
+    }
+    if (y2 > getDisplayHeight() - 1) {
+        y2 = getDisplayHeight() - 1;
+    }
+    if (x1 > x2 || y1 > y2) {
+        return;
+    }
+
+    // merge with all the touching or overlapping rects,
+    // repeat until there is nothing more to merge
+    for (int i = 0; i < dirtyRects.count; ) {
+        DirtyRect &rect = dirtyRects.rects[i];
+
+        if (x1 >= rect.x1 && y1 >= rect.y1 && x2 <= rect.x2 && y2 <= rect.y2) {
+            // already contained
+            return;
+        }
+
+        if (x1 <= rect.x2 + 1 && rect.x1 <= x2 + 1 && y1 <= rect.y2 + 1 && rect.y1 <= y2 + 1) {
+            x1 = MIN(x1, rect.x1);
+            y1 = MIN(y1, rect.y1);
+            x2 = MAX(x2, rect.x2);
+            y2 = MAX(y2, rect.y2);
+
+            dirtyRects.rects[i] = dirtyRects.rects[--dirtyRects.count];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+
+    if (dirtyRects.count == MAX_NUM_DIRTY_RECTS) {
+        // no more room, merge with the rect which grows the least
+        int bestIndex = 0;
+        int bestGrowth = 0;
+        for (int i = 0; i < dirtyRects.count; i++) {
+            DirtyRect &rect = dirtyRects.rects[i];
+            int growth =
+                getDirtyRectArea(MIN(x1, rect.x1), MIN(y1, rect.y1), MAX(x2, rect.x2), MAX(y2, rect.y2)) -
+                getDirtyRectArea(rect.x1, rect.y1, rect.x2, rect.y2);
+            if (i == 0 || growth < bestGrowth) {
+                bestIndex = i;
+                bestGrowth = growth;
+            }
+        }
+
+        DirtyRect rect = dirtyRects.rects[bestIndex];
+        dirtyRects.rects[bestIndex] = dirtyRects.rects[--dirtyRects.count];
+
+        // merged rect can now touch some other rect
+        addDirtyRect(dirtyRects, MIN(x1, rect.x1), MIN(y1, rect.y1), MAX(x2, rect.x2), MAX(y2, rect.y2));
+        return;
+    }
+
+    DirtyRect &rect = dirtyRects.rects[dirtyRects.count++];
+    rect.x1 = x1;
+    rect.y1 = y1;
+    rect.x2 = x2;
+    rect.y2 = y2;
+}
 
 void clearDirty() {
-    g_dirty = false;
-
-    // g_prevDirtyX1 = g_nextDirtyX1;
-    // g_prevDirtyY1 = g_nextDirtyY1;
-    // g_prevDirtyX2 = g_nextDirtyX2;
-    // g_prevDirtyY2 = g_nextDirtyY2;
-
-    // g_nextDirtyX1 = getDisplayWidth();
-    // g_nextDirtyY1 = getDisplayHeight();
-    // g_nextDirtyX2 = -1;
-    // g_nextDirtyY2 = -1;
-}
-
-// void markDirty(int x1, int y1, int x2, int y2) {
-//     if (x1 < g_nextDirtyX1) {
-//         g_nextDirtyX1 = x1;
-//     }
-//     if (y1 < g_nextDirtyY1) {
-//         g_nextDirtyY1 = y1;
-//     }
-//     if (x2 > g_nextDirtyX2) {
-//         g_nextDirtyX2 = x2;
-//     }
-//     if (y2 > g_nextDirtyY2) {
-//         g_nextDirtyY2 = y2;
-//     }
-// }
+    g_prevDirtyRects = g_nextDirtyRects;
+    g_nextDirtyRects.count = 0;
+}
+
+void markDirty(int x1, int y1, int x2, int y2) {
+    if (g_composing) {
+        return;
+    }
+
+    if (g_selectedBufferIndex != -1) {
+        // translate from the buffer to the display coordinates
+        Buffer &buffer = g_buffers[g_selectedBufferIndex];
+        x1 += buffer.xOffset;
+        y1 += buffer.yOffset;
+        x2 += buffer.xOffset;
+        y2 += buffer.yOffset;
+    }
+
+    addDirtyRect(g_nextDirtyRects, x1, y1, x2, y2);
+}
+
+void markDirtyAll() {
+    g_nextDirtyRects.count = 0;
+    addDirtyRect(g_nextDirtyRects, 0, 0, getDisplayWidth() - 1, getDisplayHeight() - 1);
+}
 
 bool isDirty() {
-    // g_dirtyX1 = MIN(g_prevDirtyX1, g_nextDirtyX1);
-    // g_dirtyY1 = MIN(g_prevDirtyY1, g_nextDirtyY1);
-    // g_dirtyX2 = MAX(g_prevDirtyX2, g_nextDirtyX2);
-    // g_dirtyY2 = MAX(g_prevDirtyY2, g_nextDirtyY2);
+    g_dirtyRects = g_nextDirtyRects;
+    for (int i = 0; i < g_prevDirtyRects.count; i++) {
+        DirtyRect &rect = g_prevDirtyRects.rects[i];
+        addDirtyRect(g_dirtyRects, rect.x1, rect.y1, rect.x2, rect.y2);
+    }
 
-    // if (g_dirtyX1 <= g_dirtyX2 && g_dirtyY1 <= g_dirtyY2) {
-    //     // char msg[50];
-    //     // sprintf(msg, "%d x %d\n", g_dirtyX2 - g_dirtyX1 + 1, g_dirtyY2 - g_dirtyY1 + 1);
-    //     // Serial.println(msg);
-    //     return true;
-    // }
+    if (g_dirtyRects.count == 0) {
+        return false;
+    }
 
-    // return false;
-    return g_dirty;
+    // mouse cursor is drawn again after the buffers are composed
+    int x1, y1, x2, y2;
+    if (mouse::getCursorRect(x1, y1, x2, y2)) {
+        addDirtyRect(g_dirtyRects, x1, y1, x2, y2);
+    }
+
+    return true;
+}
+
+const DirtyRects &getDirtyRects() {
+    return g_dirtyRects;
 }
 
 void drawFocusFrame(int x, int y, int w, int h) {
@@ -379,9 +453,67 @@ void fillRoundedRect(int x1, int y1, int x2, int y2, int r) {
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Glyph lookups and measured string widths are cached, but only in the GUI
+// thread. Other threads (for example event queue) use fonts directly.
+
+static const int GLYPH_CACHE_SIZE = 256;
+
+struct GlyphCacheEntry {
+    const uint8_t *fontData;
+    uint8_t encoding;
+    gui::font::Glyph glyph;
+};
+
+static GlyphCacheEntry g_glyphCache[GLYPH_CACHE_SIZE];
+
+static const int WIDTH_CACHE_SIZE = 32;
+static const int WIDTH_CACHE_MAX_TEXT_LENGTH = 40;
+
+struct WidthCacheEntry {
+    const uint8_t *fontData;
+    int maxWidth;
+    uint32_t hash;
+    uint32_t lastUsed;
+    int width;
+    int textLength;
+    char text[WIDTH_CACHE_MAX_TEXT_LENGTH];
+};
+
+static WidthCacheEntry g_widthCache[WIDTH_CACHE_SIZE];
+static uint32_t g_widthCacheTime;
+
+static FontCacheStatistics g_fontCacheStatistics;
+
+void getGlyph(gui::font::Font &font, uint8_t encoding, gui::font::Glyph &glyph) {
+    if (!gui::isGuiThread()) {
+        font.getGlyph(encoding, glyph);
+        return;
+    }
+
+    // direct mapped, fonts are at least 4 bytes apart
+    uint32_t index = (encoding + ((uint32_t)(uintptr_t)font.fontData >> 2) * 37) % GLYPH_CACHE_SIZE;
+    GlyphCacheEntry &entry = g_glyphCache[index];
+
+    if (entry.fontData == font.fontData && entry.encoding == encoding) {
+        g_fontCacheStatistics.glyphHits++;
+    } else {
+        g_fontCacheStatistics.glyphMisses++;
+        font.getGlyph(encoding, entry.glyph);
+        entry.fontData = font.fontData;
+        entry.encoding = encoding;
+    }
+
+    glyph = entry.glyph;
+}
+
+void getFontCacheStatistics(FontCacheStatistics &statistics) {
+    statistics = g_fontCacheStatistics;
+}
+
 static int8_t measureGlyph(uint8_t encoding) {
     gui::font::Glyph glyph;
-    g_font.getGlyph(encoding, glyph);
+    getGlyph(g_font, encoding, glyph);
     if (!glyph)
         return 0;
 
@@ -390,14 +522,14 @@ static int8_t measureGlyph(uint8_t encoding) {
 
 int8_t measureGlyph(uint8_t encoding, gui::font::Font &font) {
     gui::font::Glyph glyph;
-    font.getGlyph(encoding, glyph);
+    getGlyph(font, encoding, glyph);
     if (!glyph)
         return 0;
 
     return glyph.dx;
 }
 
-int measureStr(const char *text, int textLength, gui::font::Font &font, int max_width) {
+static int doMeasureStr(const char *text, int textLength, gui::font::Font &font, int max_width) {
     g_font = font;
 
     int width = 0;
@@ -425,6 +557,54 @@ int measureStr(const char *text, int textLength, gui::font::Font &font, int max_
     return width;
 }
 
+int measureStr(const char *text, int textLength, gui::font::Font &font, int max_width) {
+    g_font = font;
+
+    if (!gui::isGuiThread()) {
+        return doMeasureStr(text, textLength, font, max_width);
+    }
+
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    int length;
+    for (length = 0; (textLength == -1 || length < textLength) && text[length]; length++) {
+        if (length == WIDTH_CACHE_MAX_TEXT_LENGTH) {
+            return doMeasureStr(text, textLength, font, max_width);
+        }
+        hash = (hash ^ (uint8_t)text[length]) * 16777619u;
+    }
+
+    g_widthCacheTime++;
+
+    WidthCacheEntry *lruEntry = &g_widthCache[0];
+    for (int i = 0; i < WIDTH_CACHE_SIZE; i++) {
+        WidthCacheEntry &entry = g_widthCache[i];
+        if (
+            entry.hash == hash && entry.fontData == font.fontData && entry.maxWidth == max_width &&
+            entry.textLength == length && memcmp(entry.text, text, length) == 0
+        ) {
+            g_fontCacheStatistics.widthHits++;
+            entry.lastUsed = g_widthCacheTime;
+            return entry.width;
+        }
+        if (entry.lastUsed < lruEntry->lastUsed) {
+            lruEntry = &entry;
+        }
+    }
+
+    g_fontCacheStatistics.widthMisses++;
+
+    lruEntry->fontData = font.fontData;
+    lruEntry->maxWidth = max_width;
+    lruEntry->hash = hash;
+    lruEntry->lastUsed = g_widthCacheTime;
+    lruEntry->width = doMeasureStr(text, length, font, max_width);
+    lruEntry->textLength = length;
+    memcpy(lruEntry->text, text, length);
+
+    return lruEntry->width;
+}
+
 Buffer g_buffers[NUM_BUFFERS];
 
 static void *g_bufferPointer;
@@ -432,6 +612,9 @@ static void *g_bufferPointer;
 static int g_bufferToDrawIndexes[NUM_BUFFERS];
 static int g_numBuffersToDraw;
 
+static int g_lastBufferToDrawIndexes[NUM_BUFFERS];
+static int g_lastNumBuffersToDraw;
+
 //int getNumFreeBuffers() {
 //    int count = 0;
 //    for (int bufferIndex = 0; bufferIndex < NUM_BUFFERS; bufferIndex++) {
@@ -470,6 +653,7 @@ void freeBuffer(int bufferIndex) {
 void selectBuffer(int bufferIndex) {
     g_buffers[bufferIndex].flags.used = true;
     g_bufferToDrawIndexes[g_numBuffersToDraw++] = bufferIndex;
+    g_selectedBufferIndex = bufferIndex;
     setBufferPointer(g_buffers[bufferIndex].bufferPointer);
 }
 
@@ -477,6 +661,24 @@ void setBufferBounds(int bufferIndex, int x, int y, int width, int height, bool
     Buffer &buffer = g_buffers[bufferIndex];
     
     if (buffer.x != x || buffer.y != y || buffer.width != width || buffer.height != height || buffer.withShadow != withShadow || buffer.opacity != opacity || buffer.xOffset != xOffset || buffer.yOffset != yOffset || backdrop != buffer.backdrop) {
+        // mark the old area
+        if (buffer.width > 0 && buffer.height > 0) {
+            int x1 = buffer.x + buffer.xOffset;
+            int y1 = buffer.y + buffer.yOffset;
+            int x2 = x1 + buffer.width - 1;
+            int y2 = y1 + buffer.height - 1;
+
+            if (buffer.withShadow) {
+                expandRectWithShadow(x1, y1, x2, y2);
+            }
+
+            addDirtyRect(g_nextDirtyRects, x1, y1, x2, y2);
+        }
+
+        if (backdrop != buffer.backdrop) {
+            markDirtyAll();
+        }
+
         buffer.x = x;
         buffer.y = y;
         buffer.width = width;
@@ -496,13 +698,14 @@ void setBufferBounds(int bufferIndex, int x, int y, int width, int height, bool
             expandRectWithShadow(x1, y1, x2, y2);
         }
 
-        markDirty(x1, y1, x2, y2);
+        addDirtyRect(g_nextDirtyRects, x1, y1, x2, y2);
     }
 
     for (int i = 0; i < g_numBuffersToDraw; i++) {
         if (g_bufferToDrawIndexes[i] == bufferIndex) {
             if (i > 0) {
-                setBufferPointer(g_buffers[g_bufferToDrawIndexes[i - 1]].bufferPointer);
+                g_selectedBufferIndex = g_bufferToDrawIndexes[i - 1];
+                setBufferPointer(g_buffers[g_selectedBufferIndex].bufferPointer);
             }
             break;
         }
@@ -530,68 +733,100 @@ void beginBuffersDrawing() {
     g_bufferPointer = getBufferPointer();
 }
 
-void endBuffersDrawing() {
-    setBufferPointer(g_bufferPointer);
-
-    if (keyboard::isDisplayDirty()) {
-    	g_dirty = true;
-    }
-
-    if (mouse::isDisplayDirty()) {
-    	g_dirty = true;
-    }
-
-    if (isDirty()) {
-        for (int i = 0; i < g_numBuffersToDraw; i++) {
-            int bufferIndex = g_bufferToDrawIndexes[i];
-            Buffer &buffer = g_buffers[bufferIndex];
-
-            int sx = buffer.x;
-            int sy = buffer.y;
-
-            int x1 = buffer.x + buffer.xOffset;
-            int y1 = buffer.y + buffer.yOffset;
-            int x2 = x1 + buffer.width - 1;
-            int y2 = y1 + buffer.height - 1;
-
-            if (buffer.backdrop) {
+static void composeBuffers(const DirtyRect &dirtyRect) {
+    for (int i = 0; i < g_numBuffersToDraw; i++) {
+        int bufferIndex = g_bufferToDrawIndexes[i];
+        Buffer &buffer = g_buffers[bufferIndex];
+
+        if (buffer.backdrop) {
+            int x1 = MAX(buffer.backdrop->x, dirtyRect.x1);
+            int y1 = MAX(buffer.backdrop->y, dirtyRect.y1);
+            int x2 = MIN(buffer.backdrop->x + buffer.backdrop->w - 1, dirtyRect.x2);
+            int y2 = MIN(buffer.backdrop->y + buffer.backdrop->h - 1, dirtyRect.y2);
+            if (x1 <= x2 && y1 <= y2) {
                 auto savedOpacity = setOpacity(CONF_BACKDROP_OPACITY);
                 setColor(COLOR_ID_BACKDROP);
-                fillRect(buffer.backdrop->x, buffer.backdrop->y, buffer.backdrop->x + buffer.backdrop->w - 1, buffer.backdrop->y + buffer.backdrop->h - 1);
+                fillRect(x1, y1, x2, y2);
                 setOpacity(savedOpacity);
             }
+        }
 
-            if (buffer.withShadow) {
-                // if (x1 > g_dirtyY1 || y1 > g_dirtyY1 || x2 < g_dirtyX2 || y2 < g_dirtyY2) {
-                    drawShadow(x1, y1, x2, y2);
-                // }
+        int sx = buffer.x;
+        int sy = buffer.y;
+
+        int x1 = buffer.x + buffer.xOffset;
+        int y1 = buffer.y + buffer.yOffset;
+        int x2 = x1 + buffer.width - 1;
+        int y2 = y1 + buffer.height - 1;
+
+        if (buffer.withShadow) {
+            if (x1 > dirtyRect.x1 || y1 > dirtyRect.y1 || x2 < dirtyRect.x2 || y2 < dirtyRect.y2) {
+                Rect clipRect;
+                clipRect.x = dirtyRect.x1;
+                clipRect.y = dirtyRect.y1;
+                clipRect.w = dirtyRect.x2 - dirtyRect.x1 + 1;
+                clipRect.h = dirtyRect.y2 - dirtyRect.y1 + 1;
+                drawShadow(x1, y1, x2, y2, &clipRect);
             }
+        }
 
-            // if (x1 < g_dirtyX1) {
-            //     int xd = g_dirtyX1 - x1;
-            //     sx += xd;
-            //     x1 += xd;
-            // }
+        if (x1 < dirtyRect.x1) {
+            int xd = dirtyRect.x1 - x1;
+            sx += xd;
+            x1 += xd;
+        }
 
-            // if (y1 < g_dirtyY1) {
-            //     int yd = g_dirtyY1 - y1;
-            //     sy += yd;
-            //     y1 += yd;
-            // }
+        if (y1 < dirtyRect.y1) {
+            int yd = dirtyRect.y1 - y1;
+            sy += yd;
+            y1 += yd;
+        }
 
-            // if (x2 > g_dirtyX2) {
-            //     x2 = g_dirtyX2;
-            // }
+        if (x2 > dirtyRect.x2) {
+            x2 = dirtyRect.x2;
+        }
 
-            // if (y2 > g_dirtyY2) {
-            //     y2 = g_dirtyY2;
-            // }
+        if (y2 > dirtyRect.y2) {
+            y2 = dirtyRect.y2;
+        }
 
+        if (x1 <= x2 && y1 <= y2) {
             bitBlt(buffer.bufferPointer, nullptr, sx, sy, x2 - x1 + 1, y2 - y1 + 1, x1, y1, buffer.opacity);
         }
+    }
+}
+
+void endBuffersDrawing() {
+    setBufferPointer(g_bufferPointer);
+    g_selectedBufferIndex = -1;
+
+    // buffer added, removed or reordered, compose everything
+    if (g_numBuffersToDraw != g_lastNumBuffersToDraw || memcmp(g_bufferToDrawIndexes, g_lastBufferToDrawIndexes, g_numBuffersToDraw * sizeof(int)) != 0) {
+        memcpy(g_lastBufferToDrawIndexes, g_bufferToDrawIndexes, g_numBuffersToDraw * sizeof(int));
+        g_lastNumBuffersToDraw = g_numBuffersToDraw;
+        markDirtyAll();
+    }
+
+    // focus frame or mouse cursor moved
+    if (keyboard::isDisplayDirty()) {
+        markDirtyAll();
+    }
+
+    if (mouse::isDisplayDirty()) {
+        markDirtyAll();
+    }
+
+    if (isDirty()) {
+        g_composing = true;
+
+        for (int i = 0; i < g_dirtyRects.count; i++) {
+            composeBuffers(g_dirtyRects.rects[i]);
+        }
 
         keyboard::updateDisplay();
         mouse::updateDisplay();
+
+        g_composing = false;
     }
 
     g_numBuffersToDraw = 0;
@@ -609,7 +844,7 @@ int getCharIndexAtPosition(int xPos, const char *text, int textLength, int x, in
     for (i = 0; i < textLength && text[i]; ++i) {
         char encoding = text[i];
         gui::font::Glyph glyph;
-        font.getGlyph(encoding, glyph);
+        getGlyph(font, encoding, glyph);
         auto dx = 0;
         if (glyph) {
             dx = glyph.dx;
@@ -634,7 +869,7 @@ int getCursorXPosition(int cursorPosition, const char *text, int textLength, int
         }
         char encoding = text[i];
         gui::font::Glyph glyph;
-        font.getGlyph(encoding, glyph);
+        getGlyph(font, encoding, glyph);
         if (glyph) {
             x += glyph.dx;
         }
@@ -86,11 +86,25 @@ uint8_t getOpacity();
 
 const uint8_t * takeScreenshot();
 
+static const int MAX_NUM_DIRTY_RECTS = 8;
+
+struct DirtyRect {
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+};
+
+struct DirtyRects {
+    int count;
+    DirtyRect rects[MAX_NUM_DIRTY_RECTS];
+};
+
 void clearDirty();
-// void markDirty(int x1, int y1, int x2, int y2);
-extern bool g_dirty;
-#define markDirty(x1, y1, x2, y2) g_dirty = true
+void markDirty(int x1, int y1, int x2, int y2);
+void markDirtyAll();
 bool isDirty();
+const DirtyRects &getDirtyRects();
 
 void drawPixel(int x, int y);
 void drawPixel(int x, int y, uint8_t opacity);
@@ -112,6 +126,31 @@ int getCursorXPosition(int cursorPosition, const char *text, int textLength, int
 int8_t measureGlyph(uint8_t encoding, gui::font::Font &font);
 int measureStr(const char *text, int textLength, gui::font::Font &font, int max_width = 0);
 
+void getGlyph(gui::font::Font &font, uint8_t encoding, gui::font::Glyph &glyph);
+
+struct FontCacheStatistics {
+    uint32_t glyphHits;
+    uint32_t glyphMisses;
+    uint32_t widthHits;
+    uint32_t widthMisses;
+};
+
+void getFontCacheStatistics(FontCacheStatistics &statistics);
+
+#if defined(EEZ_PLATFORM_SIMULATOR)
+// Frame time is the time spent uploading the dirty area to the screen texture and presenting it.
+struct FrameStatistics {
+    uint32_t numFrames;
+    uint32_t lastFrameTimeUs;
+    uint32_t maxFrameTimeUs;
+    uint64_t totalFrameTimeUs;
+    uint32_t lastUploadBytes;
+    uint64_t totalUploadBytes;
+};
+
+void getFrameStatistics(FrameStatistics &statistics);
+#endif
+
 static const int NUM_BUFFERS = 6;
 struct BufferFlags {
     unsigned allocated : 1;
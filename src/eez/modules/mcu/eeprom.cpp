@@ -47,6 +47,8 @@ static const uint16_t EEPROM_ADDRESS = 0b10100000;
 
 TestResult g_testResult = TEST_FAILED;
 
+static Statistics g_statistics;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 #if defined(EEZ_PLATFORM_STM32)
@@ -54,6 +56,8 @@ const int MAX_READ_CHUNK_SIZE = 16;
 #endif
 
 bool read(uint8_t *buffer, uint16_t bufferSize, uint16_t address) {
+    g_statistics.numReads++;
+    g_statistics.bytesRead += bufferSize;
 
 #if defined(EEZ_PLATFORM_STM32)
     for (uint16_t i = 0; i < bufferSize; i += MAX_READ_CHUNK_SIZE) {
@@ -112,12 +116,16 @@ const int MAX_WRITE_CHUNK_SIZE = 16;
 #endif
 
 bool write(const uint8_t *buffer, uint16_t bufferSize, uint16_t address) {
+    g_statistics.numWrites++;
+    g_statistics.bytesWritten += bufferSize;
 
 #if defined(EEZ_PLATFORM_STM32)
-    for (uint16_t i = 0; i < bufferSize; i += MAX_WRITE_CHUNK_SIZE) {
+    uint16_t chunkSize;
+    for (uint16_t i = 0; i < bufferSize; i += chunkSize) {
         uint16_t chunkAddress = address + i;
 
-        uint16_t chunkSize = MIN(MAX_WRITE_CHUNK_SIZE, bufferSize - i);
+        // chunks are aligned, so they never cross the EEPROM page boundary
+        chunkSize = MIN(MAX_WRITE_CHUNK_SIZE - chunkAddress % MAX_WRITE_CHUNK_SIZE, bufferSize - i);
 
         HAL_StatusTypeDef returnValue;
 
@@ -183,6 +191,10 @@ bool write(const uint8_t *buffer, uint16_t bufferSize, uint16_t address) {
 void init() {
 }
 
+void getStatistics(Statistics &statistics) {
+    statistics = g_statistics;
+}
+
 bool test() {
 #if OPTION_EXT_EEPROM
     // TODO add test
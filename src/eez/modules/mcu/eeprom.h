@@ -28,6 +28,7 @@
 |64     |  24|[Total ON-time counter](#ontime-counter)  |
 |1024   |  64|[Device configuration](#device)           |
 |1536   | 128|[Device configuration 2](#device2)        |
+|4096   |16K |[Device configuration journal](#journal)  |
 
 ## <a name="ontime-counter">ON-time counter</a>
 
@@ -89,6 +90,12 @@
 |11 |Force disabling of all outputs on power up     |
 |12 |Click sound enabled |
 
+## <a name="journal">Device configuration journal</a>
+
+8 segments, 2048 bytes each, see conf_journal.h for the segment format.
+Device configuration blocks are read only once, when there is no valid
+journal segment, to migrate the configuration to the journal.
+
 ## <a name="block-header">Block header</a>
 
 |Offset|Size|Type|Description|
@@ -122,6 +129,15 @@ extern TestResult g_testResult;
 bool read(uint8_t *buffer, uint16_t buffer_size, uint16_t address);
 bool write(const uint8_t *buffer, uint16_t buffer_size, uint16_t address);
 
+struct Statistics {
+    uint32_t numReads;
+    uint32_t bytesRead;
+    uint32_t numWrites;
+    uint32_t bytesWritten;
+};
+
+void getStatistics(Statistics &statistics);
+
 void resetAllExceptOnTimeCounters();
 
 } // namespace eeprom
@@ -31,6 +31,8 @@
 #include <netif.h>
 #include <ethernetif.h>
 #include <dns.h>
+#include <tcp.h>
+#include <tcpip.h>
 extern struct netif gnetif;
 extern ip4_addr_t ipaddr;
 ip4_addr_t dns;
@@ -55,7 +57,9 @@ extern ip4_addr_t gw;
 #include <fcntl.h>
 #include <memory.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <stdio.h>
+#include <sys/select.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -76,6 +80,7 @@ using namespace eez::psu::ethernet;
 using namespace eez::scpi;
 
 #define CONF_CONNECT_TIMEOUT 30000
+#define CONF_WRITE_TIMEOUT 5000
 
 namespace eez {
 namespace mcu {
@@ -131,11 +136,21 @@ enum ConnectionState {
 static ConnectionState g_connectionState = CONNECTION_STATE_INITIALIZED;
 static uint16_t g_port;
 struct netconn *g_tcpListenConnection;
-struct netconn *g_tcpClientConnection;
-static netbuf *g_inbuf;
+struct netconn *g_tcpClientConnections[ETHERNET_MAX_NUM_CLIENTS];
+static netbuf *g_inbufs[ETHERNET_MAX_NUM_CLIENTS];
+static uint32_t g_inputAvailableTimes[ETHERNET_MAX_NUM_CLIENTS];
 static bool g_checkLinkWhileIdle = false;
 static bool g_acceptClientIsDone;
 
+static int findClient(struct netconn *conn) {
+    for (int clientIndex = 0; clientIndex < ETHERNET_MAX_NUM_CLIENTS; clientIndex++) {
+        if (g_tcpClientConnections[clientIndex] == conn) {
+            return clientIndex;
+        }
+    }
+    return -1;
+}
+
 static void netconnCallback(struct netconn *conn, enum netconn_evt evt, u16_t len) {
 	switch (evt) {
 	case NETCONN_EVT_RCVPLUS:
@@ -145,8 +160,12 @@ static void netconnCallback(struct netconn *conn, enum netconn_evt evt, u16_t le
             while (!g_acceptClientIsDone) {
                 osDelay(1);
             }
-		} else if (conn == g_tcpClientConnection) {
-			sendMessageToLowPriorityThread(ETHERNET_INPUT_AVAILABLE);
+		} else {
+            int clientIndex = findClient(conn);
+            if (clientIndex != -1) {
+                g_inputAvailableTimes[clientIndex] = micros();
+			    sendMessageToLowPriorityThread(ETHERNET_INPUT_AVAILABLE, clientIndex);
+            }
 		}
 		break;
 
@@ -263,15 +282,22 @@ static void onEvent(uint8_t eventType) {
 		{
 			struct netconn *newConnection;
 			if (netconn_accept(g_tcpListenConnection, &newConnection) == ERR_OK) {
-				if (g_tcpClientConnection) {
-					// there is a client already connected, close this connection
+                int clientIndex = findClient(nullptr);
+				if (clientIndex == -1) {
+					// all the client slots are taken, close this connection
                     g_acceptClientIsDone = true;
                     osDelay(10);
 					netconn_delete(newConnection);
 				} else {
 					// connection with the client established
-					g_tcpClientConnection = newConnection;
-					sendMessageToLowPriorityThread(ETHERNET_CLIENT_CONNECTED);
+#if ETHERNET_TCP_NODELAY
+					// pcb belongs to the lwIP core thread
+					LOCK_TCPIP_CORE();
+					tcp_nagle_disable(newConnection->pcb.tcp);
+					UNLOCK_TCPIP_CORE();
+#endif
+					g_tcpClientConnections[clientIndex] = newConnection;
+					sendMessageToLowPriorityThread(ETHERNET_CLIENT_CONNECTED, clientIndex);
                     g_acceptClientIsDone = true;
 				}
 			}  else {
@@ -304,37 +330,42 @@ void onIdle() {
             sendMessageToLowPriorityThread(ETHERNET_CONNECTED);
 		}
 	}
-
-	if (g_tcpClientConnection) {
-
-	}
 }
 #endif
 
 #if defined(EEZ_PLATFORM_SIMULATOR)
 #define INPUT_BUFFER_SIZE 1024
 
+#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
+typedef SOCKET socket_t;
+#define INVALID_SOCKET_VALUE INVALID_SOCKET
+#else
+typedef int socket_t;
+#define INVALID_SOCKET_VALUE -1
+#endif
+
+struct Client {
+    socket_t socket;
+    bool connected;
+    char inputBuffer[INPUT_BUFFER_SIZE];
+    uint32_t inputBufferLength;
+    uint32_t inputAvailableTime;
+};
+
 static uint16_t g_port;
-static char g_inputBuffer[INPUT_BUFFER_SIZE];
-static uint32_t g_inputBufferLength;
+static socket_t listen_socket = INVALID_SOCKET_VALUE;
+static Client g_clients[ETHERNET_MAX_NUM_CLIENTS];
+static bool g_clientsInitialized;
 
 ////////////////////////////////////////////////////////////////////////////////
 
 bool bind(int port);
-bool client_available();
-bool connected();
-int available();
-int read(char *buffer, int buffer_size);
-int write(const char *buffer, int buffer_size);
-void stop();
-
-#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
-static SOCKET listen_socket = INVALID_SOCKET;
-static SOCKET client_socket = INVALID_SOCKET;
-#else
-static int listen_socket = -1;
-static int client_socket = -1;
+void acceptClient();
+int read(Client &client, char *buffer, int buffer_size);
+int write(Client &client, const char *buffer, int buffer_size, bool more);
+void stop(Client &client);
 
+#ifndef EEZ_PLATFORM_SIMULATOR_WIN32
 bool enable_non_blocking(int fd) {
     int flags = fcntl(fd, F_GETFL, 0);
     if (flags < 0) {
@@ -346,9 +377,104 @@ bool enable_non_blocking(int fd) {
     }
     return true;
 }
+#endif
+
+static void closeSocket(socket_t socket) {
+#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+static void setNoDelay(socket_t socket) {
+#if ETHERNET_TCP_NODELAY
+    int flag = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (const char *)&flag, sizeof(flag));
+#endif
+}
+
+static bool isWouldBlockError() {
+#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EWOULDBLOCK || errno == EAGAIN || errno == EINTR;
+#endif
+}
 
+// Sends all the data to the non blocking socket, if socket send buffer is full
+// it waits until there is some space available. Returns false on error or timeout.
+static bool sendAll(socket_t socket, const char *buffer, uint32_t length, bool more) {
+    int flags = 0;
+#ifdef MSG_NOSIGNAL
+    flags |= MSG_NOSIGNAL;
+#endif
+#ifdef MSG_MORE
+    if (more) {
+        flags |= MSG_MORE;
+    }
 #endif
 
+    while (length > 0) {
+        int n = ::send(socket, buffer, length, flags);
+        if (n > 0) {
+            buffer += n;
+            length -= n;
+            continue;
+        }
+
+        if (n < 0 && isWouldBlockError()) {
+            fd_set writeSet;
+            FD_ZERO(&writeSet);
+            FD_SET(socket, &writeSet);
+
+            timeval timeout;
+            timeout.tv_sec = CONF_WRITE_TIMEOUT / 1000;
+            timeout.tv_usec = 0;
+
+            if (select((int)(socket + 1), nullptr, &writeSet, nullptr, &timeout) > 0) {
+                continue;
+            }
+
+            DebugTrace("ETHERNET: write timeout\n");
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+static void initClients() {
+    if (!g_clientsInitialized) {
+        for (int clientIndex = 0; clientIndex < ETHERNET_MAX_NUM_CLIENTS; clientIndex++) {
+            g_clients[clientIndex].socket = INVALID_SOCKET_VALUE;
+        }
+        g_clientsInitialized = true;
+    }
+}
+
+static bool hasSockets() {
+    if (listen_socket != INVALID_SOCKET_VALUE) {
+        return true;
+    }
+    for (int clientIndex = 0; clientIndex < ETHERNET_MAX_NUM_CLIENTS; clientIndex++) {
+        if (g_clients[clientIndex].socket != INVALID_SOCKET_VALUE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static int findFreeClient() {
+    for (int clientIndex = 0; clientIndex < ETHERNET_MAX_NUM_CLIENTS; clientIndex++) {
+        if (g_clients[clientIndex].socket == INVALID_SOCKET_VALUE && !g_clients[clientIndex].connected) {
+            return clientIndex;
+        }
+    }
+    return -1;
+}
+
 bool bind(int port) {
 #ifdef EEZ_PLATFORM_SIMULATOR_WIN32
     WSADATA wsaData;
@@ -459,76 +585,72 @@ bool bind(int port) {
 #endif    
 }
 
-bool client_available() {
-#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
-    if (connected())
-        return true;
-
-    if (listen_socket == INVALID_SOCKET) {
-        return false;
+void acceptClient() {
+    if (listen_socket == INVALID_SOCKET_VALUE) {
+        return;
     }
 
+#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
     // Accept a client socket
-    client_socket = accept(listen_socket, NULL, NULL);
+    SOCKET client_socket = accept(listen_socket, NULL, NULL);
     if (client_socket == INVALID_SOCKET) {
         if (WSAGetLastError() == WSAEWOULDBLOCK) {
-            return false;
+            return;
         }
 
         DebugTrace("EHTERNET accept failed with error %d\n", WSAGetLastError());
         closesocket(listen_socket);
         listen_socket = INVALID_SOCKET;
-        return false;
+        return;
     }
 
-    return true;
-#else
-    if (connected())
-        return true;
-
-    if (listen_socket == -1) {
-        return 0;
+    u_long iMode = 1;
+    if (ioctlsocket(client_socket, FIONBIO, &iMode) != NO_ERROR) {
+        DebugTrace("EHTERNET: ioctlsocket on client socket failed with error %d\n", WSAGetLastError());
+        closesocket(client_socket);
+        return;
     }
-
+#else
     sockaddr_in cli_addr;
     socklen_t clilen = sizeof(cli_addr);
-    client_socket = accept(listen_socket, (sockaddr *)&cli_addr, &clilen);
+    int client_socket = accept(listen_socket, (sockaddr *)&cli_addr, &clilen);
     if (client_socket < 0) {
         if (errno == EWOULDBLOCK) {
-            return false;
+            return;
         }
 
         DebugTrace("EHTERNET: accept failed with error %d", errno);
         close(listen_socket);
         listen_socket = -1;
-        return false;
+        return;
     }
 
     if (!enable_non_blocking(client_socket)) {
         DebugTrace("EHTERNET: ioctl on client socket failed with error %d", errno);
         close(client_socket);
-        listen_socket = -1;
-        return false;
+        return;
     }
+#endif
 
-    return true;
-#endif    
-}
+    int clientIndex = findFreeClient();
+    if (clientIndex == -1) {
+        // all the client slots are taken, refuse this connection
+        closeSocket(client_socket);
+        return;
+    }
 
-bool connected() {
-#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
-    return client_socket != INVALID_SOCKET;
-#else
-    return client_socket != -1;
-#endif    
+    setNoDelay(client_socket);
+
+    Client &client = g_clients[clientIndex];
+    client.socket = client_socket;
+    client.connected = true;
+    client.inputBufferLength = 0;
+    sendMessageToLowPriorityThread(ETHERNET_CLIENT_CONNECTED, clientIndex);
 }
 
-int available() {
+int read(Client &client, char *buffer, int buffer_size) {
 #ifdef EEZ_PLATFORM_SIMULATOR_WIN32
-    if (client_socket == INVALID_SOCKET)
-        return 0;
-
-    int iResult = ::recv(client_socket, g_inputBuffer, INPUT_BUFFER_SIZE, MSG_PEEK);
+    int iResult = ::recv(client.socket, buffer, buffer_size, 0);
     if (iResult > 0) {
         return iResult;
     }
@@ -537,111 +659,197 @@ int available() {
         return 0;
     }
 
-    stop();
+    stop(client);
 
     return 0;
 #else
-    if (client_socket == -1)
-        return 0;
-
-    char buffer[1000];
-    int iResult = ::recv(client_socket, buffer, 1000, MSG_PEEK);
-    if (iResult > 0) {
-        return iResult;
+    int n = ::read(client.socket, buffer, buffer_size);
+    if (n > 0) {
+        return n;
     }
 
-    if (iResult < 0 && errno == EWOULDBLOCK) {
+    if (n < 0 && errno == EWOULDBLOCK) {
         return 0;
     }
 
-    stop();
+    stop(client);
 
     return 0;
-#endif        
+#endif    
 }
 
-int read(char *buffer, int buffer_size) {
-#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
-    int iResult = ::recv(client_socket, buffer, buffer_size, 0);
-    if (iResult > 0) {
-        return iResult;
+int write(Client &client, const char *buffer, int buffer_size, bool more) {
+    socket_t socket = client.socket;
+    if (socket == INVALID_SOCKET_VALUE) {
+        return 0;
     }
 
-    if (iResult < 0 && WSAGetLastError() == WSAEWOULDBLOCK) {
+    if (!sendAll(socket, buffer, buffer_size, more)) {
+        closeSocket(socket);
+        client.socket = INVALID_SOCKET_VALUE;
         return 0;
     }
 
-    stop();
+    return buffer_size;
+}
 
-    return 0;
-#else
-    int n = ::read(client_socket, buffer, buffer_size);
-    if (n > 0) {
-        return n;
+void stop(Client &client) {
+    if (client.socket == INVALID_SOCKET_VALUE) {
+        return;
     }
 
-    if (n < 0 && errno == EWOULDBLOCK) {
-        return 0;
+#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
+    int iResult = ::shutdown(client.socket, SD_SEND);
+    if (iResult == SOCKET_ERROR) {
+        DebugTrace("EHTERNET shutdown failed with error %d\n", WSAGetLastError());
+    }
+    closesocket(client.socket);
+    client.socket = INVALID_SOCKET;
+#else
+    int result = ::shutdown(client.socket, SHUT_WR);
+    if (result < 0) {
+        DebugTrace("ETHERNET shutdown failed with error %d\n", errno);
     }
+    close(client.socket);
+    client.socket = -1;
+#endif    
+}
 
-    stop();
+////////////////////////////////////////////////////////////////////////////////
 
-    return 0;
-#endif    
+static void loopbackReaderMainLoop(const void *);
+
+osThreadDef(g_loopbackReaderTask, loopbackReaderMainLoop, osPriorityNormal, 0, 1024);
+
+static socket_t g_loopbackWriteSocket = INVALID_SOCKET_VALUE;
+static socket_t g_loopbackReadSocket = INVALID_SOCKET_VALUE;
+static volatile uint32_t g_loopbackNumBytesReceived;
+static volatile bool g_loopbackReaderDone;
+
+void loopbackReaderMainLoop(const void *) {
+    static char buffer[65536];
+    while (true) {
+        osThreadEnterExternalWait();
+        int n = ::recv(g_loopbackReadSocket, buffer, sizeof(buffer), 0);
+        osThreadExitExternalWait();
+        if (n <= 0) {
+            break;
+        }
+        g_loopbackNumBytesReceived += n;
+    }
+    g_loopbackReaderDone = true;
 }
 
-int write(const char *buffer, int buffer_size) {
+bool openLoopbackClient() {
 #ifdef EEZ_PLATFORM_SIMULATOR_WIN32
-    int iSendResult;
-
-    if (client_socket != INVALID_SOCKET) {
-        // Echo the buffer back to the sender
-        iSendResult = ::send(client_socket, buffer, buffer_size, 0);
-        if (iSendResult == SOCKET_ERROR) {
-            DebugTrace("send failed with error: %d\n", WSAGetLastError());
-            closesocket(client_socket);
-            client_socket = INVALID_SOCKET;
-            return 0;
-        }
-        return iSendResult;
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
+        return false;
     }
+#endif
 
-    return 0;
-#else
-    if (client_socket != -1) {
-        int n = ::write(client_socket, buffer, buffer_size);
-        if (n < 0) {
-            close(client_socket);
-            client_socket = -1;
-            return 0;
-        }
-        return n;
+    socket_t listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET_VALUE) {
+        return false;
     }
 
-    return 0;
-#endif    
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0; // any free port
+
+    socklen_t addrLen = sizeof(addr);
+    if (::bind(listenSocket, (sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(listenSocket, 1) < 0 ||
+        getsockname(listenSocket, (sockaddr *)&addr, &addrLen) < 0
+    ) {
+        closeSocket(listenSocket);
+        return false;
+    }
+
+    g_loopbackReadSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (g_loopbackReadSocket == INVALID_SOCKET_VALUE) {
+        closeSocket(listenSocket);
+        return false;
+    }
+
+    if (connect(g_loopbackReadSocket, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        closeSocket(g_loopbackReadSocket);
+        g_loopbackReadSocket = INVALID_SOCKET_VALUE;
+        closeSocket(listenSocket);
+        return false;
+    }
+
+    g_loopbackWriteSocket = accept(listenSocket, nullptr, nullptr);
+    closeSocket(listenSocket);
+    if (g_loopbackWriteSocket == INVALID_SOCKET_VALUE) {
+        closeSocket(g_loopbackReadSocket);
+        g_loopbackReadSocket = INVALID_SOCKET_VALUE;
+        return false;
+    }
+
+    // same socket options as for the SCPI client connection
+#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
+    u_long iMode = 1;
+    ioctlsocket(g_loopbackWriteSocket, FIONBIO, &iMode);
+#else
+    enable_non_blocking(g_loopbackWriteSocket);
+#endif
+    setNoDelay(g_loopbackWriteSocket);
+
+    g_loopbackNumBytesReceived = 0;
+    g_loopbackReaderDone = false;
+    osThreadCreate(osThread(g_loopbackReaderTask), nullptr);
+
+    return true;
 }
 
-void stop() {
+int writeLoopbackClient(const char *buffer, uint32_t length, bool more) {
+    if (g_loopbackWriteSocket == INVALID_SOCKET_VALUE || !sendAll(g_loopbackWriteSocket, buffer, length, more)) {
+        return 0;
+    }
+    return length;
+}
+
+uint32_t closeLoopbackClient() {
+    if (g_loopbackWriteSocket == INVALID_SOCKET_VALUE) {
+        return 0;
+    }
+
+    // reader thread exits when it receives all the data
 #ifdef EEZ_PLATFORM_SIMULATOR_WIN32
-    if (client_socket != INVALID_SOCKET) {
-        int iResult = ::shutdown(client_socket, SD_SEND);
-        if (iResult == SOCKET_ERROR) {
-            DebugTrace("EHTERNET shutdown failed with error %d\n", WSAGetLastError());
-        }
-        closesocket(client_socket);
-        client_socket = INVALID_SOCKET;
+    ::shutdown(g_loopbackWriteSocket, SD_SEND);
+#else
+    ::shutdown(g_loopbackWriteSocket, SHUT_WR);
+#endif
+    for (int i = 0; i < CONF_WRITE_TIMEOUT && !g_loopbackReaderDone; i++) {
+        osDelay(1);
     }
+
+    if (!g_loopbackReaderDone) {
+        // unblock the reader, data it didn't receive yet is not counted
+#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
+        ::shutdown(g_loopbackReadSocket, SD_BOTH);
 #else
-    int result = ::shutdown(client_socket, SHUT_WR);
-    if (result < 0) {
-        DebugTrace("ETHERNET shutdown failed with error %d\n", errno);
+        ::shutdown(g_loopbackReadSocket, SHUT_RDWR);
+#endif
+        for (int i = 0; i < CONF_WRITE_TIMEOUT && !g_loopbackReaderDone; i++) {
+            osDelay(1);
+        }
     }
-    close(client_socket);
-    client_socket = -1;
-#endif    
+
+    closeSocket(g_loopbackWriteSocket);
+    g_loopbackWriteSocket = INVALID_SOCKET_VALUE;
+
+    closeSocket(g_loopbackReadSocket);
+    g_loopbackReadSocket = INVALID_SOCKET_VALUE;
+
+    return g_loopbackNumBytesReceived;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
 void onEvent(uint8_t eventType) {
     switch (eventType) {
     case QUEUE_MESSAGE_CONNECT:
@@ -653,36 +861,100 @@ void onEvent(uint8_t eventType) {
         break;
 
     case QUEUE_MESSAGE_DESTROY_TCP_SERVER:
-#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
-        if (listen_socket != INVALID_SOCKET) {
-            closesocket(listen_socket);
-            listen_socket = INVALID_SOCKET;
+        if (listen_socket != INVALID_SOCKET_VALUE) {
+            closeSocket(listen_socket);
+            listen_socket = INVALID_SOCKET_VALUE;
         }
-#else
-        close(listen_socket);
-        listen_socket = -1;
-#endif    
         break;
     }
 }
 
-void onIdle() {
-    static bool wasConnected = false;
+// Waits until listen socket or some of the client sockets is ready for reading,
+// instead of peeking into the client socket periodically.
+static void waitForSockets(uint32_t timeoutMs) {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+
+    socket_t maxSocket = listen_socket;
 
-    if (wasConnected) {
-        if (connected()) {
-            if (!g_inputBufferLength && available()) {
-                g_inputBufferLength = read(g_inputBuffer, INPUT_BUFFER_SIZE);
-                sendMessageToLowPriorityThread(ETHERNET_INPUT_AVAILABLE);
+    // always wait on the listen socket, acceptClient closes the connection
+    // if all the client slots are taken
+    if (listen_socket != INVALID_SOCKET_VALUE) {
+        FD_SET(listen_socket, &readSet);
+    }
+
+    bool inputPending = false;
+    for (int clientIndex = 0; clientIndex < ETHERNET_MAX_NUM_CLIENTS; clientIndex++) {
+        Client &client = g_clients[clientIndex];
+        if (client.socket != INVALID_SOCKET_VALUE) {
+            // wait until previous input is processed
+            if (client.inputBufferLength) {
+                inputPending = true;
+            } else {
+                FD_SET(client.socket, &readSet);
+                if (maxSocket == INVALID_SOCKET_VALUE || client.socket > maxSocket) {
+                    maxSocket = client.socket;
+                }
             }
-        } else {
-            sendMessageToLowPriorityThread(ETHERNET_CLIENT_DISCONNECTED);
-            wasConnected = false;
         }
-    } else {
-        if (client_available()) {
-            wasConnected = true;
-            sendMessageToLowPriorityThread(ETHERNET_CLIENT_CONNECTED);
+    }
+
+    // processing of the pending input releases the input buffer without
+    // waking up select, so check again soon
+    if (inputPending) {
+        timeoutMs = 1;
+    }
+
+    timeval timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_usec = timeoutMs * 1000;
+
+    osThreadEnterExternalWait();
+    int result = select((int)(maxSocket + 1), &readSet, nullptr, nullptr, &timeout);
+    osThreadExitExternalWait();
+    if (result < 0) {
+#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
+        // select fails if there are no sockets in the set
+        osDelay(timeoutMs);
+#endif
+        return;
+    }
+
+    if (result == 0) {
+        return;
+    }
+
+    if (listen_socket != INVALID_SOCKET_VALUE && FD_ISSET(listen_socket, &readSet)) {
+        acceptClient();
+    }
+
+    for (int clientIndex = 0; clientIndex < ETHERNET_MAX_NUM_CLIENTS; clientIndex++) {
+        Client &client = g_clients[clientIndex];
+        if (client.socket != INVALID_SOCKET_VALUE && !client.inputBufferLength && FD_ISSET(client.socket, &readSet)) {
+            // if readable socket has no data then connection is closed
+            uint32_t length = read(client, client.inputBuffer, INPUT_BUFFER_SIZE);
+            if (length > 0) {
+                client.inputAvailableTime = micros();
+                client.inputBufferLength = length;
+                sendMessageToLowPriorityThread(ETHERNET_INPUT_AVAILABLE, clientIndex);
+            }
+        }
+    }
+}
+
+void onIdle() {
+    initClients();
+
+    if (hasSockets()) {
+        waitForSockets(10);
+    }
+
+    for (int clientIndex = 0; clientIndex < ETHERNET_MAX_NUM_CLIENTS; clientIndex++) {
+        Client &client = g_clients[clientIndex];
+        if (client.connected && client.socket == INVALID_SOCKET_VALUE) {
+            client.connected = false;
+            client.inputBufferLength = 0;
+            sendMessageToLowPriorityThread(ETHERNET_CLIENT_DISCONNECTED, clientIndex);
         }
     }
 }
@@ -690,7 +962,13 @@ void onIdle() {
 
 void mainLoop(const void *) {
     while (1) {
+#if defined(EEZ_PLATFORM_SIMULATOR)
+        // while there are open sockets onIdle is waiting for them
+        initClients();
+        osEvent event = osMessageGet(g_ethernetMessageQueueId, hasSockets() ? 0 : 10);
+#else
         osEvent event = osMessageGet(g_ethernetMessageQueueId, 10);
+#endif
         if (event.status == osEventMessage) {
             uint8_t eventType = event.value.v & 0xFF;
             if (eventType == QUEUE_MESSAGE_PUSH_EVENT) {
@@ -766,30 +1044,33 @@ void endServer() {
     osMessagePut(g_ethernetMessageQueueId, QUEUE_MESSAGE_DESTROY_TCP_SERVER, osWaitForever);
 }
 
-void getInputBuffer(int bufferPosition, char **buffer, uint32_t *length) {
+void getInputBuffer(int clientIndex, char **buffer, uint32_t *length) {
 #if defined(EEZ_PLATFORM_STM32)
-	if (!g_tcpClientConnection) {
+    struct netconn *tcpClientConnection = g_tcpClientConnections[clientIndex];
+	if (!tcpClientConnection) {
+        *buffer = nullptr;
+        *length = 0;
 		return;
 	}
 
-	if (netconn_recv(g_tcpClientConnection, &g_inbuf) != ERR_OK) {
+	if (netconn_recv(tcpClientConnection, &g_inbufs[clientIndex]) != ERR_OK) {
 		goto fail1;
 	}
 
-	if (netconn_err(g_tcpClientConnection) != ERR_OK) {
+	if (netconn_err(tcpClientConnection) != ERR_OK) {
 		goto fail2;
 	}
 
 	uint8_t* data;
 	u16_t dataLength;
-	netbuf_data(g_inbuf, (void**)&data, &dataLength);
+	netbuf_data(g_inbufs[clientIndex], (void**)&data, &dataLength);
 
     if (dataLength > 0) {
     	*buffer = (char *)data;
     	*length = dataLength;
     } else {
-        netbuf_delete(g_inbuf);
-        g_inbuf = nullptr;
+        netbuf_delete(g_inbufs[clientIndex]);
+        g_inbufs[clientIndex] = nullptr;
     	*buffer = nullptr;
     	*length = 0;
     }
@@ -797,56 +1078,73 @@ void getInputBuffer(int bufferPosition, char **buffer, uint32_t *length) {
     return;
 
 fail2:
-	netbuf_delete(g_inbuf);
-	g_inbuf = nullptr;
+	netbuf_delete(g_inbufs[clientIndex]);
+	g_inbufs[clientIndex] = nullptr;
 
 fail1:
-	netconn_delete(g_tcpClientConnection);
-	g_tcpClientConnection = nullptr;
-	sendMessageToLowPriorityThread(ETHERNET_CLIENT_DISCONNECTED);
+	netconn_delete(tcpClientConnection);
+	g_tcpClientConnections[clientIndex] = nullptr;
+	sendMessageToLowPriorityThread(ETHERNET_CLIENT_DISCONNECTED, clientIndex);
 
 	*buffer = nullptr;
-	length = 0;
+	*length = 0;
+#endif
+
+#if defined(EEZ_PLATFORM_SIMULATOR)
+    *buffer = g_clients[clientIndex].inputBuffer;
+    *length = g_clients[clientIndex].inputBufferLength;
+#endif
+}
+
+void releaseInputBuffer(int clientIndex) {
+#if defined(EEZ_PLATFORM_STM32)
+	netbuf_delete(g_inbufs[clientIndex]);
+	g_inbufs[clientIndex] = nullptr;
 #endif
 
 #if defined(EEZ_PLATFORM_SIMULATOR)
-    *buffer = g_inputBuffer;
-    *length = g_inputBufferLength;
+    g_clients[clientIndex].inputBufferLength = 0;
 #endif
 }
 
-void releaseInputBuffer() {
+uint32_t getInputAvailableTime(int clientIndex) {
 #if defined(EEZ_PLATFORM_STM32)
-	netbuf_delete(g_inbuf);
-	g_inbuf = nullptr;
+    return g_inputAvailableTimes[clientIndex];
 #endif
 
 #if defined(EEZ_PLATFORM_SIMULATOR)
-    g_inputBufferLength = 0;
+    return g_clients[clientIndex].inputAvailableTime;
 #endif
 }
 
-int writeBuffer(const char *buffer, uint32_t length) {
+int writeBuffer(int clientIndex, const char *buffer, uint32_t length, bool more) {
 #if defined(EEZ_PLATFORM_STM32)
-    netconn_write(g_tcpClientConnection, (void *)buffer, (uint16_t)length, NETCONN_COPY);
+    if (!g_tcpClientConnections[clientIndex]) {
+        return 0;
+    }
+    // NETCONN_MORE doesn't set PSH flag on the last segment
+    uint8_t apiflags = NETCONN_COPY | (more ? NETCONN_MORE : 0);
+    if (netconn_write(g_tcpClientConnections[clientIndex], (void *)buffer, length, apiflags) != ERR_OK) {
+        return 0;
+    }
     return length;
 #endif
 
 #if defined(EEZ_PLATFORM_SIMULATOR)
-    int numWritten = write(buffer, length);
-    osDelay(1);
-    return numWritten;
+    return write(g_clients[clientIndex], buffer, length, more);
 #endif
 }
 
-void disconnectClient() {
+void disconnectClient(int clientIndex) {
 #if defined(EEZ_PLATFORM_STM32)
-	netconn_delete(g_tcpClientConnection);
-	g_tcpClientConnection = nullptr;
+    if (g_tcpClientConnections[clientIndex]) {
+	    netconn_delete(g_tcpClientConnections[clientIndex]);
+	    g_tcpClientConnections[clientIndex] = nullptr;
+    }
 #endif
 
 #if defined(EEZ_PLATFORM_SIMULATOR)
-    stop();
+    stop(g_clients[clientIndex]);
 #endif    
 }
 
@@ -58,11 +58,25 @@ IPAddress dnsServerIP();
 void beginServer(uint16_t port);
 void endServer();
 
-void getInputBuffer(int bufferPosition, char **buffer, uint32_t *length);
-void releaseInputBuffer();
-
-int writeBuffer(const char *buffer, uint32_t length);
-void disconnectClient();
+void getInputBuffer(int clientIndex, char **buffer, uint32_t *length);
+void releaseInputBuffer(int clientIndex);
+
+// time (in microseconds) when the last input from the client became available
+uint32_t getInputAvailableTime(int clientIndex);
+
+// Writes all the data to the client, if more is true then more data will follow
+// immediately and this data can be coalesced with it into the same TCP segment.
+int writeBuffer(int clientIndex, const char *buffer, uint32_t length, bool more = false);
+void disconnectClient(int clientIndex);
+
+#if defined(EEZ_PLATFORM_SIMULATOR)
+// Local TCP connection, which is drained by the separate thread,
+// used to measure the output throughput.
+bool openLoopbackClient();
+int writeLoopbackClient(const char *buffer, uint32_t length, bool more);
+// returns number of bytes received at the other end of connection
+uint32_t closeLoopbackClient();
+#endif
 
 void pushEvent(int16_t eventId);
 
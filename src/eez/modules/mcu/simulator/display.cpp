@@ -24,13 +24,18 @@
 #include <string.h>
 #include <utility>
 #include <string>
+#include <chrono>
+#include <thread>
 
+#if !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
 #include <SDL.h>
 #include <SDL_image.h>
+#endif
 
 #include <cmsis_os.h>
 
 #include <eez/modules/mcu/display.h>
+#include <eez/modules/mcu/simulator/display_kernels.h>
 
 #include <eez/modules/psu/gui/psu.h>
 #include <eez/debug.h>
@@ -50,14 +55,34 @@ namespace display {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-static const char *TITLE = "EEZ Modular Firmware Simulator";
-static const char *ICON = "eez.png";
+#if defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
+// nobody is looking at the offscreen display, it is refreshed only for the screenshots
+static const uint32_t FRAME_TIME_MS = 1000 / 20;
+#else
+static const uint32_t FRAME_TIME_MS = 1000 / 60;
+#endif
 
 static bool g_isOn;
 
+#if !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
+static const char *TITLE = "EEZ Modular Firmware Simulator";
+static const char *ICON = "eez.png";
+
 static SDL_Window *g_mainWindow;
 static SDL_Renderer *g_renderer;
 
+// Long-lived streaming texture with the content of the last presented frame,
+// only the dirty area of the new frame is uploaded into it.
+static SDL_Texture *g_texture;
+static bool g_isTextureValid;
+
+// when present waits for the vertical blank, sync doesn't have to sleep
+static bool g_isPresentVsync;
+static bool g_isFramePresented;
+#endif
+
+static FrameStatistics g_frameStatistics;
+
 static uint32_t *g_buffer;
 static uint32_t *g_lastBuffer;
 
@@ -79,6 +104,8 @@ std::string getFullPath(std::string category, std::string path) {
     return path;
 }
 
+#if !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
+
 int getDesktopResolution(int *w, int *h) {
     SDL_Init(SDL_INIT_VIDEO);
 
@@ -120,6 +147,19 @@ bool init() {
 
     SDL_SetRenderDrawBlendMode(g_renderer, SDL_BLENDMODE_BLEND);
 
+    SDL_RendererInfo rendererInfo;
+    if (SDL_GetRendererInfo(g_renderer, &rendererInfo) == 0) {
+        g_isPresentVsync = (rendererInfo.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+    }
+
+    // VRAM is in the 32-bit BGRA format, alpha is ignored
+    g_texture = SDL_CreateTexture(g_renderer, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    if (g_texture == NULL) {
+        printf("Texture could not be created! SDL Error: %s\n", SDL_GetError());
+        return false;
+    }
+    g_isTextureValid = false;
+
     // Initialize PNG loading
     int imgFlags = IMG_INIT_PNG;
     if ((IMG_Init(imgFlags) & imgFlags) != imgFlags) {
@@ -148,6 +188,8 @@ bool init() {
     return true;
 }
 
+#endif
+
 void *getBufferPointer() {
     return g_buffer;
 }
@@ -177,7 +219,8 @@ void turnOn() {
     }
 }
 
-void updateScreen(uint32_t *buffer);
+// when dirtyRects is nullptr whole screen is updated
+void updateScreen(uint32_t *buffer, const DirtyRects *dirtyRects = nullptr);
 
 void turnOff() {
     if (isOn()) {
@@ -197,32 +240,62 @@ bool isOn() {
 void updateBrightness() {
 }
 
-void updateScreen(uint32_t *buffer) {
+void updateScreen(uint32_t *buffer, const DirtyRects *dirtyRects) {
     g_lastBuffer = buffer;
 
     if (!isOn()) {
+#if !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
+        g_isTextureValid = false;
+#endif
         return;
     }
 
-    SDL_Surface *rgbSurface = SDL_CreateRGBSurfaceFrom(
-        buffer, DISPLAY_WIDTH, DISPLAY_HEIGHT, 32, 4 * DISPLAY_WIDTH, 0, 0, 0, 0);
-    if (rgbSurface != NULL) {
-        SDL_Texture *texture = SDL_CreateTextureFromSurface(g_renderer, rgbSurface);
-        if (texture != NULL) {
-            SDL_Rect srcRect = { 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT };
-            SDL_Rect dstRect = { 0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT };
+    auto frameStartTime = std::chrono::steady_clock::now();
+    uint32_t uploadBytes = 0;
 
-            SDL_RenderCopyEx(g_renderer, texture, &srcRect, &dstRect, 0.0, NULL, SDL_FLIP_NONE);
+#if !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
+    if (g_texture == nullptr) {
+        return;
+    }
 
-            SDL_DestroyTexture(texture);
-        } else {
-            printf("Unable to create texture from image buffer! SDL Error: %s\n", SDL_GetError());
+    // texture has the previous frame, so only the area changed since then has to be uploaded
+    if (dirtyRects != nullptr && g_isTextureValid) {
+        for (int i = 0; i < dirtyRects->count; i++) {
+            const DirtyRect &dirtyRect = dirtyRects->rects[i];
+            SDL_Rect rect = { dirtyRect.x1, dirtyRect.y1, dirtyRect.x2 - dirtyRect.x1 + 1, dirtyRect.y2 - dirtyRect.y1 + 1 };
+            if (SDL_UpdateTexture(g_texture, &rect, buffer + rect.y * DISPLAY_WIDTH + rect.x, 4 * DISPLAY_WIDTH) != 0) {
+                printf("Unable to update texture! SDL Error: %s\n", SDL_GetError());
+            }
+            uploadBytes += 4 * rect.w * rect.h;
         }
-        SDL_FreeSurface(rgbSurface);
     } else {
-        printf("Unable to render text surface! SDL Error: %s\n", SDL_GetError());
+        if (SDL_UpdateTexture(g_texture, NULL, buffer, 4 * DISPLAY_WIDTH) != 0) {
+            printf("Unable to update texture! SDL Error: %s\n", SDL_GetError());
+        }
+        uploadBytes = 4 * DISPLAY_WIDTH * DISPLAY_HEIGHT;
+        g_isTextureValid = true;
     }
+
+    SDL_RenderCopy(g_renderer, g_texture, NULL, NULL);
     SDL_RenderPresent(g_renderer);
+
+    g_isFramePresented = true;
+#endif
+
+    uint32_t frameTimeUs = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - frameStartTime).count();
+
+    g_frameStatistics.numFrames++;
+    g_frameStatistics.lastFrameTimeUs = frameTimeUs;
+    if (frameTimeUs > g_frameStatistics.maxFrameTimeUs) {
+        g_frameStatistics.maxFrameTimeUs = frameTimeUs;
+    }
+    g_frameStatistics.totalFrameTimeUs += frameTimeUs;
+    g_frameStatistics.lastUploadBytes = uploadBytes;
+    g_frameStatistics.totalUploadBytes += uploadBytes;
+}
+
+void getFrameStatistics(FrameStatistics &statistics) {
+    statistics = g_frameStatistics;
 }
 
 void animate() {
@@ -271,21 +344,38 @@ void doTakeScreenshot() {
 }
 
 void sync() {
-    static uint32_t g_lastTickCount;
-    uint32_t tickCount = millis();
-    int32_t diff = 1000 / 60 - (tickCount - g_lastTickCount);
-    g_lastTickCount = tickCount;
-    if (diff > 0 && diff < 1000 / 60) {
-        SDL_Delay(diff);
+    if (osKernelIsVirtualTime()) {
+        // screen is still refreshed in real time, while the rest of the firmware
+        // runs in virtual time as fast as it can
+        osThreadEnterExternalWait();
+        std::this_thread::sleep_for(std::chrono::milliseconds(FRAME_TIME_MS));
+        osThreadExitExternalWait();
+    } else {
+        static uint32_t g_lastTickCount;
+        uint32_t tickCount = millis();
+        int32_t diff = FRAME_TIME_MS - (tickCount - g_lastTickCount);
+        g_lastTickCount = tickCount;
+#if !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
+        if (g_isPresentVsync && g_isFramePresented) {
+            // last present already waited for the vertical blank
+            diff = 0;
+        }
+        g_isFramePresented = false;
+#endif
+        if (diff > 0 && diff < (int32_t)FRAME_TIME_MS) {
+            osDelay(diff);
+        }
     }
 
     if (!isOn()) {
         return;
     }
 
+#if !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
     if (g_mainWindow == nullptr) {
         init();
     }
+#endif
 
     if (g_animationState.enabled) {
         animate();
@@ -302,7 +392,7 @@ void sync() {
     }
 
     if (isDirty()) {
-        updateScreen(g_buffer);
+        updateScreen(g_buffer, &getDirtyRects());
 
         if (g_buffer == (uint32_t *)VRAM_BUFFER1_START_ADDRESS) {
             g_buffer = (uint32_t *)VRAM_BUFFER2_START_ADDRESS;
@@ -358,29 +448,14 @@ const uint8_t *takeScreenshot() {
 ////////////////////////////////////////////////////////////////////////////////
 
 static void doDrawGlyph(const gui::font::Glyph &glyph, int x_glyph, int y_glyph, int width, int height, int offset, int iStartByte) {
-    uint32_t pixel;
-    ((uint8_t *)&pixel)[0] = COLOR_TO_B(g_fc);
-    ((uint8_t *)&pixel)[1] = COLOR_TO_G(g_fc);
-    ((uint8_t *)&pixel)[2] = COLOR_TO_R(g_fc);
-    uint8_t *pixelAlpha = ((uint8_t *)&pixel) + 3;
-
     const uint8_t *src = glyph.data + offset + iStartByte;
-    int nlSrc = glyph.width - width;
-
     uint32_t *dst = g_buffer + y_glyph * DISPLAY_WIDTH + x_glyph;
-    int nlDst = DISPLAY_WIDTH - width;
-
-    for (const uint8_t *srcEnd = src + height * glyph.width; src != srcEnd; src += nlSrc, dst += nlDst) {
-        for (uint32_t *dstEnd = dst + width; dst != dstEnd; src++, dst++) {
-            *pixelAlpha = *src;
-            *dst = blendColor(pixel, *dst);
-        }
-    }
+    kernels::drawGlyph(dst, DISPLAY_WIDTH, src, glyph.width, width, height, color16to32(g_fc));
 }
 
 static int8_t drawGlyph(int x1, int y1, int clip_x1, int clip_y1, int clip_x2, int clip_y2, uint8_t encoding) {
     gui::font::Glyph glyph;
-    g_font.getGlyph(encoding, glyph);
+    getGlyph(g_font, encoding, glyph);
     if (!glyph) {
         return 0;
     }
@@ -467,19 +542,10 @@ void fillRect(int x1, int y1, int x2, int y2, int r) {
         uint32_t *dst = g_buffer + y1 * DISPLAY_WIDTH + x1;
         int width = x2 - x1 + 1;
         int height = y2 - y1 + 1;
-        int nl = DISPLAY_WIDTH - width;
         if (g_opacity == 255) {
-            for (uint32_t *dstEnd = dst + height * DISPLAY_WIDTH; dst != dstEnd; dst += nl) {
-                for (uint32_t *lineEnd = dst + width; dst != lineEnd; dst++) {
-                    *dst = color32;
-                }
-            }
+            kernels::fill(dst, DISPLAY_WIDTH, width, height, color32);
         } else {
-            for (uint32_t *dstEnd = dst + height * DISPLAY_WIDTH; dst != dstEnd; dst += nl) {
-                for (uint32_t *lineEnd = dst + width; dst != lineEnd; dst++) {
-                    *dst = blendColor(color32, *dst);
-                }
-            }
+            kernels::fillBlend(dst, DISPLAY_WIDTH, width, height, color32);
         }
     } else {
         fillRoundedRect(x1, y1, x2, y2, r);
@@ -489,15 +555,8 @@ void fillRect(int x1, int y1, int x2, int y2, int r) {
 }
 
 void fillRect(void *dstBuffer, int x1, int y1, int x2, int y2) {
-    uint32_t color32 = color16to32(g_fc);
     uint32_t *dst = (uint32_t *)dstBuffer + y1 * DISPLAY_WIDTH + x1;
-    int nl = DISPLAY_WIDTH - (x2 - x1 + 1);
-    for (int y = y1; y <= y2; y++) {
-        for (int x = x1; x <= x2; x++) {
-            *dst++ = color32;
-        }
-        dst += nl;
-    }
+    kernels::fill(dst, DISPLAY_WIDTH, x2 - x1 + 1, y2 - y1 + 1, color16to32(g_fc));
 
     markDirty(x1, y1, x2, y2);
 }
@@ -529,18 +588,9 @@ void drawVLine(int x, int y, int l) {
 }
 
 void bitBlt(int x1, int y1, int x2, int y2, int dstx, int dsty) {
-    int width = x2 - x1 + 1;
-
     uint32_t *src = g_buffer + y1 * DISPLAY_WIDTH + x1;
     uint32_t *dst = g_buffer + dsty * DISPLAY_WIDTH + dstx;
-    int nl = DISPLAY_WIDTH - width;
-
-    for (int y = y1; y <= y2; y++, src += nl, dst += nl) {
-        for (uint32_t *lineEnd = dst + width; dst != lineEnd; dst++, src++) {
-            uint8_t *src8 = (uint8_t *)src;
-            *dst = color16to32(RGB_TO_COLOR(src8[2], src8[1], src8[0]));
-        }
-    }
+    kernels::copyRgb565(dst, DISPLAY_WIDTH, src, DISPLAY_WIDTH, x2 - x1 + 1, y2 - y1 + 1);
 
     markDirty(dstx, dsty, dstx + x2 - x1, dsty + y2 - y1);
 }
@@ -551,12 +601,8 @@ void bitBlt(void *src, int x1, int y1, int x2, int y2) {
 }
 
 void bitBlt(void *src, void *dst, int x1, int y1, int x2, int y2) {
-    for (int y = y1; y <= y2; ++y) {
-        for (int x = x1; x <= x2; ++x) {
-            int i = y * DISPLAY_WIDTH + x;
-            ((uint32_t *)dst)[i] = ((uint32_t *)src)[i];
-        }
-    }
+    int i = y1 * DISPLAY_WIDTH + x1;
+    kernels::copy((uint32_t *)dst + i, DISPLAY_WIDTH, (uint32_t *)src + i, DISPLAY_WIDTH, x2 - x1 + 1, y2 - y1 + 1);
 
     markDirty(x1, y1, x2, y2);
 }
@@ -566,23 +612,13 @@ void bitBlt(void *src, void *dst, int sx, int sy, int sw, int sh, int dx, int dy
         dst = g_buffer;
     }
 
+    uint32_t *srcPixels = (uint32_t *)src + sy * DISPLAY_WIDTH + sx;
+    uint32_t *dstPixels = (uint32_t *)dst + dy * DISPLAY_WIDTH + dx;
+
     if (opacity == 255) {
-        for (int y = 0; y < sh; ++y) {
-            for (int x = 0; x < sw; ++x) {
-                ((uint32_t *)dst)[(dy + y) * DISPLAY_WIDTH + dx + x] = ((uint32_t *)src)[(sy + y) * DISPLAY_WIDTH + sx + x];
-            }
-        }
+        kernels::copy(dstPixels, DISPLAY_WIDTH, srcPixels, DISPLAY_WIDTH, sw, sh);
     } else {
-        for (int y = 0; y < sh; ++y) {
-            for (int x = 0; x < sw; ++x) {
-                uint8_t *p = (uint8_t *)&((uint32_t *)src)[(sy + y) * DISPLAY_WIDTH + sx + x];
-                p[3] = opacity;
-                ((uint32_t *)dst)[(dy + y) * DISPLAY_WIDTH + dx + x] = blendColor(
-                    ((uint32_t *)src)[(sy + y) * DISPLAY_WIDTH + sx + x],
-                    ((uint32_t *)dst)[(dy + y) * DISPLAY_WIDTH + dx + x]
-                );
-            }
-        }
+        kernels::copyWithOpacity(dstPixels, DISPLAY_WIDTH, srcPixels, DISPLAY_WIDTH, sw, sh, opacity);
     }
 }
 
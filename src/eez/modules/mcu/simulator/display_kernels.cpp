@@ -0,0 +1,464 @@
+/*
+ * EEZ Modular Firmware
+ * Copyright (C) 2015-present, Envox d.o.o.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#if OPTION_DISPLAY
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define KERNELS_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include <eez/system.h>
+#include <eez/modules/mcu/display.h>
+#include <eez/modules/mcu/simulator/display_kernels.h>
+
+namespace eez {
+namespace mcu {
+namespace display {
+namespace kernels {
+
+static const uint32_t ALPHA_MASK = 0xFF000000;
+static const uint32_t RGB565_MASK = 0x00F8FCF8;
+
+////////////////////////////////////////////////////////////////////////////////
+
+// Same as blendColor when background is opaque (which is almost always the
+// case), i.e. (fg * a + bg * (255 - a)) / 255 for each color component.
+static inline uint32_t blendOpaque(uint32_t fg, uint32_t bg, uint32_t a) {
+    uint32_t ia = 255 - a;
+    uint32_t b = ((fg & 0xFF) * a + (bg & 0xFF) * ia) / 255;
+    uint32_t g = (((fg >> 8) & 0xFF) * a + ((bg >> 8) & 0xFF) * ia) / 255;
+    uint32_t r = (((fg >> 16) & 0xFF) * a + ((bg >> 16) & 0xFF) * ia) / 255;
+    return ALPHA_MASK | (r << 16) | (g << 8) | b;
+}
+
+static inline uint32_t blendPixel(uint32_t fg, uint32_t bg) {
+    if ((bg & ALPHA_MASK) == ALPHA_MASK) {
+        return blendOpaque(fg, bg, fg >> 24);
+    }
+    return blendColor(fg, bg);
+}
+
+#if KERNELS_SSE2
+
+// exact x / 255 for x <= 255 * 255
+static inline __m128i div255(__m128i x) {
+    return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), _mm_srli_epi16(x, 8)), 8);
+}
+
+// blends 4 pixels over opaque background, a contains alpha for each byte
+static inline __m128i blend4(__m128i fg, __m128i bg, __m128i a) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i c255 = _mm_set1_epi16(255);
+
+    __m128i aLo = _mm_unpacklo_epi8(a, zero);
+    __m128i aHi = _mm_unpackhi_epi8(a, zero);
+
+    __m128i lo = div255(_mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpacklo_epi8(fg, zero), aLo),
+        _mm_mullo_epi16(_mm_unpacklo_epi8(bg, zero), _mm_sub_epi16(c255, aLo))));
+    __m128i hi = div255(_mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpackhi_epi8(fg, zero), aHi),
+        _mm_mullo_epi16(_mm_unpackhi_epi8(bg, zero), _mm_sub_epi16(c255, aHi))));
+
+    return _mm_or_si128(_mm_packus_epi16(lo, hi), _mm_set1_epi32(ALPHA_MASK));
+}
+
+static inline bool isOpaque4(__m128i bg) {
+    __m128i alphaMask = _mm_set1_epi32(ALPHA_MASK);
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(bg, alphaMask), alphaMask)) == 0xFFFF;
+}
+
+// alpha of 4 pixels replicated to all the bytes of the pixel
+static inline __m128i expandAlpha4(const uint8_t *src) {
+    uint32_t a;
+    memcpy(&a, src, 4);
+    __m128i a16 = _mm_unpacklo_epi8(_mm_cvtsi32_si128(a), _mm_setzero_si128());
+    __m128i a32 = _mm_unpacklo_epi16(a16, a16);
+    return _mm_packus_epi16(_mm_unpacklo_epi32(a32, a32), _mm_unpackhi_epi32(a32, a32));
+}
+
+#elif KERNELS_NEON
+
+static inline uint8x8_t blend2(uint8x8_t fg, uint8x8_t bg, uint8x8_t a) {
+    uint16x8_t x = vmlal_u8(vmull_u8(fg, a), bg, vsub_u8(vdup_n_u8(255), a));
+    // exact x / 255 for x <= 255 * 255
+    x = vshrq_n_u16(vaddq_u16(vaddq_u16(x, vdupq_n_u16(1)), vshrq_n_u16(x, 8)), 8);
+    return vmovn_u16(x);
+}
+
+// blends 4 pixels over opaque background, a contains alpha for each byte
+static inline uint32x4_t blend4(uint32x4_t fg, uint32x4_t bg, uint8x16_t a) {
+    uint8x16_t fg8 = vreinterpretq_u8_u32(fg);
+    uint8x16_t bg8 = vreinterpretq_u8_u32(bg);
+    uint8x16_t result = vcombine_u8(
+        blend2(vget_low_u8(fg8), vget_low_u8(bg8), vget_low_u8(a)),
+        blend2(vget_high_u8(fg8), vget_high_u8(bg8), vget_high_u8(a)));
+    return vorrq_u32(vreinterpretq_u32_u8(result), vdupq_n_u32(ALPHA_MASK));
+}
+
+static inline bool isOpaque4(uint32x4_t bg) {
+    uint32x4_t alphaMask = vdupq_n_u32(ALPHA_MASK);
+    uint32x4_t eq = vceqq_u32(vandq_u32(bg, alphaMask), alphaMask);
+    uint32x2_t eq2 = vand_u32(vget_low_u32(eq), vget_high_u32(eq));
+    return (vget_lane_u32(eq2, 0) & vget_lane_u32(eq2, 1)) == 0xFFFFFFFF;
+}
+
+// alpha of 4 pixels replicated to all the bytes of the pixel
+static inline uint8x16_t expandAlpha4(const uint8_t *src) {
+    uint32_t a[4] = { src[0], src[1], src[2], src[3] };
+    return vreinterpretq_u8_u32(vmulq_n_u32(vld1q_u32(a), 0x01010101));
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+void fill(uint32_t *dst, int dstStride, int width, int height, uint32_t color) {
+    for (int y = 0; y < height; y++, dst += dstStride) {
+        int x = 0;
+#if KERNELS_SSE2
+        __m128i color4 = _mm_set1_epi32(color);
+        for (; x + 4 <= width; x += 4) {
+            _mm_storeu_si128((__m128i *)(dst + x), color4);
+        }
+#elif KERNELS_NEON
+        uint32x4_t color4 = vdupq_n_u32(color);
+        for (; x + 4 <= width; x += 4) {
+            vst1q_u32(dst + x, color4);
+        }
+#endif
+        for (; x < width; x++) {
+            dst[x] = color;
+        }
+    }
+}
+
+void fillBlend(uint32_t *dst, int dstStride, int width, int height, uint32_t color) {
+    for (int y = 0; y < height; y++, dst += dstStride) {
+        int x = 0;
+#if KERNELS_SSE2
+        __m128i color4 = _mm_set1_epi32(color);
+        __m128i a = _mm_set1_epi8((char)(color >> 24));
+        for (; x + 4 <= width; x += 4) {
+            __m128i bg = _mm_loadu_si128((const __m128i *)(dst + x));
+            if (isOpaque4(bg)) {
+                _mm_storeu_si128((__m128i *)(dst + x), blend4(color4, bg, a));
+            } else {
+                for (int i = 0; i < 4; i++) {
+                    dst[x + i] = blendPixel(color, dst[x + i]);
+                }
+            }
+        }
+#elif KERNELS_NEON
+        uint32x4_t color4 = vdupq_n_u32(color);
+        uint8x16_t a = vdupq_n_u8((uint8_t)(color >> 24));
+        for (; x + 4 <= width; x += 4) {
+            uint32x4_t bg = vld1q_u32(dst + x);
+            if (isOpaque4(bg)) {
+                vst1q_u32(dst + x, blend4(color4, bg, a));
+            } else {
+                for (int i = 0; i < 4; i++) {
+                    dst[x + i] = blendPixel(color, dst[x + i]);
+                }
+            }
+        }
+#endif
+        for (; x < width; x++) {
+            dst[x] = blendPixel(color, dst[x]);
+        }
+    }
+}
+
+void drawGlyph(uint32_t *dst, int dstStride, const uint8_t *src, int srcStride, int width, int height, uint32_t color) {
+    color &= ~ALPHA_MASK;
+
+    for (int y = 0; y < height; y++, dst += dstStride, src += srcStride) {
+        int x = 0;
+#if KERNELS_SSE2
+        __m128i color4 = _mm_set1_epi32(color);
+        for (; x + 4 <= width; x += 4) {
+            __m128i bg = _mm_loadu_si128((const __m128i *)(dst + x));
+            if (isOpaque4(bg)) {
+                uint32_t a;
+                memcpy(&a, src + x, 4);
+                if (a == 0xFFFFFFFF) {
+                    _mm_storeu_si128((__m128i *)(dst + x), _mm_or_si128(color4, _mm_set1_epi32(ALPHA_MASK)));
+                } else if (a != 0) {
+                    _mm_storeu_si128((__m128i *)(dst + x), blend4(color4, bg, expandAlpha4(src + x)));
+                }
+            } else {
+                for (int i = 0; i < 4; i++) {
+                    dst[x + i] = blendPixel(color | (src[x + i] << 24), dst[x + i]);
+                }
+            }
+        }
+#elif KERNELS_NEON
+        uint32x4_t color4 = vdupq_n_u32(color);
+        for (; x + 4 <= width; x += 4) {
+            uint32x4_t bg = vld1q_u32(dst + x);
+            if (isOpaque4(bg)) {
+                uint32_t a;
+                memcpy(&a, src + x, 4);
+                if (a == 0xFFFFFFFF) {
+                    vst1q_u32(dst + x, vorrq_u32(color4, vdupq_n_u32(ALPHA_MASK)));
+                } else if (a != 0) {
+                    vst1q_u32(dst + x, blend4(color4, bg, expandAlpha4(src + x)));
+                }
+            } else {
+                for (int i = 0; i < 4; i++) {
+                    dst[x + i] = blendPixel(color | (src[x + i] << 24), dst[x + i]);
+                }
+            }
+        }
+#endif
+        for (; x < width; x++) {
+            dst[x] = blendPixel(color | (src[x] << 24), dst[x]);
+        }
+    }
+}
+
+void copy(uint32_t *dst, int dstStride, const uint32_t *src, int srcStride, int width, int height) {
+    for (int y = 0; y < height; y++, dst += dstStride, src += srcStride) {
+        memmove(dst, src, width * sizeof(uint32_t));
+    }
+}
+
+void copyWithOpacity(uint32_t *dst, int dstStride, uint32_t *src, int srcStride, int width, int height, uint8_t opacity) {
+    // source alpha is replaced with the opacity, as it was always done
+    uint32_t alpha = (uint32_t)opacity << 24;
+
+    for (int y = 0; y < height; y++, dst += dstStride, src += srcStride) {
+        int x = 0;
+#if KERNELS_SSE2
+        __m128i alpha4 = _mm_set1_epi32(alpha);
+        __m128i rgbMask = _mm_set1_epi32(~ALPHA_MASK);
+        __m128i a = _mm_set1_epi8((char)opacity);
+        for (; x + 4 <= width; x += 4) {
+            __m128i fg = _mm_or_si128(_mm_and_si128(_mm_loadu_si128((const __m128i *)(src + x)), rgbMask), alpha4);
+            _mm_storeu_si128((__m128i *)(src + x), fg);
+            __m128i bg = _mm_loadu_si128((const __m128i *)(dst + x));
+            if (isOpaque4(bg)) {
+                _mm_storeu_si128((__m128i *)(dst + x), blend4(fg, bg, a));
+            } else {
+                for (int i = 0; i < 4; i++) {
+                    dst[x + i] = blendPixel(src[x + i], dst[x + i]);
+                }
+            }
+        }
+#elif KERNELS_NEON
+        uint32x4_t alpha4 = vdupq_n_u32(alpha);
+        uint32x4_t rgbMask = vdupq_n_u32(~ALPHA_MASK);
+        uint8x16_t a = vdupq_n_u8(opacity);
+        for (; x + 4 <= width; x += 4) {
+            uint32x4_t fg = vorrq_u32(vandq_u32(vld1q_u32(src + x), rgbMask), alpha4);
+            vst1q_u32(src + x, fg);
+            uint32x4_t bg = vld1q_u32(dst + x);
+            if (isOpaque4(bg)) {
+                vst1q_u32(dst + x, blend4(fg, bg, a));
+            } else {
+                for (int i = 0; i < 4; i++) {
+                    dst[x + i] = blendPixel(src[x + i], dst[x + i]);
+                }
+            }
+        }
+#endif
+        for (; x < width; x++) {
+            src[x] = (src[x] & ~ALPHA_MASK) | alpha;
+            dst[x] = blendPixel(src[x], dst[x]);
+        }
+    }
+}
+
+void copyRgb565(uint32_t *dst, int dstStride, const uint32_t *src, int srcStride, int width, int height) {
+    for (int y = 0; y < height; y++, dst += dstStride, src += srcStride) {
+        int x = 0;
+#if KERNELS_SSE2
+        __m128i mask = _mm_set1_epi32(RGB565_MASK);
+        __m128i alpha = _mm_set1_epi32(ALPHA_MASK);
+        for (; x + 4 <= width; x += 4) {
+            __m128i pixels = _mm_loadu_si128((const __m128i *)(src + x));
+            _mm_storeu_si128((__m128i *)(dst + x), _mm_or_si128(_mm_and_si128(pixels, mask), alpha));
+        }
+#elif KERNELS_NEON
+        uint32x4_t mask = vdupq_n_u32(RGB565_MASK);
+        uint32x4_t alpha = vdupq_n_u32(ALPHA_MASK);
+        for (; x + 4 <= width; x += 4) {
+            vst1q_u32(dst + x, vorrq_u32(vandq_u32(vld1q_u32(src + x), mask), alpha));
+        }
+#endif
+        for (; x < width; x++) {
+            dst[x] = (src[x] & RGB565_MASK) | ALPHA_MASK;
+        }
+    }
+}
+
+const char *getInstructionSet() {
+#if KERNELS_SSE2
+    return "SSE2";
+#elif KERNELS_NEON
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Reference loops, the way it was done before the kernels, used by benchmark
+
+static void fillBlendReference(uint32_t *dst, int dstStride, int width, int height, uint32_t color) {
+    for (int y = 0; y < height; y++, dst += dstStride) {
+        for (int x = 0; x < width; x++) {
+            dst[x] = blendColor(color, dst[x]);
+        }
+    }
+}
+
+static void drawGlyphReference(uint32_t *dst, int dstStride, const uint8_t *src, int srcStride, int width, int height, uint32_t color) {
+    uint32_t pixel = color;
+    uint8_t *pixelAlpha = ((uint8_t *)&pixel) + 3;
+    for (int y = 0; y < height; y++, dst += dstStride, src += srcStride) {
+        for (int x = 0; x < width; x++) {
+            *pixelAlpha = src[x];
+            dst[x] = blendColor(pixel, dst[x]);
+        }
+    }
+}
+
+static void copyWithOpacityReference(uint32_t *dst, int dstStride, uint32_t *src, int srcStride, int width, int height, uint8_t opacity) {
+    for (int y = 0; y < height; y++, dst += dstStride, src += srcStride) {
+        for (int x = 0; x < width; x++) {
+            ((uint8_t *)&src[x])[3] = opacity;
+            dst[x] = blendColor(src[x], dst[x]);
+        }
+    }
+}
+
+static void copyRgb565Reference(uint32_t *dst, int dstStride, const uint32_t *src, int srcStride, int width, int height) {
+    for (int y = 0; y < height; y++, dst += dstStride, src += srcStride) {
+        for (int x = 0; x < width; x++) {
+            uint8_t *src8 = (uint8_t *)&src[x];
+            dst[x] = color16to32(RGB_TO_COLOR(src8[2], src8[1], src8[0]));
+        }
+    }
+}
+
+static const int BENCHMARK_WIDTH = 480;
+static const int BENCHMARK_HEIGHT = 272;
+static const int BENCHMARK_ITERATIONS = 20;
+
+static uint32_t *g_benchmarkDst;
+static uint32_t *g_benchmarkSrc;
+static uint8_t *g_benchmarkGlyph;
+
+static void initBenchmarkBuffers() {
+    for (int i = 0; i < BENCHMARK_WIDTH * BENCHMARK_HEIGHT; i++) {
+        g_benchmarkDst[i] = ALPHA_MASK | (i * 2654435761u >> 8);
+        g_benchmarkSrc[i] = ALPHA_MASK | (i * 40503u);
+        // mostly fully transparent or opaque, like antialiased text
+        uint32_t r = i * 2246822519u >> 24;
+        g_benchmarkGlyph[i] = r < 128 ? 0 : r < 224 ? 255 : (uint8_t)r;
+    }
+}
+
+static float measure(int kernel) {
+    static const uint32_t COLOR = 0xFF3080C0;
+    static const uint32_t COLOR_BLEND = 0x803080C0;
+    static const uint8_t OPACITY = 200;
+
+    initBenchmarkBuffers();
+
+    uint32_t start = micros();
+
+    for (int i = 0; i < BENCHMARK_ITERATIONS; i++) {
+        uint32_t *dst = g_benchmarkDst;
+        uint32_t *src = g_benchmarkSrc;
+        int stride = BENCHMARK_WIDTH;
+        int w = BENCHMARK_WIDTH;
+        int h = BENCHMARK_HEIGHT;
+
+        switch (kernel) {
+        case 0: fill(dst, stride, w, h, COLOR); break;
+        case 1: fillBlend(dst, stride, w, h, COLOR_BLEND); break;
+        case 2: fillBlendReference(dst, stride, w, h, COLOR_BLEND); break;
+        case 3: drawGlyph(dst, stride, g_benchmarkGlyph, stride, w, h, COLOR); break;
+        case 4: drawGlyphReference(dst, stride, g_benchmarkGlyph, stride, w, h, COLOR); break;
+        case 5: copyWithOpacity(dst, stride, src, stride, w, h, OPACITY); break;
+        case 6: copyWithOpacityReference(dst, stride, src, stride, w, h, OPACITY); break;
+        case 7: copyRgb565(dst, stride, src, stride, w, h); break;
+        case 8: copyRgb565Reference(dst, stride, src, stride, w, h); break;
+        }
+    }
+
+    uint32_t time = micros() - start;
+    if (time == 0) {
+        time = 1;
+    }
+
+    return 1.0f * BENCHMARK_WIDTH * BENCHMARK_HEIGHT * BENCHMARK_ITERATIONS / time;
+}
+
+void benchmark(char *text, int textLength) {
+    static const char *KERNEL_NAMES[] = {
+        "fill",
+        "fill blend",
+        "fill blend (reference)",
+        "glyph",
+        "glyph (reference)",
+        "opacity blit",
+        "opacity blit (reference)",
+        "rgb565 blit",
+        "rgb565 blit (reference)"
+    };
+    static const int NUM_KERNELS = sizeof(KERNEL_NAMES) / sizeof(const char *);
+
+    g_benchmarkDst = (uint32_t *)malloc(BENCHMARK_WIDTH * BENCHMARK_HEIGHT * sizeof(uint32_t));
+    g_benchmarkSrc = (uint32_t *)malloc(BENCHMARK_WIDTH * BENCHMARK_HEIGHT * sizeof(uint32_t));
+    g_benchmarkGlyph = (uint8_t *)malloc(BENCHMARK_WIDTH * BENCHMARK_HEIGHT);
+
+    if (!g_benchmarkDst || !g_benchmarkSrc || !g_benchmarkGlyph) {
+        snprintf(text, textLength, "out of memory");
+    } else {
+        int n = snprintf(text, textLength, "%s\n", getInstructionSet());
+        for (int kernel = 0; kernel < NUM_KERNELS && n < textLength; kernel++) {
+            n += snprintf(text + n, textLength - n, "%s: %.1f Mpixel/s\n", KERNEL_NAMES[kernel], measure(kernel));
+        }
+    }
+
+    free(g_benchmarkGlyph);
+    free(g_benchmarkSrc);
+    free(g_benchmarkDst);
+
+    g_benchmarkGlyph = nullptr;
+    g_benchmarkSrc = nullptr;
+    g_benchmarkDst = nullptr;
+}
+
+} // namespace kernels
+} // namespace display
+} // namespace mcu
+} // namespace eez
+
+#endif
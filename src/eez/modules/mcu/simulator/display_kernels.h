@@ -0,0 +1,47 @@
+/*
+ * EEZ Modular Firmware
+ * Copyright (C) 2015-present, Envox d.o.o.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace eez {
+namespace mcu {
+namespace display {
+namespace kernels {
+
+// Pixel kernels used by the simulator display. All the buffers are in the
+// 32-bit BGRA format and strides are in pixels. Blending gives exactly the
+// same result as blendColor, SSE2 or NEON is used when available.
+
+void fill(uint32_t *dst, int dstStride, int width, int height, uint32_t color);
+void fillBlend(uint32_t *dst, int dstStride, int width, int height, uint32_t color);
+void drawGlyph(uint32_t *dst, int dstStride, const uint8_t *src, int srcStride, int width, int height, uint32_t color);
+void copy(uint32_t *dst, int dstStride, const uint32_t *src, int srcStride, int width, int height);
+void copyWithOpacity(uint32_t *dst, int dstStride, uint32_t *src, int srcStride, int width, int height, uint8_t opacity);
+void copyRgb565(uint32_t *dst, int dstStride, const uint32_t *src, int srcStride, int width, int height);
+
+const char *getInstructionSet();
+
+// measures all the kernels and the reference scalar loops, result is in Mpixel/s
+void benchmark(char *text, int textLength);
+
+} // namespace kernels
+} // namespace display
+} // namespace mcu
+} // namespace eez
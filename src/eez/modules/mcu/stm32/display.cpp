@@ -557,7 +557,7 @@ const uint8_t *takeScreenshot() {
 static int8_t drawGlyph(int x1, int y1, int clip_x1, int clip_y1, int clip_x2, int clip_y2,
                         uint8_t encoding) {
     gui::font::Glyph glyph;
-    g_font.getGlyph(encoding, glyph);
+    getGlyph(g_font, encoding, glyph);
     if (!glyph) {
         return 0;
     }
@@ -43,6 +43,7 @@
 #include <eez/sound.h>
 #include <eez/index.h>
 #include <eez/gui/gui.h>
+#include <eez/modules/psu/gui/data.h>
 
 #include <eez/modules/bp3c/io_exp.h>
 #include <eez/modules/bp3c/flash_slave.h>
@@ -77,6 +78,59 @@ void ChannelHistory::update() {
             historyLastTickMs += ytViewRateMs;
         }
     }
+
+    uint32_t tickCountMs = millis();
+    if (!acquisitionStarted) {
+        acquisitionStarted = true;
+        acquisitionLastTickMs = tickCountMs;
+    } else {
+        uint32_t acquisitionPeriodMs = (uint32_t)round(channel.acquisitionPeriod * 1000L);
+        uint32_t elapsedMs = tickCountMs - acquisitionLastTickMs;
+        if (elapsedMs >= acquisitionPeriodMs) {
+            // one sample per tick, missed periods are skipped and not repeated
+            uint32_t sequence = acquisitionPosition;
+            AcquisitionSample &sample = acquisitionSamples[sequence % CHANNEL_ACQUISITION_SIZE];
+            sample.timeMs = tickCountMs;
+            sample.u = channel_dispatcher::getUMonLast(channel);
+            sample.i = channel_dispatcher::getIMonLast(channel);
+            acquisitionPosition = sequence + 1;
+
+            acquisitionLastTickMs += elapsedMs - elapsedMs % acquisitionPeriodMs;
+        }
+    }
+}
+
+void ChannelHistory::resetAcquisition() {
+    acquisitionStarted = false;
+}
+
+uint32_t ChannelHistory::getAcquisitionSamples(uint32_t since, uint32_t maxSamples, AcquisitionSample *samples, uint32_t &firstSequence) {
+    // Samples are written from the PSU thread. Slot of the sample which is currently
+    // written is never copied and if the ring was overwritten during copying then repeat.
+    for (int retry = 0; retry < 3; retry++) {
+        uint32_t position = acquisitionPosition;
+
+        uint32_t numSamples = MIN(position, CHANNEL_ACQUISITION_SIZE - 1);
+        if (since > position) {
+            numSamples = 0;
+        } else if (position - since < numSamples) {
+            numSamples = position - since;
+        }
+        if (numSamples > maxSamples) {
+            numSamples = maxSamples;
+        }
+
+        firstSequence = position - numSamples;
+        for (uint32_t i = 0; i < numSamples; i++) {
+            samples[i] = acquisitionSamples[(firstSequence + i) % CHANNEL_ACQUISITION_SIZE];
+        }
+
+        if (acquisitionPosition - firstSequence < CHANNEL_ACQUISITION_SIZE) {
+            return numSamples;
+        }
+    }
+
+    return 0;
 }
 
 float ChannelHistory::getChannel0HistoryValue(uint32_t rowIndex, uint8_t columnIndex, float *max) {
@@ -438,6 +492,7 @@ void Channel::initParams(uint16_t moduleRevision) {
     flags.displayValue1 = DISPLAY_VALUE_VOLTAGE;
     flags.displayValue2 = DISPLAY_VALUE_CURRENT;
     ytViewRate = GUI_YT_VIEW_RATE_DEFAULT;
+    acquisitionPeriod = CHANNEL_ACQUISITION_PERIOD_DEFAULT;
 
     autoRangeCheckLastTickCountMs = 0;
 
@@ -630,6 +685,8 @@ void Channel::reset() {
     flags.displayValue2 = DISPLAY_VALUE_CURRENT;
     ytViewRate = GUI_YT_VIEW_RATE_DEFAULT;
 
+    setAcquisitionPeriod(CHANNEL_ACQUISITION_PERIOD_DEFAULT);
+
     flags.voltageTriggerMode = TRIGGER_MODE_FIXED;
     flags.currentTriggerMode = TRIGGER_MODE_FIXED;
     flags.triggerOutputState = 1;
@@ -643,6 +700,8 @@ void Channel::reset() {
     *label = 0;
     color = 0;
 
+    eez::gui::incrementDataVersions(eez::gui::DATA_VERSION_SOURCE_CHANNEL);
+
 #ifdef EEZ_PLATFORM_SIMULATOR
     simulator.setLoadEnabled(false);
     simulator.load = 10;
@@ -665,6 +724,21 @@ void Channel::resetHistory() {
     }
 }
 
+void Channel::setAcquisitionPeriod(float period) {
+    acquisitionPeriod = period;
+    if (channelHistory) {
+        channelHistory->resetAcquisition();
+    }
+}
+
+uint32_t Channel::getAcquisitionSamples(uint32_t since, uint32_t maxSamples, AcquisitionSample *samples, uint32_t &firstSequence) {
+    if (!channelHistory) {
+        firstSequence = since;
+        return 0;
+    }
+    return channelHistory->getAcquisitionSamples(since, maxSamples, samples, firstSequence);
+}
+
 void Channel::clearProtectionConf() {
     prot_conf.flags.u_state = params.OVP_DEFAULT_STATE;
     if (params.features & CH_FEATURE_HW_OVP) {
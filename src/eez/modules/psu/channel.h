@@ -208,14 +208,26 @@ static const float RAMP_DURATION_PREC = 0.001f;
 
 typedef float(*YtDataGetValueFunctionPointer)(uint32_t rowIndex, uint8_t columnIndex, float *max);
 
+struct AcquisitionSample {
+    uint32_t timeMs;
+    float u;
+    float i;
+};
+
 struct ChannelHistory {
     friend struct Channel;
 
-    ChannelHistory(Channel& channel_) : channel(channel_) {}
+    ChannelHistory(Channel& channel_) : acquisitionStarted(false), acquisitionPosition(0), channel(channel_) {}
 
     void reset();
     void update();
 
+    void resetAcquisition();
+    // Copies at most maxSamples of the most recent acquired samples which sequence number
+    // is greater or equal to since. Returns number of copied samples and the sequence
+    // number of the first copied sample.
+    uint32_t getAcquisitionSamples(uint32_t since, uint32_t maxSamples, AcquisitionSample *samples, uint32_t &firstSequence);
+
     static YtDataGetValueFunctionPointer getChannelHistoryValueFuncs(int channelIndex);
 
 protected:
@@ -225,6 +237,13 @@ protected:
     uint32_t historyPosition;
     uint32_t historyLastTickMs;
 
+    // Acquisition buffer is sampled with the channel acquisitionPeriod,
+    // independently of the ytViewRate used for the history above.
+    bool acquisitionStarted;
+    AcquisitionSample acquisitionSamples[CHANNEL_ACQUISITION_SIZE];
+    volatile uint32_t acquisitionPosition;
+    uint32_t acquisitionLastTickMs;
+
 private: 
     Channel& channel;
 
@@ -402,6 +421,9 @@ public:
 
     float ytViewRate;
 
+    // sampling period of the acquisition buffer read by the FETCh:ARRay queries
+    float acquisitionPeriod;
+
     float outputDelayDuration;
 
     static const size_t CHANNEL_LABEL_MAX_LENGTH = 10;
@@ -556,6 +578,9 @@ public:
     static void resetHistoryForAllChannels();
     void resetHistory();
 
+    void setAcquisitionPeriod(float period);
+    uint32_t getAcquisitionSamples(uint32_t since, uint32_t maxSamples, AcquisitionSample *samples, uint32_t &firstSequence);
+
     TriggerMode getVoltageTriggerMode();
     void setVoltageTriggerMode(TriggerMode mode);
 
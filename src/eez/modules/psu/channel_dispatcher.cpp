@@ -25,6 +25,7 @@
 #include <eez/modules/psu/event_queue.h>
 #include <eez/modules/psu/list_program.h>
 #include <eez/modules/psu/gui/psu.h>
+#include <eez/modules/psu/gui/data.h>
 #include <eez/scpi/regs.h>
 #include <eez/modules/psu/temperature.h>
 #include <eez/modules/psu/trigger.h>
@@ -293,6 +294,8 @@ void setCouplingTypeInPsuThread(CouplingType couplingType) {
 
     delay(100); // Huge pause that allows relay contacts to debounce
 
+    eez::gui::incrementDataVersions(eez::gui::DATA_VERSION_SOURCE_CHANNEL);
+
     g_setCouplingTypeErr = SCPI_RES_OK;
 }
 
@@ -310,6 +313,8 @@ void setTrackingChannels(uint16_t trackingEnabled) {
             }
         }
 
+        eez::gui::incrementDataVersions(eez::gui::DATA_VERSION_SOURCE_CHANNEL);
+
         if (resetTrackingChannels) {
             event_queue::pushEvent(event_queue::EVENT_INFO_CHANNELS_TRACKED);
 
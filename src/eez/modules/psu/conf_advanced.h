@@ -194,6 +194,59 @@
 /// until we declare ethernet initialization failure.
 #define ETHERNET_DHCP_TIMEOUT 15
 
+/// Maximum number of the clients concurrently connected to the ethernet SCPI server.
+/// Each client has its own SCPI session with input and output buffers and error queue,
+/// that is SCPI_PARSER_INPUT_BUFFER_LENGTH + ETHERNET_OUTPUT_BUFFER_SIZE + error queue
+/// and registers, about 7.5 KB of static RAM per session on STM32.
+#if defined(EEZ_PLATFORM_STM32)
+#define ETHERNET_MAX_NUM_CLIENTS 2
+#else
+#define ETHERNET_MAX_NUM_CLIENTS 4
+#endif
+
+/// Size of the output buffer of each ethernet SCPI session. Responses are sent
+/// to the client line by line, except arbitrary block data (MMEM:UPL?, DISP:DATA?)
+/// which is sent in chunks of this size.
+#if defined(EEZ_PLATFORM_STM32)
+#define ETHERNET_OUTPUT_BUFFER_SIZE 2048
+#else
+#define ETHERNET_OUTPUT_BUFFER_SIZE 16384
+#endif
+
+/// Disable Nagle's algorithm on the ethernet SCPI connections, so the response
+/// is sent as soon as it is flushed. Arbitrary block data is still coalesced.
+#define ETHERNET_TCP_NODELAY 1
+
+/// Maximum number of MQTT messages published in one MQTT tick. Changed values which
+/// don't fit into the budget are published in the following ticks.
+#define MQTT_MAX_PUBLISHES_PER_TICK 8
+
+/// Channel value is published to MQTT only if it changed by more than its deadband
+/// since the last publish.
+#define MQTT_DEADBAND_U_SET 0.0f
+#define MQTT_DEADBAND_I_SET 0.0f
+#define MQTT_DEADBAND_U_MON 0.005f
+#define MQTT_DEADBAND_I_MON 0.0005f
+#define MQTT_DEADBAND_TEMPERATURE 0.5f
+
+/// Set to 1 to publish oe, uset, iset, umon, imon and temp of the channel as a single
+/// JSON object to the <host>/dcpsupply/ch/<n>/state topic, instead of one topic per value.
+#define MQTT_CHANNEL_STATE_JSON 0
+
+/// File downloaded with MMEM:DOWNload is synced at most once per this interval and
+/// when download is finished. If SD card error happens, download can continue only
+/// if all the data written to the file is synced, so with 0 file is synced after each
+/// written block and download can always continue after SD card is reinitialized.
+/// Otherwise download fails, the file is kept and MMEM:DOWNload:OFFSet? reports the
+/// synced size, so the client can continue the download with MMEM:DOWNload:OFFSet.
+#define SD_CARD_DOWNLOAD_SYNC_INTERVAL_MS 1000
+
+/// Queued events are written to the event log file in a batch when there are at least
+/// EVENT_LOG_FLUSH_THRESHOLD of them or when the oldest one is queued for
+/// EVENT_LOG_FLUSH_INTERVAL_MS. Threshold must be less than the queue size (50).
+#define EVENT_LOG_FLUSH_THRESHOLD 16
+#define EVENT_LOG_FLUSH_INTERVAL_MS 500
+
 /// Output power is monitored and if its go below DP_NEG_LEV
 /// that is negative value in Watts (default -5 W),
 /// and that condition lasts more then DP_NEG_DELAY seconds (default 5 s),
@@ -211,6 +264,14 @@
 #define GUI_YT_VIEW_RATE_MIN 0.005f
 #define GUI_YT_VIEW_RATE_MAX 300.0f
 
+/// Number of samples in the acquisition buffer of each channel read by FETCh:ARRay queries.
+/// Acquisition period (SENSe:ACQuire:PERiod) is independent of the YT view rate.
+#define CHANNEL_ACQUISITION_SIZE 256
+
+#define CHANNEL_ACQUISITION_PERIOD_DEFAULT 0.01f
+#define CHANNEL_ACQUISITION_PERIOD_MIN 0.001f
+#define CHANNEL_ACQUISITION_PERIOD_MAX 300.0f
+
 #define MAX_LIST_LENGTH 256
 
 #define LIST_DWELL_MIN 0.0001f
@@ -271,6 +332,9 @@
 
 #define CONF_SURVIVE_MODE 0
 
+/// Set to 0 to strip out the measuring of the PSU thread tick stages (DEBUg:TICK?).
+#define CONF_TICK_PROFILER 1
+
 #if CONF_SURVIVE_MODE
 #undef CONF_SKIP_PWRGOOD_TEST
 #define CONF_SKIP_PWRGOOD_TEST 1
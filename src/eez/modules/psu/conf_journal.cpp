@@ -0,0 +1,280 @@
+/*
+ * EEZ Modular Firmware
+ * Copyright (C) 2015-present, Envox d.o.o.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include <eez/util.h>
+
+#include <eez/modules/psu/conf_journal.h>
+
+namespace eez {
+namespace psu {
+namespace conf_journal {
+
+static const uint32_t SEGMENT_MAGIC = 0x4C4E4A43; // "CJNL"
+
+struct SegmentHeader {
+    uint32_t magic;
+    uint32_t sequenceNumber;
+    uint32_t layoutVersion;
+    uint32_t crc;
+};
+
+static_assert(sizeof(SegmentHeader) == SEGMENT_HEADER_SIZE, "wrong segment header size");
+
+// record is prefixed with the segment sequence number when CRC is calculated
+static const uint16_t RECORD_CRC_PREFIX_SIZE = 4;
+static const uint16_t RECORD_BUFFER_SIZE = RECORD_CRC_PREFIX_SIZE + RECORD_OVERHEAD + MAX_RECORD_DATA_SIZE;
+
+static uint16_t getRecordsSize(uint16_t size) {
+    uint16_t numRecords = (size + MAX_RECORD_DATA_SIZE - 1) / MAX_RECORD_DATA_SIZE;
+    return size + numRecords * RECORD_OVERHEAD;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Journal::init(const Storage &storage, uint16_t address, uint8_t numSegments, uint16_t segmentSize, uint32_t layoutVersion) {
+    m_storage = storage;
+    m_address = address;
+    m_numSegments = numSegments;
+    m_segmentSize = segmentSize;
+    m_layoutVersion = layoutVersion;
+
+    m_activeSegment = -1;
+    m_newestSegment = -1;
+    m_sequenceNumber = 0;
+    m_otherLayoutFound = false;
+    m_writePosition = SEGMENT_HEADER_SIZE;
+
+    m_numRecords = 0;
+    m_numAppends = 0;
+    m_numCompactions = 0;
+    m_bytesWritten = 0;
+    m_replayBytesRead = 0;
+}
+
+bool Journal::replay(uint8_t *data, uint16_t dataSize) {
+    m_activeSegment = -1;
+    m_otherLayoutFound = false;
+
+    // new segment must get sequence number higher than any valid segment,
+    // including the segments with other layout version
+    int newestSegment = -1;
+    uint32_t sequenceNumber = 0;
+
+    for (int i = 0; i < m_numSegments; i++) {
+        SegmentHeader header;
+        if (!m_storage.read((uint8_t *)&header, sizeof(SegmentHeader), getSegmentAddress(i))) {
+            continue;
+        }
+        m_replayBytesRead += sizeof(SegmentHeader);
+
+        if (header.magic != SEGMENT_MAGIC || header.crc != crc32((const uint8_t *)&header, offsetof(SegmentHeader, crc))) {
+            continue;
+        }
+
+        if (newestSegment == -1 || (int32_t)(header.sequenceNumber - sequenceNumber) > 0) {
+            newestSegment = i;
+            sequenceNumber = header.sequenceNumber;
+        }
+
+        if (header.layoutVersion != m_layoutVersion) {
+            m_otherLayoutFound = true;
+            continue;
+        }
+
+        if (m_activeSegment == -1 || (int32_t)(header.sequenceNumber - m_sequenceNumber) > 0) {
+            m_activeSegment = i;
+            m_sequenceNumber = header.sequenceNumber;
+        }
+    }
+
+    if (m_activeSegment == -1) {
+        // compaction continues after the newest segment
+        m_newestSegment = newestSegment;
+        m_sequenceNumber = sequenceNumber;
+        return false;
+    }
+
+    uint8_t record[RECORD_BUFFER_SIZE];
+    memcpy(record, &m_sequenceNumber, RECORD_CRC_PREFIX_SIZE);
+    uint8_t *recordHeader = record + RECORD_CRC_PREFIX_SIZE;
+    uint8_t *recordData = recordHeader + RECORD_HEADER_SIZE;
+
+    uint16_t segmentAddress = getSegmentAddress(m_activeSegment);
+    uint16_t position = SEGMENT_HEADER_SIZE;
+    bool readError = false;
+
+    m_numRecords = 0;
+
+    while (position + RECORD_OVERHEAD < m_segmentSize) {
+        if (!m_storage.read(recordHeader, RECORD_HEADER_SIZE, segmentAddress + position)) {
+            readError = true;
+            break;
+        }
+
+        uint16_t offset = recordHeader[0] | (recordHeader[1] << 8);
+        uint16_t size = recordHeader[2];
+        if (size == 0 || size > MAX_RECORD_DATA_SIZE || position + RECORD_OVERHEAD + size > m_segmentSize) {
+            // erased EEPROM or garbage
+            break;
+        }
+
+        if (!m_storage.read(recordData, size + RECORD_CRC_SIZE, segmentAddress + position + RECORD_HEADER_SIZE)) {
+            readError = true;
+            break;
+        }
+        m_replayBytesRead += RECORD_OVERHEAD + size;
+
+        uint32_t crc;
+        memcpy(&crc, recordData + size, RECORD_CRC_SIZE);
+        if (crc != crc32(record, RECORD_CRC_PREFIX_SIZE + RECORD_HEADER_SIZE + size)) {
+            // record left from the previous use of this segment or torn record
+            break;
+        }
+
+        if (offset + size <= dataSize) {
+            memcpy(data + offset, recordData, size);
+        }
+
+        position += RECORD_OVERHEAD + size;
+        m_numRecords++;
+    }
+
+    // Do not append after the record that couldn't be read, because valid records
+    // could be overwritten, instead mark segment as full so the next write compacts.
+    m_writePosition = readError ? m_segmentSize : position;
+
+    return true;
+}
+
+bool Journal::isOtherLayoutFound() const {
+    return m_otherLayoutFound;
+}
+
+bool Journal::hasSpaceFor(uint16_t size) const {
+    return m_activeSegment != -1 && m_writePosition + getRecordsSize(size) <= m_segmentSize;
+}
+
+bool Journal::append(uint16_t offset, const uint8_t *data, uint16_t size) {
+    if (!hasSpaceFor(size)) {
+        return false;
+    }
+
+    // In case of error write position is not changed, so next append will
+    // overwrite whatever was partially written.
+    if (!writeRecords(getSegmentAddress(m_activeSegment) + m_writePosition, m_sequenceNumber, offset, data, size)) {
+        return false;
+    }
+
+    m_writePosition += getRecordsSize(size);
+    m_numRecords += (size + MAX_RECORD_DATA_SIZE - 1) / MAX_RECORD_DATA_SIZE;
+    m_numAppends++;
+
+    return true;
+}
+
+bool Journal::needsCompaction() const {
+    return m_activeSegment == -1 || m_writePosition > m_segmentSize - m_segmentSize / 4;
+}
+
+bool Journal::compact(const uint8_t *data, uint16_t dataSize) {
+    if (SEGMENT_HEADER_SIZE + getRecordsSize(dataSize) > m_segmentSize) {
+        return false;
+    }
+
+    int lastSegment = m_activeSegment != -1 ? m_activeSegment : m_newestSegment;
+    int segmentIndex = lastSegment == -1 ? 0 : (lastSegment + 1) % m_numSegments;
+    uint32_t sequenceNumber = m_sequenceNumber + 1;
+    uint16_t segmentAddress = getSegmentAddress(segmentIndex);
+
+    if (!writeRecords(segmentAddress + SEGMENT_HEADER_SIZE, sequenceNumber, 0, data, dataSize)) {
+        return false;
+    }
+
+    // header is written last, until then previous segment is active
+    SegmentHeader header;
+    header.magic = SEGMENT_MAGIC;
+    header.sequenceNumber = sequenceNumber;
+    header.layoutVersion = m_layoutVersion;
+    header.crc = crc32((const uint8_t *)&header, offsetof(SegmentHeader, crc));
+
+    if (!m_storage.write((const uint8_t *)&header, sizeof(SegmentHeader), segmentAddress)) {
+        return false;
+    }
+    m_bytesWritten += sizeof(SegmentHeader);
+
+    m_activeSegment = segmentIndex;
+    m_sequenceNumber = sequenceNumber;
+    m_writePosition = SEGMENT_HEADER_SIZE + getRecordsSize(dataSize);
+    m_numRecords = (dataSize + MAX_RECORD_DATA_SIZE - 1) / MAX_RECORD_DATA_SIZE;
+    m_numCompactions++;
+
+    return true;
+}
+
+void Journal::getStatistics(Statistics &statistics) const {
+    statistics.activeSegment = m_activeSegment;
+    statistics.sequenceNumber = m_sequenceNumber;
+    statistics.segmentSize = m_segmentSize;
+    statistics.usedBytes = m_activeSegment != -1 ? m_writePosition : 0;
+    statistics.numRecords = m_numRecords;
+    statistics.numAppends = m_numAppends;
+    statistics.numCompactions = m_numCompactions;
+    statistics.bytesWritten = m_bytesWritten;
+    statistics.replayBytesRead = m_replayBytesRead;
+}
+
+uint16_t Journal::getSegmentAddress(int segmentIndex) const {
+    return m_address + segmentIndex * m_segmentSize;
+}
+
+bool Journal::writeRecords(uint16_t address, uint32_t sequenceNumber, uint16_t offset, const uint8_t *data, uint16_t size) {
+    uint8_t record[RECORD_BUFFER_SIZE];
+    memcpy(record, &sequenceNumber, RECORD_CRC_PREFIX_SIZE);
+    uint8_t *recordHeader = record + RECORD_CRC_PREFIX_SIZE;
+    uint8_t *recordData = recordHeader + RECORD_HEADER_SIZE;
+
+    for (uint16_t i = 0; i < size; i += MAX_RECORD_DATA_SIZE) {
+        uint16_t recordOffset = offset + i;
+        uint16_t recordSize = size - i < MAX_RECORD_DATA_SIZE ? size - i : MAX_RECORD_DATA_SIZE;
+
+        recordHeader[0] = recordOffset & 0xFF;
+        recordHeader[1] = recordOffset >> 8;
+        recordHeader[2] = (uint8_t)recordSize;
+        memcpy(recordData, data + i, recordSize);
+
+        uint32_t crc = crc32(record, RECORD_CRC_PREFIX_SIZE + RECORD_HEADER_SIZE + recordSize);
+        memcpy(recordData + recordSize, &crc, RECORD_CRC_SIZE);
+
+        uint16_t recordStorageSize = RECORD_OVERHEAD + recordSize;
+        if (!m_storage.write(recordHeader, recordStorageSize, address)) {
+            return false;
+        }
+        m_bytesWritten += recordStorageSize;
+
+        address += recordStorageSize;
+    }
+
+    return true;
+}
+
+} // namespace conf_journal
+} // namespace psu
+} // namespace eez
@@ -0,0 +1,121 @@
+/*
+ * EEZ Modular Firmware
+ * Copyright (C) 2015-present, Envox d.o.o.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace eez {
+namespace psu {
+namespace conf_journal {
+
+// Log structured storage of a configuration structure in EEPROM.
+//
+// Storage is divided into segments and only one segment, the one with the highest
+// sequence number, is active. Segment starts with a header followed by the records:
+//
+//   |Offset|Size|Description                                 |
+//   |------|----|--------------------------------------------|
+//   |0     |2   |Offset of the data inside the configuration |
+//   |2     |1   |Data size, 1 to MAX_RECORD_DATA_SIZE        |
+//   |3     |N   |Data                                        |
+//   |3 + N |4   |CRC32 of segment sequence number and record |
+//
+// Segment sequence number is part of the record CRC, so records left in the
+// segment from its previous use, as well as the record torn by the power loss,
+// terminate the replay.
+//
+// Segment header also holds the layout version of the configuration structure given
+// to init. Segments with different layout version are not replayed, because record
+// offsets have different meaning in that layout.
+//
+// Compaction writes the snapshot of the complete configuration into the next
+// segment and then its header, so the previous segment stays active until the
+// new one is complete. Segments are used round robin which spreads the wear, and
+// replay never reads more than one segment.
+
+static const uint16_t SEGMENT_HEADER_SIZE = 16;
+static const uint16_t RECORD_HEADER_SIZE = 3;
+static const uint16_t RECORD_CRC_SIZE = 4;
+static const uint16_t RECORD_OVERHEAD = RECORD_HEADER_SIZE + RECORD_CRC_SIZE;
+static const uint16_t MAX_RECORD_DATA_SIZE = 64;
+
+struct Storage {
+    bool (*read)(uint8_t *buffer, uint16_t bufferSize, uint16_t address);
+    bool (*write)(const uint8_t *buffer, uint16_t bufferSize, uint16_t address);
+};
+
+struct Statistics {
+    int activeSegment; // -1 if there is no valid segment
+    uint32_t sequenceNumber;
+    uint16_t segmentSize;
+    uint16_t usedBytes;
+    uint32_t numRecords; // in the active segment
+    uint32_t numAppends;
+    uint32_t numCompactions;
+    uint32_t bytesWritten;
+    uint32_t replayBytesRead;
+};
+
+class Journal {
+public:
+    void init(const Storage &storage, uint16_t address, uint8_t numSegments, uint16_t segmentSize, uint32_t layoutVersion);
+
+    // Applies the active segment records to the data, returns false if there is
+    // no valid segment with the same layout version and data is left untouched
+    // in that case.
+    bool replay(uint8_t *data, uint16_t dataSize);
+
+    // valid segment with different layout version was found by the replay
+    bool isOtherLayoutFound() const;
+
+    bool hasSpaceFor(uint16_t size) const;
+    bool append(uint16_t offset, const uint8_t *data, uint16_t size);
+
+    // more than 3/4 of the active segment is used
+    bool needsCompaction() const;
+    bool compact(const uint8_t *data, uint16_t dataSize);
+
+    void getStatistics(Statistics &statistics) const;
+
+private:
+    Storage m_storage;
+    uint16_t m_address;
+    uint8_t m_numSegments;
+    uint16_t m_segmentSize;
+    uint32_t m_layoutVersion;
+
+    int m_activeSegment;
+    int m_newestSegment; // of any layout, used only if there is no active segment
+    uint32_t m_sequenceNumber;
+    bool m_otherLayoutFound;
+    uint16_t m_writePosition;
+
+    uint32_t m_numRecords;
+    uint32_t m_numAppends;
+    uint32_t m_numCompactions;
+    uint32_t m_bytesWritten;
+    uint32_t m_replayBytesRead;
+
+    uint16_t getSegmentAddress(int segmentIndex) const;
+    bool writeRecords(uint16_t address, uint32_t sequenceNumber, uint16_t offset, const uint8_t *data, uint16_t size);
+};
+
+} // namespace conf_journal
+} // namespace psu
+} // namespace eez
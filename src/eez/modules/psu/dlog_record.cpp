@@ -30,12 +30,14 @@
 #include <eez/modules/psu/dlog_record.h>
 #include <eez/modules/psu/event_queue.h>
 #include <eez/modules/psu/gui/psu.h>
+#include <eez/modules/psu/gui/data.h>
 
 #include <eez/modules/psu/scpi/psu.h>
 
 #include <eez/gui/widgets/yt_graph.h>
 
 #include <eez/libs/sd_fat/sd_fat.h>
+#include <eez/libs/lz4/lz4.h>
 
 #include <eez/memory.h>
 
@@ -46,9 +48,7 @@ using namespace scpi;
 namespace psu {
 namespace dlog_record {
 
-#define CHUNK_SIZE 4096
-
-#define CONF_DLOG_SYNC_FILE_TIME_MS 10000
+#define SECTOR_SIZE 512
 
 #define CONF_WRITE_TIMEOUT_MS 1000
 #define CONF_WRITE_FLUSH_TIMEOUT_MS 10000
@@ -87,6 +87,15 @@ static uint32_t g_countingStarted;
 static double g_currentTime;
 static double g_nextTime;
 
+// Sampling deadlines are kept as exact multiples of the period in nanoseconds,
+// so rounding errors are not accumulated during the long recordings.
+static uint64_t g_periodNs;
+static uint64_t g_durationNs;
+static uint64_t g_nextDeadlineNs;
+static uint64_t g_elapsedUs;
+
+SamplingStatistics g_samplingStatistics;
+
 static unsigned int g_lastSavedBufferIndex;
 static uint32_t g_lastSavedBufferTickCount;
 
@@ -95,6 +104,27 @@ static dlog_file::Writer g_writer(DLOG_RECORD_BUFFER, DLOG_RECORD_BUFFER_SIZE);
 static uint32_t g_fileLength;
 static uint32_t g_numSamples;
 
+static uint32_t g_flushChunkSize = FLUSH_CHUNK_SIZE_DEFAULT;
+static uint32_t g_flushTimeMs = (uint32_t)(FLUSH_TIME_DEFAULT * 1000);
+
+static bool g_compression;
+
+// DLOG V3 frames, see compressedFileWrite
+static uint32_t g_frameIndex;
+static uint32_t g_frameFileOffset;
+static uint32_t g_partialFrameSize;
+static uint32_t g_flushedBufferIndex;
+
+static uint8_t * const FRAME_LZ4_STATE = DLOG_RECORD_FRAME_BUFFER;
+static uint8_t * const FRAME_DATA = FRAME_LZ4_STATE + LZ4_STREAMSIZE;
+static uint8_t * const FRAME_ENCODED_DATA = FRAME_DATA + dlog_file::FRAME_MAX_DATA_SIZE;
+static uint8_t * const FRAME_COMPRESSED = FRAME_ENCODED_DATA + dlog_file::FRAME_MAX_DATA_SIZE;
+
+static_assert(
+    LZ4_STREAMSIZE + 2 * dlog_file::FRAME_MAX_DATA_SIZE + dlog_file::FRAME_HEADER_SIZE + dlog_file::FRAME_MAX_COMPRESSED_SIZE + 3 <= DLOG_RECORD_FRAME_BUFFER_SIZE,
+    "DLOG_RECORD_FRAME_BUFFER_SIZE too small"
+);
+
 ////////////////////////////////////////////////////////////////////////////////
 
 static float getValue(uint32_t rowIndex, uint8_t columnIndex, float *max) {
@@ -149,56 +179,188 @@ static int fileTruncate() {
         return SCPI_ERROR_MASS_STORAGE_ERROR;
     }
 
+    // index of the previous recording with the same file path is no longer valid
+    sd_card::deleteDlogIndexFile(g_parameters.filePath);
+
     return SCPI_RES_OK;
 }
 
-bool getNextWriteBuffer(const uint8_t *&buffer, uint32_t &bufferSize, bool flush) {
-    static uint8_t g_saveBuffer[CHUNK_SIZE];
+// Returns the next part of the DLOG_RECORD_BUFFER that should be written to the file.
+// No copy is made, buffer points directly into the DLOG_RECORD_BUFFER and if that part
+// wraps around the end of DLOG_RECORD_BUFFER it is returned as two buffers.
+static bool getNextWriteBuffer(const uint8_t *&buffer1, uint32_t &bufferSize1, const uint8_t *&buffer2, uint32_t &bufferSize2, bool flush) {
+    buffer1 = nullptr;
+    bufferSize1 = 0;
+    buffer2 = nullptr;
+    bufferSize2 = 0;
 
-    buffer = nullptr;
-    bufferSize = 0;
+    // buffer index is updated only by the high priority thread and
+    // 32-bit read is atomic, so no need for the critical section here
+    uint32_t bufferIndex = g_writer.getBufferIndex();
 
-#if defined(EEZ_PLATFORM_STM32)
-    taskENTER_CRITICAL();
-#endif
     int32_t timeDiff = millis() - g_lastSavedBufferTickCount;
-    uint32_t alignedBufferIndex = (g_writer.getBufferIndex() / 4) * 4;
+    uint32_t alignedBufferIndex = (bufferIndex / 4) * 4;
     uint32_t indexDiff = alignedBufferIndex - g_lastSavedBufferIndex;
-    if (indexDiff > 0 && (flush || timeDiff >= CONF_DLOG_SYNC_FILE_TIME_MS || indexDiff >= CHUNK_SIZE)) {
-        bufferSize = MIN(indexDiff, CHUNK_SIZE);
-        buffer = g_saveBuffer;
+    if (indexDiff == 0) {
+        return true;
+    }
 
-        int32_t i = g_writer.getBufferIndex() - (g_lastSavedBufferIndex + DLOG_RECORD_BUFFER_SIZE);
+    bool timeout = timeDiff >= (int32_t)g_flushTimeMs;
+    if (!flush && !timeout && indexDiff < g_flushChunkSize) {
+        return true;
+    }
 
-        if (i <= 0) {
-            i = 0;
-        } else {
-#if defined(EEZ_PLATFORM_STM32)
-            taskEXIT_CRITICAL();
-#endif
+    if (bufferIndex > g_lastSavedBufferIndex + DLOG_RECORD_BUFFER_SIZE) {
+        abortAfterBufferOverflowError();
+        return false;
+    }
+
+    uint32_t bufferSize = MIN(indexDiff, g_flushChunkSize);
+
+    if (!flush && !timeout) {
+        // keep file writes sector aligned so they can go directly from the buffer to the card
+        uint32_t unaligned = (g_lastSavedBufferIndex + bufferSize) % SECTOR_SIZE;
+        if (unaligned < bufferSize) {
+            bufferSize -= unaligned;
+        }
+    }
+
+    uint32_t tail = g_lastSavedBufferIndex % DLOG_RECORD_BUFFER_SIZE;
+    buffer1 = DLOG_RECORD_BUFFER + tail;
+    if (tail + bufferSize <= DLOG_RECORD_BUFFER_SIZE) {
+        bufferSize1 = bufferSize;
+    } else {
+        bufferSize1 = DLOG_RECORD_BUFFER_SIZE - tail;
+        buffer2 = DLOG_RECORD_BUFFER;
+        bufferSize2 = bufferSize - bufferSize1;
+    }
+
+    return true;
+}
+
+// Compresses numRows rows starting at g_lastSavedBufferIndex into FRAME_COMPRESSED,
+// returns frame size (with header and padding) or 0 in case of error.
+static uint32_t compressFrame(uint32_t numRows) {
+    uint32_t dataSize = numRows * g_recording.numFloatsPerRow * sizeof(float);
+
+    uint32_t tail = g_lastSavedBufferIndex % DLOG_RECORD_BUFFER_SIZE;
+    if (tail + dataSize <= DLOG_RECORD_BUFFER_SIZE) {
+        memcpy(FRAME_DATA, DLOG_RECORD_BUFFER + tail, dataSize);
+    } else {
+        uint32_t dataSize1 = DLOG_RECORD_BUFFER_SIZE - tail;
+        memcpy(FRAME_DATA, DLOG_RECORD_BUFFER + tail, dataSize1);
+        memcpy(FRAME_DATA + dataSize1, DLOG_RECORD_BUFFER, dataSize - dataSize1);
+    }
+
+    dlog_file::encodeFrameData(FRAME_DATA, numRows, g_recording.numFloatsPerRow, FRAME_ENCODED_DATA);
+
+    int compressedSize = LZ4_compress_fast_extState(FRAME_LZ4_STATE,
+        (const char *)FRAME_ENCODED_DATA, (char *)FRAME_COMPRESSED + dlog_file::FRAME_HEADER_SIZE,
+        dataSize, dlog_file::FRAME_MAX_COMPRESSED_SIZE, 1);
+    if (compressedSize <= 0) {
+        return 0;
+    }
+
+    dlog_file::FrameHeader *frameHeader = (dlog_file::FrameHeader *)FRAME_COMPRESSED;
+    frameHeader->frameIndex = g_frameIndex;
+    frameHeader->numRows = numRows;
+    frameHeader->reserved = 0;
+    frameHeader->compressedSize = compressedSize;
+
+    uint32_t frameSize = dlog_file::getFrameSize(compressedSize);
+    uint32_t frameDataEnd = dlog_file::FRAME_HEADER_SIZE + compressedSize;
+    memset(FRAME_COMPRESSED + frameDataEnd, 0, frameSize - frameDataEnd);
+
+    return frameSize;
+}
+
+// Writes DLOG V3 file. Only the full frames are written, except on flush or
+// after the flush time is elapsed when the incomplete last frame is written.
+// Incomplete frame is kept in the buffer (g_lastSavedBufferIndex points to its
+// beginning) and rewritten at the same file position until it is completed.
+static void compressedFileWrite(bool flush) {
+    uint32_t rowSize = g_recording.numFloatsPerRow * sizeof(float);
+    uint32_t frameNumRows = dlog_file::getFrameNumRows(g_recording.numFloatsPerRow);
+
+    uint32_t timeout = millis() + CONF_WRITE_TIMEOUT_MS;
+    while (millis() < timeout) {
+        uint32_t numRows = 0;
+        uint32_t frameSize = 0;
+
+        // header is written first, without compression
+        if (g_frameFileOffset > 0) {
+            uint32_t bufferIndex = g_writer.getBufferIndex();
+            numRows = MIN((bufferIndex - g_lastSavedBufferIndex) / rowSize, frameNumRows);
+            if (numRows < frameNumRows) {
+                bool flushTimeElapsed = (int32_t)(millis() - g_lastSavedBufferTickCount) >= (int32_t)g_flushTimeMs;
+                if (!(flush || flushTimeElapsed) || g_lastSavedBufferIndex + numRows * rowSize == g_flushedBufferIndex) {
+                    return;
+                }
+            }
+
+            frameSize = compressFrame(numRows);
+            if (frameSize == 0) {
+                abortAfterMassStorageError();
+                return;
+            }
+        }
+
+        // check that high priority thread didn't overwrite the data before it was copied
+        if (g_writer.getBufferIndex() > g_lastSavedBufferIndex + DLOG_RECORD_BUFFER_SIZE) {
             abortAfterBufferOverflowError();
-            return false;
+            return;
         }
 
-        if ((uint32_t)i < bufferSize) {
-            uint32_t tail = (g_lastSavedBufferIndex + i) % DLOG_RECORD_BUFFER_SIZE;
-            uint32_t head = (g_lastSavedBufferIndex + bufferSize) % DLOG_RECORD_BUFFER_SIZE;
-            if (tail < head) {
-                memcpy(g_saveBuffer + i, DLOG_RECORD_BUFFER + tail, head - tail);
-            } else {
-                uint32_t n = DLOG_RECORD_BUFFER_SIZE - tail;
-                memcpy(g_saveBuffer, DLOG_RECORD_BUFFER + tail, n);
-                if (head > 0) {
-                    memcpy(g_saveBuffer + n, DLOG_RECORD_BUFFER, head);
+        int err = 0;
+
+        File file;
+        if (file.open(g_recording.parameters.filePath, FILE_OPEN_APPEND | FILE_WRITE)) {
+            const uint8_t *buffer = g_frameFileOffset > 0 ? FRAME_COMPRESSED : DLOG_RECORD_BUFFER;
+            uint32_t bufferSize = g_frameFileOffset > 0 ? frameSize : g_recording.dataOffset;
+
+            if (file.seek(g_frameFileOffset)) {
+                if (file.write(buffer, bufferSize) != bufferSize) {
+                    err = event_queue::EVENT_ERROR_DLOG_WRITE_ERROR;
+                } else if (bufferSize < g_partialFrameSize) {
+                    // previously written incomplete frame was bigger
+                    if (!file.truncate(g_frameFileOffset + bufferSize)) {
+                        err = event_queue::EVENT_ERROR_DLOG_TRUNCATE_ERROR;
+                    }
+                }
+
+                if (!file.close()) {
+                    err = event_queue::EVENT_ERROR_DLOG_WRITE_ERROR;
                 }
+            } else {
+                err = event_queue::EVENT_ERROR_DLOG_SEEK_ERROR;
             }
-        } 
-    }
-#if defined(EEZ_PLATFORM_STM32)
-    taskEXIT_CRITICAL();
-#endif
+        } else {
+            err = event_queue::EVENT_ERROR_DLOG_FILE_REOPEN_ERROR;
+        }
 
-    return true;
+        if (err) {
+            sd_card::reinitialize();
+            return;
+        }
+
+        g_lastSavedBufferTickCount = millis();
+
+        if (g_frameFileOffset == 0) {
+            g_frameFileOffset = g_recording.dataOffset;
+            g_lastSavedBufferIndex = g_recording.dataOffset;
+            g_flushedBufferIndex = g_recording.dataOffset;
+        } else if (numRows == frameNumRows) {
+            g_frameIndex++;
+            g_frameFileOffset += frameSize;
+            g_partialFrameSize = 0;
+            g_lastSavedBufferIndex += numRows * rowSize;
+            g_flushedBufferIndex = g_lastSavedBufferIndex;
+        } else {
+            g_partialFrameSize = frameSize;
+            g_flushedBufferIndex = g_lastSavedBufferIndex + numRows * rowSize;
+            return;
+        }
+    }
 }
 
 // returns true if there is more data to write
@@ -211,16 +373,23 @@ void fileWrite(bool flush) {
         return;
     }
 
+    if (g_compression) {
+        compressedFileWrite(flush);
+        return;
+    }
+
     uint32_t timeout = millis() + CONF_WRITE_TIMEOUT_MS;
     while (millis() < timeout) {
-        const uint8_t *buffer = nullptr;
-        uint32_t bufferSize = 0;
+        const uint8_t *buffer1;
+        uint32_t bufferSize1;
+        const uint8_t *buffer2;
+        uint32_t bufferSize2;
 
-        if (!getNextWriteBuffer(buffer, bufferSize, flush)) {
+        if (!getNextWriteBuffer(buffer1, bufferSize1, buffer2, bufferSize2, flush)) {
         	return;
         }
 
-        if (!buffer) {
+        if (!buffer1) {
             return;
         }
 
@@ -229,9 +398,12 @@ void fileWrite(bool flush) {
         File file;
         if (file.open(g_recording.parameters.filePath, FILE_OPEN_APPEND | FILE_WRITE)) {
             if (file.seek(g_lastSavedBufferIndex)) {
-                size_t written = file.write(buffer, bufferSize);
+                size_t written = file.write(buffer1, bufferSize1);
+                if (written == bufferSize1 && bufferSize2 > 0) {
+                    written += file.write(buffer2, bufferSize2);
+                }
 
-                if (written != bufferSize) {
+                if (written != bufferSize1 + bufferSize2) {
                     err = event_queue::EVENT_ERROR_DLOG_WRITE_ERROR;
                 }
 
@@ -240,7 +412,14 @@ void fileWrite(bool flush) {
                 }
 
                 if (!err) {
-                    g_lastSavedBufferIndex += bufferSize;
+                    // Since there is no copy, check that high priority thread
+                    // didn't overwrite the data while it was written to the file.
+                    if (g_writer.getBufferIndex() > g_lastSavedBufferIndex + DLOG_RECORD_BUFFER_SIZE) {
+                        abortAfterBufferOverflowError();
+                        return;
+                    }
+
+                    g_lastSavedBufferIndex += bufferSize1 + bufferSize2;
                     g_lastSavedBufferTickCount = millis();
                 }
             } else {
@@ -266,7 +445,7 @@ static void flushData() {
 	g_writer.flushBits();
 
     uint32_t timeout = millis() + CONF_WRITE_FLUSH_TIMEOUT_MS;
-    while (g_lastSavedBufferIndex < g_writer.getBufferIndex() && millis() < timeout) {
+    while ((g_compression ? g_flushedBufferIndex : g_lastSavedBufferIndex) < g_writer.getBufferIndex() && millis() < timeout) {
         fileWrite(true);
     }
 
@@ -281,6 +460,13 @@ static void initRecordingStart() {
     g_nextTime = 0;
     g_lastSavedBufferIndex = 0;
 
+    g_frameIndex = 0;
+    g_frameFileOffset = 0;
+    g_partialFrameSize = 0;
+    g_flushedBufferIndex = 0;
+
+    memset(&g_samplingStatistics, 0, sizeof(g_samplingStatistics));
+
     memcpy(&g_recording.parameters, &g_parameters, sizeof(dlog_view::Parameters));
 
     if (isModuleLocalRecording()) {
@@ -293,6 +479,9 @@ static void initRecordingStart() {
     g_recording.xAxisOffset = 0.0f;
     g_recording.xAxisDiv = g_recording.pageSize * g_recording.parameters.period / dlog_view::NUM_HORZ_DIVISIONS;
 
+    g_periodNs = (uint64_t)round(g_recording.parameters.period * 1E9);
+    g_durationNs = (uint64_t)round(g_recording.parameters.duration * 1E9);
+
     if (!g_traceInitiated) {
         dlog_view::initAxis(g_recording);
     }
@@ -322,45 +511,46 @@ static void setState(State newState) {
         }
 
         g_state = newState;
+
+        eez::gui::incrementDataVersions(eez::gui::DATA_VERSION_SOURCE_DLOG);
     }
 }
 
 static void log() {
-    uint32_t tickCountMs = millis();
+    uint32_t tickCountUs = micros();
 
-    static uint32_t g_seconds;
-    static uint32_t g_millis;
     static uint32_t g_iSample;
-    static uint32_t g_lastTickCountMs;
+    static uint32_t g_lastTickCountUs;
 
     if (!g_countingStarted) {
-        g_seconds = 0;
-        g_millis = 0;
+        g_elapsedUs = 0;
         g_iSample = 0;
+        g_nextDeadlineNs = 0;
         g_countingStarted = true;
-        g_lastTickCountMs = tickCountMs;
+        g_lastTickCountUs = tickCountUs;
         return;
     }
-	
-    g_millis += tickCountMs - g_lastTickCountMs;
-    g_lastTickCountMs = tickCountMs;
 
-    if (g_millis >= 1000) {
-        ++g_seconds;
-        g_millis -= 1000;
-    }
+    // unsigned difference is correct even when micros() wraps around
+    g_elapsedUs += tickCountUs - g_lastTickCountUs;
+    g_lastTickCountUs = tickCountUs;
 
-    g_currentTime = g_seconds + g_millis * 1E-3;
+    g_currentTime = g_elapsedUs * 1E-6;
 
     if (g_traceInitiated) {
         // data is logged with the SCPI command `SENSe:DLOG:TRACe[:DATA]`
         return;
     }
 
-    if (g_currentTime >= g_nextTime) {
+    uint64_t elapsedNs = g_elapsedUs * 1000;
+
+    if (elapsedNs >= g_nextDeadlineNs) {
+        uint64_t sampleDeadlineNs;
+
         while (1) {
-            g_nextTime = ++g_iSample * g_recording.parameters.period;
-            if (g_currentTime < g_nextTime || g_nextTime > g_recording.parameters.duration) {
+            sampleDeadlineNs = g_nextDeadlineNs;
+            g_nextDeadlineNs = ++g_iSample * g_periodNs;
+            if (elapsedNs < g_nextDeadlineNs || g_nextDeadlineNs > g_durationNs) {
                 break;
             }
 
@@ -384,8 +574,11 @@ static void log() {
             g_writer.flushBits();
 
             ++g_recording.size;
+            ++g_samplingStatistics.numMissedSamples;
         }
 
+        g_nextTime = g_nextDeadlineNs * 1E-9;
+
         // write sample
         for (int i = 0; i < g_recording.parameters.numDlogItems; i++) {
             auto &dlogItem = g_recording.parameters.dlogItems[i];
@@ -417,7 +610,18 @@ static void log() {
         
         ++g_recording.size;
 
-        if (g_nextTime > g_recording.parameters.duration) {
+        // how late is this sample
+        uint32_t jitterUs = (uint32_t)((elapsedNs - sampleDeadlineNs) / 1000);
+        if (g_samplingStatistics.numSamples == 0 || jitterUs < g_samplingStatistics.minJitterUs) {
+            g_samplingStatistics.minJitterUs = jitterUs;
+        }
+        if (jitterUs > g_samplingStatistics.maxJitterUs) {
+            g_samplingStatistics.maxJitterUs = jitterUs;
+        }
+        g_samplingStatistics.totalJitterUs += jitterUs;
+        ++g_samplingStatistics.numSamples;
+
+        if (g_nextDeadlineNs > g_durationNs) {
             stateTransition(EVENT_FINISH);
         }
     }
@@ -452,7 +656,7 @@ static int doStartImmediately() {
 	}
 
     if (!isModuleLocalRecording()) {
-        g_writer.writeFileHeaderAndMetaFields(g_recording.parameters);
+        g_writer.writeFileHeaderAndMetaFields(g_recording.parameters, g_compression);
     }
     g_recording.dataOffset = g_writer.getDataOffset();
 
@@ -490,6 +694,9 @@ static void resetAllParameters() {
     g_parameters.period = dlog_view::PERIOD_DEFAULT;
     g_parameters.duration = dlog_view::DURATION_DEFAULT;
     setTriggerSource(trigger::SOURCE_IMMEDIATE);
+    setFlushChunkSize(FLUSH_CHUNK_SIZE_DEFAULT);
+    setFlushTime(FLUSH_TIME_DEFAULT);
+    g_compression = false;
 }
 
 static void resetFilePath() {
@@ -501,6 +708,10 @@ static void doFinish(bool afterError) {
         if (!isModuleLocalRecording()) {        
             flushData();
             onSdCardFileChangeHook(g_parameters.filePath);
+
+            if (g_samplingStatistics.numMissedSamples > 0) {
+                event_queue::pushEvent(event_queue::EVENT_WARNING_DLOG_SAMPLES_MISSED);
+            }
         }
     }
     resetFilePath();
@@ -540,6 +751,14 @@ double getCurrentTime() {
     return isModuleLocalRecording() ? (g_numSamples - 1) * g_parameters.period * 1.0 : g_currentTime;
 }
 
+float getRequestedSamplingRate() {
+    return g_recording.parameters.period > 0 ? 1.0f / g_recording.parameters.period : 0.0f;
+}
+
+float getAchievedSamplingRate() {
+    return g_currentTime > 0 ? (float)(g_samplingStatistics.numSamples / g_currentTime) : 0.0f;
+}
+
 uint32_t getFileLength() {
 	return isModuleLocalRecording() ? g_fileLength : g_writer.getFileLength();
 }
@@ -554,6 +773,44 @@ void setNumSamples(uint32_t numSamples) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+int setFlushChunkSize(uint32_t chunkSize) {
+    if (chunkSize < FLUSH_CHUNK_SIZE_MIN || chunkSize > FLUSH_CHUNK_SIZE_MAX) {
+        return SCPI_ERROR_DATA_OUT_OF_RANGE;
+    }
+
+    g_flushChunkSize = (chunkSize / SECTOR_SIZE) * SECTOR_SIZE;
+
+    return SCPI_RES_OK;
+}
+
+uint32_t getFlushChunkSize() {
+    return g_flushChunkSize;
+}
+
+int setFlushTime(float time) {
+    if (time < FLUSH_TIME_MIN || time > FLUSH_TIME_MAX) {
+        return SCPI_ERROR_DATA_OUT_OF_RANGE;
+    }
+
+    g_flushTimeMs = (uint32_t)roundf(time * 1000);
+
+    return SCPI_RES_OK;
+}
+
+float getFlushTime() {
+    return g_flushTimeMs / 1000.0f;
+}
+
+void setCompression(bool enable) {
+    g_compression = enable;
+}
+
+bool getCompression() {
+    return g_compression;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 void setTriggerSource(trigger::Source source) {
     g_parameters.triggerSource = source;
 
@@ -763,6 +1020,38 @@ void log(float *values) {
     }
 }
 
+// rows are packed little-endian floats, numYAxes per row, possibly unaligned
+bool log(const void *rows, uint32_t numRows, int *err) {
+    if (g_state != STATE_EXECUTING) {
+        if (err) {
+            *err = SCPI_ERROR_EXECUTION_ERROR;
+        }
+        return false;
+    }
+
+    uint32_t rowSize = g_recording.parameters.numYAxes * sizeof(float);
+    uint32_t bufferFree = g_lastSavedBufferIndex + DLOG_RECORD_BUFFER_SIZE - g_writer.getBufferIndex();
+    if (numRows * rowSize > bufferFree) {
+        if (err) {
+            *err = SCPI_ERROR_TOO_MUCH_DATA;
+        }
+        return false;
+    }
+
+    const uint8_t *p = (const uint8_t *)rows;
+    for (uint32_t rowIndex = 0; rowIndex < numRows; rowIndex++) {
+        for (int yAxisIndex = 0; yAxisIndex < g_recording.parameters.numYAxes; yAxisIndex++) {
+            float value;
+            memcpy(&value, p, sizeof(float));
+            p += sizeof(float);
+            g_writer.writeFloat(value);
+        }
+    }
+    g_recording.size += numRows;
+
+    return true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 const char *getLatestFilePath() {
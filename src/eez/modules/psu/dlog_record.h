@@ -25,6 +25,14 @@ namespace eez {
 namespace psu {
 namespace dlog_record {
 
+static const uint32_t FLUSH_CHUNK_SIZE_MIN = 512;
+static const uint32_t FLUSH_CHUNK_SIZE_MAX = 32 * 1024;
+static const uint32_t FLUSH_CHUNK_SIZE_DEFAULT = 4096;
+
+static const float FLUSH_TIME_MIN = 0.1f;
+static const float FLUSH_TIME_MAX = 60.0f;
+static const float FLUSH_TIME_DEFAULT = 10.0f;
+
 extern dlog_view::Parameters g_parameters;
 extern dlog_view::Recording g_recording;
 
@@ -34,6 +42,21 @@ enum State {
     STATE_EXECUTING
 };
 
+// Samples are taken from psu::tick(), which runs every 1 ms, at deadlines that are
+// exact multiples of the period. Sub-millisecond rates are out of scope of this
+// sampler: dlog_view::PERIOD_MIN is its shortest period, shorter periods are
+// recorded locally by the module (see getModuleLocalRecordingSlotIndex).
+struct SamplingStatistics {
+    uint32_t numSamples;
+    uint32_t numMissedSamples;
+    uint32_t minJitterUs;
+    uint32_t maxJitterUs;
+    uint64_t totalJitterUs;
+};
+
+// statistics of the current or, if idle, of the last recording
+extern SamplingStatistics g_samplingStatistics;
+
 extern State g_state;
 extern bool g_inStateTransition;
 extern bool g_traceInitiated;
@@ -49,10 +72,23 @@ bool isModuleLocalRecording();
 int getModuleLocalRecordingSlotIndex();
 bool isModuleAtSlotRecording(int slotIndex);
 double getCurrentTime();
+float getRequestedSamplingRate();
+float getAchievedSamplingRate();
 uint32_t getFileLength();
 void setFileLength(uint32_t fileLength);
 void setNumSamples(uint32_t numSamples);
 
+// data is written to the file in chunks of this size or,
+// if there is less data, after the flush time is elapsed
+int setFlushChunkSize(uint32_t chunkSize);
+uint32_t getFlushChunkSize();
+int setFlushTime(float time);
+float getFlushTime();
+
+// if enabled, file is written in DLOG V3 format, i.e. data is compressed
+void setCompression(bool enable);
+bool getCompression();
+
 void setTriggerSource(trigger::Source source);
 
 int checkDlogParameters(dlog_view::Parameters &parameters, bool doNotCheckFilePath, bool forTraceUsage);
@@ -70,6 +106,7 @@ void reset();
 
 void tick();
 void log(float *values);
+bool log(const void *rows, uint32_t numRows, int *err);
 
 void fileWrite(bool flush = false);
 void stateTransition(int event, int *perr = nullptr);
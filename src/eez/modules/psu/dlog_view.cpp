@@ -32,6 +32,7 @@
 #include <eez/modules/psu/scpi/psu.h>
 #include <eez/modules/psu/serial_psu.h>
 #include <eez/modules/psu/gui/psu.h>
+#include <eez/modules/psu/gui/data.h>
 #if OPTION_ETHERNET
 #include <eez/modules/psu/ethernet.h>
 #endif
@@ -40,6 +41,7 @@
 #include <eez/gui/widgets/container.h>
 
 #include <eez/libs/sd_fat/sd_fat.h>
+#include <eez/libs/lz4/lz4.h>
 
 #include <eez/memory.h>
 
@@ -236,12 +238,525 @@ void invalidateAllBlocks() {
     }
 }
 
+static void updateBlockElements(BlockElement *blockElements, const float *row, unsigned numElementsPerRow, bool first) {
+    uint32_t bitMask = 0;
+    uint32_t bits = 0;
+    uint32_t m = 0;
+
+    for (unsigned k = 0; k < numElementsPerRow; k++) {
+        BlockElement *blockElement = blockElements + k;
+
+        float value;
+
+        auto &yAxis = g_recording.parameters.yAxes[k];
+        if (yAxis.unit == UNIT_BIT) {
+            if (bitMask == 0) {
+                bits = *(uint32_t *)&row[m++];
+                bitMask = 0x4000;
+            } else {
+                bitMask >>= 1;
+            }
+
+            value = bits & 0x8000 ? ((bits & bitMask) ? 1.0f : 0.0f) : NAN;
+        } else {
+            bitMask = 0;
+            value = row[m++];
+        }
+
+        if (first) {
+            blockElement->min = blockElement->max = value;
+        } else if (value < blockElement->min) {
+            blockElement->min = value;
+        } else if (value > blockElement->max) {
+            blockElement->max = value;
+        }
+    }
+}
+
+static void mergeBlockElements(BlockElement *blockElements, const BlockElement *fromBlockElements, unsigned numElementsPerRow, bool first) {
+    for (unsigned k = 0; k < numElementsPerRow; k++) {
+        BlockElement *blockElement = blockElements + k;
+        const BlockElement *fromBlockElement = fromBlockElements + k;
+
+        if (first) {
+            *blockElement = *fromBlockElement;
+        } else {
+            if (fromBlockElement->min < blockElement->min) {
+                blockElement->min = fromBlockElement->min;
+            }
+            if (fromBlockElement->max > blockElement->max) {
+                blockElement->max = fromBlockElement->max;
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// DLOG V3 (compressed) files, see "DLOG File Format V3" in dlog_file.h.
+// Frame headers are scanned when file is opened and offset of every
+// g_frameTableStride-th frame is remembered, so any frame can be found
+// by reading at most g_frameTableStride - 1 other frame headers.
+// Last decoded frame is kept in FRAME_DATA.
+
+static const uint32_t FRAME_TABLE_SIZE = 1024;
+
+static uint8_t * const FRAME_COMPRESSED = DLOG_VIEW_FRAME_BUFFER;
+static uint8_t * const FRAME_ENCODED_DATA = FRAME_COMPRESSED + dlog_file::FRAME_MAX_COMPRESSED_SIZE;
+static uint8_t * const FRAME_DATA = FRAME_ENCODED_DATA + dlog_file::FRAME_MAX_DATA_SIZE;
+
+static_assert(
+    dlog_file::FRAME_MAX_COMPRESSED_SIZE + 2 * dlog_file::FRAME_MAX_DATA_SIZE <= DLOG_VIEW_FRAME_BUFFER_SIZE,
+    "DLOG_VIEW_FRAME_BUFFER_SIZE too small"
+);
+
+static bool g_compressed;
+static uint32_t g_frameNumRows;
+static uint32_t g_numFrames;
+static uint32_t g_frameTable[FRAME_TABLE_SIZE];
+static uint32_t g_frameTableStride;
+static int32_t g_decodedFrameIndex;
+static uint32_t g_decodedFrameNumRows;
+
+static bool readFrameHeader(File &file, uint32_t fileSize, uint32_t offset, uint32_t frameIndex, dlog_file::FrameHeader &frameHeader) {
+    if (offset + dlog_file::FRAME_HEADER_SIZE > fileSize) {
+        return false;
+    }
+
+    if (!file.seek(offset) || file.read(&frameHeader, dlog_file::FRAME_HEADER_SIZE) != dlog_file::FRAME_HEADER_SIZE) {
+        return false;
+    }
+
+    return frameHeader.frameIndex == frameIndex &&
+        frameHeader.numRows > 0 && frameHeader.numRows <= g_frameNumRows &&
+        frameHeader.compressedSize <= dlog_file::FRAME_MAX_COMPRESSED_SIZE &&
+        offset + dlog_file::getFrameSize(frameHeader.compressedSize) <= fileSize;
+}
+
+// returns number of rows in the file
+static uint32_t initFrames(File &file) {
+    g_frameNumRows = dlog_file::getFrameNumRows(g_recording.numFloatsPerRow);
+    g_numFrames = 0;
+    g_frameTableStride = 1;
+    g_decodedFrameIndex = -1;
+
+    uint32_t fileSize = file.size();
+    uint32_t offset = g_recording.dataOffset;
+    uint32_t numRows = 0;
+
+    dlog_file::FrameHeader frameHeader;
+    while (readFrameHeader(file, fileSize, offset, g_numFrames, frameHeader)) {
+        if (g_numFrames == FRAME_TABLE_SIZE * g_frameTableStride) {
+            // table is full, keep every other offset
+            for (uint32_t i = 0; i < FRAME_TABLE_SIZE / 2; i++) {
+                g_frameTable[i] = g_frameTable[2 * i];
+            }
+            g_frameTableStride *= 2;
+        }
+
+        if (g_numFrames % g_frameTableStride == 0) {
+            g_frameTable[g_numFrames / g_frameTableStride] = offset;
+        }
+
+        g_numFrames++;
+        numRows += frameHeader.numRows;
+        offset += dlog_file::getFrameSize(frameHeader.compressedSize);
+
+        if (frameHeader.numRows < g_frameNumRows) {
+            // only the last frame can be incomplete
+            break;
+        }
+    }
+
+    return numRows;
+}
+
+static bool loadFrame(File &file, uint32_t frameIndex) {
+    if (g_decodedFrameIndex == (int32_t)frameIndex) {
+        return true;
+    }
+
+    if (frameIndex >= g_numFrames) {
+        return false;
+    }
+
+    g_decodedFrameIndex = -1;
+
+    uint32_t fileSize = file.size();
+    uint32_t i = frameIndex / g_frameTableStride * g_frameTableStride;
+    uint32_t offset = g_frameTable[frameIndex / g_frameTableStride];
+
+    dlog_file::FrameHeader frameHeader;
+    while (true) {
+        if (!readFrameHeader(file, fileSize, offset, i, frameHeader)) {
+            return false;
+        }
+        if (i == frameIndex) {
+            break;
+        }
+        offset += dlog_file::getFrameSize(frameHeader.compressedSize);
+        i++;
+    }
+
+    if (file.read(FRAME_COMPRESSED, frameHeader.compressedSize) != frameHeader.compressedSize) {
+        return false;
+    }
+
+    int dataSize = frameHeader.numRows * g_recording.numFloatsPerRow * sizeof(float);
+    if (LZ4_decompress_safe((const char *)FRAME_COMPRESSED, (char *)FRAME_ENCODED_DATA, frameHeader.compressedSize, dataSize) != dataSize) {
+        return false;
+    }
+
+    dlog_file::decodeFrameData(FRAME_ENCODED_DATA, frameHeader.numRows, g_recording.numFloatsPerRow, FRAME_DATA);
+
+    g_decodedFrameIndex = frameIndex;
+    g_decodedFrameNumRows = frameHeader.numRows;
+
+    return true;
+}
+
+// reads numRows rows, starting from rowIndex, of the opened DLOG file
+static bool readRows(File &file, uint32_t rowIndex, uint32_t numRows, float *rows) {
+    uint32_t rowSize = g_recording.numFloatsPerRow * sizeof(float);
+
+    if (!g_compressed) {
+        uint32_t bytesToRead = numRows * rowSize;
+        return file.seek(g_recording.dataOffset + rowIndex * rowSize) && file.read(rows, bytesToRead) == bytesToRead;
+    }
+
+    uint8_t *dst = (uint8_t *)rows;
+    while (numRows > 0) {
+        if (!loadFrame(file, rowIndex / g_frameNumRows)) {
+            return false;
+        }
+
+        uint32_t frameRowIndex = rowIndex % g_frameNumRows;
+        if (frameRowIndex >= g_decodedFrameNumRows) {
+            return false;
+        }
+
+        uint32_t numFrameRows = MIN(numRows, g_decodedFrameNumRows - frameRowIndex);
+        memcpy(dst, FRAME_DATA + frameRowIndex * rowSize, numFrameRows * rowSize);
+
+        dst += numFrameRows * rowSize;
+        rowIndex += numFrameRows;
+        numRows -= numFrameRows;
+    }
+
+    return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Min/max pyramid index, see "DLOG Index File Format" in dlog_file.h.
+// It is built in the low priority thread, in small steps, the first time
+// the file is opened and later used by loadBlock for zoomed out views.
+
+static const uint32_t INDEX_FIRST_DECIMATION = 16;
+static const uint32_t INDEX_DECIMATION_FACTOR = 4;
+static const uint32_t INDEX_MIN_NUM_ROWS = INDEX_FIRST_DECIMATION * VIEW_WIDTH;
+static const uint32_t INDEX_BUILD_STEP_NUM_ROWS = 64; // output rows per build step
+static const uint32_t INDEX_READ_NUM_ROWS = 16;
+
+enum IndexState {
+    INDEX_STATE_NONE,
+    INDEX_STATE_BUILDING,
+    INDEX_STATE_READY
+};
+
+static IndexState g_indexState;
+static char g_indexFilePath[MAX_PATH_LENGTH + dlog_file::INDEX_FILE_PATH_EXTRA_LENGTH + 1];
+static dlog_file::IndexHeader g_indexHeader;
+static uint32_t g_indexLevelOffsets[dlog_file::INDEX_MAX_NUM_OF_LEVELS];
+static uint32_t g_indexLevelNumRows[dlog_file::INDEX_MAX_NUM_OF_LEVELS];
+static uint32_t g_indexBuildLevel;
+static uint32_t g_indexBuildRowIndex;
+
+static float g_indexReadBuffer[MAX(dlog_file::MAX_NUM_OF_Y_AXES, 2 * MAX_NUM_OF_Y_VALUES) * INDEX_READ_NUM_ROWS];
+static BlockElement g_indexWriteBuffer[MAX_NUM_OF_Y_VALUES * INDEX_BUILD_STEP_NUM_ROWS];
+
+static uint32_t getIndexRowSize() {
+    return g_indexHeader.numValues * sizeof(BlockElement);
+}
+
+static uint32_t getIndexLevelDecimation(uint32_t level) {
+    uint32_t decimation = g_indexHeader.firstDecimation;
+    while (level--) {
+        decimation *= g_indexHeader.decimationFactor;
+    }
+    return decimation;
+}
+
+static void initIndexLevels() {
+    uint32_t offset = dlog_file::INDEX_HEADER_SIZE;
+    uint32_t numRows = g_indexHeader.numRows;
+    uint32_t decimation = g_indexHeader.firstDecimation;
+
+    g_indexHeader.numLevels = 0;
+    while (g_indexHeader.numLevels < dlog_file::INDEX_MAX_NUM_OF_LEVELS) {
+        numRows = (numRows + decimation - 1) / decimation;
+
+        g_indexLevelOffsets[g_indexHeader.numLevels] = offset;
+        g_indexLevelNumRows[g_indexHeader.numLevels] = numRows;
+        g_indexHeader.numLevels++;
+
+        if (numRows <= VIEW_WIDTH) {
+            break;
+        }
+
+        offset += numRows * getIndexRowSize();
+        decimation = g_indexHeader.decimationFactor;
+    }
+}
+
+static void initIndex(File &file) {
+    g_indexState = INDEX_STATE_NONE;
+
+    if (g_recording.numSamples < INDEX_MIN_NUM_ROWS) {
+        return;
+    }
+
+    dlog_file::getIndexFilePath(g_filePath, g_indexFilePath);
+
+    g_indexHeader.magic = dlog_file::INDEX_MAGIC;
+    g_indexHeader.version = dlog_file::INDEX_VERSION1;
+    g_indexHeader.fileSize = file.size();
+    g_indexHeader.numRows = g_recording.numSamples;
+    g_indexHeader.numValues = getNumElementsPerRow();
+    g_indexHeader.reserved = 0;
+    g_indexHeader.firstDecimation = INDEX_FIRST_DECIMATION;
+    g_indexHeader.decimationFactor = INDEX_DECIMATION_FACTOR;
+    initIndexLevels();
+
+    File indexFile;
+    if (indexFile.open(g_indexFilePath, FILE_OPEN_EXISTING | FILE_READ)) {
+        dlog_file::IndexHeader indexHeader;
+        uint32_t read = indexFile.read(&indexHeader, sizeof(indexHeader));
+        indexFile.close();
+        if (read == sizeof(indexHeader) && memcmp(&indexHeader, &g_indexHeader, sizeof(indexHeader)) == 0) {
+            g_indexState = INDEX_STATE_READY;
+            return;
+        }
+    }
+
+    // (re)build index, header is written at the end so incomplete index is never used
+    if (!indexFile.open(g_indexFilePath, FILE_CREATE_ALWAYS | FILE_WRITE)) {
+        return;
+    }
+    dlog_file::IndexHeader emptyIndexHeader;
+    memset(&emptyIndexHeader, 0, sizeof(emptyIndexHeader));
+    bool result = indexFile.write(&emptyIndexHeader, sizeof(emptyIndexHeader)) == sizeof(emptyIndexHeader);
+    if (!indexFile.close() || !result) {
+        return;
+    }
+
+    g_indexBuildLevel = 0;
+    g_indexBuildRowIndex = 0;
+    g_indexState = INDEX_STATE_BUILDING;
+
+    sendMessageToLowPriorityThread(THREAD_MESSAGE_DLOG_BUILD_INDEX, 0, 0);
+}
+
+// Computes next INDEX_BUILD_STEP_NUM_ROWS rows of the level being built,
+// level 0 is computed from the DLOG file and other levels from the previous level.
+static bool buildIndexStep(File &indexFile, File &file) {
+    auto numElementsPerRow = g_indexHeader.numValues;
+    auto rowSize = getIndexRowSize();
+
+    uint32_t inputRowSize;
+    uint32_t inputNumRows;
+    uint32_t decimation;
+    if (g_indexBuildLevel == 0) {
+        inputRowSize = g_recording.numFloatsPerRow * sizeof(float);
+        inputNumRows = g_indexHeader.numRows;
+        decimation = g_indexHeader.firstDecimation;
+    } else {
+        inputRowSize = rowSize;
+        inputNumRows = g_indexLevelNumRows[g_indexBuildLevel - 1];
+        decimation = g_indexHeader.decimationFactor;
+    }
+
+    uint32_t numRows = MIN(INDEX_BUILD_STEP_NUM_ROWS, g_indexLevelNumRows[g_indexBuildLevel] - g_indexBuildRowIndex);
+    uint32_t inputRowIndex = g_indexBuildRowIndex * decimation;
+    uint32_t inputRowIndexEnd = MIN((g_indexBuildRowIndex + numRows) * decimation, inputNumRows);
+
+    if (g_indexBuildLevel > 0 && !indexFile.seek(g_indexLevelOffsets[g_indexBuildLevel - 1] + inputRowIndex * inputRowSize)) {
+        return false;
+    }
+
+    while (inputRowIndex < inputRowIndexEnd) {
+        uint32_t numInputRows = MIN(INDEX_READ_NUM_ROWS, inputRowIndexEnd - inputRowIndex);
+        if (g_indexBuildLevel == 0) {
+            if (!readRows(file, inputRowIndex, numInputRows, g_indexReadBuffer)) {
+                return false;
+            }
+        } else {
+            uint32_t bytesToRead = numInputRows * inputRowSize;
+            if (indexFile.read(g_indexReadBuffer, bytesToRead) != bytesToRead) {
+                return false;
+            }
+        }
+
+        for (uint32_t i = 0; i < numInputRows; i++, inputRowIndex++) {
+            BlockElement *blockElements = g_indexWriteBuffer + (inputRowIndex / decimation - g_indexBuildRowIndex) * numElementsPerRow;
+            bool first = inputRowIndex % decimation == 0;
+            if (g_indexBuildLevel == 0) {
+                updateBlockElements(blockElements, g_indexReadBuffer + i * g_recording.numFloatsPerRow, numElementsPerRow, first);
+            } else {
+                mergeBlockElements(blockElements, (BlockElement *)g_indexReadBuffer + i * numElementsPerRow, numElementsPerRow, first);
+            }
+        }
+    }
+
+    if (!indexFile.seek(g_indexLevelOffsets[g_indexBuildLevel] + g_indexBuildRowIndex * rowSize)) {
+        return false;
+    }
+
+    if (indexFile.write(g_indexWriteBuffer, numRows * rowSize) != numRows * rowSize) {
+        return false;
+    }
+
+    g_indexBuildRowIndex += numRows;
+    if (g_indexBuildRowIndex == g_indexLevelNumRows[g_indexBuildLevel]) {
+        g_indexBuildRowIndex = 0;
+        if (++g_indexBuildLevel == g_indexHeader.numLevels) {
+            if (!indexFile.seek(0) || indexFile.write(&g_indexHeader, sizeof(g_indexHeader)) != sizeof(g_indexHeader)) {
+                return false;
+            }
+            g_indexState = INDEX_STATE_READY;
+        }
+    }
+
+    return true;
+}
+
+static bool buildIndexStep() {
+    File indexFile;
+    if (!indexFile.open(g_indexFilePath, FILE_OPEN_EXISTING | FILE_READ | FILE_WRITE)) {
+        return false;
+    }
+
+    // level 0 is read from the DLOG file
+    File file;
+    bool result = (g_indexBuildLevel > 0 || file.open(g_filePath, FILE_OPEN_EXISTING | FILE_READ)) && buildIndexStep(indexFile, file);
+
+    if (file.isOpen()) {
+        file.close();
+    }
+
+    if (!indexFile.close()) {
+        result = false;
+    }
+
+    return result;
+}
+
+void buildIndex() {
+    if (g_indexState != INDEX_STATE_BUILDING || g_state != STATE_READY) {
+        return;
+    }
+
+    if (!buildIndexStep()) {
+        g_indexState = INDEX_STATE_NONE;
+        return;
+    }
+
+    if (g_indexState == INDEX_STATE_BUILDING) {
+        // zero timeout: this is called from the low priority thread itself,
+        // if the queue is full tick() will continue the build
+        sendMessageToLowPriorityThread(THREAD_MESSAGE_DLOG_BUILD_INDEX, 0, 0);
+    }
+}
+
+void tick() {
+    buildIndex();
+}
+
+static bool loadBlockFromIndex(unsigned numSamplesPerValue) {
+    // find the highest level with decimation not larger than the number of samples per value
+    int level = -1;
+    for (uint32_t decimation = g_indexHeader.firstDecimation;
+        level + 1 < g_indexHeader.numLevels && decimation <= numSamplesPerValue;
+        decimation *= g_indexHeader.decimationFactor
+    ) {
+        level++;
+    }
+
+    if (level == -1) {
+        return false;
+    }
+
+    File indexFile;
+    if (!indexFile.open(g_indexFilePath, FILE_OPEN_EXISTING | FILE_READ)) {
+        return false;
+    }
+
+    auto numElementsPerRow = g_indexHeader.numValues;
+    auto rowSize = getIndexRowSize();
+    uint32_t decimation = getIndexLevelDecimation(level);
+    uint32_t levelNumRows = g_indexLevelNumRows[level];
+
+    BlockElement *blockElements = getCacheBlock(g_blockIndexToLoad);
+
+    uint32_t i = g_cacheBlocks[g_blockIndexToLoad].loadedValues;
+    while (i < NUM_ELEMENTS_PER_BLOCKS) {
+        if (g_interruptLoading) {
+            i = NUM_ELEMENTS_PER_BLOCKS;
+            break;
+        }
+
+        // Value covers samples [startSample, endSample), merge all the rows which
+        // contain any of these samples, so neighbouring values together cover every row.
+        uint32_t valueIndex = (g_blockIndexToLoad * NUM_ELEMENTS_PER_BLOCKS + i) / numElementsPerRow;
+        uint32_t startSample = (uint32_t)roundf(valueIndex * g_loadScale);
+        uint32_t endSample = (uint32_t)roundf((valueIndex + 1) * g_loadScale);
+
+        uint32_t rowIndex = startSample / decimation;
+        if (rowIndex >= levelNumRows) {
+            i = NUM_ELEMENTS_PER_BLOCKS;
+            break;
+        }
+        uint32_t endRowIndex = (endSample + decimation - 1) / decimation;
+        uint32_t numRows = MIN(MAX(endRowIndex, rowIndex + 1), levelNumRows) - rowIndex;
+
+        if (!indexFile.seek(g_indexLevelOffsets[level] + rowIndex * rowSize)) {
+            i = NUM_ELEMENTS_PER_BLOCKS;
+            break;
+        }
+
+        for (uint32_t j = 0; j < numRows; j += INDEX_READ_NUM_ROWS) {
+            uint32_t numRowsToRead = MIN(INDEX_READ_NUM_ROWS, numRows - j);
+            uint32_t bytesToRead = numRowsToRead * rowSize;
+            if (indexFile.read(g_indexReadBuffer, bytesToRead) != bytesToRead) {
+                i = NUM_ELEMENTS_PER_BLOCKS;
+                goto closeFile;
+            }
+
+            for (uint32_t k = 0; k < numRowsToRead; k++) {
+                mergeBlockElements(blockElements + i, (BlockElement *)g_indexReadBuffer + k * numElementsPerRow, numElementsPerRow, j + k == 0);
+            }
+        }
+
+        i += numElementsPerRow;
+    }
+
+closeFile:
+    g_cacheBlocks[g_blockIndexToLoad].loadedValues = i;
+    indexFile.close();
+
+    return true;
+}
+
 void loadBlock() {
     static const int NUM_VALUES_ROWS = 16;
     float values[18 * NUM_VALUES_ROWS];
 
     auto numSamplesPerValue = (unsigned)round(g_loadScale);
     if (numSamplesPerValue > 0) {
+        if (g_indexState == INDEX_STATE_READY && loadBlockFromIndex(numSamplesPerValue)) {
+            g_isLoading = false;
+            g_refreshed = true;
+            return;
+        }
+
         File file;
         if (file.open(g_filePath, FILE_OPEN_EXISTING | FILE_READ)) {
             auto numElementsPerRow = getNumElementsPerRow();
@@ -261,17 +776,9 @@ void loadBlock() {
                     (offset + g_recording.numFloatsPerRow - 1) / g_recording.numFloatsPerRow
                 );
 
-                size_t filePosition = g_recording.dataOffset + offset * sizeof(float);
-                if (!file.seek(filePosition)) {
-                    i = NUM_ELEMENTS_PER_BLOCKS;
-                    goto closeFile;
-                }
-
-                unsigned iStart = i;
+                uint32_t rowIndex = offset / g_recording.numFloatsPerRow;
 
                 for (unsigned j = 0; j < numSamplesPerValue; j++) {
-                    i = iStart;
-
                     auto valuesRow = j % NUM_VALUES_ROWS;
 
                     if (valuesRow == 0) {
@@ -281,52 +788,20 @@ void loadBlock() {
                         }
 
                         // read up to NUM_VALUES_ROWS
-                        uint32_t bytesToRead = MIN(NUM_VALUES_ROWS, numSamplesPerValue - j) * g_recording.numFloatsPerRow * sizeof(float);
-                        uint32_t bytesRead = file.read(values, bytesToRead);
-                        if (bytesToRead != bytesRead) {
+                        uint32_t numRowsToRead = MIN(NUM_VALUES_ROWS, numSamplesPerValue - j);
+                        if (!readRows(file, rowIndex + j, numRowsToRead, values)) {
                             i = NUM_ELEMENTS_PER_BLOCKS;
                             goto closeFile;
                         }
 
-                        totalBytesRead += bytesRead;
+                        totalBytesRead += numRowsToRead * g_recording.numFloatsPerRow * sizeof(float);
                     }
 
-					unsigned valuesOffset = valuesRow * g_recording.numFloatsPerRow;
-
-                    uint32_t bitMask = 0;
-                    uint32_t bits = 0;
-                    uint32_t m = 0;
-
-                    for (unsigned k = 0; k < numElementsPerRow; k++) {
-                        BlockElement *blockElement = blockElements + i++;
-
-                        float value;
-
-                        auto &yAxis = g_recording.parameters.yAxes[k];
-                        if (yAxis.unit == UNIT_BIT) {
-                            if (bitMask == 0) {
-                                bits = *(uint32_t *)&values[valuesOffset + m++];
-                                bitMask = 0x4000;
-                            } else {
-                                bitMask >>= 1;
-                            }
-
-                            value = bits & 0x8000 ? ((bits & bitMask) ? 1.0f : 0.0f) : NAN;
-                        } else {
-                            bitMask = 0;
-                            value = values[valuesOffset + m++];
-                        }
-
-                        if (j == 0) {
-                            blockElement->min = blockElement->max = value;
-                        } else if (value < blockElement->min) {
-                            blockElement->min = value;
-                        } else if (value > blockElement->max) {
-                            blockElement->max = value;
-                        }
-                    }
+                    updateBlockElements(blockElements + i, values + valuesRow * g_recording.numFloatsPerRow, numElementsPerRow, j == 0);
                 }
 
+                i += numElementsPerRow;
+
                 if (totalBytesRead > NUM_ELEMENTS_PER_BLOCKS * sizeof(BlockElement)) {
                     break;
                 }
@@ -354,6 +829,10 @@ void stateManagment() {
             openFile(dlog_record::getLatestFilePath());
         }
     }
+    if (g_wasExecuting != isExecuting) {
+        // getRecording switches between the live and the loaded recording
+        eez::gui::incrementDataVersions(eez::gui::DATA_VERSION_SOURCE_DLOG);
+    }
     g_wasExecuting = isExecuting;
 
     if (g_refreshed) {
@@ -765,9 +1244,15 @@ bool openFile(const char *filePath, int *err) {
     }
 
     g_state = STATE_LOADING;
+    g_indexState = INDEX_STATE_NONE;
+
+    // index and blocks are later read from g_filePath
+    if (filePath != nullptr) {
+        strcpy(g_filePath, filePath);
+    }
 
     File file;
-    if (file.open(filePath != nullptr ? filePath : g_filePath, FILE_OPEN_EXISTING | FILE_READ)) {
+    if (file.open(g_filePath, FILE_OPEN_EXISTING | FILE_READ)) {
         uint8_t * buffer = FILE_VIEW_BUFFER;
         uint32_t read = file.read(buffer, dlog_file::DLOG_VERSION1_HEADER_SIZE);
         if (read == dlog_file::DLOG_VERSION1_HEADER_SIZE) {
@@ -816,7 +1301,12 @@ bool openFile(const char *filePath, int *err) {
 
 					g_recording.pageSize = VIEW_WIDTH;
 
-					g_recording.numSamples = (file.size() - g_recording.dataOffset) / (g_recording.numFloatsPerRow * sizeof(float));
+					g_compressed = reader.getVersion() == dlog_file::VERSION3;
+					if (g_compressed) {
+						g_recording.numSamples = initFrames(file);
+					} else {
+						g_recording.numSamples = (file.size() - g_recording.dataOffset) / (g_recording.numFloatsPerRow * sizeof(float));
+					}
 					g_recording.xAxisDivMin = g_recording.pageSize * g_recording.parameters.period / NUM_HORZ_DIVISIONS;
 					g_recording.xAxisDivMax = MAX(g_recording.numSamples, g_recording.pageSize) * g_recording.parameters.period / NUM_HORZ_DIVISIONS;
 
@@ -836,6 +1326,8 @@ bool openFile(const char *filePath, int *err) {
 
 					g_state = STATE_READY;
 					invalidateAllBlocks();
+
+					initIndex(file);
 				}
 			}
         }
@@ -858,6 +1350,8 @@ bool openFile(const char *filePath, int *err) {
         g_state = STATE_ERROR;
     }
 
+    eez::gui::incrementDataVersions(eez::gui::DATA_VERSION_SOURCE_DLOG);
+
     return g_state != STATE_ERROR;
 }
 
@@ -890,8 +1384,8 @@ void uploadFile() {
 #endif
 
 #if OPTION_ETHERNET
-    if (!context && psu::ethernet::isConnected()) {
-        context = &psu::ethernet::g_scpiContext;
+    if (!context) {
+        context = psu::ethernet::getActiveScpiContext();
     }
 #endif
 
@@ -148,6 +148,10 @@ extern State getState();
 // this is called from the thread that owns SD card
 void loadBlock();
 
+// builds min/max pyramid index of the opened file, also called from the thread that owns SD card
+void buildIndex();
+void tick();
+
 // this should be called during GUI state managment phase
 void stateManagment();
 
@@ -19,6 +19,7 @@
 #if OPTION_ETHERNET
 
 #include <stdio.h>
+#include <string.h>
 
 #include <eez/firmware.h>
 
@@ -44,33 +45,76 @@ namespace ethernet {
 
 TestResult g_testResult = TEST_FAILED;
 
-static bool g_isConnected = false;
-
 ////////////////////////////////////////////////////////////////////////////////
 
-static const size_t OUTPUT_BUFFER_MAX_SIZE = 1024;
-static char g_outputBuffer[OUTPUT_BUFFER_MAX_SIZE];
+static const size_t OUTPUT_BUFFER_MAX_SIZE = ETHERNET_OUTPUT_BUFFER_SIZE;
+
+size_t ethernetClientWrite(const char *data, size_t len);
+
+struct Session {
+    Session() : outputBufferWriter(&outputBuffer[0], OUTPUT_BUFFER_MAX_SIZE, ethernetClientWrite) {
+        scpiPsuContext.registers = scpiPsuRegs;
+    }
+
+    bool isConnected;
+    uint32_t lastInputTime;
+
+    scpi_t scpiContext;
+    scpi_reg_val_t scpiPsuRegs[SCPI_PSU_REG_COUNT];
+    scpi_psu_t scpiPsuContext;
+    char scpiInputBuffer[SCPI_PARSER_INPUT_BUFFER_LENGTH];
+    scpi_error_t errorQueueData[SCPI_PARSER_ERROR_QUEUE_SIZE + 1];
+
+    char outputBuffer[OUTPUT_BUFFER_MAX_SIZE];
+    OutputBufferWriter outputBufferWriter;
+
+    SessionStatistics statistics;
+};
+
+static Session g_sessions[MAX_NUM_SESSIONS];
+
+// all the output is written from the low priority thread,
+// this is the session which output buffer writer is currently used
+static Session *g_writeSession;
+
+static Session &getSession(scpi_t *context) {
+    for (int sessionIndex = 0; sessionIndex < MAX_NUM_SESSIONS; sessionIndex++) {
+        if (&g_sessions[sessionIndex].scpiContext == context) {
+            return g_sessions[sessionIndex];
+        }
+    }
+    return g_sessions[0];
+}
+
+static OutputBufferWriter &getOutputBufferWriter(scpi_t *context) {
+    g_writeSession = &getSession(context);
+    return g_writeSession->outputBufferWriter;
+}
 
 size_t ethernetClientWrite(const char *data, size_t len) {
     g_messageAvailable = true;
-    return eez::mcu::ethernet::writeBuffer(data, len);
+    g_writeSession->statistics.numBytesSent += len;
+    // while arbitrary block is written more data follows, so let it be coalesced
+    bool more = g_writeSession->outputBufferWriter.isWritingBlock();
+    return eez::mcu::ethernet::writeBuffer(g_writeSession - g_sessions, data, len, more);
 }
 
-static OutputBufferWriter g_outputBufferWriter(&g_outputBuffer[0], OUTPUT_BUFFER_MAX_SIZE, ethernetClientWrite);
-
 ////////////////////////////////////////////////////////////////////////////////
 
 size_t SCPI_Write(scpi_t *context, const char *data, size_t len) {
-    return g_outputBufferWriter.write(data, len);
+    if (context->arbitrary_reminding > 0) {
+        return getOutputBufferWriter(context).writeBlock(data, len);
+    }
+    return getOutputBufferWriter(context).write(data, len);
 }
 
 scpi_result_t SCPI_Flush(scpi_t *context) {
-    g_outputBufferWriter.flush();
+    getOutputBufferWriter(context).flush();
     return SCPI_RES_OK;
 }
 
 int SCPI_Error(scpi_t *context, int_fast16_t err) {
-    return printError(context, err, g_outputBufferWriter);
+    return printError(context, err, getOutputBufferWriter(context));
 }
 
 scpi_result_t SCPI_Control(scpi_t *context, scpi_ctrl_name_t ctrl, scpi_reg_val_t val) {
@@ -81,7 +125,7 @@ scpi_result_t SCPI_Control(scpi_t *context, scpi_ctrl_name_t ctrl, scpi_reg_val_
         sprintf(outputBuffer, "**CTRL %02x: 0x%X (%d)\r\n", ctrl, val, val);
     }
 
-    g_outputBufferWriter.write(outputBuffer, strlen(outputBuffer));
+    getOutputBufferWriter(context).write(outputBuffer, strlen(outputBuffer));
 
     return SCPI_RES_OK;
 }
@@ -89,27 +133,23 @@ scpi_result_t SCPI_Control(scpi_t *context, scpi_ctrl_name_t ctrl, scpi_reg_val_
 scpi_result_t SCPI_Reset(scpi_t *context) {
     char errorOutputBuffer[256];
     strcpy(errorOutputBuffer, "**Reset\r\n");
-    g_outputBufferWriter.write(errorOutputBuffer, strlen(errorOutputBuffer));
+    getOutputBufferWriter(context).write(errorOutputBuffer, strlen(errorOutputBuffer));
 
     return reset() ? SCPI_RES_OK : SCPI_RES_ERR;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-static scpi_reg_val_t g_scpiPsuRegs[SCPI_PSU_REG_COUNT];
-static scpi_psu_t g_scpiPsuContext = { g_scpiPsuRegs };
-
 static scpi_interface_t g_scpiInterface = {
     SCPI_Error, SCPI_Write, SCPI_Control, SCPI_Flush, SCPI_Reset,
 };
 
-static char g_scpiInputBuffer[SCPI_PARSER_INPUT_BUFFER_LENGTH];
-static scpi_error_t g_errorQueueData[SCPI_PARSER_ERROR_QUEUE_SIZE + 1];
-
-scpi_t g_scpiContext;
-
 ////////////////////////////////////////////////////////////////////////////////
 
+static void initScpi(Session &session) {
+    scpi::init(session.scpiContext, session.scpiPsuContext, &g_scpiInterface, session.scpiInputBuffer, SCPI_PARSER_INPUT_BUFFER_LENGTH, session.errorQueueData, SCPI_PARSER_ERROR_QUEUE_SIZE + 1);
+}
+
 void init() {
     initScpi();
 
@@ -124,7 +164,9 @@ void init() {
 }
 
 void initScpi() {
-    scpi::init(g_scpiContext, g_scpiPsuContext, &g_scpiInterface, g_scpiInputBuffer, SCPI_PARSER_INPUT_BUFFER_LENGTH, g_errorQueueData, SCPI_PARSER_ERROR_QUEUE_SIZE + 1);
+    for (int sessionIndex = 0; sessionIndex < MAX_NUM_SESSIONS; sessionIndex++) {
+        initScpi(g_sessions[sessionIndex]);
+    }
 }
 
 bool test() {
@@ -135,6 +177,37 @@ bool test() {
     return g_testResult != TEST_FAILED;
 }
 
+static void onInputAvailable(int sessionIndex) {
+    Session &session = g_sessions[sessionIndex];
+
+    char *buffer;
+    uint32_t length;
+    eez::mcu::ethernet::getInputBuffer(sessionIndex, &buffer, &length);
+    if (buffer && length) {
+        session.lastInputTime = millis();
+
+        input(session.scpiContext, (const char *)buffer, length);
+        eez::mcu::ethernet::releaseInputBuffer(sessionIndex);
+
+        // latency is the time from the input arrival until it is processed
+        // and the response, if any, is written
+        uint32_t latency = micros() - eez::mcu::ethernet::getInputAvailableTime(sessionIndex);
+
+        SessionStatistics &statistics = session.statistics;
+        statistics.numInputs++;
+        statistics.numBytesReceived += length;
+        statistics.lastLatency = latency;
+        if (latency > statistics.maxLatency) {
+            statistics.maxLatency = latency;
+        }
+        if (statistics.numInputs == 1) {
+            statistics.avgLatency = latency;
+        } else {
+            statistics.avgLatency = (15 * statistics.avgLatency + latency) / 16;
+        }
+    }
+}
+
 void onQueueMessage(uint32_t type, uint32_t param) {
     if (type == ETHERNET_CONNECTED) {
         bool isConnected = param ? true : false;
@@ -153,17 +226,21 @@ void onQueueMessage(uint32_t type, uint32_t param) {
         eez::mcu::ethernet::beginServer(persist_conf::devConf.ethernetScpiPort);
         //DebugTrace("Listening on port %d", (int)persist_conf::devConf.ethernetScpiPort);
     } else if (type == ETHERNET_CLIENT_CONNECTED) {
-        g_isConnected = true;
-        initScpi();
+        if (param < MAX_NUM_SESSIONS) {
+            Session &session = g_sessions[param];
+            session.isConnected = true;
+            session.lastInputTime = millis();
+            initScpi(session);
+            memset(&session.statistics, 0, sizeof(SessionStatistics));
+            session.statistics.connectedTime = millis();
+        }
     } else if (type == ETHERNET_CLIENT_DISCONNECTED) {
-        g_isConnected = false;
+        if (param < MAX_NUM_SESSIONS) {
+            g_sessions[param].isConnected = false;
+        }
     } else if (type == ETHERNET_INPUT_AVAILABLE) {
-        char *buffer;
-        uint32_t length;
-        eez::mcu::ethernet::getInputBuffer(param, &buffer, &length);
-        if (buffer && length) {
-            input(g_scpiContext, (const char *)buffer, length);
-            eez::mcu::ethernet::releaseInputBuffer();
+        if (param < MAX_NUM_SESSIONS) {
+            onInputAvailable(param);
         }
     }
 }
@@ -173,9 +250,102 @@ uint32_t getIpAddress() {
 }
 
 bool isConnected() {
-    return g_isConnected;
+    for (int sessionIndex = 0; sessionIndex < MAX_NUM_SESSIONS; sessionIndex++) {
+        if (g_sessions[sessionIndex].isConnected) {
+            return true;
+        }
+    }
+    return false;
 }
 
+bool isSessionConnected(int sessionIndex) {
+    return g_sessions[sessionIndex].isConnected;
+}
+
+scpi_t &getScpiContext(int sessionIndex) {
+    return g_sessions[sessionIndex].scpiContext;
+}
+
+scpi_t *getActiveScpiContext() {
+    Session *activeSession = nullptr;
+    for (int sessionIndex = 0; sessionIndex < MAX_NUM_SESSIONS; sessionIndex++) {
+        Session &session = g_sessions[sessionIndex];
+        if (session.isConnected && (!activeSession || int32_t(session.lastInputTime - activeSession->lastInputTime) > 0)) {
+            activeSession = &session;
+        }
+    }
+    return activeSession ? &activeSession->scpiContext : nullptr;
+}
+
+void getSessionStatistics(int sessionIndex, SessionStatistics &statistics) {
+    statistics = g_sessions[sessionIndex].statistics;
+}
+
+#if defined(EEZ_PLATFORM_SIMULATOR)
+
+static OutputBufferWriter *g_benchmarkWriter;
+
+static size_t loopbackClientWrite(const char *data, size_t len) {
+    return eez::mcu::ethernet::writeLoopbackClient(data, len, g_benchmarkWriter->isWritingBlock());
+}
+
+// Sends data to the loopback client through the output buffer writer in chunks of
+// 512 bytes, which is how MMEM:UPL? reads the file, and returns throughput in MB/s.
+static float benchmarkUpload(size_t uploadSize, size_t bufferSize, bool writeBlock) {
+    static char buffer[ETHERNET_OUTPUT_BUFFER_SIZE];
+    OutputBufferWriter writer(buffer, MIN(bufferSize, sizeof(buffer)), loopbackClientWrite);
+    g_benchmarkWriter = &writer;
+
+    if (!eez::mcu::ethernet::openLoopbackClient()) {
+        return 0;
+    }
+
+    static const size_t CHUNK_SIZE = 512;
+    char chunk[CHUNK_SIZE];
+    for (size_t i = 0; i < CHUNK_SIZE; i++) {
+        chunk[i] = (char)i;
+    }
+
+    uint32_t startTime = micros();
+
+    for (size_t uploaded = 0; uploaded < uploadSize; uploaded += CHUNK_SIZE) {
+        if (writeBlock) {
+            writer.writeBlock(chunk, CHUNK_SIZE);
+        } else {
+            writer.write(chunk, CHUNK_SIZE);
+        }
+    }
+    writer.flush();
+
+    uint32_t numBytesReceived = eez::mcu::ethernet::closeLoopbackClient();
+
+    uint32_t time = micros() - startTime;
+
+    g_benchmarkWriter = nullptr;
+
+    if (numBytesReceived != uploadSize || time == 0) {
+        return 0;
+    }
+
+    return uploadSize / (1024.0f * 1024.0f) / (time / 1E6f);
+}
+
+void benchmarkOutput(char *text, int textLength) {
+    static const size_t UPLOAD_SIZE = 10 * 1024 * 1024;
+
+    float lineModeThroughput = benchmarkUpload(UPLOAD_SIZE, 1024, false);
+    float blockModeThroughput = benchmarkUpload(UPLOAD_SIZE, ETHERNET_OUTPUT_BUFFER_SIZE, true);
+
+    snprintf(text, textLength,
+        "upload size: %d MB\nline mode, 1024 B buffer: %.1f MB/s\nblock mode, %d B buffer: %.1f MB/s\n",
+        (int)(UPLOAD_SIZE / (1024 * 1024)),
+        lineModeThroughput,
+        ETHERNET_OUTPUT_BUFFER_SIZE,
+        blockModeThroughput);
+}
+
+#endif
+
 void update() {
     static TestResult g_testResultAtBoot;
 
@@ -188,9 +358,12 @@ void update() {
             eez::mcu::ethernet::beginServer(persist_conf::devConf.ethernetScpiPort);
         }
     } else {
-        if (g_isConnected) {
-            eez::mcu::ethernet::disconnectClient();
-            g_isConnected = false;
+        for (int sessionIndex = 0; sessionIndex < MAX_NUM_SESSIONS; sessionIndex++) {
+            Session &session = g_sessions[sessionIndex];
+            if (session.isConnected) {
+                eez::mcu::ethernet::disconnectClient(sessionIndex);
+                session.isConnected = false;
+            }
         }
 
         eez::mcu::ethernet::endServer();
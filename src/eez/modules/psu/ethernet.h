@@ -25,7 +25,18 @@ namespace psu {
 namespace ethernet {
 
 extern TestResult g_testResult;
-extern scpi_t g_scpiContext;
+
+static const int MAX_NUM_SESSIONS = ETHERNET_MAX_NUM_CLIENTS;
+
+struct SessionStatistics {
+    uint32_t connectedTime; // millis
+    uint32_t numInputs;
+    uint32_t numBytesReceived;
+    uint32_t numBytesSent;
+    uint32_t lastLatency; // in microseconds
+    uint32_t maxLatency;
+    uint32_t avgLatency;
+};
 
 void init();
 void initScpi();
@@ -36,8 +47,20 @@ void onQueueMessage(uint32_t type, uint32_t param);
 
 uint32_t getIpAddress();
 
+// is any client connected
 bool isConnected();
 
+bool isSessionConnected(int sessionIndex);
+scpi_t &getScpiContext(int sessionIndex);
+// context of the connected session which received the last input
+scpi_t *getActiveScpiContext();
+void getSessionStatistics(int sessionIndex, SessionStatistics &statistics);
+
+#if defined(EEZ_PLATFORM_SIMULATOR)
+// measures throughput of the 10 MB upload to the loopback client
+void benchmarkOutput(char *text, int textLength);
+#endif
+
 // this function is called when ethernet settings are changed,
 // and it should reconnect to the ethernet with these settings
 void update();
@@ -55,11 +55,10 @@ static const int EVENTS_PER_PAGE = 8;
 static const int CONF_EVENT_LINE_WIDTH_PX = 448;
 
 static const char *LOG_FILE_NAME = "log.txt";
+static const char *LOG_INDEX_FILE_NAME = "index";
 
-static const char *LOG_DEBUG_INDEX_FILE_NAME   = "index1";
-static const char *LOG_INFO_INDEX_FILE_NAME    = "index2";
-static const char *LOG_WARNING_INDEX_FILE_NAME = "index3";
-static const char *LOG_ERROR_INDEX_FILE_NAME   = "index4";
+// index files of the older firmware versions, one for each filter
+static const char *LEGACY_LOG_INDEX_FILE_NAMES[] = { "index1", "index2", "index3", "index4" };
 
 static const char *EVENT_TYPE_NAMES[] = {
     "NONE",
@@ -72,6 +71,10 @@ static const char *EVENT_TYPE_NAMES[] = {
 static const int WRITE_QUEUE_MAX_SIZE = 50;
 static const size_t EVENT_MESSAGE_MAX_SIZE = 256;
 
+// date, time, event type, message and new line
+static const size_t LOG_LINE_MAX_SIZE = 32 + EVENT_MESSAGE_MAX_SIZE;
+static const size_t LOG_BUFFER_SIZE = 2048;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 struct QueueEvent {
@@ -84,11 +87,40 @@ static QueueEvent g_writeQueue[WRITE_QUEUE_MAX_SIZE];
 static uint8_t g_writeQueueHead = 0;
 static uint8_t g_writeQueueTail = 0;
 static bool g_writeQueueFull;
+static uint32_t g_writeQueueFirstEventTickCount;
 osMutexId(g_writeQueueMutexId);
 osMutexDef(g_writeQueueMutex);
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Index file starts with the header, which is followed by the rows of log file offsets
+// with one column for each filter. Column of the filter holds the offsets of all the
+// events with the type equal or above the filter, so any event for any filter is
+// found with a single read. Header is updated and synced after the log file and the
+// index rows, so if it doesn't cover the whole log file, the missing rows are
+// recovered from the log file.
+static const int NUM_FILTERS = EVENT_TYPE_ERROR - EVENT_TYPE_DEBUG + 1;
+
+static const uint32_t LOG_INDEX_MAGIC = 0x58444E49; // "INDX"
+static const uint32_t LOG_INDEX_VERSION = 1;
+
+struct LogIndexHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t logFileSize;
+    uint32_t numEvents[NUM_FILTERS];
+    uint32_t reserved;
+};
+
+static const uint32_t LOG_INDEX_ROW_SIZE = NUM_FILTERS * sizeof(uint32_t);
+
+static File g_logFile;
+static File g_logIndexFile;
+static bool g_isLogOpen;
+static LogIndexHeader g_logIndex;
+
+////////////////////////////////////////////////////////////////////////////////
+
 static bool g_isSdCardMounted = false;
 static bool g_refreshEvents;
 
@@ -118,8 +150,9 @@ static int g_selectedEventIndex = -1;
 static void addEventToWriteQueue(int16_t eventId, char *message, int channelIndex);
 static bool getEventFromWriteQueue(QueueEvent *queueEvent);
 
-static void getIndexFilePath(int indexType, char *filePath);
+static void getLogIndexFilePath(const char *fileName, char *filePath);
 static void getLogFilePath(char *filePath);
+static bool openLogFiles();
 
 static int getEventType(int16_t eventId);
 
@@ -127,7 +160,8 @@ static void setDisplayFromPosition(uint32_t position);
 
 static void refreshEvents();
 
-static void writeEvent(QueueEvent *event);
+static bool isWriteQueueFlushNeeded();
+static void writeQueuedEvents();
 static void readEvents(uint32_t fromPosition);
 
 static Event *getEvent(uint32_t eventIndex);
@@ -143,15 +177,15 @@ void tick() {
     bool isSdCardMounted = sd_card::isMounted(nullptr, nullptr);
     if (isSdCardMounted != g_isSdCardMounted) {
         g_refreshEvents = true;
+        if (!isSdCardMounted) {
+            closeLogFiles();
+        }
     }
     g_isSdCardMounted = isSdCardMounted;
 
-    if (g_isSdCardMounted) {
-        QueueEvent queueEvent;
-        if (getEventFromWriteQueue(&queueEvent)) {
-            writeEvent(&queueEvent);
-            g_previousDisplayFromPosition = -1;
-        }
+    if (g_isSdCardMounted && isWriteQueueFlushNeeded()) {
+        writeQueuedEvents();
+        g_previousDisplayFromPosition = -1;
     }
 
 #if OPTION_DISPLAY
@@ -170,9 +204,15 @@ void tick() {
 }
 
 void shutdownSave() {
-    QueueEvent queueEvent;
-    while (getEventFromWriteQueue(&queueEvent)) {
-        writeEvent(&queueEvent);
+    writeQueuedEvents();
+    closeLogFiles();
+}
+
+void closeLogFiles() {
+    if (g_isLogOpen) {
+        g_logFile.close();
+        g_logIndexFile.close();
+        g_isLogOpen = false;
     }
 }
 
@@ -366,6 +406,10 @@ static void addEventToWriteQueue(int16_t eventId, char *message, int channelInde
         g_writeQueue[g_writeQueueHead].eventId = eventId;
         g_writeQueue[g_writeQueueHead].channelIndex = channelIndex;
 
+        if (!g_writeQueueFull && g_writeQueueHead == g_writeQueueTail) {
+            g_writeQueueFirstEventTickCount = millis();
+        }
+
         if (message) {
             strcpy(g_writeQueue[g_writeQueueHead].message, message);
         } else {
@@ -394,20 +438,10 @@ static void addEventToWriteQueue(int16_t eventId, char *message, int channelInde
     }
 }
 
-static void getIndexFilePath(int indexType, char *filePath) {
+static void getLogIndexFilePath(const char *fileName, char *filePath) {
     strcpy(filePath, LOGS_DIR);
-
     strcat(filePath, PATH_SEPARATOR);
-
-    if (indexType == EVENT_TYPE_DEBUG) {
-        strcat(filePath, LOG_DEBUG_INDEX_FILE_NAME);
-    } else if (indexType == EVENT_TYPE_INFO) {
-        strcat(filePath, LOG_INFO_INDEX_FILE_NAME);
-    } else if (indexType == EVENT_TYPE_WARNING) {
-        strcat(filePath, LOG_WARNING_INDEX_FILE_NAME);
-    } else {
-        strcat(filePath, LOG_ERROR_INDEX_FILE_NAME);
-    }
+    strcat(filePath, fileName);
 }
 
 static void getLogFilePath(char *filePath) {
@@ -491,13 +525,8 @@ static void refreshEvents() {
     g_selectedEventIndex = -1;
 
     if (g_isSdCardMounted) {
-        char filePath[MAX_PATH_LENGTH];
-        getIndexFilePath(g_filter, filePath);
-
-        File file;
-        if (file.open(filePath, FILE_OPEN_EXISTING | FILE_READ)) {
-            g_numEvents = file.size() / 4;
-            file.close();
+        if (openLogFiles()) {
+            g_numEvents = g_logIndex.numEvents[g_filter - EVENT_TYPE_DEBUG];
         }
 
         g_refreshEvents = false;
@@ -526,97 +555,248 @@ static void refreshEvents() {
     }
 }
 
-static bool writeToLog(QueueEvent *event, uint32_t &logOffset, int &eventType) {
-    char filePath[MAX_PATH_LENGTH];
-    getLogFilePath(filePath);
-
-    File file;
-    if (!file.open(filePath, FILE_OPEN_APPEND | FILE_WRITE)) {
+static bool isWriteQueueFlushNeeded() {
+    if (!g_writeQueueFull && g_writeQueueHead == g_writeQueueTail) {
         return false;
     }
 
-    logOffset = file.size();
-
-    using namespace sd_card;
-    BufferedFileWrite bufferedFile(file);
+    int size = g_writeQueueFull ? WRITE_QUEUE_MAX_SIZE : (g_writeQueueHead + WRITE_QUEUE_MAX_SIZE - g_writeQueueTail) % WRITE_QUEUE_MAX_SIZE;
+    return size >= EVENT_LOG_FLUSH_THRESHOLD || millis() - g_writeQueueFirstEventTickCount >= EVENT_LOG_FLUSH_INTERVAL_MS;
+}
 
+static size_t formatEvent(QueueEvent *event, char *text) {
     int year, month, day, hour, minute, second;
     datetime::breakTime(event->dateTime, year, month, day, hour, minute, second);
 
-    eventType = getEventType(event->eventId);
+    int n = sprintf(text, "%04d-%02d-%02d %02d:%02d:%02d %s ", year, month, day, hour, minute, second, EVENT_TYPE_NAMES[getEventType(event->eventId)]);
 
-    char dateTimeAndEventTypeStr[32];
-    sprintf(dateTimeAndEventTypeStr, "%04d-%02d-%02d %02d:%02d:%02d %s ", year, month, day, hour, minute, second, EVENT_TYPE_NAMES[eventType]);
-    bool result = bufferedFile.write((const uint8_t *)dateTimeAndEventTypeStr, strlen(dateTimeAndEventTypeStr));
-
-    if (result) {
-        if (event->eventId == EVENT_DEBUG_TRACE || event->eventId == EVENT_INFO_TRACE) {
-            result = bufferedFile.write((const uint8_t *)event->message, strlen(event->message));
+    if (event->eventId == EVENT_DEBUG_TRACE || event->eventId == EVENT_INFO_TRACE) {
+        strcpy(text + n, event->message);
+    } else {
+        const char *message = getEventMessage(event->eventId);
+        if (event->channelIndex != -1) {
+            sprintf(text + n, message, event->channelIndex + 1);
         } else {
-            const char *message = getEventMessage(event->eventId);
-            if (event->channelIndex != -1) {
-                char buffer[128];
-                sprintf(buffer, message, event->channelIndex + 1);
-                result = bufferedFile.write((const uint8_t *)buffer, strlen(buffer));
-            } else {
-                result = bufferedFile.write((const uint8_t *)message, strlen(message));
-            }
+            strcpy(text + n, message);
         }
+    }
+
+    strcat(text + n, "\n");
+
+    return n + strlen(text + n);
+}
 
-        if (result) {
-            result = bufferedFile.write((const uint8_t *)"\n", 1);
-            if (result) {
-                result = bufferedFile.flush();
+static bool writeLogIndexHeader() {
+    return g_logIndexFile.seek(0) &&
+        g_logIndexFile.write(&g_logIndex, sizeof(LogIndexHeader)) == sizeof(LogIndexHeader) &&
+        g_logIndexFile.sync();
+}
+
+// logFileSize is the size of the log file after these events
+static bool writeToIndex(const uint32_t *logOffsets, const uint8_t *eventTypes, int numEvents, uint32_t logFileSize) {
+    for (int i = 0; i < numEvents; i++) {
+        for (int filter = EVENT_TYPE_DEBUG; filter <= eventTypes[i]; filter++) {
+            int column = filter - EVENT_TYPE_DEBUG;
+            uint32_t position = sizeof(LogIndexHeader) + g_logIndex.numEvents[column] * LOG_INDEX_ROW_SIZE + column * sizeof(uint32_t);
+            if (!g_logIndexFile.seek(position) || g_logIndexFile.write(&logOffsets[i], sizeof(uint32_t)) != sizeof(uint32_t)) {
+                return false;
             }
+            g_logIndex.numEvents[column]++;
         }
     }
 
-    file.close();
+    g_logIndex.logFileSize = logFileSize;
 
-    return result;
+    return writeLogIndexHeader();
 }
 
-static void writeToIndex(int indexType, uint32_t logOffset) {
-    char filePath[MAX_PATH_LENGTH];
-    getIndexFilePath(indexType, filePath);
+static int parseEventType(const char *line) {
+    // skip "YYYY-MM-DD HH:MM:SS "
+    static const int EVENT_TYPE_POSITION = 20;
+    if (strlen(line) <= EVENT_TYPE_POSITION) {
+        return EVENT_TYPE_NONE;
+    }
 
-    File file;
-    if (file.open(filePath, FILE_OPEN_APPEND | FILE_WRITE)) {
-        file.write((const uint8_t *)&logOffset, sizeof(uint32_t));
-        file.close();
+    const char *eventTypeStr = line + EVENT_TYPE_POSITION;
+    for (int i = EVENT_TYPE_DEBUG; i <= EVENT_TYPE_ERROR; i++) {
+        size_t length = strlen(EVENT_TYPE_NAMES[i]);
+        if (strncmp(eventTypeStr, EVENT_TYPE_NAMES[i], length) == 0 && eventTypeStr[length] == ' ') {
+            return i;
+        }
     }
+
+    return EVENT_TYPE_NONE;
 }
 
-static void writeEvent(QueueEvent *event) {
-    uint32_t logOffset;
-    int eventType;
-    if (!writeToLog(event, logOffset, eventType)) {
-        return;
+// Adds to the index all the events from the part of the log file not covered by the index.
+static bool recoverLogIndex(uint32_t logFileSize) {
+    if (!g_logFile.seek(g_logIndex.logFileSize)) {
+        return false;
     }
 
-    if (eventType >= g_filter) {
-        g_refreshEvents = true;
+    using namespace sd_card;
+    BufferedFileRead bufferedFile(g_logFile);
+
+    static const int NUM_EVENTS_PER_WRITE = 32;
+    uint32_t logOffsets[NUM_EVENTS_PER_WRITE];
+    uint8_t eventTypes[NUM_EVENTS_PER_WRITE];
+    int numEvents = 0;
+
+    char line[32];
+    size_t lineLength = 0;
+    uint32_t lineOffset = g_logIndex.logFileSize;
+
+    for (uint32_t offset = lineOffset; offset < logFileSize; offset++) {
+        int ch = bufferedFile.read();
+        if (ch == -1) {
+            break;
+        }
+
+        if (ch == '\n') {
+            line[lineLength] = 0;
+            int eventType = parseEventType(line);
+            if (eventType != EVENT_TYPE_NONE) {
+                logOffsets[numEvents] = lineOffset;
+                eventTypes[numEvents] = eventType;
+                numEvents++;
+            }
+
+            lineLength = 0;
+            lineOffset = offset + 1;
+
+            if (numEvents == NUM_EVENTS_PER_WRITE) {
+                if (!writeToIndex(logOffsets, eventTypes, numEvents, lineOffset)) {
+                    return false;
+                }
+                numEvents = 0;
+            }
+        } else if (lineLength < sizeof(line) - 1) {
+            line[lineLength++] = ch;
+        }
     }
 
-    writeToIndex(EVENT_TYPE_DEBUG, logOffset);
+    if (!writeToIndex(logOffsets, eventTypes, numEvents, lineOffset)) {
+        return false;
+    }
 
-    if (eventType == EVENT_TYPE_DEBUG) {
-        return;
+    // remove incomplete line written before the crash
+    if (lineOffset < logFileSize) {
+        return g_logFile.truncate(lineOffset);
     }
 
-    writeToIndex(EVENT_TYPE_INFO, logOffset);
+    return true;
+}
 
-    if (eventType == EVENT_TYPE_INFO) {
-        return;
+static bool loadLogIndex() {
+    uint32_t logFileSize = g_logFile.size();
+
+    if (!g_logIndexFile.seek(0) ||
+        g_logIndexFile.read(&g_logIndex, sizeof(LogIndexHeader)) != sizeof(LogIndexHeader) ||
+        g_logIndex.magic != LOG_INDEX_MAGIC ||
+        g_logIndex.version != LOG_INDEX_VERSION ||
+        g_logIndex.logFileSize > logFileSize
+    ) {
+        // index doesn't exist, it is from the older firmware version or log file is replaced,
+        // so the whole index is rebuilt from the log file
+        memset(&g_logIndex, 0, sizeof(LogIndexHeader));
+        g_logIndex.magic = LOG_INDEX_MAGIC;
+        g_logIndex.version = LOG_INDEX_VERSION;
+
+        if (!g_logIndexFile.truncate(0)) {
+            return false;
+        }
     }
 
-    writeToIndex(EVENT_TYPE_WARNING, logOffset);
+    if (g_logIndex.logFileSize < logFileSize || g_logIndexFile.size() < sizeof(LogIndexHeader)) {
+        return recoverLogIndex(logFileSize);
+    }
 
-    if (eventType == EVENT_TYPE_WARNING) {
-        return;
+    return true;
+}
+
+static bool openLogFiles() {
+    if (g_isLogOpen) {
+        return true;
+    }
+
+    char filePath[MAX_PATH_LENGTH];
+
+    for (size_t i = 0; i < sizeof(LEGACY_LOG_INDEX_FILE_NAMES) / sizeof(const char *); i++) {
+        getLogIndexFilePath(LEGACY_LOG_INDEX_FILE_NAMES[i], filePath);
+        if (sd_card::exists(filePath, nullptr)) {
+            sd_card::deleteFile(filePath, nullptr);
+        }
     }
 
-    writeToIndex(EVENT_TYPE_ERROR, logOffset);
+    getLogFilePath(filePath);
+    if (!g_logFile.open(filePath, FILE_OPEN_ALWAYS | FILE_READ | FILE_WRITE)) {
+        return false;
+    }
+
+    getLogIndexFilePath(LOG_INDEX_FILE_NAME, filePath);
+    if (!g_logIndexFile.open(filePath, FILE_OPEN_ALWAYS | FILE_READ | FILE_WRITE)) {
+        g_logFile.close();
+        return false;
+    }
+
+    g_isLogOpen = true;
+
+    if (!loadLogIndex()) {
+        closeLogFiles();
+        return false;
+    }
+
+    return true;
+}
+
+// Writes all the queued events with as few file writes as possible: events are
+// formatted into the buffer, which is appended to the log file with one write,
+// followed by the index rows and a single sync of each file.
+static void writeQueuedEvents() {
+    static char buffer[LOG_BUFFER_SIZE];
+    uint32_t logOffsets[WRITE_QUEUE_MAX_SIZE];
+    uint8_t eventTypes[WRITE_QUEUE_MAX_SIZE];
+
+    bool isLogOpen = openLogFiles();
+
+    while (true) {
+        size_t bufferSize = 0;
+        int numEvents = 0;
+
+        QueueEvent queueEvent;
+        while (numEvents < WRITE_QUEUE_MAX_SIZE && bufferSize + LOG_LINE_MAX_SIZE <= LOG_BUFFER_SIZE && getEventFromWriteQueue(&queueEvent)) {
+            logOffsets[numEvents] = g_logIndex.logFileSize + bufferSize;
+            eventTypes[numEvents] = getEventType(queueEvent.eventId);
+            bufferSize += formatEvent(&queueEvent, buffer + bufferSize);
+            numEvents++;
+        }
+
+        if (numEvents == 0) {
+            break;
+        }
+
+        if (!isLogOpen) {
+            // events are lost, as before when the log file couldn't be written
+            continue;
+        }
+
+        if (!g_logFile.seek(g_logIndex.logFileSize) ||
+            g_logFile.write(buffer, bufferSize) != bufferSize ||
+            !g_logFile.sync() ||
+            !writeToIndex(logOffsets, eventTypes, numEvents, g_logIndex.logFileSize + bufferSize)
+        ) {
+            closeLogFiles();
+            isLogOpen = false;
+            continue;
+        }
+
+        for (int i = 0; i < numEvents; i++) {
+            if (eventTypes[i] >= g_filter) {
+                g_refreshEvents = true;
+                break;
+            }
+        }
+    }
 }
 
 static void getEventInfoText(Event *e, char *text, int count) {
@@ -652,16 +832,17 @@ static void updateIsLongMessageText(Event &event) {
     event.isLongMessageText = mcu::display::measureStr(text, -1, font) > CONF_EVENT_LINE_WIDTH_PX;
 }
 
-static bool readEvent(File &indexFile, File &logFile, int eventIndex, Event &event) {
-    indexFile.seek(4 * (g_numEvents - 1 - eventIndex));
+static bool readEvent(int eventIndex, Event &event) {
+    int column = g_filter - EVENT_TYPE_DEBUG;
+    g_logIndexFile.seek(sizeof(LogIndexHeader) + (g_numEvents - 1 - eventIndex) * LOG_INDEX_ROW_SIZE + column * sizeof(uint32_t));
     uint32_t logOffset;
-    if (indexFile.read(&logOffset, sizeof(uint32_t)) != sizeof(uint32_t)) {
+    if (g_logIndexFile.read(&logOffset, sizeof(uint32_t)) != sizeof(uint32_t)) {
         return false;
     }
 
-    logFile.seek(logOffset);
+    g_logFile.seek(logOffset);
     using namespace sd_card;
-    BufferedFileRead bufferedFile(logFile, 64);
+    BufferedFileRead bufferedFile(g_logFile, 64);
 
     unsigned int year;
     if (!match(bufferedFile, year)) {
@@ -737,25 +918,16 @@ static bool readEvent(File &indexFile, File &logFile, int eventIndex, Event &eve
 
 static void readEvents(uint32_t fromPosition) {
     if (g_isSdCardMounted) {
-        char filePath[MAX_PATH_LENGTH];
-        getIndexFilePath(g_filter, filePath);
-        File indexFile;
-        if (indexFile.open(filePath, FILE_OPEN_EXISTING | FILE_READ)) {
-            getLogFilePath(filePath);
-            File logFile;
-            if (logFile.open(filePath, FILE_OPEN_EXISTING | FILE_READ)) {
-                for (int i = 0; i < EVENTS_PER_PAGE; i++) {
-                    auto &event = g_events[i];
-                    if (fromPosition + i < g_numEvents) {
-                        if (readEvent(indexFile, logFile, fromPosition + i, event)) {
-                            continue;
-                        }
+        if (openLogFiles()) {
+            for (int i = 0; i < EVENTS_PER_PAGE; i++) {
+                auto &event = g_events[i];
+                if (fromPosition + i < g_numEvents) {
+                    if (readEvent(fromPosition + i, event)) {
+                        continue;
                     }
-                    memset(&event, 0, sizeof(event));
                 }
-                logFile.close();
+                memset(&event, 0, sizeof(event));
             }
-            indexFile.close();
         }
     } else {
         if (osMutexWait(g_writeQueueMutexId, 5) == osOK) {
@@ -117,6 +117,7 @@ static const int EVENT_TYPE_ERROR = 4;
     EVENT_WARNING(FILE_UPLOAD_ABORTED, 23, "File upload aborted")                                  \
     EVENT_WARNING(FILE_DOWNLOAD_ABORTED, 24, "File download aborted")                              \
     EVENT_WARNING(AUTO_RECALL_MODULE_MISMATCH, 25, "Auto-recall module mismatch")                  \
+    EVENT_WARNING(DLOG_SAMPLES_MISSED, 26, "DLOG missed some samples")                             \
     EVENT_INFO(WELCOME, 0, "Welcome!")                                                             \
     EVENT_INFO(POWER_UP, 1, "Power up")                                                            \
     EVENT_INFO(POWER_DOWN, 2, "Power down")                                                        \
@@ -204,6 +205,10 @@ void init();
 void tick();
 void shutdownSave();
 
+// Log files are kept open while SD card is mounted, they must be closed before
+// any other SD card operation that can remove or replace them.
+void closeLogFiles();
+
 int16_t getLastErrorEventId();
 int16_t getLastErrorEventChannelIndex();
 
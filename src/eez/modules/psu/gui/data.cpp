@@ -5453,6 +5453,59 @@ void data_ac_mains(DataOperationEnum operation, Cursor cursor, Value &value) {
     }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+// Version of the data is incremented every time the state of the channel, slot
+// or DLOG it depends on changes. Listed data must not depend on anything else,
+// except on the page state, because every page change redraws the whole screen.
+// Data which changes with time or depends on focus, edit mode or blinking is
+// never listed.
+
+struct DataVersion {
+    int16_t id;
+    uint8_t sources;
+    uint32_t version;
+};
+
+static DataVersion g_dataVersions[] = {
+    { DATA_ID_CHANNEL_TITLE, DATA_VERSION_SOURCE_CHANNEL, 0 },
+    { DATA_ID_CHANNEL_SHORT_TITLE, DATA_VERSION_SOURCE_CHANNEL, 0 },
+    { DATA_ID_DIB_MIO168_DIN_NO, DATA_VERSION_SOURCE_DLOG, 0 },
+    { DATA_ID_DIB_MIO168_DIN_STATE, DATA_VERSION_SOURCE_SLOT, 0 },
+    { DATA_ID_DIB_MIO168_DIN_LABEL, DATA_VERSION_SOURCE_SLOT, 0 },
+    { DATA_ID_DIB_MIO168_DOUT_NO, 0, 0 },
+    { DATA_ID_DIB_MIO168_DOUT_STATE, DATA_VERSION_SOURCE_SLOT, 0 },
+    { DATA_ID_DIB_MIO168_DOUT_LABEL, DATA_VERSION_SOURCE_SLOT, 0 },
+    { DATA_ID_DIB_MIO168_AIN_LABEL, DATA_VERSION_SOURCE_SLOT | DATA_VERSION_SOURCE_DLOG, 0 },
+    { DATA_ID_DIB_MIO168_AIN_VALUE, DATA_VERSION_SOURCE_SLOT | DATA_VERSION_SOURCE_DLOG, 0 },
+    { DATA_ID_DIB_MIO168_AIN_FAULT_STATUS, DATA_VERSION_SOURCE_SLOT | DATA_VERSION_SOURCE_DLOG, 0 },
+    { DATA_ID_DIB_MIO168_AIN_MODE_AND_RANGE, DATA_VERSION_SOURCE_SLOT, 0 },
+    { DATA_ID_DIB_MIO168_AOUT_LABEL, DATA_VERSION_SOURCE_SLOT, 0 },
+    { DATA_ID_DIB_MIO168_AOUT_MODE_AND_RANGE, DATA_VERSION_SOURCE_SLOT, 0 },
+    { DATA_ID_DIB_MIO168_PWM_LABEL, DATA_VERSION_SOURCE_SLOT, 0 },
+    { DATA_ID_DIB_MIO168_AFE_VERSION, DATA_VERSION_SOURCE_SLOT, 0 },
+    { DATA_ID_DLOG_STATE, DATA_VERSION_SOURCE_DLOG, 0 },
+    { DATA_ID_RECORDING_READY, DATA_VERSION_SOURCE_DLOG, 0 },
+    { DATA_ID_DLOG_X_AXIS_MAX_VALUE_LABEL, DATA_VERSION_SOURCE_DLOG, 0 },
+};
+
+void incrementDataVersions(DataVersionSource source) {
+    for (unsigned i = 0; i < sizeof(g_dataVersions) / sizeof(DataVersion); i++) {
+        if (g_dataVersions[i].sources & source) {
+            g_dataVersions[i].version++;
+        }
+    }
+}
+
+const uint32_t *getDataVersionHook(int16_t id) {
+    for (unsigned i = 0; i < sizeof(g_dataVersions) / sizeof(DataVersion); i++) {
+        if (g_dataVersions[i].id == id) {
+            return &g_dataVersions[i].version;
+        }
+    }
+    return nullptr;
+}
+
 } // namespace gui
 } // namespace eez
 
@@ -61,5 +61,14 @@ Value MakeEventMessageValue(int16_t eventId, int channelIndex);
 
 void data_channel_index(psu::Channel &channel, DataOperationEnum operation, Cursor cursor, Value &value);
 
+enum DataVersionSource {
+    DATA_VERSION_SOURCE_CHANNEL = 1 << 0,
+    DATA_VERSION_SOURCE_SLOT = 1 << 1,
+    DATA_VERSION_SOURCE_DLOG = 1 << 2
+};
+
+// Called every time the state of the source changes, see getDataVersionHook.
+void incrementDataVersions(DataVersionSource source);
+
 } // namespace gui
 } // namespace eez
\ No newline at end of file
@@ -19,6 +19,7 @@
 #if OPTION_DISPLAY
 
 #include <assert.h>
+#include <stdio.h>
 
 #if defined(EEZ_PLATFORM_STM32)
 #include <usbh_hid_keybd.h>
@@ -1119,7 +1120,47 @@ void PsuAppContext::updatePage(int i, WidgetCursor &widgetCursor) {
             eez::mcu::display::setColor(0, 255, 0);
             eez::mcu::display::fillRect(x - 1, y - 1, x + 1, y + 1);
         }
+    } else if (i == m_pageNavigationStackPointer && isSkipRateVisible()) {
+        mcu::display::selectBuffer(m_pageNavigationStack[i].displayBufferIndex);
+
+        // percentage of the widgets skipped in the last frame, because their data didn't change
+        UpdateScreenStatistics statistics;
+        getUpdateScreenStatistics(statistics);
+
+        char text[32];
+        snprintf(text, sizeof(text), "Skipped: %u%%", (unsigned)statistics.skipRate);
+
+        static const int SKIP_RATE_WIDTH = 80;
+        static const int SKIP_RATE_HEIGHT = 16;
+        static const int BAR_HEIGHT = 32;
+        static const int BAR_BUTTONS_WIDTH = 96;
+
+        // DLOG view has free space above the bottom bar, the max view is full,
+        // so there it goes into the title bar, left of the buttons
+        int x;
+        int y;
+        if (getActivePageId() == PAGE_ID_DLOG_VIEW) {
+            x = rect.x + rect.w - SKIP_RATE_WIDTH;
+            y = rect.y + rect.h - BAR_HEIGHT - SKIP_RATE_HEIGHT;
+        } else {
+            x = rect.x + rect.w - BAR_BUTTONS_WIDTH - SKIP_RATE_WIDTH;
+            y = rect.y + (BAR_HEIGHT - SKIP_RATE_HEIGHT) / 2;
+        }
+
+        drawText(text, -1, x, y, SKIP_RATE_WIDTH, SKIP_RATE_HEIGHT,
+            getStyle(STYLE_ID_DEFAULT_S_RIGHT_CONDENSED), false, false, false, nullptr, nullptr, nullptr, nullptr);
+    }
+}
+
+bool PsuAppContext::isSkipRateVisible() {
+    int activePageId = getActivePageId();
+    if (activePageId == PAGE_ID_DLOG_VIEW) {
+        return true;
+    }
+    if (activePageId == PAGE_ID_MAIN && persist_conf::isMaxView()) {
+        return g_slots[persist_conf::getMaxSlotIndex()]->moduleType == MODULE_TYPE_DIB_MIO168;
     }
+    return false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
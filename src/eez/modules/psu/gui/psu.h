@@ -283,6 +283,9 @@ protected:
     void updatePage(int i, WidgetCursor &widgetCursor) override;
 
 private:
+    // skip rate of the GUI update is shown on the DLOG view and on the MIO168 max view
+    bool isSkipRateVisible();
+
     void doShowProgressPage();
     void doHideProgressPage();
 
@@ -18,6 +18,7 @@
 
 #include <assert.h>
 #include <ctype.h> 
+#include <stdio.h>
 
 #include <eez/system.h>
 #include <eez/usb.h>
@@ -72,6 +73,10 @@ static const uint16_t CH_CAL_CONF_VERSION = 4;
 
 static const uint16_t PERSIST_CONF_DEV_CONF_ADDRESS = 128;
 
+static const uint16_t PERSIST_CONF_JOURNAL_ADDRESS = 4096;
+static const uint8_t PERSIST_CONF_JOURNAL_NUM_SEGMENTS = 8;
+static const uint16_t PERSIST_CONF_JOURNAL_SEGMENT_SIZE = 2048;
+
 static const uint32_t ONTIME_MAGIC = 0xA7F31B3CL;
 static const uint32_t COUNTER_MAGIC = 0XEF8D43B2;
 
@@ -91,6 +96,9 @@ struct DevConfBlock {
     uint32_t lastSaveTickCount;
 };
 
+// Blocks are no longer stored separately, device configuration is stored in the
+// journal, but they are still used to read the configuration stored by the older
+// firmware and to throttle the saving of some parts of the configuration.
 static DevConfBlock g_devConfBlocks[] = {
     { offsetof(DeviceConfiguration, dateYear), 1, false, 0, 0, 0 },
     { offsetof(DeviceConfiguration, profileAutoRecallLocation), 1, false, 0, 0, 0 },
@@ -104,6 +112,11 @@ static DevConfBlock g_devConfBlocks[] = {
     { sizeof(DeviceConfiguration), 1, false, 0, 0, 0 },
 };
 
+static conf_journal::Journal g_journal;
+static unsigned g_numJournalCompactionErrors;
+
+static ModuleConfWriteStatistics g_moduleConfWriteStatistics;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 void initDefaultDevConf() {
@@ -301,13 +314,33 @@ static bool moduleConfRead(int slotIndex, uint8_t *buffer, uint16_t bufferSize,
 	return false;
 }
 
+// page size of the module EEPROM
+static const uint16_t MODULE_CONF_WRITE_CHUNK_SIZE = 32;
+
 static bool moduleConfWrite(int slotIndex, const uint8_t *buffer, uint16_t bufferSize, uint16_t address) {
 	if (bp3c::eeprom::g_testResult != TEST_OK) {
 		return false;
     }
 
+	uint8_t verifyBuffer[1024];
+	assert(sizeof(verifyBuffer) >= bufferSize);
+
+	g_moduleConfWriteStatistics.numWrites++;
+
 	for (int i = 0; i < NUM_RETRIES; i++) {
-        bool result = bp3c::eeprom::write(slotIndex, buffer, bufferSize, address);
+        // write only the pages that are different from what is already stored
+        bool stored = moduleConfRead(slotIndex, verifyBuffer, bufferSize, address, -1);
+
+        bool result = true;
+        for (uint16_t j = 0; result && j < bufferSize; j += MODULE_CONF_WRITE_CHUNK_SIZE) {
+            uint16_t chunkSize = MIN(MODULE_CONF_WRITE_CHUNK_SIZE, bufferSize - j);
+            if (!stored || memcmp(buffer + j, verifyBuffer + j, chunkSize) != 0) {
+                result = bp3c::eeprom::write(slotIndex, buffer + j, chunkSize, address + j);
+                g_moduleConfWriteStatistics.bytesWritten += chunkSize;
+            } else {
+                g_moduleConfWriteStatistics.bytesSkipped += chunkSize;
+            }
+        }
 
         if (!result) {
 #if defined(EEZ_PLATFORM_STM32)
@@ -316,8 +349,6 @@ static bool moduleConfWrite(int slotIndex, const uint8_t *buffer, uint16_t buffe
         	continue;
         }
 
-		uint8_t verifyBuffer[1024];
-		assert(sizeof(verifyBuffer) >= bufferSize);
 		if (!moduleConfRead(slotIndex, verifyBuffer, bufferSize, address, -1)) {
 			continue;
 		}
@@ -346,10 +377,62 @@ bool checkBlock(const BlockHeader *block, uint16_t size, uint16_t version) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
-static bool save(BlockHeader *block, uint16_t size, uint16_t address, uint16_t version) {
-    block->version = version;
-    block->checksum = calcChecksum(block, size);
-    return confWrite((const uint8_t *)block, size, address);
+// Changes when any block is added, resized or gets a new version, i.e. whenever
+// the same offset in DeviceConfiguration could mean a different field.
+static uint32_t getDevConfLayoutVersion() {
+    uint16_t layout[2 * sizeof(g_devConfBlocks) / sizeof(DevConfBlock)];
+    for (unsigned i = 0; i < sizeof(g_devConfBlocks) / sizeof(DevConfBlock); i++) {
+        layout[2 * i] = g_devConfBlocks[i].end;
+        layout[2 * i + 1] = g_devConfBlocks[i].version;
+    }
+    return crc32((const uint8_t *)layout, sizeof(layout));
+}
+
+static bool journalRead(uint8_t *buffer, uint16_t bufferSize, uint16_t address) {
+    return confRead(buffer, bufferSize, address, -1);
+}
+
+static bool journalWrite(const uint8_t *buffer, uint16_t bufferSize, uint16_t address) {
+    return confWrite(buffer, bufferSize, address);
+}
+
+// Appends the runs of bytes from [start, end) that are different in data and savedData
+// to the journal and copies them to savedData. Runs separated by less bytes than
+// the record overhead are merged. If there is not enough space the journal is
+// compacted first, from savedData, so snapshot contains only what is already saved.
+static bool writeChangesToJournal(conf_journal::Journal &journal, const uint8_t *data, uint8_t *savedData, uint16_t start, uint16_t end, uint16_t size) {
+    uint16_t offset = start;
+
+    while (true) {
+        while (offset < end && data[offset] == savedData[offset]) {
+            offset++;
+        }
+
+        if (offset == end) {
+            return true;
+        }
+
+        uint16_t runEnd = offset + 1;
+        for (uint16_t i = runEnd; i < end && i - runEnd < conf_journal::RECORD_OVERHEAD; i++) {
+            if (data[i] != savedData[i]) {
+                runEnd = i + 1;
+            }
+        }
+
+        uint16_t runSize = runEnd - offset;
+
+        if (!journal.hasSpaceFor(runSize) && !journal.compact(savedData, size)) {
+            return false;
+        }
+
+        if (!journal.append(offset, data + offset, runSize)) {
+            return false;
+        }
+
+        memcpy(savedData + offset, data + offset, runSize);
+
+        offset = runEnd;
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -364,9 +447,11 @@ static bool moduleSave(int slotIndex, BlockHeader *block, uint16_t size, uint16_
 
 static const unsigned PERSISTENT_STORAGE_ADDRESS_ALIGNMENT = 32;
 
-void init() {
-    initDefaultDevConf();
+static uint16_t getBlockStorageSize(uint16_t blockSize) {
+    return PERSISTENT_STORAGE_ADDRESS_ALIGNMENT * ((sizeof(BlockHeader) + blockSize + PERSISTENT_STORAGE_ADDRESS_ALIGNMENT - 1) / PERSISTENT_STORAGE_ADDRESS_ALIGNMENT);
+}
 
+static void loadDevConfBlocks() {
     //bool storageInitialized = true;
 
     uint8_t blockData[sizeof(BlockHeader) + sizeof(DeviceConfiguration)];
@@ -375,7 +460,7 @@ void init() {
     for (unsigned i = 0; i < sizeof(g_devConfBlocks) / sizeof(DevConfBlock); i++) {
         uint16_t blockEnd = g_devConfBlocks[i].end;
         uint16_t blockSize = blockEnd - blockStart;
-        uint16_t blockStorageSize = PERSISTENT_STORAGE_ADDRESS_ALIGNMENT * ((sizeof(BlockHeader) + blockSize + PERSISTENT_STORAGE_ADDRESS_ALIGNMENT - 1) / PERSISTENT_STORAGE_ADDRESS_ALIGNMENT);
+        uint16_t blockStorageSize = getBlockStorageSize(blockSize);
 
         if (!confRead(blockData, blockStorageSize, blockAddress, g_devConfBlocks[i].version)) {
             if (!confRead(blockData, blockStorageSize, blockAddress + blockStorageSize, g_devConfBlocks[i].version)) {
@@ -389,9 +474,6 @@ void init() {
 
                 // use default g_devConf data for this block
                 memcpy(blockData + sizeof(BlockHeader), (uint8_t *)&g_defaultDevConf + blockStart, blockSize);
-
-                // mark this block dirty, so it will be saved to persistent storage
-                g_devConfBlocks[i].dirty = true;
             }
         }
 
@@ -401,6 +483,23 @@ void init() {
         blockAddress += 2 * blockStorageSize;
         blockStart = blockEnd;
     }
+}
+
+void init() {
+    initDefaultDevConf();
+
+    static const conf_journal::Storage journalStorage = { journalRead, journalWrite };
+    g_journal.init(journalStorage, PERSIST_CONF_JOURNAL_ADDRESS, PERSIST_CONF_JOURNAL_NUM_SEGMENTS, PERSIST_CONF_JOURNAL_SEGMENT_SIZE, getDevConfLayoutVersion());
+
+    memcpy(&g_devConf, &g_defaultDevConf, sizeof(DeviceConfiguration));
+
+    // Journal is compacted, i.e. initialized from g_devConf, in tick if replay fails.
+    // If journal was written by the firmware with different DeviceConfiguration layout
+    // defaults are used, same as for the block with different version. If there is no
+    // journal at all, configuration is stored in blocks by the older firmware.
+    if (!g_journal.replay((uint8_t *)&g_devConf, sizeof(DeviceConfiguration)) && !g_journal.isOtherLayoutFound()) {
+        loadDevConfBlocks();
+    }
 
     if (g_devConf.ntpRefreshFrequency < NTP_REFRESH_FREQUENCY_MIN || g_devConf.ntpRefreshFrequency > NTP_REFRESH_FREQUENCY_MAX) {
         g_devConf.ntpRefreshFrequency = NTP_REFRESH_FREQUENCY_DEF;
@@ -440,17 +539,14 @@ bool saveAll(bool force) {
 
     uint32_t tickCountMillis = millis();
 
-    // write dirty device configuration blocks
+    // append changes from the dirty device configuration blocks to the journal
     DeviceConfiguration devConf;
     memcpy(&devConf, &g_devConf, sizeof(DeviceConfiguration));
 
-    uint8_t blockData[sizeof(BlockHeader) + sizeof(DeviceConfiguration)];
-    uint16_t blockAddress = PERSIST_CONF_DEV_CONF_ADDRESS;
     uint16_t blockStart = 0;
     for (unsigned i = 0; i < sizeof(g_devConfBlocks) / sizeof(DevConfBlock); i++) {
         uint16_t blockEnd = g_devConfBlocks[i].end;
         uint16_t blockSize = blockEnd - blockStart;
-        uint16_t blockStorageSize = PERSISTENT_STORAGE_ADDRESS_ALIGNMENT * ((sizeof(BlockHeader) + blockSize + PERSISTENT_STORAGE_ADDRESS_ALIGNMENT - 1) / PERSISTENT_STORAGE_ADDRESS_ALIGNMENT);
 
         if (!g_devConfBlocks[i].dirty) {
             // compare devConf with last saved g_devConf
@@ -462,14 +558,9 @@ bool saveAll(bool force) {
             g_devConfBlocks[i].numSaveErrors < CONF_MAX_NUMBER_OF_SAVE_ERRORS_ALLOWED && 
 			(force || (tickCountMillis - g_devConfBlocks[i].lastSaveTickCount >= g_devConfBlocks[i].minTickCountsBetweenSaves))
         ) {
-        	memset(blockData, 0, blockStorageSize);
-            memcpy(blockData + sizeof(BlockHeader), (uint8_t *)&devConf + blockStart, blockSize);
-
-        	bool saved = save((BlockHeader *)blockData, blockStorageSize, blockAddress, g_devConfBlocks[i].version);
-        	saved |= save((BlockHeader *)blockData, blockStorageSize, blockAddress + blockStorageSize, g_devConfBlocks[i].version);
+            bool saved = writeChangesToJournal(g_journal, (const uint8_t *)&devConf, (uint8_t *)&g_savedDevConf, blockStart, blockEnd, sizeof(DeviceConfiguration));
 
             if (saved) {
-                memcpy((uint8_t *)&g_savedDevConf + blockStart, (uint8_t *)&devConf + blockStart, blockSize);
                 g_devConfBlocks[i].dirty = false;
                 g_devConfBlocks[i].numSaveErrors = 0;
                 g_devConfBlocks[i].lastSaveTickCount = tickCountMillis;
@@ -482,7 +573,6 @@ bool saveAll(bool force) {
             }
         }
 
-        blockAddress += 2 * blockStorageSize;
         blockStart = blockEnd;
     }
 
@@ -490,13 +580,185 @@ bool saveAll(bool force) {
 }
 
 void tick() {
-    saveAll(false);
+    if (saveAll(false)) {
+        return;
+    }
+
+    // compact in the background, before the journal is full
+    if (g_journal.needsCompaction() && g_numJournalCompactionErrors < CONF_MAX_NUMBER_OF_SAVE_ERRORS_ALLOWED) {
+        if (g_journal.compact((const uint8_t *)&g_savedDevConf, sizeof(DeviceConfiguration))) {
+            g_numJournalCompactionErrors = 0;
+        } else {
+            g_numJournalCompactionErrors++;
+        }
+    }
 }
 
 bool saveAllDirtyBlocks() {
     return saveAll(true);
 }
 
+void getJournalStatistics(conf_journal::Statistics &statistics) {
+    g_journal.getStatistics(statistics);
+}
+
+#if defined(EEZ_PLATFORM_SIMULATOR)
+
+static uint8_t g_simulatedEeprom[mcu::eeprom::EEPROM_SIZE];
+static uint16_t g_simulatedEepromNumWrites[mcu::eeprom::EEPROM_SIZE];
+
+static bool simulatedEepromRead(uint8_t *buffer, uint16_t bufferSize, uint16_t address) {
+    if (address + bufferSize > mcu::eeprom::EEPROM_SIZE) {
+        return false;
+    }
+
+    memcpy(buffer, g_simulatedEeprom + address, bufferSize);
+    return true;
+}
+
+static bool simulatedEepromWrite(const uint8_t *buffer, uint16_t bufferSize, uint16_t address) {
+    if (address + bufferSize > mcu::eeprom::EEPROM_SIZE) {
+        return false;
+    }
+
+    memcpy(g_simulatedEeprom + address, buffer, bufferSize);
+
+    for (uint16_t i = 0; i < bufferSize; i++) {
+        if (g_simulatedEepromNumWrites[address + i] < 0xFFFF) {
+            g_simulatedEepromNumWrites[address + i]++;
+        }
+    }
+
+    return true;
+}
+
+static void getSimulatedEepromWrites(uint16_t start, uint16_t end, uint32_t &bytesWritten, uint32_t &maxWritesPerByte) {
+    bytesWritten = 0;
+    maxWritesPerByte = 0;
+    for (uint16_t address = start; address < end; address++) {
+        bytesWritten += g_simulatedEepromNumWrites[address];
+        if (g_simulatedEepromNumWrites[address] > maxWritesPerByte) {
+            maxWritesPerByte = g_simulatedEepromNumWrites[address];
+        }
+    }
+}
+
+// typical changes made from the front panel
+static void changeDevConf(DeviceConfiguration &conf, uint32_t changeIndex) {
+    switch (changeIndex % 8) {
+    case 0:
+        conf.isSoundEnabled = !conf.isSoundEnabled;
+        break;
+    case 1:
+        conf.displayBrightness = conf.displayBrightness % 20 + 1;
+        break;
+    case 2:
+        conf.channelsViewMode = (conf.channelsViewMode + 1) % NUM_CHANNELS_VIEW_MODES;
+        break;
+    case 3:
+        conf.selectedThemeIndex ^= 1;
+        break;
+    case 4:
+        conf.maxSlotIndex = (conf.maxSlotIndex + 1) % 4;
+        break;
+    case 5:
+        conf.timeZone = conf.timeZone == 100 ? 0 : 100;
+        break;
+    case 6:
+        conf.ethernetIpAddress ^= getIpAddress(0, 0, 0, 1);
+        break;
+    case 7:
+        snprintf(conf.ntpServer, sizeof(conf.ntpServer), "%d.pool.ntp.org", (int)(changeIndex / 8 % 4));
+        break;
+    }
+}
+
+void benchmarkJournal(uint32_t numChanges, JournalBenchmark &benchmark) {
+    memset(g_simulatedEeprom, 0xFF, sizeof(g_simulatedEeprom));
+
+    static const conf_journal::Storage storage = { simulatedEepromRead, simulatedEepromWrite };
+
+    conf_journal::Journal journal;
+    journal.init(storage, PERSIST_CONF_JOURNAL_ADDRESS, PERSIST_CONF_JOURNAL_NUM_SEGMENTS, PERSIST_CONF_JOURNAL_SEGMENT_SIZE, getDevConfLayoutVersion());
+
+    DeviceConfiguration conf;
+    memcpy(&conf, &g_devConf, sizeof(DeviceConfiguration));
+
+    DeviceConfiguration savedConf;
+    memcpy(&savedConf, &conf, sizeof(DeviceConfiguration));
+
+    journal.compact((const uint8_t *)&savedConf, sizeof(DeviceConfiguration));
+
+    // measure only the changes, not the initial state
+    memset(g_simulatedEepromNumWrites, 0, sizeof(g_simulatedEepromNumWrites));
+
+    benchmark.numChanges = numChanges;
+    benchmark.changedBytes = 0;
+
+    uint8_t blockData[sizeof(BlockHeader) + sizeof(DeviceConfiguration)];
+
+    for (uint32_t changeIndex = 0; changeIndex < numChanges; changeIndex++) {
+        changeDevConf(conf, changeIndex);
+
+        for (unsigned i = 0; i < sizeof(DeviceConfiguration); i++) {
+            if (((const uint8_t *)&conf)[i] != ((const uint8_t *)&savedConf)[i]) {
+                benchmark.changedBytes++;
+            }
+        }
+
+        // every dirty block is written twice
+        uint16_t blockAddress = PERSIST_CONF_DEV_CONF_ADDRESS;
+        uint16_t blockStart = 0;
+        for (unsigned i = 0; i < sizeof(g_devConfBlocks) / sizeof(DevConfBlock); i++) {
+            uint16_t blockEnd = g_devConfBlocks[i].end;
+            uint16_t blockSize = blockEnd - blockStart;
+            uint16_t blockStorageSize = getBlockStorageSize(blockSize);
+
+            if (memcmp((uint8_t *)&conf + blockStart, (uint8_t *)&savedConf + blockStart, blockSize) != 0) {
+                memset(blockData, 0, blockStorageSize);
+                memcpy(blockData + sizeof(BlockHeader), (uint8_t *)&conf + blockStart, blockSize);
+
+                BlockHeader *block = (BlockHeader *)blockData;
+                block->version = g_devConfBlocks[i].version;
+                block->checksum = calcChecksum(block, blockStorageSize);
+
+                simulatedEepromWrite(blockData, blockStorageSize, blockAddress);
+                simulatedEepromWrite(blockData, blockStorageSize, blockAddress + blockStorageSize);
+            }
+
+            blockAddress += 2 * blockStorageSize;
+            blockStart = blockEnd;
+        }
+
+        writeChangesToJournal(journal, (const uint8_t *)&conf, (uint8_t *)&savedConf, 0, sizeof(DeviceConfiguration), sizeof(DeviceConfiguration));
+
+        if (journal.needsCompaction()) {
+            journal.compact((const uint8_t *)&savedConf, sizeof(DeviceConfiguration));
+        }
+    }
+
+    getSimulatedEepromWrites(PERSIST_CONF_DEV_CONF_ADDRESS, PERSIST_CONF_JOURNAL_ADDRESS, benchmark.blocksBytesWritten, benchmark.blocksMaxWritesPerByte);
+    getSimulatedEepromWrites(PERSIST_CONF_JOURNAL_ADDRESS, PERSIST_CONF_JOURNAL_ADDRESS + PERSIST_CONF_JOURNAL_NUM_SEGMENTS * PERSIST_CONF_JOURNAL_SEGMENT_SIZE, benchmark.journalBytesWritten, benchmark.journalMaxWritesPerByte);
+
+    conf_journal::Statistics statistics;
+    journal.getStatistics(statistics);
+    benchmark.journalCompactions = statistics.numCompactions;
+
+    // replay, as it is done on boot
+    conf_journal::Journal replayJournal;
+    replayJournal.init(storage, PERSIST_CONF_JOURNAL_ADDRESS, PERSIST_CONF_JOURNAL_NUM_SEGMENTS, PERSIST_CONF_JOURNAL_SEGMENT_SIZE, getDevConfLayoutVersion());
+
+    DeviceConfiguration replayedConf;
+    memcpy(&replayedConf, &g_defaultDevConf, sizeof(DeviceConfiguration));
+    benchmark.journalReplayMatches = replayJournal.replay((uint8_t *)&replayedConf, sizeof(DeviceConfiguration)) &&
+        memcmp(&replayedConf, &conf, sizeof(DeviceConfiguration)) == 0;
+
+    replayJournal.getStatistics(statistics);
+    benchmark.journalReplayBytesRead = statistics.replayBytesRead;
+}
+
+#endif
+
 bool isSystemPasswordValid(const char *new_password, size_t new_password_len, int16_t &err) {
     if (new_password_len < PASSWORD_MIN_LENGTH) {
         err = SCPI_ERROR_PASSWORD_TOO_SHORT;
@@ -1419,6 +1681,10 @@ bool saveModuleConf(int slotIndex) {
     );
 }
 
+void getModuleConfWriteStatistics(ModuleConfWriteStatistics &statistics) {
+    statistics = g_moduleConfWriteStatistics;
+}
+
 bool isChannelCalibrationEnabled(int slotIndex, int subchannelIndex) {
     ModuleConfiguration &moduleConf = g_moduleConf[slotIndex];
     return moduleConf.chCalEnabled & (1 << subchannelIndex);
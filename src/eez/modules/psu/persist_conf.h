@@ -33,6 +33,8 @@
 
 #include <eez/file_type.h>
 
+#include <eez/modules/psu/conf_journal.h>
+
 namespace eez {
 namespace psu {
 
@@ -206,6 +208,26 @@ void tick();
 
 bool saveAllDirtyBlocks(); // returns true if there are still more dirty blocks
 
+void getJournalStatistics(conf_journal::Statistics &statistics);
+
+#if defined(EEZ_PLATFORM_SIMULATOR)
+// Same sequence of configuration changes is saved, to the EEPROM simulated in RAM,
+// as blocks (the way it was done before the journal) and to the journal.
+struct JournalBenchmark {
+    uint32_t numChanges;
+    uint32_t changedBytes;
+    uint32_t blocksBytesWritten;
+    uint32_t blocksMaxWritesPerByte;
+    uint32_t journalBytesWritten;
+    uint32_t journalMaxWritesPerByte;
+    uint32_t journalCompactions;
+    uint32_t journalReplayBytesRead;
+    bool journalReplayMatches;
+};
+
+void benchmarkJournal(uint32_t numChanges, JournalBenchmark &benchmark);
+#endif
+
 bool checkBlock(const BlockHeader *block, uint16_t size, uint16_t version);
 uint32_t calcChecksum(const BlockHeader *block, uint16_t size);
 
@@ -358,6 +380,14 @@ struct ModuleConfiguration {
 
 extern ModuleConfiguration g_moduleConf[NUM_SLOTS];
 
+struct ModuleConfWriteStatistics {
+    uint32_t numWrites;
+    uint32_t bytesWritten;
+    uint32_t bytesSkipped; // not written because EEPROM page already had the same content
+};
+
+void getModuleConfWriteStatistics(ModuleConfWriteStatistics &statistics);
+
 bool loadSerialNo(int slotIndex);
 bool saveSerialNo(int slotIndex);
 
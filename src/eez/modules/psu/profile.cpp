@@ -16,6 +16,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stddef.h>
 #include <stdio.h>
 
 #include <eez/file_type.h>
@@ -33,6 +34,7 @@
 #include <eez/modules/psu/sd_card.h>
 
 #include <eez/modules/psu/gui/psu.h>
+#include <eez/modules/psu/gui/data.h>
 
 #include <eez/libs/sd_fat/sd_fat.h>
 
@@ -69,6 +71,7 @@ static void loadProfileName(int location);
 static Parameters *getProfileParametersFromCache(int location);
 
 static void getProfileFilePath(int location, char *filePath);
+static void getBinaryProfileFilePath(int location, char *filePath);
 
 static void resetProfileToDefaults(Parameters &profile);
 
@@ -76,13 +79,18 @@ static void saveState(Parameters &profile, List *lists);
 static bool recallState(Parameters &profile, List *lists, int recallOptions, int *err);
 
 static bool saveProfileToFile(const char *filePath, Parameters &profile, List *lists, bool showProgress, int *err);
-static void saveStateToProfile0(bool merge);
+static void saveStateToProfile0(bool merge, bool binaryOnly);
 
 enum {
     LOAD_PROFILE_FROM_FILE_OPTION_ONLY_NAME = 0x01
 };
 static bool loadProfileFromFile(const char *filePath, Parameters &profile, List *lists, int options, bool showProgress, int *err);
 
+static bool loadProfileFromLocation(int location, Parameters &profile, List *lists, bool showProgress, int *err);
+static bool saveProfileToLocation(int location, Parameters &profile, List *lists, bool showProgress, int *err);
+static bool saveProfileToLocationBinaryOnly(int location, Parameters &profile, List *lists);
+static bool isBinaryProfileNewerThanText(int location);
+
 static bool doSaveToLastLocation(int *err);
 static bool doRecallFromLastLocation(int *err);
 
@@ -103,7 +111,7 @@ void tick() {
         g_lastAutoSaveTime = tick;
 #endif
         if (isTickSaveAllowed() && isAutoSaveAllowed() && isProfile0Dirty() && sd_card::isMounted(nullptr, nullptr)) {
-            saveStateToProfile0(true);
+            saveStateToProfile0(true, true);
         }
 #if !CONF_SURVIVE_MODE        
     }
@@ -117,8 +125,8 @@ void onAfterSdCardMounted() {
 }
 
 void shutdownSave() {
-    if (isAutoSaveAllowed() && isProfile0Dirty()) {
-        saveStateToProfile0(true);
+    if (isAutoSaveAllowed() && (isProfile0Dirty() || isBinaryProfileNewerThanText(0))) {
+        saveStateToProfile0(true, false);
     }
 }
 
@@ -146,12 +154,9 @@ bool recallFromLocation(int location, int recallOptions, bool showProgress, int
         return doRecallFromLastLocation(err);
     }
 
-    char filePath[MAX_PATH_LENGTH];
-    getProfileFilePath(location, filePath);
-
     Parameters profile;
     resetProfileToDefaults(profile);
-    if (!loadProfileFromFile(filePath, profile, g_listsProfile0, 0, showProgress, err)) {
+    if (!loadProfileFromLocation(location, profile, g_listsProfile0, showProgress, err)) {
         return false;
     }
 
@@ -206,7 +211,7 @@ bool recallFromLocation(int location, int recallOptions, bool showProgress, int
         event_queue::pushEvent(event_queue::EVENT_INFO_RECALL_FROM_PROFILE_0 + location);
 
         if (isAutoSaveAllowed()) {
-            saveStateToProfile0(false);
+            saveStateToProfile0(false, true);
         }        
     }
 
@@ -227,7 +232,7 @@ bool recallFromFile(const char *filePath, int recallOptions, bool showProgress,
     event_queue::pushEvent(event_queue::EVENT_INFO_RECALL_FROM_FILE);
 
     if (isAutoSaveAllowed()) {
-        saveStateToProfile0(false);
+        saveStateToProfile0(false, true);
     }
 
     return true;
@@ -253,9 +258,6 @@ bool saveToLocation(int location, const char *name, bool showProgress, int *err)
         return doSaveToLastLocation(err);
     }
 
-    char filePath[MAX_PATH_LENGTH];
-    getProfileFilePath(location, filePath);
-
     Parameters profile;
     memset(&profile, 0, sizeof(Parameters));
     saveState(profile, nullptr);
@@ -263,7 +265,7 @@ bool saveToLocation(int location, const char *name, bool showProgress, int *err)
         strcpy(profile.name, name);
     }
 
-    if (!saveProfileToFile(filePath, profile, nullptr, showProgress, err)) {
+    if (!saveProfileToLocation(location, profile, nullptr, showProgress, err)) {
         return false;
     }
 
@@ -293,6 +295,15 @@ bool importFileToLocation(const char *filePath, int location, bool showProgress,
 }
 
 bool exportLocationToFile(int location, const char *filePath, bool showProgress, int *err) {
+    if (isBinaryProfileNewerThanText(location)) {
+        // auto-saved binary profile must be written to the text profile first
+        Parameters profile;
+        resetProfileToDefaults(profile);
+        if (!loadProfileFromLocation(location, profile, g_listsProfile0, false, err) || !saveProfileToLocation(location, profile, g_listsProfile0, false, err)) {
+            return false;
+        }
+    }
+
     char profileFilePath[MAX_PATH_LENGTH];
     getProfileFilePath(location, profileFilePath);
     return sd_card::copyFile(profileFilePath, filePath, true, err);
@@ -309,6 +320,11 @@ bool deleteLocation(int location, bool showProgress, int *err) {
         g_profilesCache[location].flags.isValid = false;
 
         char filePath[MAX_PATH_LENGTH];
+        getBinaryProfileFilePath(location, filePath);
+        if (sd_card::exists(filePath, nullptr)) {
+            sd_card::deleteFile(filePath, nullptr);
+        }
+
         getProfileFilePath(location, filePath);
         if (!sd_card::exists(filePath, err)) {
             return true;
@@ -377,13 +393,9 @@ bool setName(int location, const char *name, bool showProgress, int *err) {
     if (location > 0 && location < NUM_PROFILE_LOCATIONS) {
         Parameters *profileFromCache = getProfileParametersFromCache(location);
         if (profileFromCache && profileFromCache->flags.isValid) {
-
-            char filePath[MAX_PATH_LENGTH];
-            getProfileFilePath(location, filePath);
-
             Parameters profile;
             resetProfileToDefaults(profile);
-            if (!loadProfileFromFile(filePath, profile, g_listsProfile10, 0, false, err)) {
+            if (!loadProfileFromLocation(location, profile, g_listsProfile10, false, err)) {
                 return false;
             }
 
@@ -392,7 +404,7 @@ bool setName(int location, const char *name, bool showProgress, int *err) {
                 strcpy(profile.name, name);
             }
 
-            if (!saveProfileToFile(filePath, profile, g_listsProfile10, showProgress, err)) {
+            if (!saveProfileToLocation(location, profile, g_listsProfile10, showProgress, err)) {
                 return false;
             }
 
@@ -446,10 +458,8 @@ void loadProfileParametersToCache(int location) {
         
         sendMessageToLowPriorityThread(THREAD_MESSAGE_LOAD_PROFILE, location);
     } else {
-        char filePath[MAX_PATH_LENGTH];
-        getProfileFilePath(location, filePath);
         int err;
-        if (!loadProfileFromFile(filePath, g_profilesCache[location], nullptr, 0, false, &err)) {
+        if (!loadProfileFromLocation(location, g_profilesCache[location], nullptr, false, &err)) {
             if (err != SCPI_ERROR_FILE_NOT_FOUND && err != SCPI_ERROR_MISSING_MASS_MEDIA) {
                 generateError(err);
             }
@@ -844,6 +854,7 @@ static bool recallState(Parameters &profile, List *lists, int recallOptions, int
             Channel &channel = Channel::get(i);
             if (channel.flags.trackingEnabled) {
                 channel.flags.trackingEnabled = 0;
+                eez::gui::incrementDataVersions(eez::gui::DATA_VERSION_SOURCE_CHANNEL);
                 break;
             }
         }
@@ -1141,10 +1152,7 @@ static bool saveProfileToFile(const char *filePath, Parameters &profile, List *l
     return false;
 }
 
-static void saveStateToProfile0(bool merge) {
-    char filePath[MAX_PATH_LENGTH];
-    getProfileFilePath(0, filePath);
-
+static void saveStateToProfile0(bool merge, bool binaryOnly) {
     if (!merge) {
         memset(&g_profilesCache[0], 0, sizeof(Parameters));
         memset(g_listsProfile0, 0, CH_MAX * sizeof(List));
@@ -1152,8 +1160,13 @@ static void saveStateToProfile0(bool merge) {
 
     saveState(g_profilesCache[0], g_listsProfile0);
 
+    // text profile is still saved if there is no text profile yet
+    if (binaryOnly && saveProfileToLocationBinaryOnly(0, g_profilesCache[0], g_listsProfile0)) {
+        return;
+    }
+
     int err;
-    if (!saveProfileToFile(filePath, g_profilesCache[0], g_listsProfile0, false, &err)) {
+    if (!saveProfileToLocation(0, g_profilesCache[0], g_listsProfile0, false, &err)) {
         generateError(err);
         return;
     }
@@ -1478,6 +1491,819 @@ static bool loadProfileFromFile(const char *filePath, Parameters &profile, List
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// Binary profile "<dir>/.<name>.bin" is kept next to the text profile of every location.
+// It is made from (and is valid only together with) the text profile with the same
+// size and hash, so the text profile changed from the outside is never shadowed by the
+// old binary profile. Auto-save of the location 0 writes only the binary profile and marks
+// it as newer than text, text profile is updated on shutdown and before export.
+//
+// Binary profile doesn't depend on the firmware build:
+//   - header and section headers are fixed size structures of the fixed width fields,
+//     first 8 bytes of the header (magic, version and flags) are the same in every version,
+//   - system section fields are stored one by one, little endian, without padding,
+//   - module parameters are tagged with the module profileParametersVersion, section of
+//     the module with other parameters version is skipped and the text profile is used.
+// BINARY_PROFILE_VERSION is increased only when the format changes incompatibly, new
+// fields can be added at the end of the section and new section types are skipped.
+//
+// Binary profile marked as newer than text is never replaced before it is restored: if it
+// can't be used as it is (e.g. after the firmware update), whatever is compatible is
+// restored on top of the text profile and written out to the text profile first.
+
+static const uint32_t BINARY_PROFILE_MAGIC = 0x46525042; // "BPRF"
+static const uint16_t BINARY_PROFILE_VERSION = 2;
+
+enum {
+    BINARY_PROFILE_FLAG_NEWER_THAN_TEXT = 0x0001
+};
+
+struct BinaryProfileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t flags;
+    uint32_t textFileSize;
+    uint32_t textFileHash;
+    uint32_t fileSize;
+    uint16_t numSections;
+    uint16_t reserved;
+    uint32_t crc; // of the header, every section has its own CRC
+};
+
+static_assert(sizeof(BinaryProfileHeader) == 28, "wrong binary profile header size");
+
+enum BinaryProfileHeaderStatus {
+    BINARY_PROFILE_HEADER_INVALID,
+    BINARY_PROFILE_HEADER_OTHER_VERSION,
+    BINARY_PROFILE_HEADER_VALID
+};
+
+enum BinaryProfileSectionType {
+    BINARY_PROFILE_SECTION_SYSTEM,
+    BINARY_PROFILE_SECTION_SLOT,
+    BINARY_PROFILE_SECTION_CHANNEL,
+    BINARY_PROFILE_SECTION_DWELL_LIST,
+    BINARY_PROFILE_SECTION_VOLTAGE_LIST,
+    BINARY_PROFILE_SECTION_CURRENT_LIST
+};
+
+struct BinaryProfileSection {
+    uint8_t type;
+    uint8_t index; // slot or channel index
+    uint16_t size;
+    uint32_t crc;
+};
+
+static_assert(sizeof(BinaryProfileSection) == 8, "wrong binary profile section size");
+
+// moduleType, moduleRevision and profileParametersVersion precede the parameters
+static const uint16_t BINARY_PROFILE_MODULE_SECTION_SIZE = 6 + MAX_CHANNEL_PARAMETERS_SIZE;
+
+static const uint16_t BINARY_PROFILE_SECTION_BUFFER_SIZE = MAX_LIST_LENGTH * sizeof(float);
+static uint8_t g_binaryProfileSectionBuffer[BINARY_PROFILE_SECTION_BUFFER_SIZE];
+
+static_assert(BINARY_PROFILE_MODULE_SECTION_SIZE <= BINARY_PROFILE_SECTION_BUFFER_SIZE, "binary profile section buffer is too small");
+
+class BinaryProfileWriter {
+public:
+    BinaryProfileWriter(uint8_t *buffer, uint16_t bufferSize) : m_buffer(buffer), m_bufferSize(bufferSize), m_size(0) {}
+
+    void u8(uint8_t value) {
+        bytes(&value, 1);
+    }
+
+    void u16(uint16_t value) {
+        uint8_t data[2] = { (uint8_t)value, (uint8_t)(value >> 8) };
+        bytes(data, 2);
+    }
+
+    void u32(uint32_t value) {
+        uint8_t data[4] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+        bytes(data, 4);
+    }
+
+    void f32(float value) {
+        uint32_t data;
+        memcpy(&data, &value, 4);
+        u32(data);
+    }
+
+    void bytes(const void *data, uint16_t size) {
+        if (m_size + size <= m_bufferSize) {
+            memcpy(m_buffer + m_size, data, size);
+        }
+        m_size += size;
+    }
+
+    // false if the buffer was too small
+    bool getSize(uint16_t &size) const {
+        size = m_size;
+        return m_size <= m_bufferSize;
+    }
+
+private:
+    uint8_t *m_buffer;
+    uint16_t m_bufferSize;
+    uint16_t m_size;
+};
+
+class BinaryProfileReader {
+public:
+    BinaryProfileReader(const uint8_t *buffer, uint16_t size) : result(true), m_buffer(buffer), m_size(size), m_position(0) {}
+
+    uint8_t u8() {
+        uint8_t data = 0;
+        bytes(&data, 1);
+        return data;
+    }
+
+    uint16_t u16() {
+        uint8_t data[2] = { 0 };
+        bytes(data, 2);
+        return data[0] | (data[1] << 8);
+    }
+
+    uint32_t u32() {
+        uint8_t data[4] = { 0 };
+        bytes(data, 4);
+        return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+    }
+
+    float f32() {
+        uint32_t data = u32();
+        float value;
+        memcpy(&value, &data, 4);
+        return value;
+    }
+
+    void bytes(void *data, uint16_t size) {
+        if (m_position + size <= m_size) {
+            memcpy(data, m_buffer + m_position, size);
+        } else {
+            result = false;
+        }
+        m_position += size;
+    }
+
+    bool result; // false if the section was too short
+
+private:
+    const uint8_t *m_buffer;
+    uint16_t m_size;
+    uint16_t m_position;
+};
+
+static void getBinaryProfileFilePath(int location, char *filePath) {
+    strcpy(filePath, PROFILES_DIR);
+    strcat(filePath, PATH_SEPARATOR ".");
+    strcatInt(filePath, location);
+    strcat(filePath, getExtensionFromFileType(FILE_TYPE_PROFILE));
+    strcat(filePath, ".bin");
+}
+
+static uint32_t getBinaryProfileHeaderCrc(const BinaryProfileHeader &header) {
+    return crc32((const uint8_t *)&header, offsetof(BinaryProfileHeader, crc));
+}
+
+// FNV-1a hash of the whole file, it is much cheaper than parsing it
+static bool getTextProfileSignature(const char *filePath, uint32_t &fileSize, uint32_t &fileHash) {
+    File file;
+    if (!file.open(filePath, FILE_OPEN_EXISTING | FILE_READ)) {
+        return false;
+    }
+
+    fileSize = file.size();
+
+    uint32_t hash = 2166136261UL;
+    uint8_t buffer[512];
+    while (true) {
+        size_t read = file.read(buffer, sizeof(buffer));
+        for (size_t i = 0; i < read; i++) {
+            hash = (hash ^ buffer[i]) * 16777619UL;
+        }
+        if (read < sizeof(buffer)) {
+            break;
+        }
+    }
+
+    file.close();
+
+    fileHash = hash;
+    return true;
+}
+
+static bool writeBinaryProfileSection(sd_card::BufferedFileWrite &file, BinaryProfileHeader &header, uint8_t type, uint8_t index, const void *data, uint16_t size) {
+    BinaryProfileSection section;
+    section.type = type;
+    section.index = index;
+    section.size = size;
+    section.crc = crc32((const uint8_t *)data, size);
+
+    if (!file.write((const uint8_t *)&section, sizeof(section))) {
+        return false;
+    }
+
+    if (size > 0 && !file.write((const uint8_t *)data, size)) {
+        return false;
+    }
+
+    header.numSections++;
+    header.fileSize += sizeof(section) + size;
+
+    return true;
+}
+
+static bool writeBinaryProfileSystemSection(sd_card::BufferedFileWrite &file, BinaryProfileHeader &header, const Parameters &profile) {
+    BinaryProfileWriter writer(g_binaryProfileSectionBuffer, BINARY_PROFILE_SECTION_BUFFER_SIZE);
+
+    writer.u8(profile.flags.powerIsUp);
+    writer.u8(profile.flags.couplingType);
+    writer.u8(profile.flags.triggerContinuousInitializationEnabled);
+
+    uint8_t nameLength = (uint8_t)MIN(strlen(profile.name), (size_t)PROFILE_NAME_MAX_LENGTH);
+    writer.u8(nameLength);
+    writer.bytes(profile.name, nameLength);
+
+    writer.u16(profile.triggerSource);
+    writer.f32(profile.triggerDelay);
+
+    writer.u8(temp_sensor::MAX_NUM_TEMP_SENSORS);
+    for (int i = 0; i < temp_sensor::MAX_NUM_TEMP_SENSORS; i++) {
+        writer.f32(profile.tempProt[i].delay);
+        writer.f32(profile.tempProt[i].level);
+        writer.u8(profile.tempProt[i].state);
+    }
+
+    writer.u8(NUM_IO_PINS);
+    for (int i = 0; i < NUM_IO_PINS; i++) {
+        writer.u8(profile.ioPins[i].function);
+        writer.u8(profile.ioPins[i].polarity);
+    }
+
+    writer.u8(NUM_IO_PINS - DOUT1);
+    for (int i = 0; i < NUM_IO_PINS - DOUT1; i++) {
+        writer.f32(profile.ioPinsPwmFrequency[i]);
+        writer.f32(profile.ioPinsPwmDuty[i]);
+    }
+
+    uint16_t size;
+    return writer.getSize(size) && writeBinaryProfileSection(file, header, BINARY_PROFILE_SECTION_SYSTEM, 0, g_binaryProfileSectionBuffer, size);
+}
+
+static bool readBinaryProfileSystemSection(const uint8_t *data, uint16_t size, Parameters &profile) {
+    BinaryProfileReader reader(data, size);
+
+    uint8_t powerIsUp = reader.u8();
+    uint8_t couplingType = reader.u8();
+    uint8_t triggerContinuousInitializationEnabled = reader.u8();
+
+    char name[PROFILE_NAME_MAX_LENGTH + 1];
+    uint8_t nameLength = reader.u8();
+    if (nameLength > PROFILE_NAME_MAX_LENGTH) {
+        return false;
+    }
+    reader.bytes(name, nameLength);
+    name[nameLength] = 0;
+
+    uint16_t triggerSource = reader.u16();
+    float triggerDelay = reader.f32();
+
+    temperature::ProtectionConfiguration tempProt[temp_sensor::MAX_NUM_TEMP_SENSORS];
+    memcpy(tempProt, profile.tempProt, sizeof(tempProt));
+    uint8_t numTempSensors = reader.u8();
+    for (int i = 0; i < numTempSensors; i++) {
+        float delay = reader.f32();
+        float level = reader.f32();
+        uint8_t state = reader.u8();
+        if (i < temp_sensor::MAX_NUM_TEMP_SENSORS) {
+            tempProt[i].delay = delay;
+            tempProt[i].level = level;
+            tempProt[i].state = state ? true : false;
+        }
+    }
+
+    io_pins::IOPin ioPins[NUM_IO_PINS];
+    memcpy(ioPins, profile.ioPins, sizeof(ioPins));
+    uint8_t numIoPins = reader.u8();
+    for (int i = 0; i < numIoPins; i++) {
+        uint8_t function = reader.u8();
+        uint8_t polarity = reader.u8();
+        if (i < NUM_IO_PINS) {
+            ioPins[i].function = function;
+            ioPins[i].polarity = polarity;
+        }
+    }
+
+    float ioPinsPwmFrequency[NUM_IO_PINS - DOUT1];
+    float ioPinsPwmDuty[NUM_IO_PINS - DOUT1];
+    memcpy(ioPinsPwmFrequency, profile.ioPinsPwmFrequency, sizeof(ioPinsPwmFrequency));
+    memcpy(ioPinsPwmDuty, profile.ioPinsPwmDuty, sizeof(ioPinsPwmDuty));
+    uint8_t numPwmPins = reader.u8();
+    for (int i = 0; i < numPwmPins; i++) {
+        float frequency = reader.f32();
+        float duty = reader.f32();
+        if (i < NUM_IO_PINS - DOUT1) {
+            ioPinsPwmFrequency[i] = frequency;
+            ioPinsPwmDuty[i] = duty;
+        }
+    }
+
+    if (!reader.result) {
+        return false;
+    }
+
+    profile.flags.isValid = 1;
+    profile.flags.powerIsUp = powerIsUp;
+    profile.flags.couplingType = couplingType;
+    profile.flags.triggerContinuousInitializationEnabled = triggerContinuousInitializationEnabled;
+    memcpy(profile.name, name, nameLength + 1);
+    profile.triggerSource = triggerSource;
+    profile.triggerDelay = triggerDelay;
+    memcpy(profile.tempProt, tempProt, sizeof(tempProt));
+    memcpy(profile.ioPins, ioPins, sizeof(ioPins));
+    memcpy(profile.ioPinsPwmFrequency, ioPinsPwmFrequency, sizeof(ioPinsPwmFrequency));
+    memcpy(profile.ioPinsPwmDuty, ioPinsPwmDuty, sizeof(ioPinsPwmDuty));
+
+    return true;
+}
+
+static bool writeBinaryProfileModuleSection(sd_card::BufferedFileWrite &file, BinaryProfileHeader &header, uint8_t type, uint8_t index, uint16_t moduleType, uint16_t moduleRevision, const uint32_t *parameters) {
+    BinaryProfileWriter writer(g_binaryProfileSectionBuffer, BINARY_PROFILE_SECTION_BUFFER_SIZE);
+
+    writer.u16(moduleType);
+    writer.u16(moduleRevision);
+    writer.u16(getModule(moduleType)->profileParametersVersion);
+    writer.bytes(parameters, MAX_CHANNEL_PARAMETERS_SIZE);
+
+    uint16_t size;
+    return writer.getSize(size) && writeBinaryProfileSection(file, header, type, index, g_binaryProfileSectionBuffer, size);
+}
+
+// Returns false if the parameters were stored by the module with other parameters version.
+static bool readBinaryProfileModuleSection(const uint8_t *data, uint16_t size, uint16_t &moduleType, uint16_t &moduleRevision, uint32_t *parameters) {
+    BinaryProfileReader reader(data, size);
+
+    uint16_t type = reader.u16();
+    uint16_t revision = reader.u16();
+    uint16_t parametersVersion = reader.u16();
+    if (!reader.result || size != BINARY_PROFILE_MODULE_SECTION_SIZE || parametersVersion != getModule(type)->profileParametersVersion) {
+        return false;
+    }
+
+    moduleType = type;
+    moduleRevision = revision;
+    reader.bytes(parameters, MAX_CHANNEL_PARAMETERS_SIZE);
+
+    return true;
+}
+
+static bool writeBinaryProfileSections(sd_card::BufferedFileWrite &file, BinaryProfileHeader &header, const Parameters &profile, List *lists) {
+    if (!writeBinaryProfileSystemSection(file, header, profile)) {
+        return false;
+    }
+
+    for (int slotIndex = 0; slotIndex < NUM_SLOTS; slotIndex++) {
+        auto &slot = profile.slots[slotIndex];
+        if (slot.parametersAreValid) {
+            if (!writeBinaryProfileModuleSection(file, header, BINARY_PROFILE_SECTION_SLOT, slotIndex, slot.moduleType, slot.moduleRevision, slot.parameters)) {
+                return false;
+            }
+        }
+    }
+
+    for (int channelIndex = 0; channelIndex < CH_MAX; channelIndex++) {
+        auto &channel = profile.channels[channelIndex];
+        if (!channel.parametersAreValid) {
+            continue;
+        }
+
+        if (!writeBinaryProfileModuleSection(file, header, BINARY_PROFILE_SECTION_CHANNEL, channelIndex, channel.moduleType, channel.moduleRevision, channel.parameters)) {
+            return false;
+        }
+
+        const float *dwellList;
+        uint16_t dwellListLength;
+        const float *voltageList;
+        uint16_t voltageListLength;
+        const float *currentList;
+        uint16_t currentListLength;
+
+        if (lists) {
+            dwellList = lists[channelIndex].dwellList;
+            dwellListLength = lists[channelIndex].dwellListLength;
+            voltageList = lists[channelIndex].voltageList;
+            voltageListLength = lists[channelIndex].voltageListLength;
+            currentList = lists[channelIndex].currentList;
+            currentListLength = lists[channelIndex].currentListLength;
+        } else if (channelIndex < CH_NUM) {
+            auto &channel = Channel::get(channelIndex);
+            dwellList = list::getDwellList(channel, &dwellListLength);
+            voltageList = list::getVoltageList(channel, &voltageListLength);
+            currentList = list::getCurrentList(channel, &currentListLength);
+        } else {
+            continue;
+        }
+
+        // list values are IEEE 754 floats, little endian on every supported platform
+        if (
+            !writeBinaryProfileSection(file, header, BINARY_PROFILE_SECTION_DWELL_LIST, channelIndex, dwellList, dwellListLength * sizeof(float)) ||
+            !writeBinaryProfileSection(file, header, BINARY_PROFILE_SECTION_VOLTAGE_LIST, channelIndex, voltageList, voltageListLength * sizeof(float)) ||
+            !writeBinaryProfileSection(file, header, BINARY_PROFILE_SECTION_CURRENT_LIST, channelIndex, currentList, currentListLength * sizeof(float))
+        ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool saveProfileToBinaryFile(const char *filePath, const Parameters &profile, List *lists, uint32_t textFileSize, uint32_t textFileHash, bool newerThanText) {
+    File file;
+    if (!file.open(filePath, FILE_CREATE_ALWAYS | FILE_WRITE)) {
+        return false;
+    }
+
+    BinaryProfileHeader header;
+    memset(&header, 0, sizeof(header));
+
+    // header is written at the end, so incomplete binary profile is never used
+    sd_card::BufferedFileWrite bufferedFile(file);
+    bool result = bufferedFile.write((const uint8_t *)&header, sizeof(header));
+
+    header.magic = BINARY_PROFILE_MAGIC;
+    header.version = BINARY_PROFILE_VERSION;
+    header.flags = newerThanText ? BINARY_PROFILE_FLAG_NEWER_THAN_TEXT : 0;
+    header.textFileSize = textFileSize;
+    header.textFileHash = textFileHash;
+    header.fileSize = sizeof(header);
+
+    result = result && writeBinaryProfileSections(bufferedFile, header, profile, lists) && bufferedFile.flush();
+
+    if (result) {
+        header.crc = getBinaryProfileHeaderCrc(header);
+        result = file.seek(0) && file.write(&header, sizeof(header)) == sizeof(header);
+    }
+
+    return file.close() && result;
+}
+
+static BinaryProfileHeaderStatus readBinaryProfileHeader(File &file, BinaryProfileHeader &header) {
+    if (file.read(&header, sizeof(header)) < 8 || header.magic != BINARY_PROFILE_MAGIC) {
+        return BINARY_PROFILE_HEADER_INVALID;
+    }
+
+    if (header.version != BINARY_PROFILE_VERSION) {
+        return BINARY_PROFILE_HEADER_OTHER_VERSION;
+    }
+
+    if (header.crc != getBinaryProfileHeaderCrc(header) || header.fileSize != file.size()) {
+        return BINARY_PROFILE_HEADER_INVALID;
+    }
+
+    return BINARY_PROFILE_HEADER_VALID;
+}
+
+static BinaryProfileHeaderStatus readBinaryProfileHeader(const char *filePath, BinaryProfileHeader &header) {
+    File file;
+    if (!file.open(filePath, FILE_OPEN_EXISTING | FILE_READ)) {
+        return BINARY_PROFILE_HEADER_INVALID;
+    }
+
+    BinaryProfileHeaderStatus status = readBinaryProfileHeader(file, header);
+
+    file.close();
+
+    return status;
+}
+
+// Sections that can't be used, because they are damaged or stored by the module with
+// other parameters version, are skipped and complete is set to false. Returns false
+// if the file can't be read.
+static bool readBinaryProfileSections(File &file, const BinaryProfileHeader &header, Parameters &profile, List *lists, bool &complete) {
+    complete = true;
+
+    for (int i = 0; i < header.numSections; i++) {
+        BinaryProfileSection section;
+        if (file.read(&section, sizeof(section)) != sizeof(section)) {
+            return false;
+        }
+
+        bool isList = section.type >= BINARY_PROFILE_SECTION_DWELL_LIST && section.type <= BINARY_PROFILE_SECTION_CURRENT_LIST;
+        if (section.size > BINARY_PROFILE_SECTION_BUFFER_SIZE || section.type > BINARY_PROFILE_SECTION_CURRENT_LIST || (isList && !lists)) {
+            // unknown section type or the lists are not needed
+            if (!file.seek(file.tell() + section.size)) {
+                return false;
+            }
+            continue;
+        }
+
+        uint8_t *data = g_binaryProfileSectionBuffer;
+        if (file.read(data, section.size) != section.size) {
+            return false;
+        }
+
+        if (crc32(data, section.size) != section.crc) {
+            complete = false;
+            continue;
+        }
+
+        if (section.type == BINARY_PROFILE_SECTION_SYSTEM) {
+            if (!readBinaryProfileSystemSection(data, section.size, profile)) {
+                complete = false;
+            }
+        } else if (section.type == BINARY_PROFILE_SECTION_SLOT || section.type == BINARY_PROFILE_SECTION_CHANNEL) {
+            bool isSlot = section.type == BINARY_PROFILE_SECTION_SLOT;
+            if (section.index >= (isSlot ? NUM_SLOTS : CH_MAX)) {
+                complete = false;
+                continue;
+            }
+
+            // SlotParameters and ChannelParameters have the same fields
+            uint16_t &moduleType = isSlot ? profile.slots[section.index].moduleType : profile.channels[section.index].moduleType;
+            uint16_t &moduleRevision = isSlot ? profile.slots[section.index].moduleRevision : profile.channels[section.index].moduleRevision;
+            bool &parametersAreValid = isSlot ? profile.slots[section.index].parametersAreValid : profile.channels[section.index].parametersAreValid;
+            uint32_t *parameters = isSlot ? profile.slots[section.index].parameters : profile.channels[section.index].parameters;
+
+            if (readBinaryProfileModuleSection(data, section.size, moduleType, moduleRevision, parameters)) {
+                parametersAreValid = true;
+            } else {
+                complete = false;
+            }
+        } else {
+            if (section.index >= CH_MAX || section.size % sizeof(float) != 0) {
+                complete = false;
+                continue;
+            }
+
+            auto &list = lists[section.index];
+            if (section.type == BINARY_PROFILE_SECTION_DWELL_LIST) {
+                memcpy(list.dwellList, data, section.size);
+                list.dwellListLength = section.size / sizeof(float);
+            } else if (section.type == BINARY_PROFILE_SECTION_VOLTAGE_LIST) {
+                memcpy(list.voltageList, data, section.size);
+                list.voltageListLength = section.size / sizeof(float);
+            } else {
+                memcpy(list.currentList, data, section.size);
+                list.currentListLength = section.size / sizeof(float);
+            }
+        }
+    }
+
+    return true;
+}
+
+// Fast path, succeeds only if the binary profile is made from the text profile with the given
+// signature and every section is used.
+static bool loadProfileFromBinaryFile(const char *filePath, Parameters &profile, List *lists, uint32_t textFileSize, uint32_t textFileHash, bool *newerThanText) {
+    File file;
+    if (!file.open(filePath, FILE_OPEN_EXISTING | FILE_READ)) {
+        return false;
+    }
+
+    BinaryProfileHeader header;
+    bool complete = false;
+    bool result = readBinaryProfileHeader(file, header) == BINARY_PROFILE_HEADER_VALID &&
+        header.textFileSize == textFileSize &&
+        header.textFileHash == textFileHash &&
+        readBinaryProfileSections(file, header, profile, lists, complete) &&
+        complete;
+
+    file.close();
+
+    if (result && newerThanText) {
+        *newerThanText = (header.flags & BINARY_PROFILE_FLAG_NEWER_THAN_TEXT) != 0;
+    }
+
+    return result;
+}
+
+// Applies whatever can be used from the binary profile on top of the profile.
+static void restoreProfileFromBinaryFile(const char *filePath, Parameters &profile, List *lists) {
+    File file;
+    if (!file.open(filePath, FILE_OPEN_EXISTING | FILE_READ)) {
+        return;
+    }
+
+    BinaryProfileHeader header;
+    bool complete;
+    if (readBinaryProfileHeader(file, header) == BINARY_PROFILE_HEADER_VALID) {
+        readBinaryProfileSections(file, header, profile, lists, complete);
+    }
+
+    file.close();
+}
+
+static bool isBinaryProfileNewerThanText(int location) {
+    char filePath[MAX_PATH_LENGTH];
+    getBinaryProfileFilePath(location, filePath);
+
+    BinaryProfileHeader header;
+    return readBinaryProfileHeader(filePath, header) == BINARY_PROFILE_HEADER_VALID && (header.flags & BINARY_PROFILE_FLAG_NEWER_THAN_TEXT);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static bool loadProfileFromLocation(int location, Parameters &profile, List *lists, bool showProgress, int *err) {
+    char filePath[MAX_PATH_LENGTH];
+    getProfileFilePath(location, filePath);
+
+    if (!sd_card::isMounted(filePath, err)) {
+        if (err) {
+            *err = SCPI_ERROR_MISSING_MASS_MEDIA;
+        }
+        return false;
+    }
+
+    char binaryFilePath[MAX_PATH_LENGTH];
+    getBinaryProfileFilePath(location, binaryFilePath);
+
+    uint32_t textFileSize;
+    uint32_t textFileHash;
+    bool textFileExists = getTextProfileSignature(filePath, textFileSize, textFileHash);
+    if (textFileExists) {
+        bool newerThanText;
+        if (loadProfileFromBinaryFile(binaryFilePath, profile, lists, textFileSize, textFileHash, &newerThanText)) {
+            // auto-saved state is written out to the text profile, so it is not stale
+            // if power is lost before the next shutdown save
+            if (newerThanText && lists) {
+                saveProfileToLocation(location, profile, lists, false, nullptr);
+            }
+            return true;
+        }
+
+        // binary profile could be partially loaded
+        resetProfileToDefaults(profile);
+    }
+
+    if (!loadProfileFromFile(filePath, profile, lists, 0, showProgress, err)) {
+        return false;
+    }
+
+    BinaryProfileHeader header;
+    BinaryProfileHeaderStatus status = readBinaryProfileHeader(binaryFilePath, header);
+    if (status != BINARY_PROFILE_HEADER_INVALID && (header.flags & BINARY_PROFILE_FLAG_NEWER_THAN_TEXT)) {
+        if (status == BINARY_PROFILE_HEADER_OTHER_VERSION) {
+            // stored by the firmware with other binary profile format, keep it for that firmware
+            char oldFilePath[MAX_PATH_LENGTH];
+            strcpy(oldFilePath, binaryFilePath);
+            strcat(oldFilePath, ".old");
+            sd_card::deleteFile(oldFilePath, nullptr);
+            sd_card::moveFile(binaryFilePath, oldFilePath, nullptr);
+            return true;
+        }
+
+        // Auto-saved state that didn't make it to the text profile (e.g. power was lost and
+        // then the firmware was updated), it is written out to the text profile, which also
+        // replaces the binary profile, only if it is complete with the lists.
+        restoreProfileFromBinaryFile(binaryFilePath, profile, lists);
+        if (lists) {
+            saveProfileToLocation(location, profile, lists, false, nullptr);
+        }
+        return true;
+    }
+
+    // without the lists binary profile would be incomplete
+    if (lists && textFileExists) {
+        saveProfileToBinaryFile(binaryFilePath, profile, lists, textFileSize, textFileHash, false);
+    }
+
+    return true;
+}
+
+static bool saveProfileToLocation(int location, Parameters &profile, List *lists, bool showProgress, int *err) {
+    char filePath[MAX_PATH_LENGTH];
+    getProfileFilePath(location, filePath);
+
+    if (!saveProfileToFile(filePath, profile, lists, showProgress, err)) {
+        return false;
+    }
+
+    // text profile is already saved, so failing to save binary profile is not an error
+    char binaryFilePath[MAX_PATH_LENGTH];
+    getBinaryProfileFilePath(location, binaryFilePath);
+
+    uint32_t textFileSize;
+    uint32_t textFileHash;
+    if (getTextProfileSignature(filePath, textFileSize, textFileHash)) {
+        saveProfileToBinaryFile(binaryFilePath, profile, lists, textFileSize, textFileHash, false);
+    }
+
+    return true;
+}
+
+// Saves only the binary profile, if it is possible, text profile stays as it is.
+static bool saveProfileToLocationBinaryOnly(int location, Parameters &profile, List *lists) {
+    char filePath[MAX_PATH_LENGTH];
+    getProfileFilePath(location, filePath);
+
+    if (!sd_card::isMounted(filePath, nullptr)) {
+        return false;
+    }
+
+    uint32_t textFileSize;
+    uint32_t textFileHash;
+    if (!getTextProfileSignature(filePath, textFileSize, textFileHash)) {
+        return false;
+    }
+
+    char binaryFilePath[MAX_PATH_LENGTH];
+    getBinaryProfileFilePath(location, binaryFilePath);
+
+    return saveProfileToBinaryFile(binaryFilePath, profile, lists, textFileSize, textFileHash, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool benchmarkStorage(int location, StorageBenchmark &benchmark, int *err) {
+    if (location < 0 || location >= NUM_PROFILE_LOCATIONS - 1) {
+        if (err) {
+            *err = SCPI_ERROR_DATA_OUT_OF_RANGE;
+        }
+        return false;
+    }
+
+    char filePath[MAX_PATH_LENGTH];
+    getProfileFilePath(location, filePath);
+
+    // g_listsProfile0 holds the lists of the auto-saved state, so use the
+    // same scratch lists buffer as setName
+    Parameters profile;
+    resetProfileToDefaults(profile);
+    if (!sd_card::exists(filePath, nullptr) || !loadProfileFromFile(filePath, profile, g_listsProfile10, 0, false, nullptr)) {
+        memset(&profile, 0, sizeof(Parameters));
+        saveState(profile, g_listsProfile10);
+    }
+
+    char textFilePath[MAX_PATH_LENGTH];
+    strcpy(textFilePath, PROFILES_DIR);
+    strcat(textFilePath, PATH_SEPARATOR ".benchmark");
+    strcat(textFilePath, getExtensionFromFileType(FILE_TYPE_PROFILE));
+
+    char binaryFilePath[MAX_PATH_LENGTH];
+    strcpy(binaryFilePath, textFilePath);
+    strcat(binaryFilePath, ".bin");
+
+    // Every operation is repeated and the mean time is reported, single operation
+    // could take less than the micros() resolution (1 ms in the simulator).
+    uint32_t time = micros();
+    for (int i = 0; i < STORAGE_BENCHMARK_NUM_ITERATIONS; i++) {
+        if (!saveProfileToFile(textFilePath, profile, g_listsProfile10, false, err)) {
+            return false;
+        }
+    }
+    benchmark.textSaveUs = (micros() - time) / STORAGE_BENCHMARK_NUM_ITERATIONS;
+
+    uint32_t textFileSize = 0;
+    uint32_t textFileHash = 0;
+    bool result = true;
+
+    time = micros();
+    for (int i = 0; i < STORAGE_BENCHMARK_NUM_ITERATIONS && result; i++) {
+        result = getTextProfileSignature(textFilePath, textFileSize, textFileHash) &&
+            saveProfileToBinaryFile(binaryFilePath, profile, g_listsProfile10, textFileSize, textFileHash, false);
+    }
+    benchmark.binarySaveUs = (micros() - time) / STORAGE_BENCHMARK_NUM_ITERATIONS;
+
+    if (result) {
+        time = micros();
+        for (int i = 0; i < STORAGE_BENCHMARK_NUM_ITERATIONS && result; i++) {
+            resetProfileToDefaults(profile);
+            result = loadProfileFromFile(textFilePath, profile, g_listsProfile10, 0, false, err);
+        }
+        benchmark.textLoadUs = (micros() - time) / STORAGE_BENCHMARK_NUM_ITERATIONS;
+    }
+
+    // fast path recall: text profile signature and binary profile
+    if (result) {
+        time = micros();
+        for (int i = 0; i < STORAGE_BENCHMARK_NUM_ITERATIONS && result; i++) {
+            resetProfileToDefaults(profile);
+            result = getTextProfileSignature(textFilePath, textFileSize, textFileHash) &&
+                loadProfileFromBinaryFile(binaryFilePath, profile, g_listsProfile10, textFileSize, textFileHash, nullptr);
+        }
+        benchmark.binaryLoadUs = (micros() - time) / STORAGE_BENCHMARK_NUM_ITERATIONS;
+    }
+
+    benchmark.textFileSize = textFileSize;
+
+    File file;
+    benchmark.binaryFileSize = 0;
+    if (file.open(binaryFilePath, FILE_OPEN_EXISTING | FILE_READ)) {
+        benchmark.binaryFileSize = file.size();
+        file.close();
+    }
+
+    sd_card::deleteFile(textFilePath, nullptr);
+    sd_card::deleteFile(binaryFilePath, nullptr);
+
+    if (!result && err) {
+        *err = SCPI_ERROR_MASS_STORAGE_ERROR;
+    }
+
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 static bool doSaveToLastLocation(int *err) {
     memset(&g_profilesCache[NUM_PROFILE_LOCATIONS - 1], 0, sizeof(Parameters));
     saveState(g_profilesCache[NUM_PROFILE_LOCATIONS - 1], g_listsProfile10);
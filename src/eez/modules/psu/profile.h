@@ -122,6 +122,22 @@ void setFreezeState(bool value);
 
 void loadProfileParametersToCache(int location);
 
+static const int STORAGE_BENCHMARK_NUM_ITERATIONS = 20;
+
+/// Mean times of STORAGE_BENCHMARK_NUM_ITERATIONS saves and loads.
+struct StorageBenchmark {
+    uint32_t textFileSize;
+    uint32_t binaryFileSize;
+    uint32_t textSaveUs;
+    uint32_t textLoadUs;
+    uint32_t binarySaveUs;
+    uint32_t binaryLoadUs; // including the text profile signature check
+};
+
+/// Saves and loads the profile from the location (or the current state if location is empty)
+/// in the text and binary format, using temporary files in the profiles directory.
+bool benchmarkStorage(int location, StorageBenchmark &benchmark, int *err);
+
 class WriteContext {
 public:
     WriteContext(File &file_);
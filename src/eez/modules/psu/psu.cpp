@@ -23,6 +23,10 @@
 #include <tim.h>
 #endif
 
+#if defined(EEZ_PLATFORM_SIMULATOR)
+#include <eez/platform/simulator/events.h>
+#endif
+
 #include <eez/firmware.h>
 #include <eez/system.h>
 #include <eez/sound.h>
@@ -53,9 +57,11 @@
 #include <eez/modules/psu/ramp.h>
 #include <eez/modules/psu/trigger.h>
 #include <eez/modules/psu/ontime.h>
+#include <eez/modules/psu/tick_profiler.h>
 
 #if OPTION_DISPLAY
 #include <eez/modules/psu/gui/psu.h>
+#include <eez/modules/psu/gui/data.h>
 #endif
 
 #if OPTION_FAN
@@ -469,6 +475,8 @@ void PsuModule::setPowerChannelProfileParameters(int channelIndex, uint8_t *buff
 
     strcpy(channel.label, parameters->label);
     channel.color = parameters->color;
+
+    eez::gui::incrementDataVersions(eez::gui::DATA_VERSION_SOURCE_CHANNEL);
 }
 
 bool PsuModule::writePowerChannelProfileProperties(profile::WriteContext &ctx, const uint8_t *buffer) {
@@ -635,6 +643,7 @@ eez_err_t PsuModule::setChannelLabel(int subchannelIndex, const char *label, int
     Channel *channel = Channel::getBySlotIndex(slotIndex, subchannelIndex);
     strncpy(channel->label, label, length);
     channel->label[length] = 0;
+    eez::gui::incrementDataVersions(eez::gui::DATA_VERSION_SOURCE_CHANNEL);
     return SCPI_RES_OK;
 }
 
@@ -1211,30 +1220,45 @@ void onProtectionTripped() {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+static_assert(tick_profiler::STAGE_SLOT1 + NUM_SLOTS <= tick_profiler::STAGE_TRIGGER, "not enough tick profiler slot stages");
+
 void tick() {
+    TICK_PROFILER_BEGIN();
+
     for (int i = 0; i < NUM_SLOTS; i++) {
         g_slots[i]->tick();
+        TICK_PROFILER_END_STAGE(STAGE_SLOT1 + i);
     }
 
     trigger::tick();
+    TICK_PROFILER_END_STAGE(STAGE_TRIGGER);
     list::tick();
+    TICK_PROFILER_END_STAGE(STAGE_LIST);
     ramp::tick();
+    TICK_PROFILER_END_STAGE(STAGE_RAMP);
 
     for (int i = 0; i < CH_NUM; ++i) {
         Channel::get(i).tick();
     }
+    TICK_PROFILER_END_STAGE(STAGE_CHANNELS);
 
     dlog_record::tick();
+    TICK_PROFILER_END_STAGE(STAGE_DLOG_RECORD);
 
     io_pins::tick();
+    TICK_PROFILER_END_STAGE(STAGE_IO_PINS);
     temperature::tick();
+    TICK_PROFILER_END_STAGE(STAGE_TEMPERATURE);
     aux_ps::fan::tick();
+    TICK_PROFILER_END_STAGE(STAGE_FAN);
     datetime::tick();
+    TICK_PROFILER_END_STAGE(STAGE_DATETIME);
 
     // call every 10 ms
     static int counter = 0;
     if (++counter == 10) {
         touch::tickHighPriority();
+        TICK_PROFILER_END_STAGE(STAGE_TOUCH);
         counter = 0;
     }
 
@@ -1242,6 +1266,8 @@ void tick() {
         g_diagCallback();
         g_diagCallback = NULL;
     }
+
+    TICK_PROFILER_END();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1352,6 +1378,8 @@ void setCC(int pin, bool on) {
 ////////////////////////////////////////////////////////////////////////////////
 
 void exit() {
+    // same as closing the simulator window, needed by the headless simulator
+    platform::simulator::requestExit();
 }
 
 } // namespace simulator
@@ -84,6 +84,20 @@ bool test() {
 #if defined(EEZ_PLATFORM_SIMULATOR)
 uint32_t nowUtc() {
     time_t now_time_t = time(0);
+
+    // in virtual time mode RTC is counting from the moment virtual time was switched on
+    static time_t g_virtualTimeStart;
+    static uint32_t g_virtualTimeStartMs;
+    if (osKernelIsVirtualTime()) {
+        if (!g_virtualTimeStart) {
+            g_virtualTimeStart = now_time_t;
+            g_virtualTimeStartMs = millis();
+        }
+        now_time_t = g_virtualTimeStart + (millis() - g_virtualTimeStartMs) / 1000;
+    } else {
+        g_virtualTimeStart = 0;
+    }
+
     struct tm *now_tm = gmtime(&now_time_t);
     return datetime::makeTime(1900 + now_tm->tm_year, now_tm->tm_mon + 1, now_tm->tm_mday,
                               now_tm->tm_hour, now_tm->tm_min, now_tm->tm_sec);
@@ -25,6 +25,9 @@
 
 #include <eez/firmware.h>
 #include <eez/system.h>
+#include <eez/tasks.h>
+#include <eez/message_queue.h>
+#include <eez/mqtt.h>
 
 #if OPTION_FAN
 #include <eez/modules/aux_ps/fan.h>
@@ -32,10 +35,14 @@
 
 #include <eez/modules/psu/psu.h>
 #include <eez/modules/psu/serial_psu.h>
+#include <eez/modules/psu/ethernet.h>
 #include <eez/modules/psu/temperature.h>
 #include <eez/modules/psu/ontime.h>
 #include <eez/modules/psu/scpi/psu.h>
 #include <eez/modules/psu/event_queue.h>
+#include <eez/modules/psu/profile.h>
+#include <eez/modules/psu/sd_card.h>
+#include <eez/modules/psu/tick_profiler.h>
 #if OPTION_DISPLAY
 #include <eez/modules/psu/gui/psu.h>
 #endif
@@ -441,6 +448,298 @@ scpi_result_t scpi_cmd_debugDownloadFirmware(scpi_t *context) {
 #endif // DEBUG
 }
 
+scpi_result_t scpi_cmd_debugFontCacheQ(scpi_t *context) {
+#if OPTION_DISPLAY
+    mcu::display::FontCacheStatistics statistics;
+    mcu::display::getFontCacheStatistics(statistics);
+
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+        "glyph hits: %u\nglyph misses: %u\nwidth hits: %u\nwidth misses: %u\n",
+        (unsigned)statistics.glyphHits, (unsigned)statistics.glyphMisses,
+        (unsigned)statistics.widthHits, (unsigned)statistics.widthMisses);
+
+    SCPI_ResultCharacters(context, buffer, strlen(buffer));
+
+    return SCPI_RES_OK;
+#else
+    SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+    return SCPI_RES_ERR;
+#endif
+}
+
+scpi_result_t scpi_cmd_debugGuiUpdateQ(scpi_t *context) {
+#if OPTION_DISPLAY
+    eez::gui::UpdateScreenStatistics statistics;
+    eez::gui::getUpdateScreenStatistics(statistics);
+
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+        "frames: %u\nlast frame time: %u us\nmax frame time: %u us\navg frame time: %u us\nskipped subtrees: %u\nskipped widgets: %u\ndrawn widgets: %u\nskip rate: %u%%\n",
+        (unsigned)statistics.numFrames, (unsigned)statistics.lastFrameTime,
+        (unsigned)statistics.maxFrameTime, (unsigned)statistics.avgFrameTime,
+        (unsigned)statistics.numSkippedSubtrees, (unsigned)statistics.numSkippedWidgets,
+        (unsigned)statistics.numDrawnWidgets, (unsigned)statistics.skipRate);
+
+    SCPI_ResultCharacters(context, buffer, strlen(buffer));
+
+    return SCPI_RES_OK;
+#else
+    SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+    return SCPI_RES_ERR;
+#endif
+}
+
+scpi_result_t scpi_cmd_debugQueueQ(scpi_t *context) {
+    MessageQueueStatistics highPriority;
+    getHighPriorityMessageQueueStatistics(highPriority);
+
+    MessageQueueStatistics lowPriority;
+    getLowPriorityMessageQueueStatistics(lowPriority);
+
+    MessageQueueStatistics lowPriorityUrgent;
+    getLowPriorityUrgentMessageQueueStatistics(lowPriorityUrgent);
+
+    char buffer[512];
+    int n = 0;
+    const char *names[] = { "high priority", "low priority", "low priority urgent" };
+    MessageQueueStatistics *statistics[] = { &highPriority, &lowPriority, &lowPriorityUrgent };
+    for (int i = 0; i < 3; i++) {
+        n += snprintf(buffer + n, sizeof(buffer) - n,
+            "%s: capacity=%u, waiting=%u, high water mark=%u, put=%u, stalled=%u, dropped=%u\n",
+            names[i], (unsigned)statistics[i]->capacity, (unsigned)statistics[i]->numWaiting,
+            (unsigned)statistics[i]->highWaterMark, (unsigned)statistics[i]->numPut,
+            (unsigned)statistics[i]->numStalled, (unsigned)statistics[i]->numDropped);
+    }
+
+    SCPI_ResultCharacters(context, buffer, n);
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_debugQueueLatencyQ(scpi_t *context) {
+    char buffer[2048];
+    int n = 0;
+    for (int messageType = 0; messageType <= THREAD_MESSAGE_MODULE_SPECIFIC; messageType++) {
+        LowPriorityThreadMessageStatistics statistics;
+        if (!getLowPriorityThreadMessageStatistics(messageType, statistics) || statistics.count == 0) {
+            continue;
+        }
+
+        int length = snprintf(buffer + n, sizeof(buffer) - n,
+            "%s%s: count=%u, avg wait=%u us, max wait=%u us, avg run=%u us, max run=%u us\n",
+            statistics.name, statistics.urgent ? " (urgent)" : "", (unsigned)statistics.count,
+            (unsigned)statistics.avgWaitUs, (unsigned)statistics.maxWaitUs,
+            (unsigned)statistics.avgRunUs, (unsigned)statistics.maxRunUs);
+        if (length < 0 || n + length >= (int)sizeof(buffer)) {
+            break;
+        }
+        n += length;
+    }
+
+    SCPI_ResultCharacters(context, buffer, n);
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_debugMqttQ(scpi_t *context) {
+#if OPTION_ETHERNET
+    mqtt::PublishStatistics statistics;
+    mqtt::getPublishStatistics(statistics);
+
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer),
+        "published: %u\nfailed: %u\nmessages/s: %u\nmax publishes per tick: %u\nmax publishes in flight: %u\n"
+        "last staleness: %u ms\navg staleness: %u ms\nmax staleness: %u ms\n",
+        (unsigned)statistics.numPublished, (unsigned)statistics.numFailed,
+        (unsigned)statistics.messagesPerSecond, (unsigned)statistics.maxPublishesPerTick,
+        (unsigned)statistics.maxPublishesInFlight, (unsigned)statistics.lastStaleness,
+        (unsigned)(statistics.numStalenessSamples > 0 ? statistics.totalStaleness / statistics.numStalenessSamples : 0),
+        (unsigned)statistics.maxStaleness);
+
+    SCPI_ResultCharacters(context, buffer, strlen(buffer));
+
+    return SCPI_RES_OK;
+#else
+    SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+    return SCPI_RES_ERR;
+#endif
+}
+
+scpi_result_t scpi_cmd_debugTickQ(scpi_t *context) {
+#if CONF_TICK_PROFILER
+    using namespace tick_profiler;
+
+    static char buffer[2048];
+    int n = 0;
+    for (int i = 0; i < NUM_STAGES; i++) {
+        StageStatistics statistics;
+        getStageStatistics((Stage)i, statistics);
+        n += snprintf(buffer + n, sizeof(buffer) - n,
+            "%s: count=%u, min=%u ns, avg=%u ns, p99=%u ns, max=%u ns, overruns=%u\n",
+            getStageName((Stage)i), (unsigned)statistics.count,
+            (unsigned)statistics.minNs, (unsigned)statistics.avgNs,
+            (unsigned)statistics.p99Ns, (unsigned)statistics.maxNs,
+            (unsigned)statistics.numOverruns);
+    }
+
+    SCPI_ResultCharacters(context, buffer, n);
+
+    return SCPI_RES_OK;
+#else
+    SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+    return SCPI_RES_ERR;
+#endif
+}
+
+scpi_result_t scpi_cmd_debugTickReset(scpi_t *context) {
+#if CONF_TICK_PROFILER
+    tick_profiler::reset();
+    return SCPI_RES_OK;
+#else
+    SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+    return SCPI_RES_ERR;
+#endif
+}
+
+static int printTransferStatistics(char *buffer, size_t bufferSize, const char *name, const sd_card::TransferStatistics &statistics) {
+    return snprintf(buffer, bufferSize,
+        "%s: %u bytes in %u ms, %.2f MB/s, file %.2f MB/s, blocks=%u, syncs=%u, retries=%u\n",
+        name, (unsigned)statistics.numBytes, (unsigned)(statistics.timeUs / 1000),
+        statistics.timeUs > 0 ? 1.0 * statistics.numBytes / statistics.timeUs : 0.0,
+        statistics.fileTimeUs > 0 ? 1.0 * statistics.numBytes / statistics.fileTimeUs : 0.0,
+        (unsigned)statistics.numBlocks, (unsigned)statistics.numSyncs, (unsigned)statistics.numRetries);
+}
+
+scpi_result_t scpi_cmd_debugMmemoryTransferQ(scpi_t *context) {
+    sd_card::TransferStatistics statistics;
+
+    char buffer[256];
+    int n = 0;
+
+    sd_card::getDownloadStatistics(statistics);
+    n += printTransferStatistics(buffer + n, sizeof(buffer) - n, "download", statistics);
+
+    sd_card::getUploadStatistics(statistics);
+    n += printTransferStatistics(buffer + n, sizeof(buffer) - n, "upload", statistics);
+
+    SCPI_ResultCharacters(context, buffer, n);
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_debugProfileBenchmarkQ(scpi_t *context) {
+    char buffer[1536];
+    int n = 0;
+
+    for (int location = 0; location < NUM_PROFILE_LOCATIONS - 1; location++) {
+        profile::StorageBenchmark benchmark;
+        int err;
+        if (!profile::benchmarkStorage(location, benchmark, &err)) {
+            SCPI_ErrorPush(context, err);
+            return SCPI_RES_ERR;
+        }
+
+        n += snprintf(buffer + n, sizeof(buffer) - n,
+            "%d: text %u B save %u us load %u us, binary %u B save %u us load %u us (mean of %d)\n",
+            location, (unsigned)benchmark.textFileSize, (unsigned)benchmark.textSaveUs, (unsigned)benchmark.textLoadUs,
+            (unsigned)benchmark.binaryFileSize, (unsigned)benchmark.binarySaveUs, (unsigned)benchmark.binaryLoadUs,
+            profile::STORAGE_BENCHMARK_NUM_ITERATIONS);
+    }
+
+    SCPI_ResultCharacters(context, buffer, n);
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_debugConfigQ(scpi_t *context) {
+    conf_journal::Statistics journal;
+    persist_conf::getJournalStatistics(journal);
+
+    mcu::eeprom::Statistics eeprom;
+    mcu::eeprom::getStatistics(eeprom);
+
+    persist_conf::ModuleConfWriteStatistics moduleConf;
+    persist_conf::getModuleConfWriteStatistics(moduleConf);
+
+    char buffer[512];
+    int n = snprintf(buffer, sizeof(buffer),
+        "journal: segment=%d, sequence=%u, used=%u/%u B, records=%u, appends=%u, compactions=%u, written=%u B, replay read=%u B\n"
+        "mcu eeprom: reads=%u, read=%u B, writes=%u, written=%u B\n"
+        "module conf: writes=%u, written=%u B, skipped=%u B\n",
+        journal.activeSegment, (unsigned)journal.sequenceNumber, (unsigned)journal.usedBytes, (unsigned)journal.segmentSize,
+        (unsigned)journal.numRecords, (unsigned)journal.numAppends, (unsigned)journal.numCompactions,
+        (unsigned)journal.bytesWritten, (unsigned)journal.replayBytesRead,
+        (unsigned)eeprom.numReads, (unsigned)eeprom.bytesRead, (unsigned)eeprom.numWrites, (unsigned)eeprom.bytesWritten,
+        (unsigned)moduleConf.numWrites, (unsigned)moduleConf.bytesWritten, (unsigned)moduleConf.bytesSkipped);
+
+    SCPI_ResultCharacters(context, buffer, n);
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_debugConfigBenchmarkQ(scpi_t *context) {
+#if defined(EEZ_PLATFORM_SIMULATOR)
+    uint32_t numChanges = 1000;
+    if (!SCPI_ParamUInt32(context, &numChanges, false)) {
+        if (SCPI_ParamErrorOccurred(context)) {
+            return SCPI_RES_ERR;
+        }
+    }
+
+    if (numChanges < 1 || numChanges > 10000) {
+        SCPI_ErrorPush(context, SCPI_ERROR_DATA_OUT_OF_RANGE);
+        return SCPI_RES_ERR;
+    }
+
+    persist_conf::JournalBenchmark benchmark;
+    persist_conf::benchmarkJournal(numChanges, benchmark);
+
+    char buffer[512];
+    int n = snprintf(buffer, sizeof(buffer),
+        "changes: %u, changed bytes: %u\n"
+        "blocks: written=%u B, amplification=%.1f, max writes per byte=%u\n"
+        "journal: written=%u B, amplification=%.1f, max writes per byte=%u, compactions=%u\n"
+        "replay: read=%u B, %s\n",
+        (unsigned)benchmark.numChanges, (unsigned)benchmark.changedBytes,
+        (unsigned)benchmark.blocksBytesWritten, 1.0 * benchmark.blocksBytesWritten / benchmark.changedBytes,
+        (unsigned)benchmark.blocksMaxWritesPerByte,
+        (unsigned)benchmark.journalBytesWritten, 1.0 * benchmark.journalBytesWritten / benchmark.changedBytes,
+        (unsigned)benchmark.journalMaxWritesPerByte, (unsigned)benchmark.journalCompactions,
+        (unsigned)benchmark.journalReplayBytesRead, benchmark.journalReplayMatches ? "OK" : "MISMATCH");
+
+    SCPI_ResultCharacters(context, buffer, n);
+
+    return SCPI_RES_OK;
+#else
+    SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+    return SCPI_RES_ERR;
+#endif
+}
+
+scpi_result_t scpi_cmd_debugScpiBenchmarkQ(scpi_t *context) {
+    char buffer[256];
+    benchmarkCommandLookup(buffer, sizeof(buffer));
+
+    SCPI_ResultCharacters(context, buffer, strlen(buffer));
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_debugEthernetBenchmarkQ(scpi_t *context) {
+#if defined(EEZ_PLATFORM_SIMULATOR) && OPTION_ETHERNET
+    char buffer[256];
+    ethernet::benchmarkOutput(buffer, sizeof(buffer));
+
+    SCPI_ResultCharacters(context, buffer, strlen(buffer));
+
+    return SCPI_RES_OK;
+#else
+    SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+    return SCPI_RES_ERR;
+#endif
+}
+
 scpi_result_t scpi_cmd_debugEvent(scpi_t *context) {
     int32_t eventId;
     if (!SCPI_ParamInt(context, &eventId, TRUE)) {
@@ -275,6 +275,125 @@ scpi_result_t scpi_cmd_senseDlogPeriodQ(scpi_t *context) {
     return SCPI_RES_OK;
 }
 
+scpi_result_t scpi_cmd_senseDlogCompression(scpi_t *context) {
+    if (!dlog_record::isIdle()) {
+        SCPI_ErrorPush(context, SCPI_ERROR_CANNOT_CHANGE_TRANSIENT_TRIGGER);
+        return SCPI_RES_ERR;
+    }
+
+    bool enable;
+    if (!SCPI_ParamBool(context, &enable, TRUE)) {
+        return SCPI_RES_ERR;
+    }
+
+    dlog_record::setCompression(enable);
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_senseDlogCompressionQ(scpi_t *context) {
+    SCPI_ResultBool(context, dlog_record::getCompression());
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_senseDlogFlushSize(scpi_t *context) {
+    scpi_number_t param;
+    if (!SCPI_ParamNumber(context, scpi_special_numbers_def, &param, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    uint32_t chunkSize;
+
+    if (param.special) {
+        if (param.content.tag == SCPI_NUM_MIN) {
+            chunkSize = dlog_record::FLUSH_CHUNK_SIZE_MIN;
+        } else if (param.content.tag == SCPI_NUM_MAX) {
+            chunkSize = dlog_record::FLUSH_CHUNK_SIZE_MAX;
+        } else if (param.content.tag == SCPI_NUM_DEF) {
+            chunkSize = dlog_record::FLUSH_CHUNK_SIZE_DEFAULT;
+        } else {
+            SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+            return SCPI_RES_ERR;
+        }
+    } else {
+        if (param.unit != SCPI_UNIT_NONE) {
+            SCPI_ErrorPush(context, SCPI_ERROR_INVALID_SUFFIX);
+            return SCPI_RES_ERR;
+        }
+
+        chunkSize = (uint32_t)param.content.value;
+    }
+
+    int err = dlog_record::setFlushChunkSize(chunkSize);
+    if (err != SCPI_RES_OK) {
+        SCPI_ErrorPush(context, err);
+        return SCPI_RES_ERR;
+    }
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_senseDlogFlushSizeQ(scpi_t *context) {
+    SCPI_ResultUInt32(context, dlog_record::getFlushChunkSize());
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_senseDlogFlushTime(scpi_t *context) {
+    scpi_number_t param;
+    if (!SCPI_ParamNumber(context, scpi_special_numbers_def, &param, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    float time;
+
+    if (param.special) {
+        if (param.content.tag == SCPI_NUM_MIN) {
+            time = dlog_record::FLUSH_TIME_MIN;
+        } else if (param.content.tag == SCPI_NUM_MAX) {
+            time = dlog_record::FLUSH_TIME_MAX;
+        } else if (param.content.tag == SCPI_NUM_DEF) {
+            time = dlog_record::FLUSH_TIME_DEFAULT;
+        } else {
+            SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+            return SCPI_RES_ERR;
+        }
+    } else {
+        if (param.unit != SCPI_UNIT_NONE && param.unit != SCPI_UNIT_SECOND) {
+            SCPI_ErrorPush(context, SCPI_ERROR_INVALID_SUFFIX);
+            return SCPI_RES_ERR;
+        }
+
+        time = (float)param.content.value;
+    }
+
+    int err = dlog_record::setFlushTime(time);
+    if (err != SCPI_RES_OK) {
+        SCPI_ErrorPush(context, err);
+        return SCPI_RES_ERR;
+    }
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_senseDlogFlushTimeQ(scpi_t *context) {
+    SCPI_ResultFloat(context, dlog_record::getFlushTime());
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_senseDlogStatisticsQ(scpi_t *context) {
+    auto &statistics = dlog_record::g_samplingStatistics;
+
+    SCPI_ResultFloat(context, dlog_record::getRequestedSamplingRate());
+    SCPI_ResultFloat(context, dlog_record::getAchievedSamplingRate());
+    SCPI_ResultUInt32(context, statistics.numSamples);
+    SCPI_ResultUInt32(context, statistics.numMissedSamples);
+    SCPI_ResultUInt32(context, statistics.minJitterUs);
+    SCPI_ResultUInt32(context, statistics.numSamples > 0 ? (uint32_t)(statistics.totalJitterUs / statistics.numSamples) : 0);
+    SCPI_ResultUInt32(context, statistics.maxJitterUs);
+
+    return SCPI_RES_OK;
+}
+
 scpi_result_t scpi_cmd_senseDlogTime(scpi_t *context) {
     if (!dlog_record::isIdle()) {
         SCPI_ErrorPush(context, SCPI_ERROR_CANNOT_CHANGE_TRANSIENT_TRIGGER);
@@ -867,6 +986,33 @@ scpi_result_t scpi_cmd_senseDlogTraceData(scpi_t *context) {
     return SCPI_RES_OK;
 }
 
+scpi_result_t scpi_cmd_senseDlogTraceBinary(scpi_t *context) {
+    if (!dlog_record::isTraceExecuting()) {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+    }
+
+    const char *buffer;
+    size_t size;
+    if (!SCPI_ParamArbitraryBlock(context, &buffer, &size, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    size_t rowSize = dlog_record::g_recording.parameters.numYAxes * sizeof(float);
+    if (size % rowSize != 0) {
+        SCPI_ErrorPush(context, SCPI_ERROR_INVALID_BLOCK_DATA);
+        return SCPI_RES_ERR;
+    }
+
+    int err;
+    if (!dlog_record::log(buffer, size / rowSize, &err)) {
+        SCPI_ErrorPush(context, err);
+        return SCPI_RES_ERR;
+    }
+
+    return SCPI_RES_OK;
+}
+
 
 } // namespace scpi
 } // namespace psu
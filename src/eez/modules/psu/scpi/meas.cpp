@@ -110,6 +110,98 @@ scpi_result_t scpi_cmd_measureDigitalByteQ(scpi_t *context) {
     return SCPI_RES_OK;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
+enum FetchArrayFunction {
+    FETCH_ARRAY_VOLTAGE,
+    FETCH_ARRAY_CURRENT,
+    FETCH_ARRAY_POWER
+};
+
+// Returns samples from the channel acquisition buffer as arbitrary block. Every sample
+// is 12 bytes: sequence number (uint32), time in milliseconds (uint32) and value (float),
+// all little endian. Parameters: [<count>[, <since>[, <channel>]]], where count is
+// the maximum number of the most recent samples and since is the first sequence number.
+static scpi_result_t fetchArray(scpi_t *context, FetchArrayFunction function) {
+    uint32_t count;
+    if (!SCPI_ParamUInt32(context, &count, false)) {
+        if (SCPI_ParamErrorOccurred(context)) {
+            return SCPI_RES_ERR;
+        }
+        count = CHANNEL_ACQUISITION_SIZE;
+    }
+
+    uint32_t since;
+    if (!SCPI_ParamUInt32(context, &since, false)) {
+        if (SCPI_ParamErrorOccurred(context)) {
+            return SCPI_RES_ERR;
+        }
+        since = 0;
+    }
+
+    SlotAndSubchannelIndex slotAndSubchannelIndex;
+    if (!getChannelFromParam(context, slotAndSubchannelIndex)) {
+        return SCPI_RES_ERR;
+    }
+
+    Channel *channel = Channel::getBySlotIndex(slotAndSubchannelIndex.slotIndex, slotAndSubchannelIndex.subchannelIndex);
+    if (!channel) {
+        SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+        return SCPI_RES_ERR;
+    }
+
+    // only used from the SCPI thread
+    static AcquisitionSample g_samples[CHANNEL_ACQUISITION_SIZE];
+
+    uint32_t firstSequence;
+    uint32_t numSamples = channel->getAcquisitionSamples(since, count, g_samples, firstSequence);
+
+    static const size_t SAMPLE_SIZE = 12;
+    static const size_t CHUNK_NUM_SAMPLES = 32;
+
+    SCPI_ResultArbitraryBlockHeader(context, numSamples * SAMPLE_SIZE);
+
+    for (uint32_t i = 0; i < numSamples; ) {
+        uint8_t chunk[CHUNK_NUM_SAMPLES * SAMPLE_SIZE];
+        uint8_t *p = chunk;
+
+        for (size_t j = 0; j < CHUNK_NUM_SAMPLES && i < numSamples; j++, i++) {
+            AcquisitionSample &sample = g_samples[i];
+
+            float value;
+            if (function == FETCH_ARRAY_VOLTAGE) {
+                value = sample.u;
+            } else if (function == FETCH_ARRAY_CURRENT) {
+                value = sample.i;
+            } else {
+                value = sample.u * sample.i;
+            }
+
+            uint32_t sequence = firstSequence + i;
+            memcpy(p, &sequence, 4);
+            memcpy(p + 4, &sample.timeMs, 4);
+            memcpy(p + 8, &value, 4);
+            p += SAMPLE_SIZE;
+        }
+
+        SCPI_ResultArbitraryBlockData(context, chunk, p - chunk);
+    }
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_fetchArrayVoltageQ(scpi_t *context) {
+    return fetchArray(context, FETCH_ARRAY_VOLTAGE);
+}
+
+scpi_result_t scpi_cmd_fetchArrayCurrentQ(scpi_t *context) {
+    return fetchArray(context, FETCH_ARRAY_CURRENT);
+}
+
+scpi_result_t scpi_cmd_fetchArrayPowerQ(scpi_t *context) {
+    return fetchArray(context, FETCH_ARRAY_POWER);
+}
+
 } // namespace scpi
 } // namespace psu
 } // namespace eez
\ No newline at end of file
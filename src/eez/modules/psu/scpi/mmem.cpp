@@ -218,6 +218,7 @@ scpi_result_t scpi_cmd_mmemoryUploadQ(scpi_t *context) {
 
 static char g_downloadFilePath[MAX_PATH_LENGTH + 1];
 static uint32_t g_downloadSize;
+static uint32_t g_downloadOffset;
 static bool g_downloading;
 static bool g_aborted;
 static uint32_t g_downloaded;
@@ -232,10 +233,13 @@ void startDownloading() {
 #endif
 }
 
-void finishDownloading(int16_t eventId) {
-	sd_card::downloadFinished();
+bool finishDownloading(int16_t eventId) {
+	if (!sd_card::downloadFinished(eventId == event_queue::EVENT_INFO_FILE_DOWNLOAD_SUCCEEDED)) {
+        eventId = event_queue::EVENT_ERROR_FILE_DOWNLOAD_FAILED;
+    }
 
-	if (eventId != event_queue::EVENT_INFO_FILE_DOWNLOAD_SUCCEEDED) {
+    // failed download is kept, so it can be continued with MMEM:DOWN:OFFS
+	if (eventId == event_queue::EVENT_WARNING_FILE_DOWNLOAD_ABORTED) {
         sd_card::deleteFile(g_downloadFilePath, 0);
     }
     event_queue::pushEvent(eventId);
@@ -244,6 +248,8 @@ void finishDownloading(int16_t eventId) {
 #endif
     g_downloading = false;
     g_downloadFilePath[0] = 0;
+
+    return eventId == event_queue::EVENT_INFO_FILE_DOWNLOAD_SUCCEEDED;
 }
 
 void abortDownloading() {
@@ -261,16 +267,41 @@ scpi_result_t scpi_cmd_mmemoryDownloadFname(scpi_t *context) {
     }
 
     if (g_downloading) {
-        finishDownloading(event_queue::EVENT_INFO_FILE_DOWNLOAD_SUCCEEDED);
+        if (!finishDownloading(event_queue::EVENT_INFO_FILE_DOWNLOAD_SUCCEEDED)) {
+            SCPI_ErrorPush(context, SCPI_ERROR_MASS_STORAGE_ERROR);
+            return SCPI_RES_ERR;
+        }
         return SCPI_RES_OK;
     }
 
     g_downloadSize = 0;
+    g_downloadOffset = 0;
     g_aborted = false;
 
     return SCPI_RES_OK;
 }
 
+scpi_result_t scpi_cmd_mmemoryDownloadOffset(scpi_t *context) {
+    uint32_t offset;
+    if (!SCPI_ParamUInt32(context, &offset, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (g_downloading) {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+    }
+
+    g_downloadOffset = offset;
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_mmemoryDownloadOffsetQ(scpi_t *context) {
+    SCPI_ResultUInt32(context, sd_card::getDownloadSyncedOffset());
+    return SCPI_RES_OK;
+}
+
 scpi_result_t scpi_cmd_mmemoryDownloadSize(scpi_t *context) {
     uint32_t size;
     if (!SCPI_ParamUInt32(context, &size, true)) {
@@ -312,10 +343,11 @@ scpi_result_t scpi_cmd_mmemoryDownloadData(scpi_t *context) {
     bool downloading = g_downloading;
     if (!downloading) {
         startDownloading();
+        g_downloaded = g_downloadOffset;
     }
 
     int err;
-    if (!sd_card::download(g_downloadFilePath, !downloading, buffer, size, &err)) {
+    if (!sd_card::download(g_downloadFilePath, !downloading, g_downloadOffset, buffer, size, &err)) {
         finishDownloading(event_queue::EVENT_ERROR_FILE_DOWNLOAD_FAILED);
         if (err != 0) {
             SCPI_ErrorPush(context, err);
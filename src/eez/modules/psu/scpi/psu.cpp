@@ -16,11 +16,13 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <ctype.h>
 #include <stdio.h>
 #ifdef EEZ_PLATFORM_SIMULATOR_UNIX
 #include <bsd/string.h>
 #endif
 
+#include <eez/debug.h>
 #include <eez/sound.h>
 #include <eez/system.h>
 
@@ -44,6 +46,12 @@ SCPI_COMMANDS
 #define SCPI_COMMAND(P, C) { P, C },
 static const scpi_command_t scpi_commands[] = { SCPI_COMMANDS SCPI_CMD_LIST_END };
 
+static const size_t COMMAND_INDEX_MAX_ENTRIES = 1024;
+static uint16_t g_commandIndexEntries[COMMAND_INDEX_MAX_ENTRIES];
+static scpi_command_index_t g_commandIndex;
+static bool g_commandIndexInitialized;
+static bool g_commandIndexValid;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 bool g_messageAvailable = false;
@@ -58,6 +66,18 @@ void init(scpi_t &scpi_context, scpi_psu_t &scpi_psu_context, scpi_interface_t *
               getSerialNumber(), MCU_FIRMWARE, input_buffer, input_buffer_length,
               error_queue_data, error_queue_size);
 
+    // command index is shared by all the contexts, first init is called during boot
+    if (!g_commandIndexInitialized) {
+        g_commandIndexValid = SCPI_CommandIndexInit(&g_commandIndex, scpi_commands, g_commandIndexEntries, COMMAND_INDEX_MAX_ENTRIES);
+        if (!g_commandIndexValid) {
+            DebugTrace("SCPI command index too small, linear command search is used\n");
+        }
+        g_commandIndexInitialized = true;
+    }
+    if (g_commandIndexValid) {
+        SCPI_SetCommandIndex(&scpi_context, &g_commandIndex);
+    }
+
     if (CH_NUM > 0) {
         auto &channel = Channel::get(0);
         scpi_psu_context.selectedChannels.numChannels = 1;
@@ -76,6 +96,84 @@ void init(scpi_t &scpi_context, scpi_psu_t &scpi_psu_context, scpi_interface_t *
     emptyBuffer(scpi_context);
 }
 
+// Shortest header for the pattern, i.e. only mandatory mnemonics in short form,
+// for example "MEASure[:SCALar]:VOLTage[:DC]?" gives "MEAS:VOLT?"
+static void getShortHeader(const char *pattern, char *header, size_t headerSize) {
+    size_t i = 0;
+    int brackets = 0;
+    bool shortForm = true;
+    for (const char *p = pattern; *p && i < headerSize - 1; p++) {
+        if (*p == '[') {
+            brackets++;
+        } else if (*p == ']') {
+            brackets--;
+        } else if (brackets == 0) {
+            if (*p == ':' || *p == '?') {
+                if (*p == '?' || i > 0) {
+                    header[i++] = *p;
+                }
+                shortForm = true;
+            } else if (shortForm && !islower(*p) && *p != '#') {
+                header[i++] = *p;
+            } else {
+                shortForm = false;
+            }
+        }
+    }
+    header[i] = 0;
+}
+
+void benchmarkCommandLookup(char *text, int textLength) {
+    static const int NUM_REPEATS = 10;
+
+    uint32_t linearTime = 0;
+    uint32_t indexTime = 0;
+    int numLookups = 0;
+    int numMismatches = 0;
+
+    for (int i = 0; scpi_commands[i].pattern; i++) {
+        char header[64];
+        getShortHeader(scpi_commands[i].pattern, header, sizeof(header));
+        int headerLength = strlen(header);
+        if (headerLength == 0) {
+            continue;
+        }
+
+        const scpi_command_t *linearCommand = nullptr;
+        const scpi_command_t *indexCommand = nullptr;
+
+        uint32_t startTime = micros();
+        for (int j = 0; j < NUM_REPEATS; j++) {
+            linearCommand = SCPI_FindCommand(scpi_commands, nullptr, header, headerLength);
+        }
+        uint32_t endTime = micros();
+        linearTime += endTime - startTime;
+
+        if (g_commandIndexValid) {
+            startTime = micros();
+            for (int j = 0; j < NUM_REPEATS; j++) {
+                indexCommand = SCPI_FindCommand(scpi_commands, &g_commandIndex, header, headerLength);
+            }
+            endTime = micros();
+            indexTime += endTime - startTime;
+        }
+
+        if (linearCommand != indexCommand) {
+            numMismatches++;
+        }
+
+        numLookups += NUM_REPEATS;
+    }
+
+    snprintf(text, textLength,
+        "lookups: %d\nlinear: %.0f commands/s\nindex: %.0f commands/s\nindex entries: %d\nmismatches: %d\n",
+        numLookups,
+        linearTime > 0 ? numLookups * 1E6 / linearTime : 0.0,
+        indexTime > 0 ? numLookups * 1E6 / indexTime : 0.0,
+        g_commandIndexValid ? (int)g_commandIndex.bucket[SCPI_COMMAND_INDEX_BUCKETS + 1] : 0,
+        g_commandIndexValid ? numMismatches : -1);
+}
+
 void emptyBuffer(scpi_t &context) {
     SCPI_Input(&context, 0, 0);
 }
@@ -166,61 +264,83 @@ OutputBufferWriter::OutputBufferWriter(char *buffer, size_t maxBufferSize, size_
     : m_buffer(buffer)
     , m_maxBufferSize(maxBufferSize)
     , m_writeFunc(writeFunc)
+    , m_bufferSize(0)
+    , m_writingBlock(false)
 {
 }
 
 size_t OutputBufferWriter::write(const char *data, size_t len) {
-	if (len == 0) {
-		return len;
-	}
+    m_writingBlock = false;
 
-    g_messageAvailable = true;
+    size_t written = len;
 
-    const char *restData = nullptr;
-    size_t restLen = 0;
+    while (len > 0) {
+        g_messageAvailable = true;
 
-    if (m_bufferSize > 0 && m_buffer[m_bufferSize - 1] == '\r' && data[0] == '\n') {
-    	restData = data + 1;
-        restLen = len - 1;
-        len = 1;
-    } else {
-        const char *endOfLine = strnstr(data, "\r\n", len);
-        if (endOfLine) {
-            restData = endOfLine + 2;
-            size_t n = restData - data;
-            restLen = len - n;
-            len = n;
+        // copy up to the end of line, which is flushed immediately
+        size_t n = len;
+        if (m_bufferSize > 0 && m_buffer[m_bufferSize - 1] == '\r' && data[0] == '\n') {
+            n = 1;
+        } else {
+            const char *endOfLine = strnstr(data, "\r\n", len);
+            if (endOfLine) {
+                n = endOfLine + 2 - data;
+            }
         }
-    }
 
-    if (m_bufferSize + len < m_maxBufferSize) {
-        memcpy(m_buffer + m_bufferSize, data, len);
-        m_bufferSize += len;
-        len = 0;
-    } else {
-        int n = m_maxBufferSize - m_bufferSize;
+        n = MIN(n, m_maxBufferSize - m_bufferSize);
         memcpy(m_buffer + m_bufferSize, data, n);
         m_bufferSize += n;
         data += n;
         len -= n;
+
+        if ((m_bufferSize >= 2 && m_buffer[m_bufferSize - 2] == '\r' && m_buffer[m_bufferSize - 1] == '\n') || m_bufferSize == m_maxBufferSize) {
+            flushBuffer();
+        }
     }
 
-    if ((m_bufferSize >= 2 && m_buffer[m_bufferSize - 2] == '\r' && m_buffer[m_bufferSize - 1] == '\n') || m_bufferSize == m_maxBufferSize) {
-        flush();
+    return written;
+}
+
+size_t OutputBufferWriter::writeBlock(const char *data, size_t len) {
+    if (len == 0) {
+        return len;
     }
 
-    if (len > 0) {
-        write(data, len);
+    g_messageAvailable = true;
+    m_writingBlock = true;
+
+    size_t written = len;
+
+    if (m_bufferSize > 0) {
+        size_t n = MIN(len, m_maxBufferSize - m_bufferSize);
+        memcpy(m_buffer + m_bufferSize, data, n);
+        m_bufferSize += n;
+        data += n;
+        len -= n;
+
+        if (m_bufferSize == m_maxBufferSize) {
+            flushBuffer();
+        }
     }
 
-    if (restLen > 0) {
-        write(restData, restLen);
+    if (len >= m_maxBufferSize) {
+        // buffer is empty at this point, so write directly from the source
+        m_writeFunc(data, len);
+    } else if (len > 0) {
+        memcpy(m_buffer, data, len);
+        m_bufferSize = len;
     }
 
-    return len;
+    return written;
 }
 
 void OutputBufferWriter::flush() {
+    m_writingBlock = false;
+    flushBuffer();
+}
+
+void OutputBufferWriter::flushBuffer() {
     if (m_bufferSize > 0) {
         m_writeFunc(m_buffer, m_bufferSize);
         m_bufferSize = 0;
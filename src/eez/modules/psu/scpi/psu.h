@@ -46,6 +46,9 @@ void init(scpi_t &scpi_context, scpi_psu_t &scpi_psu_context, scpi_interface_t *
 
 void input(scpi_t &scpi_context, const char *str, size_t size);
 
+// measures command header lookup with and without command index
+void benchmarkCommandLookup(char *text, int textLength);
+
 void emptyBuffer(scpi_t &context);
 void onBufferOverrun(scpi_t &context);
 
@@ -62,11 +65,21 @@ public:
     size_t write(const char *data, size_t len);
     void flush();
 
+    // Arbitrary block data is not scanned for the line endings, buffer is flushed
+    // only when it is full and chunks larger then the buffer bypass the buffer.
+    size_t writeBlock(const char *data, size_t len);
+
+    // true while arbitrary block data is written, i.e. more data will follow
+    bool isWritingBlock() { return m_writingBlock; }
+
 private:
     char *m_buffer;
     size_t m_maxBufferSize;
     size_t (*m_writeFunc)(const char *data, size_t len);
     size_t m_bufferSize;
+    bool m_writingBlock;
+
+    void flushBuffer();
 };
 
 int printError(scpi_t *context, int_fast16_t err, OutputBufferWriter &outputBufferWriter);
@@ -336,6 +336,75 @@ scpi_result_t scpi_cmd_senseVoltageDcApertureQ(scpi_t *context) {
     return SCPI_RES_OK;
 }
 
+static Channel *getAcquisitionChannel(scpi_t *context) {
+    SlotAndSubchannelIndex slotAndSubchannelIndex;
+    if (!getChannelFromParam(context, slotAndSubchannelIndex)) {
+        return nullptr;
+    }
+
+    Channel *channel = Channel::getBySlotIndex(slotAndSubchannelIndex.slotIndex, slotAndSubchannelIndex.subchannelIndex);
+    if (!channel) {
+        SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+        return nullptr;
+    }
+
+    return channel;
+}
+
+scpi_result_t scpi_cmd_senseAcquirePeriod(scpi_t *context) {
+    scpi_number_t param;
+    if (!SCPI_ParamNumber(context, scpi_special_numbers_def, &param, true)) {
+        return SCPI_RES_ERR;
+    }
+
+    float period;
+
+    if (param.special) {
+        if (param.content.tag == SCPI_NUM_MIN) {
+            period = CHANNEL_ACQUISITION_PERIOD_MIN;
+        } else if (param.content.tag == SCPI_NUM_MAX) {
+            period = CHANNEL_ACQUISITION_PERIOD_MAX;
+        } else if (param.content.tag == SCPI_NUM_DEF) {
+            period = CHANNEL_ACQUISITION_PERIOD_DEFAULT;
+        } else {
+            SCPI_ErrorPush(context, SCPI_ERROR_ILLEGAL_PARAMETER_VALUE);
+            return SCPI_RES_ERR;
+        }
+    } else {
+        if (param.unit != SCPI_UNIT_NONE && param.unit != SCPI_UNIT_SECOND) {
+            SCPI_ErrorPush(context, SCPI_ERROR_INVALID_SUFFIX);
+            return SCPI_RES_ERR;
+        }
+
+        period = (float)param.content.value;
+
+        if (period < CHANNEL_ACQUISITION_PERIOD_MIN || period > CHANNEL_ACQUISITION_PERIOD_MAX) {
+            SCPI_ErrorPush(context, SCPI_ERROR_DATA_OUT_OF_RANGE);
+            return SCPI_RES_ERR;
+        }
+    }
+
+    Channel *channel = getAcquisitionChannel(context);
+    if (!channel) {
+        return SCPI_RES_ERR;
+    }
+
+    channel->setAcquisitionPeriod(period);
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_senseAcquirePeriodQ(scpi_t *context) {
+    Channel *channel = getAcquisitionChannel(context);
+    if (!channel) {
+        return SCPI_RES_ERR;
+    }
+
+    SCPI_ResultFloat(context, channel->acquisitionPeriod);
+
+    return SCPI_RES_OK;
+}
+
 } // namespace scpi
 } // namespace psu
 } // namespace eez
@@ -22,9 +22,17 @@
 
 #ifdef EEZ_PLATFORM_SIMULATOR
 
+#include <stdio.h>
+
 #include <eez/modules/psu/channel_dispatcher.h>
 #include <eez/modules/psu/io_pins.h>
 
+#if OPTION_DISPLAY
+#include <eez/modules/mcu/display.h>
+#include <eez/modules/mcu/simulator/display_kernels.h>
+#include <eez/platform/simulator/events.h>
+#endif
+
 // SIMULATOR SPECIFC CONFIG
 #define SIM_LOAD_MIN 0
 #define SIM_LOAD_DEF 1000.0f
@@ -396,6 +404,99 @@ scpi_result_t scpi_cmd_simulatorDigitalDataByte(scpi_t *context) {
 	return SCPI_RES_OK;
 }
 
+scpi_result_t scpi_cmd_simulatorTouch(scpi_t *context) {
+#if OPTION_DISPLAY
+    int32_t x;
+    if (!SCPI_ParamInt(context, &x, TRUE)) {
+        return SCPI_RES_ERR;
+    }
+
+    int32_t y;
+    if (!SCPI_ParamInt(context, &y, TRUE)) {
+        return SCPI_RES_ERR;
+    }
+
+    if (x < 0 || x >= mcu::display::getDisplayWidth() || y < 0 || y >= mcu::display::getDisplayHeight()) {
+        SCPI_ErrorPush(context, SCPI_ERROR_DATA_OUT_OF_RANGE);
+        return SCPI_RES_ERR;
+    }
+
+    bool isPressed;
+    bool queued;
+    if (SCPI_ParamBool(context, &isPressed, FALSE)) {
+        queued = platform::simulator::injectTouchEvent(x, y, isPressed);
+    } else {
+        if (SCPI_ParamErrorOccurred(context)) {
+            return SCPI_RES_ERR;
+        }
+
+        // without the state it is a tap: press and release
+        queued = platform::simulator::injectTouchEvent(x, y, true) &&
+            platform::simulator::injectTouchEvent(x, y, false);
+    }
+
+    if (!queued) {
+        SCPI_ErrorPush(context, SCPI_ERROR_EXECUTION_ERROR);
+        return SCPI_RES_ERR;
+    }
+
+    return SCPI_RES_OK;
+#else
+    SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+    return SCPI_RES_ERR;
+#endif
+}
+
+scpi_result_t scpi_cmd_simulatorTimeVirtual(scpi_t *context) {
+    bool enable;
+    if (!SCPI_ParamBool(context, &enable, TRUE)) {
+        return SCPI_RES_ERR;
+    }
+
+    osKernelSetVirtualTime(enable);
+
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_simulatorTimeVirtualQ(scpi_t *context) {
+    SCPI_ResultBool(context, osKernelIsVirtualTime());
+    return SCPI_RES_OK;
+}
+
+scpi_result_t scpi_cmd_simulatorDisplayBenchmarkQ(scpi_t *context) {
+#if OPTION_DISPLAY
+    static char text[512];
+    mcu::display::kernels::benchmark(text, sizeof(text));
+    SCPI_ResultCharacters(context, text, strlen(text));
+    return SCPI_RES_OK;
+#else
+    SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+    return SCPI_RES_ERR;
+#endif
+}
+
+scpi_result_t scpi_cmd_simulatorDisplayStatisticsQ(scpi_t *context) {
+#if OPTION_DISPLAY
+    mcu::display::FrameStatistics statistics;
+    mcu::display::getFrameStatistics(statistics);
+
+    uint32_t numFrames = statistics.numFrames > 0 ? statistics.numFrames : 1;
+
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+        "frames: %u\nlast frame time: %u us\navg frame time: %u us\nmax frame time: %u us\nlast upload: %u bytes\navg upload: %u bytes\n",
+        (unsigned)statistics.numFrames,
+        (unsigned)statistics.lastFrameTimeUs, (unsigned)(statistics.totalFrameTimeUs / numFrames), (unsigned)statistics.maxFrameTimeUs,
+        (unsigned)statistics.lastUploadBytes, (unsigned)(statistics.totalUploadBytes / numFrames));
+
+    SCPI_ResultCharacters(context, buffer, strlen(buffer));
+    return SCPI_RES_OK;
+#else
+    SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+    return SCPI_RES_ERR;
+#endif
+}
+
 } // namespace scpi
 } // namespace psu
 } // namespace eez
@@ -506,6 +607,31 @@ scpi_result_t scpi_cmd_simulatorDigitalDataByte(scpi_t *context) {
 	return SCPI_RES_ERR;
 }
 
+scpi_result_t scpi_cmd_simulatorTouch(scpi_t *context) {
+    SCPI_ErrorPush(context, SCPI_ERROR_UNDEFINED_HEADER);
+    return SCPI_RES_ERR;
+}
+
+scpi_result_t scpi_cmd_simulatorTimeVirtual(scpi_t *context) {
+    SCPI_ErrorPush(context, SCPI_ERROR_UNDEFINED_HEADER);
+    return SCPI_RES_ERR;
+}
+
+scpi_result_t scpi_cmd_simulatorTimeVirtualQ(scpi_t *context) {
+    SCPI_ErrorPush(context, SCPI_ERROR_UNDEFINED_HEADER);
+    return SCPI_RES_ERR;
+}
+
+scpi_result_t scpi_cmd_simulatorDisplayBenchmarkQ(scpi_t *context) {
+    SCPI_ErrorPush(context, SCPI_ERROR_UNDEFINED_HEADER);
+    return SCPI_RES_ERR;
+}
+
+scpi_result_t scpi_cmd_simulatorDisplayStatisticsQ(scpi_t *context) {
+    SCPI_ErrorPush(context, SCPI_ERROR_UNDEFINED_HEADER);
+    return SCPI_RES_ERR;
+}
+
 } // namespace scpi
 } // namespace psu
 } // namespace eez
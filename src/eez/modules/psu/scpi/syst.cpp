@@ -1282,6 +1282,40 @@ scpi_result_t scpi_cmd_systemCommunicateEthernetSmask(scpi_t *context) {
 #endif
 }
 
+scpi_result_t scpi_cmd_systemCommunicateEthernetSessionsQ(scpi_t *context) {
+#if OPTION_ETHERNET
+    char buffer[128 * ethernet::MAX_NUM_SESSIONS];
+    char *p = buffer;
+
+    uint32_t now = millis();
+
+    for (int sessionIndex = 0; sessionIndex < ethernet::MAX_NUM_SESSIONS; sessionIndex++) {
+        ethernet::SessionStatistics statistics;
+        ethernet::getSessionStatistics(sessionIndex, statistics);
+
+        bool connected = ethernet::isSessionConnected(sessionIndex);
+        uint32_t uptime = connected ? (now - statistics.connectedTime) / 1000 : 0;
+
+        p += sprintf(p, "%d,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+            sessionIndex + 1,
+            connected ? 1 : 0,
+            (unsigned long)uptime,
+            (unsigned long)statistics.numInputs,
+            (unsigned long)statistics.numBytesReceived,
+            (unsigned long)statistics.numBytesSent,
+            (unsigned long)statistics.lastLatency,
+            (unsigned long)statistics.avgLatency,
+            (unsigned long)statistics.maxLatency);
+    }
+
+    SCPI_ResultCharacters(context, buffer, p - buffer);
+    return SCPI_RES_OK;
+#else
+    SCPI_ErrorPush(context, SCPI_ERROR_HARDWARE_MISSING);
+    return SCPI_RES_ERR;
+#endif
+}
+
 scpi_result_t scpi_cmd_systemCommunicateEthernetSmaskQ(scpi_t *context) {
 #if OPTION_ETHERNET
     if (!persist_conf::isEthernetEnabled()) {
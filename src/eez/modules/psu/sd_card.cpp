@@ -26,6 +26,9 @@
 #endif
 
 #include <eez/firmware.h>
+#include <eez/memory.h>
+#include <eez/system.h>
+#include <eez/dlog_file.h>
 #include <eez/usb.h>
 #include <eez/fs_driver.h>
 
@@ -82,9 +85,22 @@ TestResult g_testResult = TEST_FAILED;
 int g_lastError;
 
 static File g_downloadFile;
-static uint32_t g_downloadedFileOffset;
 static char g_downloadFilePath[MAX_PATH_LENGTH + 1];
 
+// Downloaded data is collected in the buffer and written to the file in blocks of
+// SD_CARD_TRANSFER_BLOCK_SIZE, so every write starts at the cluster boundary and
+// FatFS can write whole sectors directly from the buffer.
+static uint8_t * const g_downloadBuffer = SD_CARD_TRANSFER_BUFFER;
+static uint32_t g_downloadBufferPosition;
+static uint32_t g_downloadedFileOffset; // data before this offset is written to the file
+static uint32_t g_syncedFileOffset; // data before this offset is synced
+static uint32_t g_lastSyncTickCount;
+static uint32_t g_downloadStartTime;
+static TransferStatistics g_downloadStatistics;
+
+static uint8_t * const g_uploadBuffer = SD_CARD_TRANSFER_BUFFER + SD_CARD_TRANSFER_BLOCK_SIZE;
+static TransferStatistics g_uploadStatistics;
+
 static uint16_t g_getInfoVersion[1 + NUM_SLOTS];
 
 static uint32_t g_debounceTimeout;
@@ -92,6 +108,7 @@ static uint32_t g_debounceTimeout;
 ////////////////////////////////////////////////////////////////////////////////
 
 static void stateTransition(Event event);
+static bool syncDownloadFile();
 #if defined(EEZ_PLATFORM_STM32)
 static void testTimeoutEvent(uint32_t &timeout, Event timeoutEvent);
 #endif
@@ -124,6 +141,11 @@ void tick() {
     stateTransition(!(usb::isMassStorageActive() && g_selectedMassStorageDevice == 0) && g_sdCardIsPresent ? EVENT_CARD_PRESENT : EVENT_CARD_NOT_PRESENT);
     testTimeoutEvent(g_debounceTimeout, EVENT_DEBOUNCE_TIMEOUT);
 #endif
+
+    // sync downloaded file also when SCPI client stops sending data
+    if (g_downloadFile.isOpen() && g_downloadedFileOffset != g_syncedFileOffset && millis() - g_lastSyncTickCount >= SD_CARD_DOWNLOAD_SYNC_INTERVAL_MS) {
+        syncDownloadFile();
+    }
 }
 
 #if defined(EEZ_PLATFORM_STM32)
@@ -313,15 +335,18 @@ bool upload(const char *filePath, void *param, void (*callback)(void *param, con
 
     *err = SCPI_RES_OK;
 
-    callback(param, NULL, totalSize);
+    memset(&g_uploadStatistics, 0, sizeof(g_uploadStatistics));
+    uint32_t startTime = micros();
 
-    const int CHUNK_SIZE = 512;
-    uint8_t buffer[CHUNK_SIZE];
+    callback(param, NULL, totalSize);
 
     while (true) {
-        int size = file.read(buffer, CHUNK_SIZE);
+        uint32_t readStartTime = micros();
+        int size = file.read(g_uploadBuffer, SD_CARD_TRANSFER_BLOCK_SIZE);
+        g_uploadStatistics.fileTimeUs += micros() - readStartTime;
+        g_uploadStatistics.numBlocks++;
 
-        callback(param, buffer, size);
+        callback(param, g_uploadBuffer, size);
 
         uploaded += size;
 
@@ -337,7 +362,7 @@ bool upload(const char *filePath, void *param, void (*callback)(void *param, con
         }
 #endif
 
-        if (size < CHUNK_SIZE) {
+        if (size < (int)SD_CARD_TRANSFER_BLOCK_SIZE) {
         	if (uploaded < totalSize) {
                 if (err) {
                     *err = SCPI_ERROR_MASS_STORAGE_ERROR;
@@ -352,6 +377,9 @@ bool upload(const char *filePath, void *param, void (*callback)(void *param, con
 
     callback(param, NULL, -1);
 
+    g_uploadStatistics.numBytes = uploaded;
+    g_uploadStatistics.timeUs = micros() - startTime;
+
 #if OPTION_DISPLAY
     psu::gui::hideProgressPage();
 #endif
@@ -359,65 +387,186 @@ bool upload(const char *filePath, void *param, void (*callback)(void *param, con
     return result;
 }
 
-bool download(const char *filePath, bool truncate, const void *buffer, size_t size, int *perr) {
-    if (!sd_card::isMounted(filePath, perr)) {
+static bool syncDownloadFile() {
+    uint32_t startTime = micros();
+    bool result = g_downloadFile.sync();
+    g_downloadStatistics.fileTimeUs += micros() - startTime;
+    if (!result) {
         return false;
     }
+    g_syncedFileOffset = g_downloadedFileOffset;
+    g_lastSyncTickCount = millis();
+    g_downloadStatistics.numSyncs++;
+    return true;
+}
+
+static bool reopenDownloadFile(uint32_t timeout) {
+    while (millis() < timeout) {
+        sd_card::reinitialize();
 
-	if (truncate) {
-	    if (!g_downloadFile.open(filePath, FILE_CREATE_ALWAYS | FILE_WRITE)) {
-			if (perr) {
-				*perr = SCPI_ERROR_FILE_NAME_NOT_FOUND;
+        if (g_downloadFile.open(g_downloadFilePath, FILE_OPEN_EXISTING | FILE_WRITE)) {
+            if (g_downloadFile.seek(g_syncedFileOffset)) {
+                return true;
             }
-			return false;
-		}
-        strcpy(g_downloadFilePath, filePath);
-        g_downloadedFileOffset = 0;
-	}
+        }
+    }
 
-    int err = 0;
+    return false;
+}
 
+static bool writeDownloadBuffer(bool sync) {
     uint32_t timeout = millis() + CONF_DOWNLOAD_TIMEOUT_MS;
-    while (millis() < timeout) {
-        size_t written = g_downloadFile.write((const uint8_t *)buffer, size);
+
+    while (true) {
+        size_t size = g_downloadBufferPosition;
+        uint32_t startTime = micros();
+        size_t written = g_downloadFile.write(g_downloadBuffer, size);
+        g_downloadStatistics.fileTimeUs += micros() - startTime;
         if (written == size) {
-            if (g_downloadFile.sync()) {
-                g_downloadedFileOffset += size;
+            g_downloadedFileOffset += size;
+            if (!sync || syncDownloadFile()) {
+                g_downloadBufferPosition = 0;
+                g_downloadStatistics.numBlocks++;
                 return true;
             }
+            g_downloadedFileOffset -= size;
         }
 
-        sd_card::reinitialize();
+        // Data written after the last sync is lost when SD card is reinitialized,
+        // so download can continue from the last synced offset only if all that
+        // data is still in the buffer. Otherwise download fails, and the client
+        // can continue it from getDownloadSyncedOffset().
+        if (g_downloadedFileOffset != g_syncedFileOffset) {
+            return false;
+        }
 
-        bool ropened = false;
+        g_downloadStatistics.numRetries++;
 
-        while (millis() < timeout) {
-            if (g_downloadFile.open(filePath, FILE_OPEN_EXISTING | FILE_WRITE)) {
-                if (g_downloadFile.seek(g_downloadedFileOffset)) {
-                    ropened = true;
-                    break;
-                }
+        if (!reopenDownloadFile(timeout)) {
+            return false;
+        }
+
+        // sync immediately after reopen so that the next error is also recoverable
+        sync = true;
+    }
+}
+
+static bool openDownloadFile(const char *filePath, uint32_t offset, int *perr) {
+    if (offset == 0) {
+        if (!g_downloadFile.open(filePath, FILE_CREATE_ALWAYS | FILE_WRITE)) {
+            if (perr) {
+                *perr = SCPI_ERROR_FILE_NAME_NOT_FOUND;
             }
+            return false;
+        }
+        return true;
+    }
 
-            sd_card::reinitialize();
+    if (!g_downloadFile.open(filePath, FILE_OPEN_EXISTING | FILE_WRITE)) {
+        if (perr) {
+            *perr = SCPI_ERROR_FILE_NAME_NOT_FOUND;
         }
+        return false;
+    }
 
-        if (!ropened) {
-            break;
+    // data after the offset could be written but not synced before the failure
+    if (offset > g_downloadFile.size()) {
+        g_downloadFile.close();
+        if (perr) {
+            *perr = SCPI_ERROR_DATA_OUT_OF_RANGE;
+        }
+        return false;
+    }
+
+    if (!g_downloadFile.truncate(offset) || !g_downloadFile.seek(offset)) {
+        g_downloadFile.close();
+        if (perr) {
+            *perr = SCPI_ERROR_MASS_STORAGE_ERROR;
         }
+        return false;
     }
 
-    sd_card::reinitialize();
+    return true;
+}
 
-    if (perr) {
-        *perr = err;
+bool download(const char *filePath, bool start, uint32_t offset, const void *buffer, size_t size, int *perr) {
+    if (start) {
+        // forget the previous download, so a failed start doesn't report its offset
+        g_downloadedFileOffset = 0;
+        g_syncedFileOffset = 0;
     }
-    return false;
+
+    if (!sd_card::isMounted(filePath, perr)) {
+        return false;
+    }
+
+	if (start) {
+        event_queue::closeLogFiles();
+        if (!openDownloadFile(filePath, offset, perr)) {
+            return false;
+        }
+        strcpy(g_downloadFilePath, filePath);
+        g_downloadBufferPosition = 0;
+        g_downloadedFileOffset = offset;
+        g_syncedFileOffset = offset;
+        g_lastSyncTickCount = millis();
+        memset(&g_downloadStatistics, 0, sizeof(g_downloadStatistics));
+        g_downloadStartTime = micros();
+	}
+
+    const uint8_t *data = (const uint8_t *)buffer;
+    while (size > 0) {
+        size_t partialSize = MIN(size, SD_CARD_TRANSFER_BLOCK_SIZE - g_downloadBufferPosition);
+        memcpy(g_downloadBuffer + g_downloadBufferPosition, data, partialSize);
+        g_downloadBufferPosition += partialSize;
+        g_downloadStatistics.numBytes += partialSize;
+        data += partialSize;
+        size -= partialSize;
+
+        if (g_downloadBufferPosition == SD_CARD_TRANSFER_BLOCK_SIZE) {
+            if (!writeDownloadBuffer(millis() - g_lastSyncTickCount >= SD_CARD_DOWNLOAD_SYNC_INTERVAL_MS)) {
+                sd_card::reinitialize();
+                if (perr) {
+                    *perr = 0;
+                }
+                return false;
+            }
+        }
+    }
+
+    g_downloadStatistics.timeUs = micros() - g_downloadStartTime;
+
+    return true;
 }
 
-void downloadFinished() {
+bool downloadFinished(bool flush) {
+    bool result = true;
+    if (flush) {
+        result = writeDownloadBuffer(true);
+        g_downloadStatistics.timeUs = micros() - g_downloadStartTime;
+    }
+
     g_downloadFile.close();
+
+    if (!result) {
+        sd_card::reinitialize();
+    }
+
     onSdCardFileChangeHook(g_downloadFilePath);
+
+    return result;
+}
+
+uint32_t getDownloadSyncedOffset() {
+    return g_syncedFileOffset;
+}
+
+void getDownloadStatistics(TransferStatistics &statistics) {
+    statistics = g_downloadStatistics;
+}
+
+void getUploadStatistics(TransferStatistics &statistics) {
+    statistics = g_uploadStatistics;
 }
 
 bool moveFile(const char *sourcePath, const char *destinationPath, int *err) {
@@ -435,12 +584,16 @@ bool moveFile(const char *sourcePath, const char *destinationPath, int *err) {
         return false;
     }
 
+    event_queue::closeLogFiles();
+
     if (!SD.rename(sourcePath, destinationPath)) {
         if (err)
             *err = SCPI_ERROR_MASS_STORAGE_ERROR;
         return false;
     }
 
+    deleteDlogIndexFile(sourcePath);
+
     onSdCardFileChangeHook(sourcePath, destinationPath);
 
     return true;
@@ -458,6 +611,8 @@ bool copyFile(const char *sourcePath, const char *destinationPath, bool showProg
         return false;
     }
 
+    event_queue::closeLogFiles();
+
     File destinationFile;
     if (!destinationFile.open(destinationPath, FILE_CREATE_ALWAYS | FILE_WRITE)) {
         sourceFile.close();
@@ -486,6 +641,8 @@ bool copyFile(const char *sourcePath, const char *destinationPath, bool showProg
 
         totalWritten += written;
 
+        yieldLowPriorityThread();
+
 #if OPTION_DISPLAY
         if (showProgress) {
             if (!psu::gui::updateProgressPage(totalWritten, totalSize)) {
@@ -534,17 +691,33 @@ bool deleteFile(const char *filePath, int *err) {
         return false;
     }
 
+    event_queue::closeLogFiles();
+
     if (!SD.remove(filePath)) {
         if (err)
             *err = SCPI_ERROR_MASS_STORAGE_ERROR;
         return false;
     }
 
+    deleteDlogIndexFile(filePath);
+
     onSdCardFileChangeHook(filePath);
 
     return true;
 }
 
+void deleteDlogIndexFile(const char *filePath) {
+    if (!endsWithNoCase(filePath, ".dlog")) {
+        return;
+    }
+
+    char indexFilePath[MAX_PATH_LENGTH + dlog_file::INDEX_FILE_PATH_EXTRA_LENGTH + 1];
+    dlog_file::getIndexFilePath(filePath, indexFilePath);
+    if (SD.exists(indexFilePath)) {
+        SD.remove(indexFilePath);
+    }
+}
+
 bool makeDir(const char *dirPath, int *err) {
     if (!sd_card::isMounted(dirPath, err)) {
         return false;
@@ -803,7 +976,7 @@ bool match(BufferedFileRead &file, const char *str) {
 }
 
 bool matchUntil(BufferedFileRead &file, char ch, char *result, int count) {
-    char *end = count == -1 ? (char *)0xFFFFFFFF : result + count;
+    char *end = count == -1 ? (char *)UINTPTR_MAX : result + count;
 
     while (true) {
         int next = file.peek();
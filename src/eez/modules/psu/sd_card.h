@@ -57,11 +57,18 @@ bool exists(const char *dirPath, int *err);
 bool catalog(const char *dirPath, void *param, void (*callback)(void *param, const char *name, FileType type, size_t size, bool isHiddenOrSystemFile), int *numFiles, int *err);
 bool catalogLength(const char *dirPath, size_t *length, int *err);
 bool upload(const char *filePath, void *param, void (*callback)(void *param, const void *buffer, int size), int *err);
-bool download(const char *filePath, bool truncate, const void *buffer, size_t size, int *err);
-void downloadFinished();
+// If start is true, file is created, or if offset is not 0, existing file is truncated
+// to the offset and download continues from there.
+bool download(const char *filePath, bool start, uint32_t offset, const void *buffer, size_t size, int *err);
+// writes the rest of the buffered data if flush is true, returns false if that failed
+bool downloadFinished(bool flush);
+// Size of the data of the current or the last download that is synced to the file,
+// if download failed it can be continued from this offset.
+uint32_t getDownloadSyncedOffset();
 bool moveFile(const char *sourcePath, const char *destinationPath, int *err);
 bool copyFile(const char *sourcePath, const char *destinationPath, bool showProgress, int *err);
 bool deleteFile(const char *filePath, int *err);
+void deleteDlogIndexFile(const char *filePath);
 bool makeDir(const char *dirPath, int *err);
 bool removeDir(const char *dirPath, int *err);
 bool getDate(const char *filePath, uint8_t &year, uint8_t &month, uint8_t &day, int *err);
@@ -70,6 +77,21 @@ bool getTime(const char *filePath, uint8_t &hour, uint8_t &minute, uint8_t &seco
 uint16_t getInfoVersion(int diskDriveIndex);
 bool getInfo(int diskDriveIndex, uint64_t &usedSpace, uint64_t &freeSpace, bool fromCache);
 
+// Statistics of the last MMEM:DOWNload and MMEM:UPLoad? transfer. Time is measured
+// from the first to the last data block, so it includes the time spent in SCPI transport,
+// file time is the time spent only in file reads, writes and syncs.
+struct TransferStatistics {
+    uint32_t numBytes;
+    uint32_t timeUs;
+    uint32_t fileTimeUs;
+    uint32_t numBlocks; // number of file reads or writes
+    uint32_t numSyncs;
+    uint32_t numRetries;
+};
+
+void getDownloadStatistics(TransferStatistics &statistics);
+void getUploadStatistics(TransferStatistics &statistics);
+
 ////////////////////////////////////////////////////////////////////////////////
 
 class BufferedFileRead {
@@ -0,0 +1,243 @@
+/*
+ * EEZ Modular Firmware
+ * Copyright (C) 2015-present, Envox d.o.o.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+
+#if defined(EEZ_PLATFORM_STM32)
+#include <main.h>
+#endif
+
+#if defined(EEZ_PLATFORM_SIMULATOR)
+#include <chrono>
+#endif
+
+#include <eez/modules/psu/tick_profiler.h>
+
+namespace eez {
+namespace psu {
+namespace tick_profiler {
+
+static const char *g_stageNames[NUM_STAGES] = {
+    "slot 1",
+    "slot 2",
+    "slot 3",
+    "trigger",
+    "list",
+    "ramp",
+    "channels",
+    "dlog record",
+    "io pins",
+    "temperature",
+    "fan",
+    "datetime",
+    "touch",
+    "total"
+};
+
+const char *getStageName(Stage stage) {
+    return g_stageNames[stage];
+}
+
+#if CONF_TICK_PROFILER
+
+// Histogram has 4 buckets per power of 2, durations longer than 2^24 timer ticks
+// are all in the last bucket.
+static const int NUM_SUB_BUCKETS_BITS = 2;
+static const int NUM_BUCKETS = 24 << NUM_SUB_BUCKETS_BITS;
+
+struct StageData {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+    uint32_t numOverruns;
+    uint32_t histogram[NUM_BUCKETS];
+};
+
+static StageData g_stages[NUM_STAGES];
+
+static uint32_t g_tickStart;
+static uint32_t g_stageStart;
+static uint32_t g_stageDurations[NUM_STAGES];
+
+static volatile bool g_resetRequested;
+
+#if defined(EEZ_PLATFORM_STM32)
+static bool g_cycleCounterEnabled;
+#endif
+
+static inline uint32_t getTimerTicks() {
+#if defined(EEZ_PLATFORM_STM32)
+    return DWT->CYCCNT;
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+static uint32_t timerTicksToNs(uint32_t ticks) {
+#if defined(EEZ_PLATFORM_STM32)
+    return (uint32_t)((uint64_t)ticks * 1000 / (SystemCoreClock / 1000000));
+#else
+    return ticks;
+#endif
+}
+
+static uint32_t getTickBudget() {
+#if defined(EEZ_PLATFORM_STM32)
+    return TICK_BUDGET_US * (SystemCoreClock / 1000000);
+#else
+    return TICK_BUDGET_US * 1000;
+#endif
+}
+
+static int getBucketIndex(uint32_t duration) {
+    if (duration < (1 << NUM_SUB_BUCKETS_BITS)) {
+        return duration;
+    }
+
+    int msb = 0;
+    while ((duration >> msb) > 1) {
+        msb++;
+    }
+
+    int index = (msb << NUM_SUB_BUCKETS_BITS) + ((duration >> (msb - NUM_SUB_BUCKETS_BITS)) & ((1 << NUM_SUB_BUCKETS_BITS) - 1));
+    return index < NUM_BUCKETS ? index : NUM_BUCKETS - 1;
+}
+
+static uint32_t getBucketUpperBound(int index) {
+    int msb = index >> NUM_SUB_BUCKETS_BITS;
+    if (msb < NUM_SUB_BUCKETS_BITS) {
+        return index;
+    }
+    int shift = msb - NUM_SUB_BUCKETS_BITS;
+    uint32_t subBucket = index & ((1 << NUM_SUB_BUCKETS_BITS) - 1);
+    return ((((1 << NUM_SUB_BUCKETS_BITS) + subBucket) << shift) + (1 << shift)) - 1;
+}
+
+static void addDuration(Stage stage, uint32_t duration) {
+    StageData &data = g_stages[stage];
+    if (data.count == 0 || duration < data.min) {
+        data.min = duration;
+    }
+    if (duration > data.max) {
+        data.max = duration;
+    }
+    data.count++;
+    data.sum += duration;
+    data.histogram[getBucketIndex(duration)]++;
+}
+
+void beginTick() {
+#if defined(EEZ_PLATFORM_STM32)
+    if (!g_cycleCounterEnabled) {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->LAR = 0xC5ACCE55;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+        g_cycleCounterEnabled = true;
+    }
+#endif
+
+    if (g_resetRequested) {
+        memset(g_stages, 0, sizeof(g_stages));
+        g_resetRequested = false;
+    }
+
+    memset(g_stageDurations, 0, sizeof(g_stageDurations));
+
+    g_tickStart = getTimerTicks();
+    g_stageStart = g_tickStart;
+}
+
+void endStage(Stage stage) {
+    uint32_t now = getTimerTicks();
+    uint32_t duration = now - g_stageStart;
+    g_stageStart = now;
+
+    g_stageDurations[stage] = duration;
+    addDuration(stage, duration);
+}
+
+void endTick() {
+    uint32_t duration = getTimerTicks() - g_tickStart;
+    addDuration(STAGE_TOTAL, duration);
+
+    if (duration > getTickBudget()) {
+        g_stages[STAGE_TOTAL].numOverruns++;
+
+        // blame the longest stage
+        int longestStage = 0;
+        for (int i = 1; i < STAGE_TOTAL; i++) {
+            if (g_stageDurations[i] > g_stageDurations[longestStage]) {
+                longestStage = i;
+            }
+        }
+        g_stages[longestStage].numOverruns++;
+    }
+}
+
+void getStageStatistics(Stage stage, StageStatistics &statistics) {
+    const StageData &data = g_stages[stage];
+
+    statistics.count = data.count;
+    statistics.numOverruns = data.numOverruns;
+
+    if (data.count == 0) {
+        statistics.minNs = 0;
+        statistics.avgNs = 0;
+        statistics.maxNs = 0;
+        statistics.p99Ns = 0;
+        return;
+    }
+
+    statistics.minNs = timerTicksToNs(data.min);
+    statistics.avgNs = timerTicksToNs((uint32_t)(data.sum / data.count));
+    statistics.maxNs = timerTicksToNs(data.max);
+
+    uint32_t p99 = data.max;
+    uint32_t target = data.count - data.count / 100;
+    uint32_t count = 0;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        count += data.histogram[i];
+        if (count >= target) {
+            if (getBucketUpperBound(i) < p99) {
+                p99 = getBucketUpperBound(i);
+            }
+            break;
+        }
+    }
+    statistics.p99Ns = timerTicksToNs(p99);
+}
+
+void reset() {
+    g_resetRequested = true;
+}
+
+#else
+
+void getStageStatistics(Stage stage, StageStatistics &statistics) {
+    memset(&statistics, 0, sizeof(statistics));
+}
+
+void reset() {
+}
+
+#endif
+
+} // namespace tick_profiler
+} // namespace psu
+} // namespace eez
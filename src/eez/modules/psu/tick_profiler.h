@@ -0,0 +1,89 @@
+/*
+ * EEZ Modular Firmware
+ * Copyright (C) 2015-present, Envox d.o.o.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include <eez/modules/psu/conf_advanced.h>
+
+namespace eez {
+namespace psu {
+namespace tick_profiler {
+
+// Measures every stage of psu::tick. Each stage is measured from the end of
+// the previous stage, so only one timer read is needed per stage. DWT cycle
+// counter is used on STM32 and std::chrono on the simulator.
+
+enum Stage {
+    STAGE_SLOT1,
+    STAGE_SLOT2,
+    STAGE_SLOT3,
+    STAGE_TRIGGER,
+    STAGE_LIST,
+    STAGE_RAMP,
+    STAGE_CHANNELS,
+    STAGE_DLOG_RECORD,
+    STAGE_IO_PINS,
+    STAGE_TEMPERATURE,
+    STAGE_FAN,
+    STAGE_DATETIME,
+    STAGE_TOUCH,
+    STAGE_TOTAL,
+    NUM_STAGES
+};
+
+/// psu::tick is called every 1 ms, longer tick is counted as overrun
+static const uint32_t TICK_BUDGET_US = 1000;
+
+struct StageStatistics {
+    uint32_t count;
+    uint32_t minNs;
+    uint32_t avgNs;
+    uint32_t maxNs;
+    uint32_t p99Ns; // upper bound of the histogram bucket, at most 25% above the real value
+    uint32_t numOverruns; // for STAGE_TOTAL all the overruns, otherwise overruns in which this was the longest stage
+};
+
+#if CONF_TICK_PROFILER
+
+void beginTick();
+void endStage(Stage stage);
+void endTick();
+
+#endif
+
+const char *getStageName(Stage stage);
+void getStageStatistics(Stage stage, StageStatistics &statistics);
+
+// statistics are reset from the PSU thread, on the next tick
+void reset();
+
+} // namespace tick_profiler
+} // namespace psu
+} // namespace eez
+
+#if CONF_TICK_PROFILER
+#define TICK_PROFILER_BEGIN() eez::psu::tick_profiler::beginTick()
+#define TICK_PROFILER_END_STAGE(stage) eez::psu::tick_profiler::endStage((eez::psu::tick_profiler::Stage)(eez::psu::tick_profiler::stage))
+#define TICK_PROFILER_END() eez::psu::tick_profiler::endTick()
+#else
+#define TICK_PROFILER_BEGIN() (void)0
+#define TICK_PROFILER_END_STAGE(stage) (void)0
+#define TICK_PROFILER_END() (void)0
+#endif
@@ -19,6 +19,7 @@
 #include <eez/mouse.h>
 #include <eez/keyboard.h>
 #include <eez/system.h>
+#include <eez/util.h>
 #include <eez/gui/gui.h>
 #include <eez/modules/mcu/display.h>
 
@@ -124,6 +125,25 @@ bool isDisplayDirty() {
     return false;
 }
 
+// Mouse cursor is blended over the display content, so the area below it
+// must be composed again from the buffers every time the cursor is drawn.
+bool getCursorRect(int &x1, int &y1, int &x2, int &y2) {
+    using namespace gui;
+
+    if (!g_lastMouseCursorVisible || g_lastMouseCursorX >= getDisplayWidth() || g_lastMouseCursorY >= getDisplayHeight()) {
+        return false;
+    }
+
+    auto bitmap = getBitmap(BITMAP_ID_MOUSE_CURSOR);
+
+    x1 = g_lastMouseCursorX;
+    y1 = g_lastMouseCursorY;
+    x2 = MIN(g_lastMouseCursorX + (int)bitmap->w, getDisplayWidth()) - 1;
+    y2 = MIN(g_lastMouseCursorY + (int)bitmap->h, getDisplayHeight()) - 1;
+
+    return true;
+}
+
 void updateDisplay() {
     using namespace gui;
 
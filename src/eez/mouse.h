@@ -31,6 +31,7 @@ void init();
 void getEvent(bool &mouseCursorVisible, gui::EventType &mouseEventType, int &mouseX, int &mouseY);
 
 bool isDisplayDirty();
+bool getCursorRect(int &x1, int &y1, int &x2, int &y2);
 void updateDisplay();
 
 void onPageChanged();
@@ -92,6 +92,9 @@ static const char *PUB_TOPIC_DCPSUPPLY_I_MON = "%s/dcpsupply/ch/%d/imon";
 static const char *PUB_TOPIC_DCPSUPPLY_TEMP = "%s/dcpsupply/ch/%d/temp";
 static const char *PUB_TOPIC_DCPSUPPLY_TOTAL_ONTIME = "%s/dcpsupply/ch/%d/total_ontime";
 static const char *PUB_TOPIC_DCPSUPPLY_LAST_ONTIME = "%s/dcpsupply/ch/%d/last_ontime";
+#if MQTT_CHANNEL_STATE_JSON
+static const char *PUB_TOPIC_DCPSUPPLY_STATE = "%s/dcpsupply/ch/%d/state";
+#endif
 
 static const size_t MAX_SUB_TOPIC_LENGTH = 85;
 
@@ -130,31 +133,77 @@ struct {
     bool full;
 } g_eventQueue;
 
-static struct {
-    bool modelPublished;
-
-    int oe;
+struct PublishedValue {
+    float value;
+    bool isPublished;
 
-    float uSet;
-    uint32_t uSetTick;
+    bool isChanged(float newValue, float deadband) {
+        if (!isPublished) {
+            return true;
+        }
+        if (isNaN(newValue) || isNaN(value)) {
+            return isNaN(newValue) != isNaN(value);
+        }
+        return fabsf(newValue - value) > deadband;
+    }
 
-    float iSet;
-    uint32_t iSetTick;
+    void set(float newValue) {
+        value = newValue;
+        isPublished = true;
+    }
+};
 
-    uint32_t uMonTick;
+static struct {
+    bool modelPublished;
 
-    uint32_t iMonTick;
+    int oe;
 
-    float temperature;
-    uint32_t temperatureTick;
+    PublishedValue uSet;
+    PublishedValue iSet;
+    PublishedValue uMon;
+    PublishedValue iMon;
+    PublishedValue temperature;
 
     uint32_t totalOnTime;
     uint32_t lastOnTime;
 } g_channelStates[CH_MAX];
 
+// All the channel values are checked once per period, changed values are
+// published in as many ticks as needed by the publish budget.
+enum ChannelValue {
+    CHANNEL_VALUE_MODEL,
+#if MQTT_CHANNEL_STATE_JSON
+    CHANNEL_VALUE_STATE,
+#else
+    CHANNEL_VALUE_OE,
+    CHANNEL_VALUE_U_MON,
+    CHANNEL_VALUE_I_MON,
+    CHANNEL_VALUE_U_SET,
+    CHANNEL_VALUE_I_SET,
+    CHANNEL_VALUE_TEMPERATURE,
+#endif
+    CHANNEL_VALUE_TOTAL_ONTIME,
+    CHANNEL_VALUE_LAST_ONTIME,
+    NUM_CHANNEL_VALUES
+};
+
+static bool g_channelsScanInProgress;
+static uint32_t g_channelsScanTick;
 static uint8_t g_lastChannelIndex = 0;
 static uint8_t g_lastValueIndex = 0;
-static bool g_publishing;
+
+static uint32_t g_numPublishesThisTick;
+
+#if defined(EEZ_PLATFORM_STM32)
+// QoS 0 publish request is finished as soon as lwIP sends it,
+// two requests are left for the subscribes
+static const uint32_t MAX_PUBLISHES_IN_FLIGHT = MQTT_REQ_MAX_IN_FLIGHT - 2;
+static volatile uint32_t g_numPublishesInFlight;
+#endif
+
+static PublishStatistics g_statistics;
+static uint32_t g_statisticsSecondTick;
+static uint32_t g_statisticsSecondNumPublished;
 
 enum {
     EEZ_MQTT_ERROR_NONE,
@@ -341,7 +390,12 @@ static void connectCallback(mqtt_client_t *client, void *arg, mqtt_connection_st
 }
 
 static void requestCallback(void *arg, err_t err) {
-	g_publishing = false;
+}
+
+static void publishCallback(void *arg, err_t err) {
+    if (g_numPublishesInFlight > 0) {
+        g_numPublishesInFlight--;
+    }
 }
 
 void incomingPublishCallback(void *arg, const char *topic, u32_t tot_len) {
@@ -387,15 +441,36 @@ void incomingPublishCallback(void** unused, struct mqtt_response_publish *publis
 }
 #endif
 
+static bool canPublish() {
+    if (g_numPublishesThisTick >= MQTT_MAX_PUBLISHES_PER_TICK) {
+        return false;
+    }
+
+#if defined(EEZ_PLATFORM_STM32)
+    if (g_numPublishesInFlight >= MAX_PUBLISHES_IN_FLIGHT) {
+        return false;
+    }
+#endif
+
+    return true;
+}
+
 bool publish(char *topic, char *payload, bool retain) {
+    if (!canPublish()) {
+        return false;
+    }
+
 #if defined(EEZ_PLATFORM_STM32)
-	g_publishing = true;
     LOCK_TCPIP_CORE();
-    err_t result = mqtt_publish(&g_client, topic, payload, strlen(payload), 0, retain ? 1 : 0, requestCallback, nullptr);
+    err_t result = mqtt_publish(&g_client, topic, payload, strlen(payload), 0, retain ? 1 : 0, publishCallback, nullptr);
+    if (result == ERR_OK) {
+        g_numPublishesInFlight++;
+    }
     UNLOCK_TCPIP_CORE();
     if (result != ERR_OK) {
-    	g_publishing = false;
+        // ERR_MEM: no free request or no room in the output buffer, try again later
         if (result != ERR_MEM) {
+            g_statistics.numFailed++;
             if (g_lastError != EEZ_MQTT_ERROR_PUBLISH) {
                 g_lastError = EEZ_MQTT_ERROR_PUBLISH;
                 DebugTrace("mqtt publish error: %d\n", (int)result);
@@ -407,11 +482,16 @@ bool publish(char *topic, char *payload, bool retain) {
         }
         return false;
     }
+
+    if (g_numPublishesInFlight > g_statistics.maxPublishesInFlight) {
+        g_statistics.maxPublishesInFlight = g_numPublishesInFlight;
+    }
 #endif
 
 #if defined(EEZ_PLATFORM_SIMULATOR)
     mqtt_publish(&g_client, topic, payload, strlen(payload), MQTT_PUBLISH_QOS_0 | (retain ? MQTT_PUBLISH_RETAIN : 0));
     if (g_client.error != MQTT_OK) {
+        g_statistics.numFailed++;
         if (g_lastError != EEZ_MQTT_ERROR_PUBLISH) {
             g_lastError = EEZ_MQTT_ERROR_PUBLISH;
             DebugTrace("mqtt publish error: %s\n", mqtt_error_str(g_client.error));
@@ -420,7 +500,10 @@ bool publish(char *topic, char *payload, bool retain) {
         return false;
     }
 #endif
-    
+
+    g_numPublishesThisTick++;
+    g_statistics.numPublished++;
+
     return true;
 }
 
@@ -569,245 +652,353 @@ void setState(ConnectionState connectionState) {
         for(int i = 0; i < CH_NUM; i++) {
             g_channelStates[i].modelPublished = false;
             g_channelStates[i].oe = -1;
-            g_channelStates[i].uSet = NAN;
-            g_channelStates[i].iSet = NAN;
-            g_channelStates[i].temperature = NAN;
+            g_channelStates[i].uSet.isPublished = false;
+            g_channelStates[i].iSet.isPublished = false;
+            g_channelStates[i].uMon.isPublished = false;
+            g_channelStates[i].iMon.isPublished = false;
+            g_channelStates[i].temperature.isPublished = false;
             g_channelStates[i].totalOnTime = 0xFFFFFFFF;
             g_channelStates[i].lastOnTime = 0xFFFFFFFF;
         }
 
+        // publish all the channel values right away
+        g_channelsScanInProgress = true;
+        g_channelsScanTick = millis();
         g_lastChannelIndex = 0;
         g_lastValueIndex = 0;
+
+#if defined(EEZ_PLATFORM_STM32)
+        // requests of the previous connection are gone
+        g_numPublishesInFlight = 0;
+#endif
     }
 
     g_connectionState = connectionState;
     g_connectionStateChangedTickCount = millis();
 }
 
-void tick() {
-    uint32_t tickCount = millis();
+static void publishSystemValues(uint32_t tickCount, uint32_t period) {
+    // publish power state
+    int powState = isPowerUp() ? 1 : 0;
+    if (powState != g_powState) {
+        if (publish(PUB_TOPIC_SYSTEM_POW, powState, true)) {
+            g_powState = powState;
+        }
+    }
 
-    if (ethernet::g_testResult != TEST_OK) {
-        if (g_connectionState != CONNECTION_STATE_IDLE && g_connectionState != CONNECTION_STATE_ETHERNET_NOT_READY) {
-			setState(CONNECTION_STATE_ETHERNET_NOT_CONNECTED);
-			return;
+    // publish events from event view
+    int16_t eventId;
+    while (canPublish() && peekEvent(eventId)) {
+        if (!publishEvent(eventId, true)) {
+            break;
         }
+        getEvent(eventId);
     }
 
-    else if (g_connectionState == CONNECTION_STATE_CONNECTED && !g_publishing) {
-        if (!persist_conf::devConf.mqttEnabled) {
-            setState(CONNECTION_STATE_DISCONNECT);
-            return;
+    // publish battery
+    if (mcu::battery::g_battery != g_battery && canPublish()) {
+        if (publish(PUB_TOPIC_SYSTEM_BATTERY, mcu::battery::g_battery, true)) {
+            g_battery = mcu::battery::g_battery;
         }
+    }
 
-#if defined(EEZ_PLATFORM_STM32)
-        if (!mqtt_client_is_connected(&g_client)) {
-            setState(CONNECTION_STATE_RECONNECT);
-            return;
+    // publish aux temperature
+    if ((tickCount - g_auxTemperatureTick) >= period && canPublish()) {
+        float temperature;
+        temperature::TempSensorTemperature &tempSensor = temperature::sensors[temp_sensor::AUX];
+        if (tempSensor.isInstalled() && tempSensor.isTestOK()) {
+            temperature = tempSensor.temperature;
+        } else {
+            temperature = NAN;
+        }
+        if (temperature != g_auxTemperature) {
+            if (publish(PUB_TOPIC_SYSTEM_AUXTEMP, temperature, true)) {
+                g_auxTemperature = temperature;
+                g_auxTemperatureTick = tickCount;
+            }
         }
+    }
+
+#if OPTION_FAN
+    // publish fan status
+    if ((tickCount - g_fanStatusTick) >= period && canPublish()) {
+        TestResult fanTestResult = aux_ps::fan::g_testResult;
+        int fanRpm = aux_ps::fan::g_rpm;
+
+        if (fanTestResult != g_fanTestResult || fanRpm != g_fanRpm) {
+            if (publishFanStatus(PUB_TOPIC_SYSTEM_FAN_STATUS, fanTestResult, fanRpm, true)) {
+                g_fanTestResult = fanTestResult;
+                g_fanRpm = fanRpm;
+                g_fanStatusTick = tickCount;
+            }
+        }
+    }
 #endif
 
-        uint32_t period = (uint32_t)roundf(persist_conf::devConf.mqttPeriod * 1000);
+    // publish total on-time counter
+    uint32_t totalOnTime = ontime::g_mcuCounter.getTotalTime();
+    if (totalOnTime != g_totalOnTime && canPublish()) {
+        if (publishOnTimeCounter(PUB_TOPIC_SYSTEM_TOTAL_ONTIME, totalOnTime, true)) {
+            g_totalOnTime = totalOnTime;
+        }
+    }
 
-        // publish power state
-        int powState = isPowerUp() ? 1 : 0;
-        if (powState != g_powState) {
-            if (publish(PUB_TOPIC_SYSTEM_POW, powState, true)) {
-                g_powState = powState;
-                if (g_publishing) {
-                    return;
-                }
-            }
+    // publish last on-time counter
+    uint32_t lastOnTime = ontime::g_mcuCounter.getLastTime();
+    if (lastOnTime != g_lastOnTime && canPublish()) {
+        if (publishOnTimeCounter(PUB_TOPIC_SYSTEM_LAST_ONTIME, lastOnTime, true)) {
+            g_lastOnTime = lastOnTime;
         }
+    }
+}
 
-        // publish events from event view
-        int16_t eventId;
-        if (peekEvent(eventId)) {
-            if (publishEvent(eventId, true)) {
-                getEvent(eventId);
-                if (g_publishing) {
-                    return;
-                }
+static float getChannelTemperature(int channelIndex) {
+    temperature::TempSensorTemperature &tempSensor = temperature::sensors[temp_sensor::CH1 + channelIndex];
+    if (tempSensor.isInstalled() && tempSensor.isTestOK()) {
+        return tempSensor.temperature;
+    }
+    return NAN;
+}
+
+#if MQTT_CHANNEL_STATE_JSON
+static void jsonNumberToString(char *text, size_t count, float value) {
+    if (isNaN(value)) {
+        strcpy(text, "null");
+    } else {
+        snprintf(text, count, "%g", value);
+    }
+}
+#endif
+
+static void onChannelValuePublished(uint32_t tickCount) {
+    // how long the changed value waited for the publish budget
+    uint32_t staleness = tickCount - g_channelsScanTick;
+    g_statistics.lastStaleness = staleness;
+    if (staleness > g_statistics.maxStaleness) {
+        g_statistics.maxStaleness = staleness;
+    }
+    g_statistics.totalStaleness += staleness;
+    g_statistics.numStalenessSamples++;
+}
+
+// returns false if value is changed, but it couldn't be published
+static bool publishChannelValue(int channelIndex, ChannelValue value, uint32_t tickCount) {
+    Channel &channel = Channel::get(channelIndex);
+    auto &channelState = g_channelStates[channelIndex];
+
+    if (value == CHANNEL_VALUE_MODEL) {
+        if (!channelState.modelPublished) {
+            char moduleInfo[50];
+            auto &slot = *g_slots[channel.slotIndex];
+            sprintf(moduleInfo, "%s_R%dB%d", slot.moduleName, (int)(slot.moduleRevision >> 8), (int)(slot.moduleRevision & 0xFF));
+            if (!publish(channelIndex, PUB_TOPIC_DCPSUPPLY_MODEL, moduleInfo, true)) {
+                return false;
             }
+            channelState.modelPublished = true;
         }
+    }
+#if MQTT_CHANNEL_STATE_JSON
+    else if (value == CHANNEL_VALUE_STATE) {
+        int oe = channel.isOutputEnabled() ? 1 : 0;
+        float uSet = channel_dispatcher::getUSet(channel);
+        float iSet = channel_dispatcher::getISet(channel);
+        float uMon = channel_dispatcher::getUMonLast(channel);
+        float iMon = channel_dispatcher::getIMonLast(channel);
+        float temperature = getChannelTemperature(channelIndex);
+
+        if (oe != channelState.oe ||
+            channelState.uSet.isChanged(uSet, MQTT_DEADBAND_U_SET) ||
+            channelState.iSet.isChanged(iSet, MQTT_DEADBAND_I_SET) ||
+            channelState.uMon.isChanged(uMon, MQTT_DEADBAND_U_MON) ||
+            channelState.iMon.isChanged(iMon, MQTT_DEADBAND_I_MON) ||
+            channelState.temperature.isChanged(temperature, MQTT_DEADBAND_TEMPERATURE)
+        ) {
+            if (!canPublish()) {
+                return false;
+            }
 
-        // publish battery
-        if (mcu::battery::g_battery != g_battery) {
-            if (publish(PUB_TOPIC_SYSTEM_BATTERY, mcu::battery::g_battery, true)) {
-                g_battery = mcu::battery::g_battery;
-                if (g_publishing) {
-                    return;
-                }
+            char numbers[5][16];
+            jsonNumberToString(numbers[0], sizeof(numbers[0]), uSet);
+            jsonNumberToString(numbers[1], sizeof(numbers[1]), iSet);
+            jsonNumberToString(numbers[2], sizeof(numbers[2]), uMon);
+            jsonNumberToString(numbers[3], sizeof(numbers[3]), iMon);
+            jsonNumberToString(numbers[4], sizeof(numbers[4]), temperature);
+
+            char payload[160];
+            snprintf(payload, sizeof(payload), "{\"oe\":%d,\"uset\":%s,\"iset\":%s,\"umon\":%s,\"imon\":%s,\"temp\":%s}",
+                oe, numbers[0], numbers[1], numbers[2], numbers[3], numbers[4]);
+
+            if (!publish(channelIndex, PUB_TOPIC_DCPSUPPLY_STATE, payload, true)) {
+                return false;
             }
-        }
 
-        // publish aux temperature
-        if ((tickCount - g_auxTemperatureTick) >= period) {
-            float temperature;
-            temperature::TempSensorTemperature &tempSensor = temperature::sensors[temp_sensor::AUX];
-            if (tempSensor.isInstalled() && tempSensor.isTestOK()) {
-                temperature = tempSensor.temperature;
-            } else {
-                temperature = NAN;
+            channelState.oe = oe;
+            channelState.uSet.set(uSet);
+            channelState.iSet.set(iSet);
+            channelState.uMon.set(uMon);
+            channelState.iMon.set(iMon);
+            channelState.temperature.set(temperature);
+
+            onChannelValuePublished(tickCount);
+        }
+    }
+#else
+    else if (value == CHANNEL_VALUE_OE) {
+        int oe = channel.isOutputEnabled() ? 1 : 0;
+        if (oe != channelState.oe) {
+            if (!publish(channelIndex, PUB_TOPIC_DCPSUPPLY_OE, oe, true)) {
+                return false;
             }
-            if (temperature != g_auxTemperature) {
-                if (publish(PUB_TOPIC_SYSTEM_AUXTEMP, temperature, true)) {
-                    g_auxTemperature = temperature;
-                    g_auxTemperatureTick = tickCount;
-                    if (g_publishing) {
-                        return;
-                    }
+            channelState.oe = oe;
+            onChannelValuePublished(tickCount);
+        }
+    } else if (value == CHANNEL_VALUE_U_MON) {
+        if (channel.isOutputEnabled()) {
+            float uMon = channel_dispatcher::getUMonLast(channel);
+            if (channelState.uMon.isChanged(uMon, MQTT_DEADBAND_U_MON)) {
+                if (!publish(channelIndex, PUB_TOPIC_DCPSUPPLY_U_MON, uMon, true)) {
+                    return false;
                 }
+                channelState.uMon.set(uMon);
+                onChannelValuePublished(tickCount);
             }
         }
-
-#if OPTION_FAN
-        // publish fan status
-        if ((tickCount - g_fanStatusTick) >= period) {
-            TestResult fanTestResult = aux_ps::fan::g_testResult;
-            int fanRpm = aux_ps::fan::g_rpm;
-
-            if (fanTestResult != g_fanTestResult || fanRpm != g_fanRpm) {
-                if (publishFanStatus(PUB_TOPIC_SYSTEM_FAN_STATUS, fanTestResult, fanRpm, true)) {
-                    g_fanTestResult = fanTestResult;
-                    g_fanRpm = fanRpm;
-                    g_fanStatusTick = tickCount;
-                    if (g_publishing) {
-                        return;
-                    }
+    } else if (value == CHANNEL_VALUE_I_MON) {
+        if (channel.isOutputEnabled()) {
+            float iMon = channel_dispatcher::getIMonLast(channel);
+            if (channelState.iMon.isChanged(iMon, MQTT_DEADBAND_I_MON)) {
+                if (!publish(channelIndex, PUB_TOPIC_DCPSUPPLY_I_MON, iMon, true)) {
+                    return false;
                 }
+                channelState.iMon.set(iMon);
+                onChannelValuePublished(tickCount);
+            }
+        }
+    } else if (value == CHANNEL_VALUE_U_SET) {
+        float uSet = channel_dispatcher::getUSet(channel);
+        if (channelState.uSet.isChanged(uSet, MQTT_DEADBAND_U_SET)) {
+            if (!publish(channelIndex, PUB_TOPIC_DCPSUPPLY_U_SET, uSet, true)) {
+                return false;
             }
+            channelState.uSet.set(uSet);
+            onChannelValuePublished(tickCount);
         }
+    } else if (value == CHANNEL_VALUE_I_SET) {
+        float iSet = channel_dispatcher::getISet(channel);
+        if (channelState.iSet.isChanged(iSet, MQTT_DEADBAND_I_SET)) {
+            if (!publish(channelIndex, PUB_TOPIC_DCPSUPPLY_I_SET, iSet, true)) {
+                return false;
+            }
+            channelState.iSet.set(iSet);
+            onChannelValuePublished(tickCount);
+        }
+    } else if (value == CHANNEL_VALUE_TEMPERATURE) {
+        float temperature = getChannelTemperature(channelIndex);
+        if (channelState.temperature.isChanged(temperature, MQTT_DEADBAND_TEMPERATURE)) {
+            if (!publish(channelIndex, PUB_TOPIC_DCPSUPPLY_TEMP, temperature, true)) {
+                return false;
+            }
+            channelState.temperature.set(temperature);
+            onChannelValuePublished(tickCount);
+        }
+    }
 #endif
-
-        // publish total on-time counter
-        uint32_t totalOnTime = ontime::g_mcuCounter.getTotalTime();
-        if (totalOnTime != g_totalOnTime) {
-            if (publishOnTimeCounter(PUB_TOPIC_SYSTEM_TOTAL_ONTIME, totalOnTime, true)) {
-                g_totalOnTime = totalOnTime;
-                if (g_publishing) {
-                    return;
-                }
+    else if (value == CHANNEL_VALUE_TOTAL_ONTIME) {
+        uint32_t totalOnTime = ontime::g_moduleCounters[channel.slotIndex].getTotalTime();
+        if (totalOnTime != channelState.totalOnTime) {
+            if (!publishOnTimeCounter(channelIndex, PUB_TOPIC_DCPSUPPLY_TOTAL_ONTIME, totalOnTime, true)) {
+                return false;
             }
+            channelState.totalOnTime = totalOnTime;
+            onChannelValuePublished(tickCount);
         }
+    } else if (value == CHANNEL_VALUE_LAST_ONTIME) {
+        uint32_t lastOnTime = ontime::g_moduleCounters[channel.slotIndex].getLastTime();
+        if (lastOnTime != channelState.lastOnTime) {
+            if (!publishOnTimeCounter(channelIndex, PUB_TOPIC_DCPSUPPLY_LAST_ONTIME, lastOnTime, true)) {
+                return false;
+            }
+            channelState.lastOnTime = lastOnTime;
+            onChannelValuePublished(tickCount);
+        }
+    }
 
-        // publish last on-time counter
-        uint32_t lastOnTime = ontime::g_mcuCounter.getLastTime();
-        if (lastOnTime != g_lastOnTime) {
-            if (publishOnTimeCounter(PUB_TOPIC_SYSTEM_LAST_ONTIME, lastOnTime, true)) {
-                g_lastOnTime = lastOnTime;
-                if (g_publishing) {
-                    return;
-                }
+    return true;
+}
+
+static void publishChannelValues(uint32_t tickCount, uint32_t period) {
+    if (!g_channelsScanInProgress) {
+        if (tickCount - g_channelsScanTick < period) {
+            return;
+        }
+        g_channelsScanInProgress = true;
+        g_channelsScanTick = tickCount;
+        g_lastChannelIndex = 0;
+        g_lastValueIndex = 0;
+    }
+
+    while (g_lastChannelIndex < CH_NUM) {
+        while (g_lastValueIndex < NUM_CHANNEL_VALUES) {
+            if (!publishChannelValue(g_lastChannelIndex, (ChannelValue)g_lastValueIndex, tickCount)) {
+                // continue from here in the next tick
+                return;
             }
+            g_lastValueIndex++;
         }
+        g_lastValueIndex = 0;
+        g_lastChannelIndex++;
+    }
 
-        if (CH_NUM > 0) {
-            // publish channel state (oe, u_mon, i_mon, u_set, i_set)
-            uint8_t channelIndex = g_lastChannelIndex;
-            Channel &channel = Channel::get(channelIndex);
+    g_channelsScanInProgress = false;
+}
 
-            int oe = channel.isOutputEnabled() ? 1 : 0;
+static void updateStatistics(uint32_t tickCount) {
+    if (g_numPublishesThisTick > g_statistics.maxPublishesPerTick) {
+        g_statistics.maxPublishesPerTick = g_numPublishesThisTick;
+    }
 
-            if (g_lastValueIndex == 0) {
-                if (!g_channelStates[channelIndex].modelPublished) {
-                    char moduleInfo[50];
-                    auto &slot = *g_slots[channel.slotIndex];
-                    sprintf(moduleInfo, "%s_R%dB%d", slot.moduleName, (int)(slot.moduleRevision >> 8), (int)(slot.moduleRevision & 0xFF));
-                    if (publish(channelIndex, PUB_TOPIC_DCPSUPPLY_MODEL, moduleInfo, true)) {
-                        g_channelStates[channelIndex].modelPublished = true;
-                    }
-                }
+    if (tickCount - g_statisticsSecondTick >= 1000) {
+        g_statistics.messagesPerSecond = (g_statistics.numPublished - g_statisticsSecondNumPublished) * 1000 / (tickCount - g_statisticsSecondTick);
+        g_statisticsSecondTick = tickCount;
+        g_statisticsSecondNumPublished = g_statistics.numPublished;
+    }
+}
 
-                if (oe != g_channelStates[channelIndex].oe) {
-                    if (publish(channelIndex, PUB_TOPIC_DCPSUPPLY_OE, oe, true)) {
-                        g_channelStates[channelIndex].oe = oe;
-                    }
-                }
-            } else {
-                if (g_lastValueIndex == 1) {
-                    if (oe && (tickCount - g_channelStates[channelIndex].uMonTick) >= period) {
-                        float uMon = channel_dispatcher::getUMonLast(channel);
-                        if (publish(channelIndex, PUB_TOPIC_DCPSUPPLY_U_MON, uMon, true)) {
-                            g_channelStates[channelIndex].uMonTick = tickCount;
-                        }
-                    }
-                } else if (g_lastValueIndex == 2) {
-                    if (oe && (tickCount - g_channelStates[channelIndex].iMonTick) >= period) {
-                        float iMon = channel_dispatcher::getIMonLast(channel);
-                        if (publish(channelIndex, PUB_TOPIC_DCPSUPPLY_I_MON, iMon, true)) {
-                            g_channelStates[channelIndex].iMonTick = tickCount;
-                        }
-                    }
-                } else if (g_lastValueIndex == 3) {
-                    if ((tickCount - g_channelStates[channelIndex].uSetTick) >= period) {
-                        float uSet = channel_dispatcher::getUSet(channel);
-                        if (isNaN(g_channelStates[channelIndex].uSet) || uSet != g_channelStates[channelIndex].uSet) {
-                            if (publish(channelIndex, PUB_TOPIC_DCPSUPPLY_U_SET, uSet, true)) {
-                                g_channelStates[channelIndex].uSet = uSet;
-                                g_channelStates[channelIndex].uSetTick = tickCount;
-                            }
-                        }
-                    }
-                } else if (g_lastValueIndex == 4) {
-                    if ((tickCount - g_channelStates[channelIndex].iSetTick) >= period) {
-                        float iSet = channel_dispatcher::getISet(channel);
-                        if (isNaN(g_channelStates[channelIndex].iSet) || iSet != g_channelStates[channelIndex].iSet) {
-                            if (publish(channelIndex, PUB_TOPIC_DCPSUPPLY_I_SET, iSet, true)) {
-                                g_channelStates[channelIndex].iSet = iSet;
-                                g_channelStates[channelIndex].iSetTick = tickCount;
-                            }
-                        }
-                    }
-                } else if (g_lastValueIndex == 5) {
-                    // publish channel temperature
-                    if ((tickCount - g_channelStates[channelIndex].temperatureTick) >= period) {
-                        float temperature;
-                        temperature::TempSensorTemperature &tempSensor = temperature::sensors[temp_sensor::CH1 + channelIndex];
-                        if (tempSensor.isInstalled() && tempSensor.isTestOK()) {
-                            temperature = tempSensor.temperature;
-                        } else {
-                            temperature = NAN;
-                        }
-                        if (isNaN(g_channelStates[channelIndex].temperature) || temperature != g_channelStates[channelIndex].temperature) {
-                            if (publish(channelIndex, PUB_TOPIC_DCPSUPPLY_TEMP, temperature, true)) {
-                                g_channelStates[channelIndex].temperature = temperature;
-                                g_channelStates[channelIndex].temperatureTick = tickCount;
-                            }
-                        }
-                    }
-                } else if (g_lastValueIndex == 6) {
-                    // publish total on-time counter
-                    uint32_t totalOnTime = ontime::g_moduleCounters[channel.slotIndex].getTotalTime();
-                    if (totalOnTime != g_channelStates[channelIndex].totalOnTime) {
-                        if (publishOnTimeCounter(channelIndex, PUB_TOPIC_DCPSUPPLY_TOTAL_ONTIME, totalOnTime, true)) {
-                            g_channelStates[channelIndex].totalOnTime = totalOnTime;
-                            if (g_publishing) {
-                                return;
-                            }
-                        }
-                    }
-                } else if (g_lastValueIndex == 7) {
-                    // publish last on-time counter
-                    uint32_t lastOnTime = ontime::g_moduleCounters[channel.slotIndex].getLastTime();
-                    if (lastOnTime != g_channelStates[channelIndex].lastOnTime) {
-                        if (publishOnTimeCounter(channelIndex, PUB_TOPIC_DCPSUPPLY_LAST_ONTIME, lastOnTime, true)) {
-                            g_channelStates[channelIndex].lastOnTime = lastOnTime;
-                            if (g_publishing) {
-                                return;
-                            }
-                        }
-                    }
-                }
-            }
+void getPublishStatistics(PublishStatistics &statistics) {
+    statistics = g_statistics;
+}
 
-            if (++g_lastValueIndex == 8) {
-                g_lastValueIndex = 0;
-                if (++g_lastChannelIndex == CH_NUM) {
-                    g_lastChannelIndex = 0;
-                }
-            }
+void tick() {
+    uint32_t tickCount = millis();
+
+    if (ethernet::g_testResult != TEST_OK) {
+        if (g_connectionState != CONNECTION_STATE_IDLE && g_connectionState != CONNECTION_STATE_ETHERNET_NOT_READY) {
+			setState(CONNECTION_STATE_ETHERNET_NOT_CONNECTED);
+			return;
         }
+    }
+
+    else if (g_connectionState == CONNECTION_STATE_CONNECTED) {
+        if (!persist_conf::devConf.mqttEnabled) {
+            setState(CONNECTION_STATE_DISCONNECT);
+            return;
+        }
+
+#if defined(EEZ_PLATFORM_STM32)
+        if (!mqtt_client_is_connected(&g_client)) {
+            setState(CONNECTION_STATE_RECONNECT);
+            return;
+        }
+#endif
+
+        uint32_t period = (uint32_t)roundf(persist_conf::devConf.mqttPeriod * 1000);
+
+        g_numPublishesThisTick = 0;
+
+        publishSystemValues(tickCount, period);
+        publishChannelValues(tickCount, period);
+
+        updateStatistics(tickCount);
 
 #if defined(EEZ_PLATFORM_SIMULATOR)
 		mqtt_sync(&g_client);
@@ -46,5 +46,20 @@ void tick();
 void reconnect();
 void pushEvent(int16_t eventId);
 
+struct PublishStatistics {
+    uint32_t numPublished;
+    uint32_t numFailed;
+    uint32_t messagesPerSecond;
+    uint32_t maxPublishesPerTick;
+    uint32_t maxPublishesInFlight;
+    // time in ms from the start of the channels scan until the changed value is published
+    uint32_t lastStaleness;
+    uint32_t maxStaleness;
+    uint64_t totalStaleness;
+    uint32_t numStalenessSamples;
+};
+
+void getPublishStatistics(PublishStatistics &statistics);
+
 } // mqtt
 } // eez
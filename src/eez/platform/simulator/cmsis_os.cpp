@@ -3,10 +3,15 @@
 #include <assert.h>
 #include <stdio.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
 #ifdef EEZ_PLATFORM_SIMULATOR_WIN32
 #include <windows.h>
 #else
-#include <sys/time.h>
 #include <time.h>
 #endif
 
@@ -21,10 +26,217 @@ static Thread g_threads[MAX_THREADS];
 Thread *g_currentThread;
 #endif
 
+////////////////////////////////////////////////////////////////////////////////
+
+// All the kernel objects are protected by the single kernel lock. A thread waits on
+// the condition of the object it is interested in, except in the virtual time mode,
+// where everybody waits on g_kernelCondition because advancing the time must be able
+// to wake up all the threads.
+
+struct Condition {
+    std::condition_variable condition;
+    Condition *next;
+};
+
+static std::mutex g_kernelMutex;
+
+static Condition *g_conditions;
+static Condition *g_kernelCondition;
+
+static uint32_t g_numThreads;
+static uint32_t g_numExternalWaits;
+
+static std::atomic<bool> g_virtualTime;
+static uint64_t g_virtualTimeMs;
+static std::atomic<int64_t> g_realTimeOffsetMs;
+
+static const uint64_t INFINITE_DEADLINE = UINT64_MAX;
+
+struct Waiter {
+    uint64_t deadline;
+    std::function<bool()> isReady;
+    Waiter *next;
+};
+
+static Waiter *g_waiters;
+static uint32_t g_numWaiters;
+
+// must be called with the kernel lock held
+static Condition *createCondition() {
+    Condition *condition = new Condition;
+    condition->next = g_conditions;
+    g_conditions = condition;
+    return condition;
+}
+
+static Condition *getKernelCondition() {
+    if (!g_kernelCondition) {
+        g_kernelCondition = createCondition();
+    }
+    return g_kernelCondition;
+}
+
+static uint64_t getRealTimeUs() {
+    using namespace std::chrono;
+    static const steady_clock::time_point g_startTime = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - g_startTime).count();
+}
+
+static uint64_t getRealTimeMs() {
+    return getRealTimeUs() / 1000;
+}
+
+// must be called with the kernel lock held
+static uint64_t getKernelTimeMs() {
+    if (g_virtualTime) {
+        return g_virtualTimeMs;
+    }
+    return getRealTimeMs() + g_realTimeOffsetMs;
+}
+
+// must be called with the kernel lock held
+static void notify(Condition *condition) {
+    if (g_virtualTime) {
+        getKernelCondition()->condition.notify_all();
+    } else {
+        condition->condition.notify_all();
+    }
+}
+
+// Must be called with the kernel lock held. When all the threads are blocked and none
+// of them can proceed, moves the virtual time to the nearest deadline.
+static void advanceVirtualTime() {
+    if (g_numWaiters + g_numExternalWaits < g_numThreads) {
+        return;
+    }
+
+    uint64_t deadline = INFINITE_DEADLINE;
+    for (Waiter *waiter = g_waiters; waiter; waiter = waiter->next) {
+        if (waiter->isReady()) {
+            return;
+        }
+        if (waiter->deadline < deadline) {
+            deadline = waiter->deadline;
+        }
+    }
+
+    if (deadline != INFINITE_DEADLINE && deadline > g_virtualTimeMs) {
+        g_virtualTimeMs = deadline;
+        getKernelCondition()->condition.notify_all();
+    }
+}
+
+// Must be called with the kernel lock held. Returns false if timeout expired before
+// isReady became true.
+static bool wait(std::unique_lock<std::mutex> &lock, Condition *condition, uint32_t millisec, const std::function<bool()> &isReady) {
+    if (isReady()) {
+        return true;
+    }
+
+    if (millisec == 0) {
+        return false;
+    }
+
+#ifdef __EMSCRIPTEN__
+    // there are no real threads, so nobody can change the state while we are waiting
+    return false;
+#else
+    // Deadline is in the kernel time which stays continuous when the virtual time mode is
+    // switched on or off, so the waiting can continue in the other mode.
+    Waiter waiter;
+    waiter.deadline = millisec == osWaitForever ? INFINITE_DEADLINE : getKernelTimeMs() + millisec;
+    waiter.isReady = isReady;
+    waiter.next = g_waiters;
+    g_waiters = &waiter;
+    g_numWaiters++;
+
+    bool result;
+    while (true) {
+        if (isReady()) {
+            result = true;
+            break;
+        }
+
+        uint64_t now = getKernelTimeMs();
+        if (now >= waiter.deadline) {
+            result = false;
+            break;
+        }
+
+        if (g_virtualTime) {
+            advanceVirtualTime();
+            if (g_virtualTimeMs < waiter.deadline) {
+                getKernelCondition()->condition.wait(lock);
+            }
+        } else if (waiter.deadline == INFINITE_DEADLINE) {
+            condition->condition.wait(lock);
+        } else {
+            condition->condition.wait_for(lock, std::chrono::milliseconds(waiter.deadline - now));
+        }
+    }
+
+    Waiter **pWaiter = &g_waiters;
+    while (*pWaiter != &waiter) {
+        pWaiter = &(*pWaiter)->next;
+    }
+    *pWaiter = waiter.next;
+    g_numWaiters--;
+
+    return result;
+#endif
+}
+
+#ifndef __EMSCRIPTEN__
+
+static void registerThread() {
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
+    g_numThreads++;
+}
+
+static void unregisterThread() {
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
+    g_numThreads--;
+    if (g_virtualTime) {
+        advanceVirtualTime();
+    }
+}
+
+struct ThreadStart {
+    const osThreadDef_t *thread_def;
+    void *argument;
+};
+
+#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
+static uint32_t __stdcall threadStart(void *param) {
+#else
+static void *threadStart(void *param) {
+#endif
+    ThreadStart *start = (ThreadStart *)param;
+    const osThreadDef_t *thread_def = start->thread_def;
+    void *argument = start->argument;
+    delete start;
+
+    thread_def->pthread(argument);
+
+    unregisterThread();
+
+#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
+    return 0;
+#else
+    return nullptr;
+#endif
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
 osThreadId osThreadCreate(const osThreadDef_t *thread_def, void *argument) {
 #ifdef EEZ_PLATFORM_SIMULATOR_WIN32
+    // counted before it is started, so the virtual time can't move while the thread is starting
+    registerThread();
     DWORD threadId;
-    CreateThread(NULL, thread_def->stacksize, (LPTHREAD_START_ROUTINE)thread_def->pthread, argument, 0, &threadId);
+    CreateThread(NULL, thread_def->stacksize, (LPTHREAD_START_ROUTINE)threadStart, new ThreadStart{ thread_def, argument }, 0, &threadId);
     return threadId;
 #elif defined(__EMSCRIPTEN__)
     for (int i = 0; i < MAX_THREADS; ++i) {
@@ -37,10 +249,12 @@ osThreadId osThreadCreate(const osThreadDef_t *thread_def, void *argument) {
     assert(false);
     return nullptr;
 #else
+    // counted before it is started, so the virtual time can't move while the thread is starting
+    registerThread();
     pthread_t thread;
-    pthread_create(&thread, 0, thread_def->pthread, 0);
+    pthread_create(&thread, 0, threadStart, new ThreadStart{ thread_def, argument });
     return thread;
-#endif    
+#endif
 }
 
 osThreadId osThreadGetId() {
@@ -50,7 +264,7 @@ osThreadId osThreadGetId() {
     return g_currentThread;
 #else
     return pthread_self();
-#endif    
+#endif
 }
 
 #ifdef __EMSCRIPTEN__
@@ -65,10 +279,26 @@ void eez_system_tick() {
 #endif
 
 osStatus osKernelStart(void) {
+#ifndef __EMSCRIPTEN__
+    // the calling thread continues to run, so it is also counted
+    registerThread();
+#endif
     return osOK;
 }
 
 osStatus osDelay(uint32_t millisec) {
+    if (g_virtualTime) {
+        // Polling with osDelay(0) must let the time move, otherwise the thread
+        // that is polled for would never get its timeout.
+        if (millisec == 0) {
+            millisec = 1;
+        }
+
+        std::unique_lock<std::mutex> lock(g_kernelMutex);
+        wait(lock, getKernelCondition(), millisec, [] { return false; });
+        return osOK;
+    }
+
 #ifdef EEZ_PLATFORM_SIMULATOR_WIN32
     Sleep(millisec);
     return osOK;
@@ -78,84 +308,52 @@ osStatus osDelay(uint32_t millisec) {
     ts.tv_nsec = (millisec % 1000) * 1000000;
     nanosleep(&ts, 0);
     return osOK;
-#endif    
+#endif
 }
 
-#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
-uint32_t osKernelSysTickFrequency;
-#else
-uint32_t osKernelSysTickFrequency = 1000000;
-#endif
+uint32_t osKernelSysTickFrequency = 1000;
 
 uint32_t osKernelSysTick() {
-#ifdef EEZ_PLATFORM_SIMULATOR_WIN32
-    static bool isFirstTime = true;
-    static LARGE_INTEGER frequency;
-    static LARGE_INTEGER startTime;
-
-    if (isFirstTime) {
-        isFirstTime = false;
-        QueryPerformanceFrequency(&frequency);
-        QueryPerformanceCounter(&startTime);
-        return 0;
-    } else {
-        LARGE_INTEGER currentTime;
-        QueryPerformanceCounter(&currentTime);
-
-        auto diff = (currentTime.QuadPart - startTime.QuadPart) * 1000 / frequency.QuadPart;
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
+    return uint32_t(getKernelTimeMs());
+}
 
-        return uint32_t(diff % 4294967296);
+uint32_t osKernelSysTickMicros() {
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
+    if (g_virtualTime) {
+        return uint32_t(g_virtualTimeMs * 1000);
     }
-#else
-    timeval tv;
-    gettimeofday(&tv, NULL);
-    uint64_t micros = tv.tv_sec * (uint64_t)1000000 + tv.tv_usec;
-    return uint32_t((micros / 1000) % 4294967296);
-#endif    
+    return uint32_t(getRealTimeUs() + g_realTimeOffsetMs * 1000);
 }
 
 osMessageQId osMessageCreate(osMessageQId queue_id, osThreadId thread_id) {
-    queue_id->tail = 0;
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
     queue_id->head = 0;
-    queue_id->overflow = 0;
+    queue_id->tail = 0;
+    queue_id->count = 0;
+    if (!queue_id->notEmpty) {
+        queue_id->notEmpty = createCondition();
+        queue_id->notFull = createCondition();
+    }
     return queue_id;
 }
 
 osEvent osMessageGet(osMessageQId queue_id, uint32_t millisec) {
-    if (millisec == 0) millisec = 1;
+    std::unique_lock<std::mutex> lock(g_kernelMutex);
 
-    while (queue_id->tail == queue_id->head) {
-        if (queue_id->overflow) {
-            queue_id->overflow = 0;
-        }
-
-#ifdef __EMSCRIPTEN__
+    if (!wait(lock, queue_id->notEmpty, millisec, [queue_id] { return queue_id->count > 0; })) {
         return {
             osOK,
             0
         };
-#else
-        
-        osDelay(1);
-        millisec -= 1;
-
-        if (millisec == 0) {
-            return {
-                osOK,
-                0
-            };
-        }
-#endif
-    }
-    uint16_t tail = queue_id->tail + 1;
-    if (tail >= queue_id->numElements) {
-        tail = 0;
-    }
-    queue_id->tail = tail;
-    uint32_t info = ((uint32_t *)queue_id->data)[tail];
-    if (queue_id->overflow) {
-        queue_id->overflow = 0;
     }
+
+    uint32_t info = ((uint32_t *)queue_id->data)[queue_id->tail];
+    queue_id->tail = (queue_id->tail + 1) % queue_id->numElements;
+    queue_id->count--;
+
+    notify(queue_id->notFull);
+
     return {
         osEventMessage,
         info
@@ -163,37 +361,138 @@ osEvent osMessageGet(osMessageQId queue_id, uint32_t millisec) {
 }
 
 osStatus osMessagePut(osMessageQId queue_id, uint32_t info, uint32_t millisec) {
-    while (queue_id->overflow) {
-        osDelay(0);
-    }
-    uint16_t head = queue_id->head + 1;
-    if (head >= queue_id->numElements) {
-        head = 0;
-    }
-    ((uint32_t *)queue_id->data)[head] = info;
-    queue_id->head = head;
-    if (queue_id->head == queue_id->tail) {
-        queue_id->overflow = 1;
+    std::unique_lock<std::mutex> lock(g_kernelMutex);
+
+    if (!wait(lock, queue_id->notFull, millisec, [queue_id] { return queue_id->count < queue_id->numElements; })) {
+        return osErrorOS;
     }
+
+    ((uint32_t *)queue_id->data)[queue_id->head] = info;
+    queue_id->head = (queue_id->head + 1) % queue_id->numElements;
+    queue_id->count++;
+
+    notify(queue_id->notEmpty);
+
     return osOK;
 }
 
 uint32_t osMessageWaiting(osMessageQId queue_id) {
-    return queue_id->head - queue_id->tail;
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
+    return queue_id->count;
+}
+
+struct Semaphore {
+    int32_t count;
+    int32_t maxCount;
+    Condition *available;
+};
+
+osSemaphoreId osSemaphoreCreate(const osSemaphoreDef_t *semaphore_def, int32_t count) {
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
+    Semaphore *semaphore = new Semaphore;
+    semaphore->count = count;
+    semaphore->maxCount = count;
+    semaphore->available = createCondition();
+    return semaphore;
+}
+
+int32_t osSemaphoreWait(osSemaphoreId semaphore_id, uint32_t millisec) {
+    std::unique_lock<std::mutex> lock(g_kernelMutex);
+
+    if (!wait(lock, semaphore_id->available, millisec, [semaphore_id] { return semaphore_id->count > 0; })) {
+        return osErrorOS;
+    }
+
+    semaphore_id->count--;
+    return osOK;
+}
+
+osStatus osSemaphoreRelease(osSemaphoreId semaphore_id) {
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
+
+    if (semaphore_id->count >= semaphore_id->maxCount) {
+        return osErrorOS;
+    }
+
+    semaphore_id->count++;
+    notify(semaphore_id->available);
+    return osOK;
 }
 
 Mutex *osMutexCreate(Mutex &mutex) {
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
+    mutex.locked = false;
+    if (!mutex.unlocked) {
+        mutex.unlocked = createCondition();
+    }
     return &mutex;
 }
 
 osStatus osMutexWait(Mutex *mutex, unsigned int timeout) {
-    while (mutex->locked) {
-    	osDelay(1);
+    std::unique_lock<std::mutex> lock(g_kernelMutex);
+
+    if (!wait(lock, mutex->unlocked, timeout, [mutex] { return !mutex->locked; })) {
+        return osErrorOS;
     }
+
     mutex->locked = true;
+    mutex->owner = osThreadGetId();
     return osOK;
 }
 
-void osMutexRelease(Mutex *mutex) {
+osStatus osMutexRelease(Mutex *mutex) {
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
+
+    // only the owner can release the mutex
+    if (!mutex->locked || mutex->owner != osThreadGetId()) {
+        return osErrorResource;
+    }
+
     mutex->locked = false;
+    notify(mutex->unlocked);
+
+    return osOK;
+}
+
+void osKernelSetVirtualTime(bool enable) {
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
+
+    if (enable == g_virtualTime) {
+        return;
+    }
+
+    // the kernel time continues from where it was, it never goes backwards
+    if (enable) {
+        g_virtualTimeMs = getKernelTimeMs();
+    } else {
+        g_realTimeOffsetMs = int64_t(g_virtualTimeMs) - int64_t(getRealTimeMs());
+    }
+
+    g_virtualTime = enable;
+
+    // waiting threads must move to the other condition
+    for (Condition *condition = g_conditions; condition; condition = condition->next) {
+        condition->condition.notify_all();
+    }
+
+    if (enable) {
+        advanceVirtualTime();
+    }
+}
+
+bool osKernelIsVirtualTime() {
+    return g_virtualTime;
+}
+
+void osThreadEnterExternalWait() {
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
+    g_numExternalWaits++;
+    if (g_virtualTime) {
+        advanceVirtualTime();
+    }
+}
+
+void osThreadExitExternalWait() {
+    std::lock_guard<std::mutex> lock(g_kernelMutex);
+    g_numExternalWaits--;
 }
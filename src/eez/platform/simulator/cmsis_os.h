@@ -4,7 +4,9 @@
 
 typedef enum {
     osOK = 0,
-    osEventMessage = 0x10
+    osEventMessage = 0x10,
+    osErrorResource = 0x81,
+    osErrorOS = 0xFF
 } osStatus;
 
 typedef enum {
@@ -73,6 +75,9 @@ uint32_t osKernelSysTick(void);
 
 extern uint32_t osKernelSysTickFrequency;
 
+// simulator only, the same time as osKernelSysTick but in microseconds
+uint32_t osKernelSysTickMicros(void);
+
 //
 
 #define osWaitForever     0xFFFFFFFF
@@ -86,12 +91,16 @@ struct osEvent {
 
 // Message Queue
 
+struct Condition;
+
 struct MessageQueue {
     void *data;
-    uint8_t numElements;
-    volatile uint16_t tail;
-    volatile uint16_t head;
-    volatile uint8_t overflow;
+    uint16_t numElements;
+    uint16_t head;
+    uint16_t tail;
+    uint16_t count;
+    Condition *notEmpty;
+    Condition *notFull;
 };
 
 typedef MessageQueue *osMessageQId;
@@ -109,10 +118,29 @@ osEvent osMessageGet(osMessageQId queue_id, uint32_t millisec);
 osStatus osMessagePut(osMessageQId queue_id, uint32_t info, uint32_t millisec);
 uint32_t osMessageWaiting(osMessageQId queue_id);
 
+// Semaphore
+
+struct Semaphore;
+
+typedef struct os_semaphore_def {
+    uint32_t dummy;
+} osSemaphoreDef_t;
+
+typedef Semaphore *osSemaphoreId;
+
+#define osSemaphoreDef(name) const osSemaphoreDef_t os_semaphore_def_##name = { 0 }
+#define osSemaphore(name) &os_semaphore_def_##name
+
+osSemaphoreId osSemaphoreCreate(const osSemaphoreDef_t *semaphore_def, int32_t count);
+int32_t osSemaphoreWait(osSemaphoreId semaphore_id, uint32_t millisec);
+osStatus osSemaphoreRelease(osSemaphoreId semaphore_id);
+
 // Mutex
 
 struct Mutex {
     bool locked;
+    osThreadId owner;
+    Condition *unlocked;
 };
 
 #define osMutexDef(mutex) Mutex mutex
@@ -121,4 +149,19 @@ struct Mutex {
 
 Mutex *osMutexCreate(Mutex &mutex);
 osStatus osMutexWait(Mutex *mutex, unsigned int timeout);
-void osMutexRelease(Mutex *mutex);
\ No newline at end of file
+osStatus osMutexRelease(Mutex *mutex);
+
+// Virtual time (simulator only)
+//
+// When enabled, osKernelSysTick stops following the wall clock. Instead, as soon as
+// every thread created with osThreadCreate (and the thread that called osKernelStart)
+// is blocked in osDelay or in a timed wait on a queue, semaphore or mutex, the time
+// jumps to the nearest timeout. Threads that block outside of the kernel (console
+// input, sockets, ...) must bracket such calls with osThreadEnterExternalWait and
+// osThreadExitExternalWait, otherwise the time will never advance.
+
+void osKernelSetVirtualTime(bool enable);
+bool osKernelIsVirtualTime();
+
+void osThreadEnterExternalWait();
+void osThreadExitExternalWait();
\ No newline at end of file
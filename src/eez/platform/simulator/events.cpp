@@ -18,7 +18,11 @@
 
 #include <eez/platform/simulator/events.h>
 
+#include <atomic>
+
+#if !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
 #include <SDL.h>
+#endif
 
 #include <eez/firmware.h>
 #include <eez/system.h>
@@ -40,6 +44,78 @@ int g_mouseButton1DownX;
 int g_mouseButton1DownY;
 bool g_mouseButton1IsPressed;
 
+static const uint32_t MAX_INJECTED_TOUCH_EVENTS = 16;
+
+struct TouchEvent {
+    int x;
+    int y;
+    bool isPressed;
+};
+
+// written only by injectTouchEvent and read only by readEvents
+static TouchEvent g_injectedTouchEvents[MAX_INJECTED_TOUCH_EVENTS];
+static std::atomic<uint32_t> g_injectedTouchEventsHead;
+static std::atomic<uint32_t> g_injectedTouchEventsTail;
+
+static TouchEvent g_lastInjectedTouchEvent;
+static bool g_isTouchInjected;
+
+static std::atomic<bool> g_exitRequested;
+
+void requestExit() {
+    g_exitRequested = true;
+}
+
+static void checkExitRequest() {
+    if (g_exitRequested.exchange(false)) {
+        eez::shutdown();
+    }
+}
+
+bool injectTouchEvent(int x, int y, bool isPressed) {
+    uint32_t head = g_injectedTouchEventsHead.load(std::memory_order_relaxed);
+    if (head - g_injectedTouchEventsTail.load(std::memory_order_acquire) == MAX_INJECTED_TOUCH_EVENTS) {
+        return false;
+    }
+
+    TouchEvent &event = g_injectedTouchEvents[head % MAX_INJECTED_TOUCH_EVENTS];
+    event.x = x;
+    event.y = y;
+    event.isPressed = isPressed;
+
+    g_injectedTouchEventsHead.store(head + 1, std::memory_order_release);
+
+    return true;
+}
+
+static void readInjectedTouchEvents() {
+    uint32_t tail = g_injectedTouchEventsTail.load(std::memory_order_relaxed);
+    if (tail != g_injectedTouchEventsHead.load(std::memory_order_acquire)) {
+        g_lastInjectedTouchEvent = g_injectedTouchEvents[tail % MAX_INJECTED_TOUCH_EVENTS];
+        g_injectedTouchEventsTail.store(tail + 1, std::memory_order_release);
+        g_isTouchInjected = true;
+    }
+
+    // injected touch overrides the mouse until it is released
+    if (g_isTouchInjected) {
+        g_mouseX = g_lastInjectedTouchEvent.x;
+        g_mouseY = g_lastInjectedTouchEvent.y;
+        g_mouseButton1IsPressed = g_lastInjectedTouchEvent.isPressed;
+        if (!g_lastInjectedTouchEvent.isPressed) {
+            g_isTouchInjected = false;
+        }
+    }
+}
+
+#if defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
+
+void readEvents() {
+    readInjectedTouchEvents();
+    checkExitRequest();
+}
+
+#else
+
 void readEvents() {
     int yMouseWheel = 0;
     bool mouseButton2IsUp = false;
@@ -82,8 +158,13 @@ void readEvents() {
 #if OPTION_DISPLAY && OPTION_ENCODER
     mcu::encoder::write(yMouseWheel, mouseButton2IsUp);
 #endif
+
+    readInjectedTouchEvents();
+    checkExitRequest();
 }
 
+#endif
+
 } // namespace simulator
 } // namespace platform
 } // namespace eez
\ No newline at end of file
@@ -30,6 +30,13 @@ extern bool g_mouseButton1IsPressed;
 
 void readEvents();
 
+// Touch events injected from SCPI or automation scripts. Events are queued and applied
+// one per readEvents call, so touch driver sees every press and release.
+bool injectTouchEvent(int x, int y, bool isPressed);
+
+// Shutdown is started from readEvents, same as when the simulator window is closed.
+void requestExit();
+
 } // namespace simulator
 } // namespace platform
 } // namespace eez
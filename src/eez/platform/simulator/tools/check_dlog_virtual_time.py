@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+
+# Checks that DLOG recordings made with the virtual time are identical between
+# runs: same number of samples, no missed samples and bit-identical data.
+#
+# Usage: check_dlog_virtual_time.py <simulator executable>
+
+import os
+import sys
+
+from simulator import Simulator
+
+PERIOD = 0.002
+DURATION = 2
+NUM_SAMPLES = int(round(DURATION / PERIOD))
+ROW_SIZE = 2 * 4  # two float values per sample
+
+# The output is constant, so the data differs between runs only if samples are
+# missed (recorded as NaN), which happens in real time at this period. Relative
+# timing to other activity started with SCPI isn't checked: the virtual time
+# doesn't serialize the threads, so two threads can act in the same millisecond
+# in either order.
+COMMANDS = [
+    "INST CH1",
+    "VOLT 5",
+    "CURR 0.5",
+    "SIMU:LOAD 20",
+    "SIMU:LOAD:STAT ON",
+    "OUTP ON",
+    "SENS:DLOG:FUNC:VOLT ON,CH1",
+    "SENS:DLOG:FUNC:CURR ON,CH1",
+    "SENS:DLOG:COMP OFF",
+    "SENS:DLOG:PER %g" % PERIOD,
+    "SENS:DLOG:TIME %g" % DURATION,
+    "TRIG:DLOG:SOUR IMM",
+    'INIT:DLOG "/Recordings/check.dlog"',
+]
+
+
+def record(executable):
+    simulator = Simulator(executable, ["--virtual-time"])
+    try:
+        for command in COMMANDS:
+            simulator.command(command)
+
+        statistics = []
+
+        def finished():
+            statistics[:] = simulator.query("SENS:DLOG:STAT?").split(",")
+            return int(statistics[2]) + int(statistics[3]) >= NUM_SAMPLES
+
+        if not simulator.wait_until(finished, 120):
+            raise RuntimeError("recording didn't finish")
+
+        filePath = os.path.join(simulator.sd_card, "Recordings", "check.dlog")
+        sizes = []
+
+        def flushed():
+            sizes.append(os.path.getsize(filePath) if os.path.exists(filePath) else 0)
+            return len(sizes) > 5 and sizes[-1] == sizes[-5] and sizes[-1] >= NUM_SAMPLES * ROW_SIZE
+
+        if not simulator.wait_until(flushed, 30):
+            raise RuntimeError("recording wasn't written")
+
+        with open(filePath, "rb") as file:
+            data = file.read()
+
+        # header has the start date and time, compare only the samples
+        return data[-NUM_SAMPLES * ROW_SIZE:], int(statistics[2]), int(statistics[3])
+    finally:
+        simulator.close()
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("Usage: %s <simulator executable>" % sys.argv[0])
+        return 2
+
+    runs = [record(sys.argv[1]) for _ in range(2)]
+
+    result = 0
+    for i, (data, numSamples, numMissedSamples) in enumerate(runs):
+        print("run %d: %d samples, %d missed" % (i + 1, numSamples, numMissedSamples))
+        if numMissedSamples != 0:
+            result = 1
+
+    if runs[0][0] != runs[1][0]:
+        print("FAILED: DLOG data differs between runs")
+        return 1
+
+    if result != 0:
+        print("FAILED: samples were missed")
+        return result
+
+    print("OK: DLOG data is identical")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
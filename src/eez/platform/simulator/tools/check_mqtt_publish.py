@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+
+# Checks MQTT publishing against the stand-in broker: after connect, every
+# value of every channel is published within one period, and no tick publishes
+# more than MQTT_MAX_PUBLISHES_PER_TICK messages.
+#
+# Usage: check_mqtt_publish.py <simulator executable>
+
+import sys
+import time
+
+from mqtt_broker import Broker
+from simulator import Simulator
+
+PERIOD = 1.0
+MAX_PUBLISHES_PER_TICK = 8  # MQTT_MAX_PUBLISHES_PER_TICK from conf_advanced.h
+
+# umon and imon are published only while the output is enabled
+CHANNEL_TOPICS = ["model", "oe", "uset", "iset", "umon", "imon", "temp"]
+
+
+def getChannelCommands(channelNumber):
+    return [
+        "INST CH%d" % channelNumber,
+        "VOLT %d" % channelNumber,
+        "CURR 0.5",
+        "SIMU:LOAD 20",
+        "SIMU:LOAD:STAT ON",
+        "OUTP ON",
+    ]
+
+
+def main():
+    if len(sys.argv) != 2:
+        print("Usage: %s <simulator executable>" % sys.argv[0])
+        return 2
+
+    broker = Broker()
+    simulator = Simulator(sys.argv[1])
+    try:
+        numChannels = int(simulator.query("SYST:CHAN?"))
+        for channelNumber in range(1, numChannels + 1):
+            for command in getChannelCommands(channelNumber):
+                simulator.command(command)
+
+        simulator.command('SYST:COMM:MQTT:SETT "127.0.0.1",%d,"","",%g' % (broker.port, PERIOD))
+        simulator.command("SYST:COMM:ENAB ON,MQTT")
+
+        if not simulator.wait_until(lambda: broker.getConnectTimes(), 30):
+            print("FAILED: simulator didn't connect to the broker")
+            return 1
+
+        time.sleep(2 * PERIOD)
+
+        # DEBUg:MQTT? prints 8 lines and an empty line
+        statistics = {}
+        for line in simulator.query_lines("DEBU:MQTT?", 9):
+            if ":" in line:
+                name, value = line.split(":", 1)
+                statistics[name] = int(value.split()[0])
+    finally:
+        simulator.close()
+        broker.close()
+
+    connectTime = broker.getConnectTimes()[0]
+    firstPublishTimes = {}
+    for publishTime, topic, _ in broker.getPublishes():
+        firstPublishTimes.setdefault(topic, publishTime - connectTime)
+
+    result = 0
+
+    for channelNumber in range(1, numChannels + 1):
+        for name in CHANNEL_TOPICS:
+            topic = "/dcpsupply/ch/%d/%s" % (channelNumber, name)
+            times = [t for fullTopic, t in firstPublishTimes.items() if fullTopic.endswith(topic)]
+            if not times:
+                print("FAILED: %s was not published" % topic)
+                result = 1
+            elif times[0] > PERIOD:
+                print("FAILED: %s was published %.3f s after connect" % (topic, times[0]))
+                result = 1
+
+    print("published: %d, failed: %d, max publishes per tick: %d" % (
+        statistics["published"], statistics["failed"], statistics["max publishes per tick"]))
+
+    if statistics["failed"] != 0:
+        print("FAILED: some publishes failed")
+        result = 1
+
+    if statistics["max publishes per tick"] > MAX_PUBLISHES_PER_TICK:
+        print("FAILED: more than %d publishes in one tick" % MAX_PUBLISHES_PER_TICK)
+        result = 1
+
+    if result == 0:
+        print("OK: %d channels published within %g s after connect" % (numChannels, PERIOD))
+
+    return result
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,95 @@
+# Minimal MQTT 3.1.1 stand-in broker for the simulator checks. It accepts any
+# client, acknowledges CONNECT, SUBSCRIBE and PINGREQ, and records every
+# PUBLISH with the time it was received. Nothing is forwarded.
+
+import socket
+import threading
+import time
+
+CONNECT = 1
+PUBLISH = 3
+SUBSCRIBE = 8
+PINGREQ = 12
+
+
+class Broker:
+    def __init__(self):
+        self.socket = socket.socket()
+        self.socket.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        self.socket.bind(("127.0.0.1", 0))
+        self.socket.listen(4)
+        self.port = self.socket.getsockname()[1]
+
+        self.lock = threading.Lock()
+        self.connectTimes = []
+        self.publishes = []  # (time, topic, payload)
+
+        threading.Thread(target=self._accept, daemon=True).start()
+
+    def _accept(self):
+        while True:
+            try:
+                client, _ = self.socket.accept()
+            except OSError:
+                return
+            threading.Thread(target=self._serve, args=(client,), daemon=True).start()
+
+    @staticmethod
+    def _receive(client, length):
+        data = b""
+        while len(data) < length:
+            chunk = client.recv(length - len(data))
+            if not chunk:
+                raise EOFError
+            data += chunk
+        return data
+
+    def _readPacket(self, client):
+        header = self._receive(client, 1)[0]
+
+        # remaining length is encoded with 7 bits per byte, LSB first
+        length = 0
+        multiplier = 1
+        while True:
+            byte = self._receive(client, 1)[0]
+            length += (byte & 127) * multiplier
+            multiplier *= 128
+            if not byte & 128:
+                break
+
+        return header >> 4, self._receive(client, length)
+
+    def _serve(self, client):
+        try:
+            while True:
+                packetType, data = self._readPacket(client)
+                if packetType == CONNECT:
+                    with self.lock:
+                        self.connectTimes.append(time.time())
+                    client.sendall(bytes([0x20, 2, 0, 0]))
+                elif packetType == SUBSCRIBE:
+                    # granted QoS 0 for a single topic filter
+                    client.sendall(bytes([0x90, 3, data[0], data[1], 0]))
+                elif packetType == PINGREQ:
+                    client.sendall(bytes([0xD0, 0]))
+                elif packetType == PUBLISH:
+                    topicLength = (data[0] << 8) | data[1]
+                    topic = data[2:2 + topicLength].decode()
+                    payload = data[2 + topicLength:].decode(errors="replace")
+                    with self.lock:
+                        self.publishes.append((time.time(), topic, payload))
+        except (EOFError, OSError):
+            pass
+        finally:
+            client.close()
+
+    def getConnectTimes(self):
+        with self.lock:
+            return list(self.connectTimes)
+
+    def getPublishes(self):
+        with self.lock:
+            return list(self.publishes)
+
+    def close(self):
+        self.socket.close()
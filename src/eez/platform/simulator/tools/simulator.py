@@ -0,0 +1,81 @@
+# Runs the simulator with its own empty home directory, so it starts from the
+# default state and doesn't touch ~/.eez_psu_sim, and talks to it over the
+# console SCPI interface (stdin/stdout).
+
+import os
+import queue
+import shutil
+import subprocess
+import tempfile
+import threading
+import time
+
+
+class Simulator:
+    def __init__(self, executable, args=()):
+        self.home = tempfile.mkdtemp(prefix="eez_psu_sim_")
+        env = dict(os.environ)
+        env["HOME"] = self.home
+        command = [executable] + list(args)
+        # simulator output is block buffered when it is not a terminal
+        if shutil.which("stdbuf"):
+            command = ["stdbuf", "-o0"] + command
+        self.process = subprocess.Popen(
+            command,
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT,
+            env=env,
+            cwd=self.home,
+            universal_newlines=True,
+            bufsize=1)
+        self.lines = queue.Queue()
+        threading.Thread(target=self._read, daemon=True).start()
+        # first line is the simulator banner
+        self.lines.get(timeout=30)
+
+    def _read(self):
+        for line in self.process.stdout:
+            line = line.rstrip("\r\n")
+            # errors are also reported with SYST:ERR?, skip the console copy
+            if not line.startswith("**ERROR"):
+                self.lines.put(line)
+
+    @property
+    def sd_card(self):
+        return os.path.join(self.home, ".eez_psu_sim", "sd_card")
+
+    def write(self, command):
+        self.process.stdin.write(command + "\n")
+        self.process.stdin.flush()
+
+    def query(self, command, timeout=10):
+        self.write(command)
+        return self.lines.get(timeout=timeout)
+
+    def query_lines(self, command, numLines, timeout=10):
+        self.write(command)
+        return [self.lines.get(timeout=timeout) for _ in range(numLines)]
+
+    def command(self, command):
+        self.write(command)
+        error = self.query("SYST:ERR?")
+        if not error.startswith("0,"):
+            raise RuntimeError("%s: %s" % (command, error))
+
+    def wait_until(self, condition, timeout, interval=0.2):
+        end = time.time() + timeout
+        while time.time() < end:
+            if condition():
+                return True
+            time.sleep(interval)
+        return False
+
+    def close(self):
+        try:
+            self.write("SIMU:EXIT")
+            self.process.wait(timeout=10)
+        except (OSError, subprocess.TimeoutExpired):
+            self.process.kill()
+            self.process.wait()
+        shutil.rmtree(self.home, ignore_errors=True)
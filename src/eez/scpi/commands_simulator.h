@@ -57,6 +57,9 @@
     SCPI_COMMAND("DISPlay[:WINdow]:DIALog:DATA", scpi_cmd_displayWindowDialogData) \
     SCPI_COMMAND("DISPlay[:WINdow]:DIALog:CLOSe", scpi_cmd_displayWindowDialogClose) \
     SCPI_COMMAND("DISPlay[:WINdow]:ERRor", scpi_cmd_displayWindowError) \
+    SCPI_COMMAND("FETCh:ARRay:CURRent?", scpi_cmd_fetchArrayCurrentQ) \
+    SCPI_COMMAND("FETCh:ARRay:POWer?", scpi_cmd_fetchArrayPowerQ) \
+    SCPI_COMMAND("FETCh:ARRay[:VOLTage]?", scpi_cmd_fetchArrayVoltageQ) \
     SCPI_COMMAND("INITiate:CONTinuous", scpi_cmd_initiateContinuous) \
     SCPI_COMMAND("INITiate:CONTinuous?", scpi_cmd_initiateContinuousQ) \
     SCPI_COMMAND("INITiate:DLOG", scpi_cmd_initiateDlog) \
@@ -105,6 +108,8 @@
     SCPI_COMMAND("MMEMory:DOWNload:ABORt", scpi_cmd_mmemoryDownloadAbort) \
     SCPI_COMMAND("MMEMory:DOWNload:DATA", scpi_cmd_mmemoryDownloadData) \
     SCPI_COMMAND("MMEMory:DOWNload:FNAMe", scpi_cmd_mmemoryDownloadFname) \
+    SCPI_COMMAND("MMEMory:DOWNload:OFFSet", scpi_cmd_mmemoryDownloadOffset) \
+    SCPI_COMMAND("MMEMory:DOWNload:OFFSet?", scpi_cmd_mmemoryDownloadOffsetQ) \
     SCPI_COMMAND("MMEMory:DOWNload:SIZE", scpi_cmd_mmemoryDownloadSize) \
     SCPI_COMMAND("MMEMory:INFOrmation?", scpi_cmd_mmemoryInformationQ) \
     SCPI_COMMAND("MMEMory:LOAD:LIST#", scpi_cmd_mmemoryLoadList) \
@@ -142,6 +147,8 @@
     SCPI_COMMAND("ROUTe:LABel:COLumn?", scpi_cmd_routeLabelColumnQ) \
     SCPI_COMMAND("ROUTe:LABel:CHANnel", scpi_cmd_routeLabelChannel) \
     SCPI_COMMAND("ROUTe:LABel:CHANnel?", scpi_cmd_routeLabelChannelQ) \
+    SCPI_COMMAND("SENSe:ACQuire:PERiod", scpi_cmd_senseAcquirePeriod) \
+    SCPI_COMMAND("SENSe:ACQuire:PERiod?", scpi_cmd_senseAcquirePeriodQ) \
     SCPI_COMMAND("SENSe:FUNCtion[:ON]", scpi_cmd_senseFunctionOn) \
     SCPI_COMMAND("SENSe:FUNCtion[:ON]?", scpi_cmd_senseFunctionOnQ) \
     SCPI_COMMAND("[SENSe]:CURRent[:DC]:RANGe", scpi_cmd_senseCurrentDcRange) \
@@ -154,6 +161,12 @@
     SCPI_COMMAND("SENSe:VOLTage[:DC]:NPLCycles", scpi_cmd_senseVoltageDcNplcycles) \
     SCPI_COMMAND("SENSe:VOLTage[:DC]:NPLCycles?", scpi_cmd_senseVoltageDcNplcyclesQ) \
     SCPI_COMMAND("SENSe:VOLTage[:DC]:APERture?", scpi_cmd_senseVoltageDcApertureQ) \
+    SCPI_COMMAND("SENSe:DLOG:COMPression", scpi_cmd_senseDlogCompression) \
+    SCPI_COMMAND("SENSe:DLOG:COMPression?", scpi_cmd_senseDlogCompressionQ) \
+    SCPI_COMMAND("SENSe:DLOG:FLUSh:SIZE", scpi_cmd_senseDlogFlushSize) \
+    SCPI_COMMAND("SENSe:DLOG:FLUSh:SIZE?", scpi_cmd_senseDlogFlushSizeQ) \
+    SCPI_COMMAND("SENSe:DLOG:FLUSh:TIME", scpi_cmd_senseDlogFlushTime) \
+    SCPI_COMMAND("SENSe:DLOG:FLUSh:TIME?", scpi_cmd_senseDlogFlushTimeQ) \
     SCPI_COMMAND("SENSe:DLOG:FUNCtion:CURRent", scpi_cmd_senseDlogFunctionCurrent) \
     SCPI_COMMAND("SENSe:DLOG:FUNCtion:CURRent?", scpi_cmd_senseDlogFunctionCurrentQ) \
     SCPI_COMMAND("SENSe:DLOG:FUNCtion:POWer", scpi_cmd_senseDlogFunctionPower) \
@@ -164,8 +177,10 @@
     SCPI_COMMAND("SENSe:DLOG:FUNCtion:DIGital[:INPut]?", scpi_cmd_senseDlogFunctionDigitalInputQ) \
     SCPI_COMMAND("SENSe:DLOG:PERiod", scpi_cmd_senseDlogPeriod) \
     SCPI_COMMAND("SENSe:DLOG:PERiod?", scpi_cmd_senseDlogPeriodQ) \
+    SCPI_COMMAND("SENSe:DLOG:STATistics?", scpi_cmd_senseDlogStatisticsQ) \
     SCPI_COMMAND("SENSe:DLOG:TIME", scpi_cmd_senseDlogTime) \
     SCPI_COMMAND("SENSe:DLOG:TIME?", scpi_cmd_senseDlogTimeQ) \
+    SCPI_COMMAND("SENSe:DLOG:TRACe:BINary", scpi_cmd_senseDlogTraceBinary) \
     SCPI_COMMAND("SENSe:DLOG:TRACe:REMark", scpi_cmd_senseDlogTraceRemark) \
     SCPI_COMMAND("SENSe:DLOG:TRACe:REMark?", scpi_cmd_senseDlogTraceRemarkQ) \
     SCPI_COMMAND("SENSe:DLOG:TRACe:X:LABel", scpi_cmd_senseDlogTraceXLabel) \
@@ -325,6 +340,7 @@
     SCPI_COMMAND("SYSTem:COMMunicate:ETHernet:MAC?", scpi_cmd_systemCommunicateEthernetMacQ) \
     SCPI_COMMAND("SYSTem:COMMunicate:ETHernet:PORT", scpi_cmd_systemCommunicateEthernetPort) \
     SCPI_COMMAND("SYSTem:COMMunicate:ETHernet:PORT?", scpi_cmd_systemCommunicateEthernetPortQ) \
+    SCPI_COMMAND("SYSTem:COMMunicate:ETHernet:SESSions?", scpi_cmd_systemCommunicateEthernetSessionsQ) \
     SCPI_COMMAND("SYSTem:COMMunicate:ETHernet:SMASk", scpi_cmd_systemCommunicateEthernetSmask) \
     SCPI_COMMAND("SYSTem:COMMunicate:ETHernet:SMASk?", scpi_cmd_systemCommunicateEthernetSmaskQ) \
     SCPI_COMMAND("SYSTem:COMMunicate:MQTT:SETTings", scpi_cmd_systemCommunicateMqttSettings) \
@@ -444,9 +460,14 @@
     SCPI_COMMAND("SIMUlator:RPOL?", scpi_cmd_simulatorRpolQ) \
     SCPI_COMMAND("SIMUlator:TEMPerature", scpi_cmd_simulatorTemperature) \
     SCPI_COMMAND("SIMUlator:TEMPerature?", scpi_cmd_simulatorTemperatureQ) \
+    SCPI_COMMAND("SIMUlator:TIME:VIRTual", scpi_cmd_simulatorTimeVirtual) \
+    SCPI_COMMAND("SIMUlator:TIME:VIRTual?", scpi_cmd_simulatorTimeVirtualQ) \
+    SCPI_COMMAND("SIMUlator:TOUCh", scpi_cmd_simulatorTouch) \
     SCPI_COMMAND("SIMUlator:VOLTage:PROGram:EXTernal", scpi_cmd_simulatorVoltageProgramExternal) \
     SCPI_COMMAND("SIMUlator:VOLTage:PROGram:EXTernal?", scpi_cmd_simulatorVoltageProgramExternalQ) \
     SCPI_COMMAND("SIMUlator:DIGital:DATA[:BYTE]", scpi_cmd_simulatorDigitalDataByte) \
+    SCPI_COMMAND("SIMUlator:DISPlay:BENChmark?", scpi_cmd_simulatorDisplayBenchmarkQ) \
+    SCPI_COMMAND("SIMUlator:DISPlay:STATistics?", scpi_cmd_simulatorDisplayStatisticsQ) \
     SCPI_COMMAND("DEBUg", scpi_cmd_debug) \
     SCPI_COMMAND("DEBUg:ONTime?", scpi_cmd_debugOntimeQ) \
     SCPI_COMMAND("DEBUg:VOLTage", scpi_cmd_debugVoltage) \
@@ -461,5 +482,18 @@
     SCPI_COMMAND("DEBUg:DCM220?", scpi_cmd_debugDcm220Q) \
     SCPI_COMMAND("DEBUg:DOWNload:FIRMware", scpi_cmd_debugDownloadFirmware) \
     SCPI_COMMAND("DEBUg:EVENt", scpi_cmd_debugEvent) \
+    SCPI_COMMAND("DEBUg:FONT:CACHe?", scpi_cmd_debugFontCacheQ) \
+    SCPI_COMMAND("DEBUg:GUI:UPDate?", scpi_cmd_debugGuiUpdateQ) \
+    SCPI_COMMAND("DEBUg:QUEue?", scpi_cmd_debugQueueQ) \
+    SCPI_COMMAND("DEBUg:QUEue:LATency?", scpi_cmd_debugQueueLatencyQ) \
+    SCPI_COMMAND("DEBUg:MQTT?", scpi_cmd_debugMqttQ) \
+    SCPI_COMMAND("DEBUg:TICK?", scpi_cmd_debugTickQ) \
+    SCPI_COMMAND("DEBUg:TICK:RESet", scpi_cmd_debugTickReset) \
+    SCPI_COMMAND("DEBUg:MMEMory:TRANsfer?", scpi_cmd_debugMmemoryTransferQ) \
+    SCPI_COMMAND("DEBUg:PROFile:BENChmark?", scpi_cmd_debugProfileBenchmarkQ) \
+    SCPI_COMMAND("DEBUg:CONFig?", scpi_cmd_debugConfigQ) \
+    SCPI_COMMAND("DEBUg:CONFig:BENChmark?", scpi_cmd_debugConfigBenchmarkQ) \
+    SCPI_COMMAND("DEBUg:SCPI:BENChmark?", scpi_cmd_debugScpiBenchmarkQ) \
+    SCPI_COMMAND("DEBUg:ETHernet:BENChmark?", scpi_cmd_debugEthernetBenchmarkQ) \
     SCPI_COMMAND("SYSTem:DATE:CLEar", scpi_cmd_systemDateClear) \
     SCPI_COMMAND("SYSTem:TIME:CLEar", scpi_cmd_systemTimeClear)
@@ -35,7 +35,9 @@ void scpi_reg_set(scpi_reg_name_t name, scpi_reg_val_t val) {
     }
 #if OPTION_ETHERNET
     if (ethernet::g_testResult == TEST_OK) {
-        SCPI_RegSet(&ethernet::g_scpiContext, name, val);
+        for (int sessionIndex = 0; sessionIndex < ethernet::MAX_NUM_SESSIONS; sessionIndex++) {
+            SCPI_RegSet(&ethernet::getScpiContext(sessionIndex), name, val);
+        }
     }
 #endif
 }
@@ -201,7 +203,9 @@ void reg_set(scpi_psu_reg_name_t name, scpi_reg_val_t val) {
     }
 #if OPTION_ETHERNET
     if (ethernet::g_testResult == TEST_OK) {
-        reg_set(&ethernet::g_scpiContext, name, val);
+        for (int sessionIndex = 0; sessionIndex < ethernet::MAX_NUM_SESSIONS; sessionIndex++) {
+            reg_set(&ethernet::getScpiContext(sessionIndex), name, val);
+        }
     }
 #endif
 }
@@ -212,7 +216,9 @@ void reg_set_esr_bits(int bit_mask) {
     }
 #if OPTION_ETHERNET
     if (ethernet::g_testResult == TEST_OK) {
-        SCPI_RegSetBits(&ethernet::g_scpiContext, SCPI_REG_ESR, bit_mask);
+        for (int sessionIndex = 0; sessionIndex < ethernet::MAX_NUM_SESSIONS; sessionIndex++) {
+            SCPI_RegSetBits(&ethernet::getScpiContext(sessionIndex), SCPI_REG_ESR, bit_mask);
+        }
     }
 #endif
 }
@@ -240,7 +246,9 @@ void reg_set_ques_bit(int bit_mask, bool on) {
     }
 #if OPTION_ETHERNET
     if (ethernet::g_testResult == TEST_OK) {
-        reg_set_ques_bit(&ethernet::g_scpiContext, bit_mask, on);
+        for (int sessionIndex = 0; sessionIndex < ethernet::MAX_NUM_SESSIONS; sessionIndex++) {
+            reg_set_ques_bit(&ethernet::getScpiContext(sessionIndex), bit_mask, on);
+        }
     }
 #endif
 }
@@ -274,7 +282,9 @@ void reg_set_ques_isum_bit(int iChannel, int bit_mask, bool on) {
     }
 #if OPTION_ETHERNET
     if (ethernet::g_testResult == TEST_OK) {
-        reg_set_ques_isum_bit(&ethernet::g_scpiContext, iChannel, bit_mask, on);
+        for (int sessionIndex = 0; sessionIndex < ethernet::MAX_NUM_SESSIONS; sessionIndex++) {
+            reg_set_ques_isum_bit(&ethernet::getScpiContext(sessionIndex), iChannel, bit_mask, on);
+        }
     }
 #endif
 }
@@ -288,9 +298,13 @@ bool is_ques_bit_enabled(int channelIndex, int bit_mask) {
     }
 #if OPTION_ETHERNET
     if (ethernet::g_testResult == TEST_OK) {
-        scpi_reg_val_t val = reg_get(&ethernet::g_scpiContext, (scpi_psu_reg_name_t)(SCPI_PSU_CH_REG_QUES_INST_ISUM_EVENT1 + channelIndex));
-        if (!(val & bit_mask)) {
-            return false;
+        for (int sessionIndex = 0; sessionIndex < ethernet::MAX_NUM_SESSIONS; sessionIndex++) {
+            if (ethernet::isSessionConnected(sessionIndex)) {
+                scpi_reg_val_t val = reg_get(&ethernet::getScpiContext(sessionIndex), (scpi_psu_reg_name_t)(SCPI_PSU_CH_REG_QUES_INST_ISUM_EVENT1 + channelIndex));
+                if (!(val & bit_mask)) {
+                    return false;
+                }
+            }
         }
     }
 #endif
@@ -321,7 +335,9 @@ void reg_set_oper_bit(int bit_mask, bool on) {
     }
 #if OPTION_ETHERNET
     if (ethernet::g_testResult == TEST_OK) {
-        reg_set_oper_bit(&ethernet::g_scpiContext, bit_mask, on);
+        for (int sessionIndex = 0; sessionIndex < ethernet::MAX_NUM_SESSIONS; sessionIndex++) {
+            reg_set_oper_bit(&ethernet::getScpiContext(sessionIndex), bit_mask, on);
+        }
     }
 #endif
 }
@@ -356,7 +372,9 @@ void reg_set_oper_isum_bit(int iChannel, int bit_mask, bool on) {
     }
 #if OPTION_ETHERNET
     if (ethernet::g_testResult == TEST_OK) {
-        reg_set_oper_isum_bit(&ethernet::g_scpiContext, iChannel, bit_mask, on);
+        for (int sessionIndex = 0; sessionIndex < ethernet::MAX_NUM_SESSIONS; sessionIndex++) {
+            reg_set_oper_isum_bit(&ethernet::getScpiContext(sessionIndex), iChannel, bit_mask, on);
+        }
     }
 #endif
 }
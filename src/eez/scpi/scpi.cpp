@@ -55,7 +55,9 @@ void resetContext() {
 
 #if OPTION_ETHERNET
     if (psu::ethernet::g_testResult == TEST_OK) {
-        scpi::resetContext(&psu::ethernet::g_scpiContext);
+        for (int sessionIndex = 0; sessionIndex < psu::ethernet::MAX_NUM_SESSIONS; sessionIndex++) {
+            scpi::resetContext(&psu::ethernet::getScpiContext(sessionIndex));
+        }
     }
 #endif
 }
@@ -69,8 +71,12 @@ void generateError(int error) {
         }
 
 #if OPTION_ETHERNET
-        if (psu::ethernet::g_testResult == TEST_OK && psu::ethernet::isConnected()) {
-            SCPI_ErrorPush(&psu::ethernet::g_scpiContext, error);
+        if (psu::ethernet::g_testResult == TEST_OK) {
+            for (int sessionIndex = 0; sessionIndex < psu::ethernet::MAX_NUM_SESSIONS; sessionIndex++) {
+                if (psu::ethernet::isSessionConnected(sessionIndex)) {
+                    SCPI_ErrorPush(&psu::ethernet::getScpiContext(sessionIndex), error);
+                }
+            }
         }
 #endif
 
@@ -110,7 +110,7 @@ uint32_t micros() {
 #endif
 
 #if defined(EEZ_PLATFORM_SIMULATOR)
-	return osKernelSysTick() * 1000;
+	return osKernelSysTickMicros();
 #endif
 }
 
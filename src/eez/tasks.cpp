@@ -19,10 +19,12 @@
 #include <stdio.h> // sprintf
 
 #if defined(EEZ_PLATFORM_STM32)
+#include <main.h>
 #include <usbd_msc_bot.h>
 #endif
 
 #include <eez/tasks.h>
+#include <eez/message_queue.h>
 #include <eez/mp.h>
 #include <eez/sound.h>
 #include <eez/hmi.h>
@@ -79,11 +81,24 @@ namespace eez {
 
 #define CONF_SCREENSHOT_TIMEOUT_MS 2000
 
+// periodic work in the low priority thread (event queue, sound, persist conf, ...)
+#define CONF_LOW_PRIORITY_THREAD_TICK_PERIOD_MS 25
+
 ////////////////////////////////////////////////////////////////////////////////
 
-#define QUEUE_MESSAGE(type, param) (((param) << 8) | (type))
-#define QUEUE_MESSAGE_TYPE(message) ((message) & 0xFF)
-#define QUEUE_MESSAGE_PARAM(param) ((message) >> 8)
+struct ThreadMessage {
+    uint16_t type;
+    uint32_t param;
+    uint32_t sendTimeUs; // used only by the low priority thread
+};
+
+static bool isInterruptHandler() {
+#if defined(EEZ_PLATFORM_STM32)
+    return __get_IPSR() != 0;
+#else
+    return false;
+#endif
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -103,15 +118,14 @@ osThreadDef(g_highPriorityThread, highPriorityThreadMainLoop, osPriorityAboveNor
 osThreadId g_highPriorityThreadHandle;
 
 #if defined(EEZ_PLATFORM_STM32)
-#define HIGH_PRIORITY_QUEUE_SIZE 50
+#define HIGH_PRIORITY_QUEUE_SIZE 64
 #endif
 
 #if defined(EEZ_PLATFORM_SIMULATOR)
-#define HIGH_PRIORITY_QUEUE_SIZE 100
+#define HIGH_PRIORITY_QUEUE_SIZE 128
 #endif
 
-osMessageQDef(g_highPriorityMessageQueue, HIGH_PRIORITY_QUEUE_SIZE, uint32_t);
-osMessageQId g_highPriorityMessageQueueId;
+static MessageQueue<ThreadMessage, HIGH_PRIORITY_QUEUE_SIZE> g_highPriorityMessageQueue;
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -130,21 +144,23 @@ osThreadDef(g_lowPriorityTask, lowPriorityThreadMainLoop, osPriorityNormal, 0, 8
 #pragma GCC diagnostic pop
 #endif
 
-osMessageQDef(g_lowPriorityMessageQueue, LOW_PRIORITY_THREAD_QUEUE_SIZE, uint32_t);
-osMessageQId g_lowPriorityMessageQueueId;
+static MessageQueue<ThreadMessage, LOW_PRIORITY_THREAD_QUEUE_SIZE> g_lowPriorityMessageQueue;
+static MessageQueue<ThreadMessage, LOW_PRIORITY_THREAD_URGENT_QUEUE_SIZE> g_lowPriorityUrgentMessageQueue;
 
 static bool g_shutingDown;
 static bool g_isLowPriorityThreadAlive;
+static bool g_isLowPriorityThreadYielding;
 
 char g_listFilePath[CH_MAX][MAX_PATH_LENGTH];
 bool g_screenshotGenerating;
 
 static uint32_t g_timer1LastTickCountMs;
+static uint32_t g_lastLowPriorityThreadTickCountMs;
 
 ////////////////////////////////////////////////////////////////////////////////
 
 void initHighPriorityMessageQueue() {
-    g_highPriorityMessageQueueId = osMessageCreate(osMessageQ(g_highPriorityMessageQueue), 0);
+    g_highPriorityMessageQueue.init();
 }
 
 void startHighPriorityThread() {
@@ -170,17 +186,15 @@ void highPriorityThreadMainLoop(const void *) {
 }
 
 void highPriorityThreadOneIter() {
-    osEvent event = osMessageGet(g_highPriorityMessageQueueId, 1);
+    ThreadMessage message;
+    bool messageAvailable = g_highPriorityMessageQueue.get(message, 1);
 
 #if defined(EEZ_PLATFORM_STM32)
     static uint32_t g_lastTickCountMs;
 #endif
 
-    if (event.status == osEventMessage) {
-        uint32_t message = event.value.v;
-    	uint8_t type = QUEUE_MESSAGE_TYPE(message);
-        uint32_t param = QUEUE_MESSAGE_PARAM(message);
-        psu::onThreadMessage(type, param);
+    if (messageAvailable) {
+        psu::onThreadMessage((uint8_t)message.type, message.param);
 
 #if defined(EEZ_PLATFORM_STM32)
         uint32_t diffMs = millis() - g_lastTickCountMs;
@@ -215,11 +229,19 @@ bool isPsuThread() {
 }
 
 void sendMessageToPsu(HighPriorityThreadMessage messageType, uint32_t messageParam, uint32_t timeoutMillisec) {
-    if (!g_highPriorityMessageQueueId) {
+    if (!g_highPriorityMessageQueue.isInitialized()) {
         return;
     }
 
-    osMessagePut(g_highPriorityMessageQueueId, QUEUE_MESSAGE(messageType, messageParam), timeoutMillisec);
+    // can't wait for the free slot in the queue from the interrupt handler
+    if (isInterruptHandler()) {
+        timeoutMillisec = 0;
+    }
+
+    ThreadMessage message;
+    message.type = messageType;
+    message.param = messageParam;
+    g_highPriorityMessageQueue.put(message, timeoutMillisec);
 
 #if defined(EEZ_PLATFORM_SIMULATOR)
     // In simulator, force handling of PSU/High priority thread messages immediately - in STM32 this will be done automatically by the FreeRTOS.
@@ -231,13 +253,431 @@ void sendMessageToPsu(HighPriorityThreadMessage messageType, uint32_t messagePar
 
 ////////////////////////////////////////////////////////////////////////////////
 
+static void onSerialMessage(uint32_t type, uint32_t param) {
+    psu::serial::onQueueMessage(type, param);
+}
+
+#if OPTION_ETHERNET
+static void onEthernetMessage(uint32_t type, uint32_t param) {
+    psu::ethernet::onQueueMessage(type, param);
+}
+#endif
+
+static void onMpMessage(uint32_t type, uint32_t param) {
+    mp::onQueueMessage(type, param);
+}
+
+static void onSaveList(uint32_t type, uint32_t param) {
+    int err;
+    if (!psu::list::saveList(param, &g_listFilePath[param][0], &err)) {
+        generateError(err);
+    }
+}
+
+static void onShutdown(uint32_t type, uint32_t param) {
+    g_shutingDown = true;
+}
+
+#if defined(EEZ_PLATFORM_STM32)
+static void onSdDetectIrq(uint32_t type, uint32_t param) {
+    psu::sd_card::onSdDetectInterruptHandler();
+}
+#endif
+
+static void onDlogStateTransition(uint32_t type, uint32_t param) {
+    psu::dlog_record::stateTransition(param);
+}
+
+static void onDlogShowFile(uint32_t type, uint32_t param) {
+    psu::dlog_view::openFile(nullptr);
+}
+
+static void onDlogLoadBlock(uint32_t type, uint32_t param) {
+    psu::dlog_view::loadBlock();
+}
+
+static void onDlogBuildIndex(uint32_t type, uint32_t param) {
+    psu::dlog_view::buildIndex();
+}
+
+static void onAbortDownloading(uint32_t type, uint32_t param) {
+    psu::scpi::abortDownloading();
+}
+
+static void onScreenshot(uint32_t type, uint32_t param) {
+    using namespace psu;
+
+    if (!sd_card::isMounted(nullptr, nullptr)) {
+        g_screenshotGenerating = false;
+        generateError(SCPI_ERROR_MISSING_MASS_MEDIA);
+        return;
+    }
+
+    sound::playShutter();
+
+    const uint8_t *screenshotPixels = mcu::display::takeScreenshot();
+
+    unsigned char* imageData;
+    size_t imageDataSize;
+
+    if (jpegEncode(screenshotPixels, &imageData, &imageDataSize)) {
+        event_queue::pushEvent(SCPI_ERROR_OUT_OF_MEMORY_FOR_REQ_OP);
+        g_screenshotGenerating = false;
+        return;
+    }
+
+    char filePath[MAX_PATH_LENGTH + 1];
+    uint8_t year, month, day, hour, minute, second;
+    datetime::getDateTime(year, month, day, hour, minute, second);
+    if (persist_conf::devConf.dateTimeFormat == datetime::FORMAT_DMY_24) {
+        sprintf(filePath, "%s/%02d_%02d_%02d-%02d_%02d_%02d.jpg",
+            SCREENSHOTS_DIR,
+            (int)day, (int)month, (int)year,
+            (int)hour, (int)minute, (int)second);
+    } else if (persist_conf::devConf.dateTimeFormat == datetime::FORMAT_MDY_24) {
+        sprintf(filePath, "%s/%02d_%02d_%02d-%02d_%02d_%02d.jpg",
+            SCREENSHOTS_DIR,
+            (int)month, (int)day, (int)year,
+            (int)hour, (int)minute, (int)second);
+    } else if (persist_conf::devConf.dateTimeFormat == datetime::FORMAT_DMY_12) {
+        bool am;
+        datetime::convertTime24to12(hour, am);
+        sprintf(filePath, "%s/%02d_%02d_%02d-%02d_%02d_%02d_%s.jpg",
+            SCREENSHOTS_DIR,
+            (int)day, (int)month, (int)year,
+            (int)hour, (int)minute, (int)second, am ? "AM" : "PM");
+    } else if (persist_conf::devConf.dateTimeFormat == datetime::FORMAT_MDY_12) {
+        bool am;
+        datetime::convertTime24to12(hour, am);
+        sprintf(filePath, "%s/%02d_%02d_%02d-%02d_%02d_%02d_%s.jpg",
+            SCREENSHOTS_DIR,
+            (int)month, (int)day, (int)year,
+            (int)hour, (int)minute, (int)second, am ? "AM" : "PM");
+    }
+
+    uint32_t timeout = millis() + CONF_SCREENSHOT_TIMEOUT_MS;
+    while (millis() < timeout) {
+        File file;
+        if (file.open(filePath, FILE_CREATE_ALWAYS | FILE_WRITE)) {
+            size_t written = file.write(imageData, imageDataSize);
+            if (written == imageDataSize) {
+                if (file.close()) {
+                    // success!
+                    psu::gui::infoMessage("Screenshot saved");
+                    event_queue::pushEvent(event_queue::EVENT_INFO_SCREENSHOT_SAVED);
+                    onSdCardFileChangeHook(filePath);
+                    g_screenshotGenerating = false;
+                    return;
+                }
+            }
+        }
+
+        sd_card::reinitialize();
+    }
+
+    // timeout
+    event_queue::pushEvent(SCPI_ERROR_MASS_STORAGE_ERROR);
+    g_screenshotGenerating = false;
+}
+
+static void onFileManagerLoadDirectory(uint32_t type, uint32_t param) {
+    file_manager::doLoadDirectory();
+}
+
+static void onFileManagerUploadFile(uint32_t type, uint32_t param) {
+    file_manager::uploadFile();
+}
+
+static void onFileManagerOpenImageFile(uint32_t type, uint32_t param) {
+    file_manager::openImageFile();
+}
+
+static void onFileManagerOpenBitFile(uint32_t type, uint32_t param) {
+    file_manager::openBitFile();
+}
+
+static void onFileManagerDeleteFile(uint32_t type, uint32_t param) {
+    file_manager::deleteFile();
+}
+
+static void onFileManagerRenameFile(uint32_t type, uint32_t param) {
+    file_manager::doRenameFile();
+}
+
+static void onDlogUploadFile(uint32_t type, uint32_t param) {
+    psu::dlog_view::uploadFile();
+}
+
+static void onFlashSlaveUploadHexFile(uint32_t type, uint32_t param) {
+    bp3c::flash_slave::uploadHexFile();
+}
+
+static void onRecallProfile(uint32_t type, uint32_t param) {
+    int err;
+    if (!psu::profile::recallFromLocation(param, 0, false, &err)) {
+        generateError(err);
+    }
+}
+
+static void onListsPageImportList(uint32_t type, uint32_t param) {
+    psu::gui::ChSettingsListsPage::doImportList();
+}
+
+static void onListsPageExportList(uint32_t type, uint32_t param) {
+    psu::gui::ChSettingsListsPage::doExportList();
+}
+
+static void onLoadProfile(uint32_t type, uint32_t param) {
+    psu::profile::loadProfileParametersToCache(param);
+}
+
+static void onUserProfilesPageSave(uint32_t type, uint32_t param) {
+    psu::gui::UserProfilesPage::doSaveProfile();
+}
+
+static void onUserProfilesPageRecall(uint32_t type, uint32_t param) {
+    psu::gui::UserProfilesPage::doRecallProfile();
+}
+
+static void onUserProfilesPageImport(uint32_t type, uint32_t param) {
+    psu::gui::UserProfilesPage::doImportProfile();
+}
+
+static void onUserProfilesPageExport(uint32_t type, uint32_t param) {
+    psu::gui::UserProfilesPage::doExportProfile();
+}
+
+static void onUserProfilesPageDelete(uint32_t type, uint32_t param) {
+    psu::gui::UserProfilesPage::doDeleteProfile();
+}
+
+static void onUserProfilesPageEditRemark(uint32_t type, uint32_t param) {
+    psu::gui::UserProfilesPage::doEditRemark();
+}
+
+static void onSoundTick(uint32_t type, uint32_t param) {
+    sound::tick();
+}
+
+static void onSelectUsbMode(uint32_t type, uint32_t param) {
+    usb::selectUsbMode(param, g_otgMode);
+}
+
+static void onSelectUsbDeviceClass(uint32_t type, uint32_t param) {
+    usb::selectUsbDeviceClass(param);
+}
+
+static void onSelectUsbMassStorageDevice(uint32_t type, uint32_t param) {
+    usb::selectMassStorageDevice(param);
+}
+
+#if defined(EEZ_PLATFORM_STM32)
+static void onUsbdMscDataIn(uint32_t type, uint32_t param) {
+    MSC_BOT_DataIn(g_pdev, param);
+}
+
+static void onUsbdMscDataOut(uint32_t type, uint32_t param) {
+    MSC_BOT_DataOut(g_pdev, param);
+}
+#endif
+
+static void onGenerateError(uint32_t type, uint32_t param) {
+    generateError(param);
+}
+
+static void onLoadCustomLogo(uint32_t type, uint32_t param) {
+    psu::gui::loadCustomLogo();
+}
+
+static void onFsDriverLink(uint32_t type, uint32_t param) {
+    fs_driver::LinkDriver(param);
+}
+
+static void onFsDriverUnlink(uint32_t type, uint32_t param) {
+    fs_driver::UnLinkDriver(param);
+}
+
+static void onModuleSpecificMessage(uint32_t type, uint32_t param) {
+    int slotIndex = param & 0xff;
+    g_slots[slotIndex]->onLowPriorityThreadMessage(type, param);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct LowPriorityThreadMessageHandler {
+    uint16_t type;
+    bool urgent;
+    void (*handler)(uint32_t type, uint32_t param);
+    const char *name;
+};
+
+// Messages which must not wait behind the slow background jobs are urgent.
+// Serial, ethernet and MP messages are in the same lane so their order is preserved.
+static const LowPriorityThreadMessageHandler g_lowPriorityThreadMessageHandlers[] = {
+    { SERIAL_INPUT_AVAILABLE, false, onSerialMessage, "serial input" },
+    { SERIAL_LINE_STATE_CHANGED, false, onSerialMessage, "serial line state" },
+#if OPTION_ETHERNET
+    { ETHERNET_CONNECTED, false, onEthernetMessage, "ethernet connected" },
+    { ETHERNET_CLIENT_CONNECTED, false, onEthernetMessage, "ethernet client connected" },
+    { ETHERNET_CLIENT_DISCONNECTED, false, onEthernetMessage, "ethernet client disconnected" },
+    { ETHERNET_INPUT_AVAILABLE, false, onEthernetMessage, "ethernet input" },
+#endif
+    { MP_LOAD_SCRIPT, false, onMpMessage, "mp load script" },
+    { THREAD_MESSAGE_SAVE_LIST, false, onSaveList, "save list" },
+#if defined(EEZ_PLATFORM_STM32)
+    { THREAD_MESSAGE_SD_DETECT_IRQ, true, onSdDetectIrq, "sd detect" },
+#endif
+    { THREAD_MESSAGE_DLOG_STATE_TRANSITION, true, onDlogStateTransition, "dlog state transition" },
+    { THREAD_MESSAGE_DLOG_SHOW_FILE, false, onDlogShowFile, "dlog show file" },
+    { THREAD_MESSAGE_DLOG_LOAD_BLOCK, false, onDlogLoadBlock, "dlog load block" },
+    { THREAD_MESSAGE_DLOG_BUILD_INDEX, false, onDlogBuildIndex, "dlog build index" },
+    { THREAD_MESSAGE_ABORT_DOWNLOADING, true, onAbortDownloading, "abort downloading" },
+    { THREAD_MESSAGE_SCREENSHOT, false, onScreenshot, "screenshot" },
+    { THREAD_MESSAGE_FILE_MANAGER_LOAD_DIRECTORY, false, onFileManagerLoadDirectory, "file manager load directory" },
+    { THREAD_MESSAGE_FILE_MANAGER_UPLOAD_FILE, false, onFileManagerUploadFile, "file manager upload file" },
+    { THREAD_MESSAGE_FILE_MANAGER_OPEN_IMAGE_FILE, false, onFileManagerOpenImageFile, "file manager open image file" },
+    { THREAD_MESSAGE_FILE_MANAGER_OPEN_BIT_FILE, false, onFileManagerOpenBitFile, "file manager open bit file" },
+    { THREAD_MESSAGE_FILE_MANAGER_DELETE_FILE, false, onFileManagerDeleteFile, "file manager delete file" },
+    { THREAD_MESSAGE_FILE_MANAGER_RENAME_FILE, false, onFileManagerRenameFile, "file manager rename file" },
+    { THREAD_MESSAGE_DLOG_UPLOAD_FILE, false, onDlogUploadFile, "dlog upload file" },
+    { THREAD_MESSAGE_FLASH_SLAVE_UPLOAD_HEX_FILE, false, onFlashSlaveUploadHexFile, "flash slave upload hex file" },
+    { THREAD_MESSAGE_SHUTDOWN, false, onShutdown, "shutdown" },
+    { THREAD_MESSAGE_RECALL_PROFILE, false, onRecallProfile, "recall profile" },
+    { THREAD_MESSAGE_LISTS_PAGE_IMPORT_LIST, false, onListsPageImportList, "lists page import list" },
+    { THREAD_MESSAGE_LISTS_PAGE_EXPORT_LIST, false, onListsPageExportList, "lists page export list" },
+    { THREAD_MESSAGE_LOAD_PROFILE, false, onLoadProfile, "load profile" },
+    { THREAD_MESSAGE_USER_PROFILES_PAGE_SAVE, false, onUserProfilesPageSave, "user profiles page save" },
+    { THREAD_MESSAGE_USER_PROFILES_PAGE_RECALL, false, onUserProfilesPageRecall, "user profiles page recall" },
+    { THREAD_MESSAGE_USER_PROFILES_PAGE_IMPORT, false, onUserProfilesPageImport, "user profiles page import" },
+    { THREAD_MESSAGE_USER_PROFILES_PAGE_EXPORT, false, onUserProfilesPageExport, "user profiles page export" },
+    { THREAD_MESSAGE_USER_PROFILES_PAGE_DELETE, false, onUserProfilesPageDelete, "user profiles page delete" },
+    { THREAD_MESSAGE_USER_PROFILES_PAGE_EDIT_REMARK, false, onUserProfilesPageEditRemark, "user profiles page edit remark" },
+    { THREAD_MESSAGE_SOUND_TICK, true, onSoundTick, "sound tick" },
+    { THREAD_MESSAGE_SELECT_USB_MODE, false, onSelectUsbMode, "select usb mode" },
+    { THREAD_MESSAGE_SELECT_USB_DEVICE_CLASS, false, onSelectUsbDeviceClass, "select usb device class" },
+    { THREAD_MESSAGE_SELECT_USB_MASS_STORAGE_DEVICE, false, onSelectUsbMassStorageDevice, "select usb mass storage device" },
+#if defined(EEZ_PLATFORM_STM32)
+    { THREAD_MESSAGE_USBD_MSC_DATAIN, true, onUsbdMscDataIn, "usbd msc data in" },
+    { THREAD_MESSAGE_USBD_MSC_DATAOUT, true, onUsbdMscDataOut, "usbd msc data out" },
+#endif
+    { THREAD_MESSAGE_GENERATE_ERROR, true, onGenerateError, "generate error" },
+    { THREAD_MESSAGE_LOAD_CUSTOM_LOGO, false, onLoadCustomLogo, "load custom logo" },
+    { THREAD_MESSAGE_FS_DRIVER_LINK, false, onFsDriverLink, "fs driver link" },
+    { THREAD_MESSAGE_FS_DRIVER_UNLINK, false, onFsDriverUnlink, "fs driver unlink" },
+    { THREAD_MESSAGE_MODULE_SPECIFIC, false, onModuleSpecificMessage, "module specific" },
+};
+
+// index is message type, all module specific messages are at THREAD_MESSAGE_MODULE_SPECIFIC
+static const LowPriorityThreadMessageHandler *g_lowPriorityThreadMessageHandlerByType[THREAD_MESSAGE_MODULE_SPECIFIC + 1];
+
+struct MessageStatisticsData {
+    uint32_t count;
+    uint64_t totalWaitUs;
+    uint32_t maxWaitUs;
+    uint64_t totalRunUs;
+    uint32_t maxRunUs;
+};
+
+static MessageStatisticsData g_messageStatistics[THREAD_MESSAGE_MODULE_SPECIFIC + 1];
+static volatile bool g_messageStatisticsResetRequested;
+
+static const LowPriorityThreadMessageHandler *getLowPriorityThreadMessageHandler(uint32_t type) {
+    return g_lowPriorityThreadMessageHandlerByType[type < THREAD_MESSAGE_MODULE_SPECIFIC ? type : THREAD_MESSAGE_MODULE_SPECIFIC];
+}
+
+static void handleLowPriorityThreadMessage(const ThreadMessage &message) {
+    const LowPriorityThreadMessageHandler *handler = getLowPriorityThreadMessageHandler(message.type);
+    if (!handler) {
+        return;
+    }
+
+    if (g_messageStatisticsResetRequested) {
+        memset(g_messageStatistics, 0, sizeof(g_messageStatistics));
+        g_messageStatisticsResetRequested = false;
+    }
+
+    uint32_t startTimeUs = micros();
+
+    handler->handler(message.type, message.param);
+
+    uint32_t waitUs = startTimeUs - message.sendTimeUs;
+    uint32_t runUs = micros() - startTimeUs;
+
+    MessageStatisticsData &data = g_messageStatistics[message.type < THREAD_MESSAGE_MODULE_SPECIFIC ? message.type : THREAD_MESSAGE_MODULE_SPECIFIC];
+    data.count++;
+    data.totalWaitUs += waitUs;
+    if (waitUs > data.maxWaitUs) {
+        data.maxWaitUs = waitUs;
+    }
+    data.totalRunUs += runUs;
+    if (runUs > data.maxRunUs) {
+        data.maxRunUs = runUs;
+    }
+}
+
+static bool handleUrgentLowPriorityThreadMessages() {
+    bool messageHandled = false;
+    ThreadMessage message;
+    while (g_lowPriorityUrgentMessageQueue.tryGet(message)) {
+        handleLowPriorityThreadMessage(message);
+        messageHandled = true;
+    }
+    return messageHandled;
+}
+
+static void lowPriorityThreadTick() {
+    using namespace psu;
+
+    uint32_t tickCountMs = millis();
+    int32_t diff = tickCountMs - g_timer1LastTickCountMs;
+
+    event_queue::tick();
+
+    sound::tick();
+
+    if (diff >= 1000L) { // 1 sec
+        g_timer1LastTickCountMs = tickCountMs;
+
+        profile::tick();
+
+        ontime::g_mcuCounter.tick();
+        for (int slotIndex = 0; slotIndex < NUM_SLOTS; slotIndex++) {
+            if (g_slots[slotIndex]->moduleType != MODULE_TYPE_NONE) {
+                ontime::g_moduleCounters[slotIndex].tick();
+            }
+        }
+
+        mcu::battery::tick();
+    }
+
+    persist_conf::tick();
+
+    sd_card::tick();
+
+    eez::psu::dlog_view::tick();
+
+    eez::hmi::tick();
+
+    usb::tick();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 void initLowPriorityMessageQueue() {
-    g_lowPriorityMessageQueueId = osMessageCreate(osMessageQ(g_lowPriorityMessageQueue), 0);
+    for (size_t i = 0; i < sizeof(g_lowPriorityThreadMessageHandlers) / sizeof(LowPriorityThreadMessageHandler); i++) {
+        const LowPriorityThreadMessageHandler &handler = g_lowPriorityThreadMessageHandlers[i];
+        g_lowPriorityThreadMessageHandlerByType[handler.type] = &handler;
+    }
+
+    // both queues release the same semaphore, so the thread can wait for both
+    g_lowPriorityUrgentMessageQueue.init();
+    g_lowPriorityMessageQueue.init(g_lowPriorityUrgentMessageQueue.getSemaphore());
 }
 
 void startLowPriorityThread() {
     g_isLowPriorityThreadAlive = true;
     g_timer1LastTickCountMs = millis();
+    g_lastLowPriorityThreadTickCountMs = g_timer1LastTickCountMs;
     g_lowPriorityTaskHandle = osThreadCreate(osThread(g_lowPriorityTask), nullptr);
 }
 
@@ -262,227 +702,49 @@ void lowPriorityThreadMainLoop(const void *) {
 }
 
 void lowPriorityThreadOneIter() {
-    using namespace psu;
-
-    osEvent event = osMessageGet(g_lowPriorityMessageQueueId, 25);
-    if (event.status == osEventMessage) {
-    	uint32_t message = event.value.v;
-
-    	uint32_t type = QUEUE_MESSAGE_TYPE(message);
-    	uint32_t param = QUEUE_MESSAGE_PARAM(message);
-        
-        if (type < SERIAL_LAST_MESSAGE_TYPE) {
-            serial::onQueueMessage(type, param);
-        }
-#if OPTION_ETHERNET
-        else if (type < ETHERNET_LAST_MESSAGE_TYPE) {
-            ethernet::onQueueMessage(type, param);
-        }
-#endif  
-        else if (type < MP_LAST_MESSAGE_TYPE) {
-            mp::onQueueMessage(type, param);
-        } else {
-            if (type == THREAD_MESSAGE_SAVE_LIST) {
-                int err;
-                if (!list::saveList(param, &g_listFilePath[param][0], &err)) {
-                    generateError(err);
-                }
-            } else if (type == THREAD_MESSAGE_SHUTDOWN) {
-                g_shutingDown = true;
-            }
-#if defined(EEZ_PLATFORM_STM32)
-			else if (type == THREAD_MESSAGE_SD_DETECT_IRQ) {
-				sd_card::onSdDetectInterruptHandler();
-			}
-#endif
-            else if (type == THREAD_MESSAGE_DLOG_STATE_TRANSITION) {
-                dlog_record::stateTransition(param);
-            } else if (type == THREAD_MESSAGE_DLOG_SHOW_FILE) {
-                dlog_view::openFile(nullptr);
-            } else if (type == THREAD_MESSAGE_DLOG_LOAD_BLOCK) {
-                dlog_view::loadBlock();
-            } else if (type == THREAD_MESSAGE_ABORT_DOWNLOADING) {
-                psu::scpi::abortDownloading();
-            } else if (type == THREAD_MESSAGE_SCREENSHOT) {
-                if (!sd_card::isMounted(nullptr, nullptr)) {
-                    g_screenshotGenerating = false;
-                    generateError(SCPI_ERROR_MISSING_MASS_MEDIA);
-                    return;
-                }
-
-                sound::playShutter();
+    // All urgent messages, and then at most one background message.
+    bool messageHandled = handleUrgentLowPriorityThreadMessages();
 
-                const uint8_t *screenshotPixels = mcu::display::takeScreenshot();
-
-                unsigned char* imageData;
-                size_t imageDataSize;
-
-                if (jpegEncode(screenshotPixels, &imageData, &imageDataSize)) {
-                    event_queue::pushEvent(SCPI_ERROR_OUT_OF_MEMORY_FOR_REQ_OP);
-                    g_screenshotGenerating = false;
-                    return;
-                }
-
-                char filePath[MAX_PATH_LENGTH + 1];
-                uint8_t year, month, day, hour, minute, second;
-                datetime::getDateTime(year, month, day, hour, minute, second);
-                if (persist_conf::devConf.dateTimeFormat == datetime::FORMAT_DMY_24) {
-                    sprintf(filePath, "%s/%02d_%02d_%02d-%02d_%02d_%02d.jpg",
-                        SCREENSHOTS_DIR,
-                        (int)day, (int)month, (int)year,
-                        (int)hour, (int)minute, (int)second);
-                } else if (persist_conf::devConf.dateTimeFormat == datetime::FORMAT_MDY_24) {
-                    sprintf(filePath, "%s/%02d_%02d_%02d-%02d_%02d_%02d.jpg",
-                        SCREENSHOTS_DIR,
-                        (int)month, (int)day, (int)year,
-                        (int)hour, (int)minute, (int)second);
-                } else if (persist_conf::devConf.dateTimeFormat == datetime::FORMAT_DMY_12) {
-                    bool am;
-                    datetime::convertTime24to12(hour, am);
-                    sprintf(filePath, "%s/%02d_%02d_%02d-%02d_%02d_%02d_%s.jpg",
-                        SCREENSHOTS_DIR,
-                        (int)day, (int)month, (int)year,
-                        (int)hour, (int)minute, (int)second, am ? "AM" : "PM");
-                } else if (persist_conf::devConf.dateTimeFormat == datetime::FORMAT_MDY_12) {
-                    bool am;
-                    datetime::convertTime24to12(hour, am);
-                    sprintf(filePath, "%s/%02d_%02d_%02d-%02d_%02d_%02d_%s.jpg",
-                        SCREENSHOTS_DIR,
-                        (int)month, (int)day, (int)year,
-                        (int)hour, (int)minute, (int)second, am ? "AM" : "PM");
-                }
-
-                uint32_t timeout = millis() + CONF_SCREENSHOT_TIMEOUT_MS;
-                while (millis() < timeout) {
-                    File file;
-                    if (file.open(filePath, FILE_CREATE_ALWAYS | FILE_WRITE)) {
-                        size_t written = file.write(imageData, imageDataSize);
-                        if (written == imageDataSize) {
-                            if (file.close()) {
-                                // success!
-                                psu::gui::infoMessage("Screenshot saved");
-                                event_queue::pushEvent(event_queue::EVENT_INFO_SCREENSHOT_SAVED);
-                                onSdCardFileChangeHook(filePath);
-                                g_screenshotGenerating = false;
-                                return;
-                            }
-                        }
-                    }
-
-                    sd_card::reinitialize();
-                }
+    ThreadMessage message;
+    if (g_lowPriorityMessageQueue.tryGet(message)) {
+        handleLowPriorityThreadMessage(message);
+        messageHandled = true;
+    }
 
-                // timeout
-                event_queue::pushEvent(SCPI_ERROR_MASS_STORAGE_ERROR);
-                g_screenshotGenerating = false;
-            } else if (type == THREAD_MESSAGE_FILE_MANAGER_LOAD_DIRECTORY) {
-                file_manager::doLoadDirectory();
-            } else if (type == THREAD_MESSAGE_FILE_MANAGER_UPLOAD_FILE) {
-                file_manager::uploadFile();
-            } else if (type == THREAD_MESSAGE_FILE_MANAGER_OPEN_IMAGE_FILE) {
-                file_manager::openImageFile();
-            } else if (type == THREAD_MESSAGE_FILE_MANAGER_OPEN_BIT_FILE) {
-                file_manager::openBitFile();
-            } else if (type == THREAD_MESSAGE_FILE_MANAGER_DELETE_FILE) {
-                file_manager::deleteFile();
-            } else if (type == THREAD_MESSAGE_FILE_MANAGER_RENAME_FILE) {
-                file_manager::doRenameFile();
-            } else if (type == THREAD_MESSAGE_DLOG_UPLOAD_FILE) {
-                dlog_view::uploadFile();
-            } else if (type == THREAD_MESSAGE_FLASH_SLAVE_UPLOAD_HEX_FILE) {
-                bp3c::flash_slave::uploadHexFile();
-            } else if (type == THREAD_MESSAGE_RECALL_PROFILE) {
-                int err;
-                if (!profile::recallFromLocation(param, 0, false, &err)) {
-                    generateError(err);
-                }
-            } else if (type == THREAD_MESSAGE_LISTS_PAGE_IMPORT_LIST) {
-                psu::gui::ChSettingsListsPage::doImportList();
-            } else if (type == THREAD_MESSAGE_LISTS_PAGE_EXPORT_LIST) {
-                psu::gui::ChSettingsListsPage::doExportList();
-            } else if (type == THREAD_MESSAGE_LOAD_PROFILE) {
-                profile::loadProfileParametersToCache(param);
-            } else if (type == THREAD_MESSAGE_USER_PROFILES_PAGE_SAVE) {
-                psu::gui::UserProfilesPage::doSaveProfile();
-            } else if (type == THREAD_MESSAGE_USER_PROFILES_PAGE_RECALL) {
-                psu::gui::UserProfilesPage::doRecallProfile();
-            } else if (type == THREAD_MESSAGE_USER_PROFILES_PAGE_IMPORT) {
-                psu::gui::UserProfilesPage::doImportProfile();
-            } else if (type == THREAD_MESSAGE_USER_PROFILES_PAGE_EXPORT) {
-                psu::gui::UserProfilesPage::doExportProfile();
-            } else if (type == THREAD_MESSAGE_USER_PROFILES_PAGE_DELETE) {
-                psu::gui::UserProfilesPage::doDeleteProfile();
-            } else if (type == THREAD_MESSAGE_USER_PROFILES_PAGE_EDIT_REMARK) {
-                psu::gui::UserProfilesPage::doEditRemark();
-            } else if (type == THREAD_MESSAGE_SOUND_TICK) {
-                sound::tick();
-            } else if (type == THREAD_MESSAGE_SELECT_USB_MODE) {
-                usb::selectUsbMode(param, g_otgMode);
-            } else if (type == THREAD_MESSAGE_SELECT_USB_DEVICE_CLASS) {
-                usb::selectUsbDeviceClass(param);
-            } else if (type == THREAD_MESSAGE_SELECT_USB_MASS_STORAGE_DEVICE) {
-                usb::selectMassStorageDevice(param);
-            } 
-#if defined(EEZ_PLATFORM_STM32)
-            else if (type == THREAD_MESSAGE_USBD_MSC_DATAIN) {
-                MSC_BOT_DataIn(g_pdev, param);
-            } else if (type == THREAD_MESSAGE_USBD_MSC_DATAOUT) {
-                MSC_BOT_DataOut(g_pdev, param);
-            }
-#endif 
-            else if (type == THREAD_MESSAGE_GENERATE_ERROR) {
-                generateError(param);
-            } else if (type == THREAD_MESSAGE_LOAD_CUSTOM_LOGO) {
-                psu::gui::loadCustomLogo();
-            } else if (type >= THREAD_MESSAGE_MODULE_SPECIFIC) {
-                int slotIndex = param & 0xff;
-                g_slots[slotIndex]->onLowPriorityThreadMessage(type, param);
-            }
-            else if (type == THREAD_MESSAGE_FS_DRIVER_LINK) {
-                fs_driver::LinkDriver(param);
-            } else if (type == THREAD_MESSAGE_FS_DRIVER_UNLINK) {
-                fs_driver::UnLinkDriver(param);
-            }
-        }
-    } else {
+    bool timeout = false;
+    if (!messageHandled) {
         if (g_shutingDown) {
             g_isLowPriorityThreadAlive = false;
             return;
         }
-        uint32_t tickCountMs = millis();
-    	int32_t diff = tickCountMs - g_timer1LastTickCountMs;
-
-        event_queue::tick();
-
-        sound::tick();
-
-    	if (diff >= 1000L) { // 1 sec
-            g_timer1LastTickCountMs = tickCountMs;
-
-    		profile::tick();
 
-            ontime::g_mcuCounter.tick();
-            for (int slotIndex = 0; slotIndex < NUM_SLOTS; slotIndex++) {
-                if (g_slots[slotIndex]->moduleType != MODULE_TYPE_NONE) {
-                    ontime::g_moduleCounters[slotIndex].tick();
-                }
-            }
+        timeout = !g_lowPriorityMessageQueue.wait(CONF_LOW_PRIORITY_THREAD_TICK_PERIOD_MS);
+    }
 
-            mcu::battery::tick();
-    	}
+    // DLOG record buffer is written between any two background messages,
+    // so it can't overflow while the queue is busy
+    eez::psu::dlog_record::fileWrite();
 
-        persist_conf::tick();
+    // periodic work is also done while the queue is busy, but not more often than when it is idle
+    uint32_t tickCountMs = millis();
+    if (timeout || tickCountMs - g_lastLowPriorityThreadTickCountMs >= CONF_LOW_PRIORITY_THREAD_TICK_PERIOD_MS) {
+        g_lastLowPriorityThreadTickCountMs = tickCountMs;
+        lowPriorityThreadTick();
+    }
+}
 
-        sd_card::tick();
+void yieldLowPriorityThread() {
+    if (g_isLowPriorityThreadYielding || !g_isBooted || !isLowPriorityThread()) {
+        return;
+    }
 
-        eez::psu::dlog_record::fileWrite();
+    g_isLowPriorityThreadYielding = true;
 
-        eez::hmi::tick();
+    handleUrgentLowPriorityThreadMessages();
 
-        usb::tick();
-    }
+    eez::psu::dlog_record::fileWrite();
 
-    return;
+    g_isLowPriorityThreadYielding = false;
 }
 
 bool isLowPriorityThreadAlive() {
@@ -494,10 +756,65 @@ bool isLowPriorityThread() {
 }
 
 void sendMessageToLowPriorityThread(LowPriorityThreadMessage messageType, uint32_t messageParam, uint32_t timeoutMillisec) {
-    if (!g_lowPriorityMessageQueueId) {
+    if (!g_lowPriorityMessageQueue.isInitialized()) {
         return;
     }
-    osMessagePut(g_lowPriorityMessageQueueId, QUEUE_MESSAGE(messageType, messageParam), timeoutMillisec);
+
+    // Can't wait for the free slot in the queue from the interrupt handler,
+    // and low priority thread would wait for itself.
+    if (isInterruptHandler() || (g_isBooted && isLowPriorityThread())) {
+        timeoutMillisec = 0;
+    }
+
+    ThreadMessage message;
+    message.type = messageType;
+    message.param = messageParam;
+    message.sendTimeUs = micros();
+
+    const LowPriorityThreadMessageHandler *handler = getLowPriorityThreadMessageHandler(messageType);
+    if (handler && handler->urgent) {
+        g_lowPriorityUrgentMessageQueue.put(message, timeoutMillisec);
+    } else {
+        g_lowPriorityMessageQueue.put(message, timeoutMillisec);
+    }
+}
+
+void getHighPriorityMessageQueueStatistics(MessageQueueStatistics &statistics) {
+    g_highPriorityMessageQueue.getStatistics(statistics);
+}
+
+void getLowPriorityMessageQueueStatistics(MessageQueueStatistics &statistics) {
+    g_lowPriorityMessageQueue.getStatistics(statistics);
+}
+
+void getLowPriorityUrgentMessageQueueStatistics(MessageQueueStatistics &statistics) {
+    g_lowPriorityUrgentMessageQueue.getStatistics(statistics);
+}
+
+bool getLowPriorityThreadMessageStatistics(int messageType, LowPriorityThreadMessageStatistics &statistics) {
+    const LowPriorityThreadMessageHandler *handler = getLowPriorityThreadMessageHandler(messageType);
+    if (!handler) {
+        return false;
+    }
+
+    const MessageStatisticsData &data = g_messageStatistics[messageType < THREAD_MESSAGE_MODULE_SPECIFIC ? messageType : THREAD_MESSAGE_MODULE_SPECIFIC];
+
+    statistics.name = handler->name;
+    statistics.urgent = handler->urgent;
+    statistics.count = data.count;
+    statistics.avgWaitUs = data.count > 0 ? (uint32_t)(data.totalWaitUs / data.count) : 0;
+    statistics.maxWaitUs = data.maxWaitUs;
+    statistics.avgRunUs = data.count > 0 ? (uint32_t)(data.totalRunUs / data.count) : 0;
+    statistics.maxRunUs = data.maxRunUs;
+
+    return true;
+}
+
+void resetMessageQueueStatistics() {
+    g_highPriorityMessageQueue.resetStatistics();
+    g_lowPriorityMessageQueue.resetStatistics();
+    g_lowPriorityUrgentMessageQueue.resetStatistics();
+    g_messageStatisticsResetRequested = true;
 }
 
 } // namespace eez
@@ -22,7 +22,12 @@
 
 namespace eez {
 
-#define LOW_PRIORITY_THREAD_QUEUE_SIZE 10
+// Low priority thread has two queues (lanes): urgent messages (DLOG state
+// transitions, SD card detect, USB mass storage transfers, ...) are always
+// handled before the next background message (SCPI input, file manager,
+// profiles, screenshots, ...). Both sizes must be power of 2.
+#define LOW_PRIORITY_THREAD_QUEUE_SIZE 64
+#define LOW_PRIORITY_THREAD_URGENT_QUEUE_SIZE 32
 
 enum HighPriorityThreadMessage {
     PSU_MESSAGE_TICK,
@@ -87,6 +92,7 @@ enum LowPriorityThreadMessage {
     THREAD_MESSAGE_DLOG_STATE_TRANSITION,
     THREAD_MESSAGE_DLOG_SHOW_FILE,
     THREAD_MESSAGE_DLOG_LOAD_BLOCK,
+    THREAD_MESSAGE_DLOG_BUILD_INDEX,
     THREAD_MESSAGE_ABORT_DOWNLOADING,
     THREAD_MESSAGE_SCREENSHOT,
     THREAD_MESSAGE_FILE_MANAGER_LOAD_DIRECTORY,
@@ -140,4 +146,31 @@ bool isLowPriorityThread();
 
 void sendMessageToLowPriorityThread(LowPriorityThreadMessage messageType, uint32_t messageParam = 0, uint32_t timeoutMillisec = osWaitForever);
 
+// Long running jobs in the low priority thread should call this periodically:
+// urgent messages are handled and DLOG record buffer is written to the file.
+// Jobs which can be split into steps should instead send the message to
+// itself after each step (see dlog_view::buildIndex).
+void yieldLowPriorityThread();
+
+struct MessageQueueStatistics;
+void getHighPriorityMessageQueueStatistics(MessageQueueStatistics &statistics);
+void getLowPriorityMessageQueueStatistics(MessageQueueStatistics &statistics);
+void getLowPriorityUrgentMessageQueueStatistics(MessageQueueStatistics &statistics);
+
+struct LowPriorityThreadMessageStatistics {
+    const char *name;
+    bool urgent;
+    uint32_t count;
+    uint32_t avgWaitUs; // time from send until handler is called
+    uint32_t maxWaitUs;
+    uint32_t avgRunUs; // handler execution time
+    uint32_t maxRunUs;
+};
+
+// All module specific messages are counted together at THREAD_MESSAGE_MODULE_SPECIFIC,
+// returns false for message types without handler.
+bool getLowPriorityThreadMessageStatistics(int messageType, LowPriorityThreadMessageStatistics &statistics);
+
+void resetMessageQueueStatistics();
+
 } // namespace eez
\ No newline at end of file
@@ -213,7 +213,7 @@ void selectUsbMode(int usbMode, int otgMode) {
     }
 #endif
 
-#if defined(EEZ_PLATFORM_SIMULATOR)
+#if defined(EEZ_PLATFORM_SIMULATOR) && !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
     if (g_usbMode == USB_MODE_HOST || g_usbMode == USB_MODE_OTG) {
         SDL_ShowCursor(SDL_ENABLE);
         SDL_CaptureMouse(SDL_FALSE);
@@ -233,7 +233,7 @@ void selectUsbMode(int usbMode, int otgMode) {
     taskEXIT_CRITICAL();
 #endif
 
-#if defined(EEZ_PLATFORM_SIMULATOR)
+#if defined(EEZ_PLATFORM_SIMULATOR) && !defined(EEZ_PLATFORM_SIMULATOR_HEADLESS)
     if (g_usbMode == USB_MODE_HOST || g_usbMode == USB_MODE_OTG) {
         SDL_ShowCursor(SDL_DISABLE);
         SDL_CaptureMouse(SDL_TRUE);
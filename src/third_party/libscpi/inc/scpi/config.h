@@ -110,6 +110,10 @@ extern "C" {
 #define USE_COMMAND_TAGS 1
 #endif
 
+#ifndef SCPI_COMMAND_INDEX_BUCKETS
+#define SCPI_COMMAND_INDEX_BUCKETS 256
+#endif
+
 #ifndef USE_DEPRECATED_FUNCTIONS
 #define USE_DEPRECATED_FUNCTIONS 1
 #endif
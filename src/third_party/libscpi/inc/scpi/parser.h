@@ -55,6 +55,10 @@ extern "C" {
     void SCPI_InitHeap(scpi_t * context, char * error_info_heap, size_t error_info_heap_length);
 #endif
 
+    scpi_bool_t SCPI_CommandIndexInit(scpi_command_index_t * index, const scpi_command_t * cmdlist, uint16_t * entries, size_t entries_len);
+    void SCPI_SetCommandIndex(scpi_t * context, const scpi_command_index_t * index);
+    const scpi_command_t * SCPI_FindCommand(const scpi_command_t * cmdlist, const scpi_command_index_t * index, const char * header, int len);
+
     scpi_bool_t SCPI_Input(scpi_t * context, const char * data, int len);
     scpi_bool_t SCPI_Parse(scpi_t * context, char * data, int len);
 
@@ -356,6 +356,20 @@ extern "C" {
 #endif /* USE_COMMAND_TAGS */
     };
 
+    /**
+     * Command lookup index. Commands are distributed into buckets by the
+     * first two characters of the first and the last header mnemonic, so
+     * only a few patterns have to be matched for each command header.
+     * Bucket SCPI_COMMAND_INDEX_BUCKETS holds commands which can't be
+     * indexed and it is always searched.
+     */
+    struct _scpi_command_index_t {
+        const scpi_command_t * cmdlist;
+        uint16_t bucket[SCPI_COMMAND_INDEX_BUCKETS + 2];
+        uint16_t * entries;
+    };
+    typedef struct _scpi_command_index_t scpi_command_index_t;
+
     struct _scpi_interface_t {
         scpi_error_callback_t error;
         scpi_write_t write;
@@ -382,6 +396,7 @@ extern "C" {
         scpi_parser_state_t parser_state;
         const char * idn[4];
         size_t arbitrary_reminding;
+        const scpi_command_index_t * cmdindex;
     };
 
     enum _scpi_array_format_t {
@@ -165,17 +165,291 @@ static scpi_bool_t processCommand(scpi_t * context) {
  * @result TRUE if context->paramlist is filled with correct values
  */
 static scpi_bool_t findCommandHeader(scpi_t * context, const char * header, int len) {
-    int32_t i;
-    const scpi_command_t * cmd;
+    const scpi_command_t * cmd = SCPI_FindCommand(context->cmdlist, context->cmdindex, header, len);
+    if (cmd) {
+        context->param_list.cmd = cmd;
+        return TRUE;
+    }
+    return FALSE;
+}
 
-    for (i = 0; context->cmdlist[i].pattern != NULL; i++) {
-        cmd = &context->cmdlist[i];
-        if (matchCommand(cmd->pattern, header, len, NULL, 0, 0)) {
-            context->param_list.cmd = cmd;
-            return TRUE;
+#define COMMAND_INDEX_MAX_NODES 16
+#define COMMAND_INDEX_MAX_KEYS 16
+#define COMMAND_INDEX_NONE 0xFFFF
+
+/**
+ * Calculate command index bucket from the first two characters of the
+ * first and the last mnemonic
+ */
+static uint16_t commandIndexBucket(scpi_bool_t query, const char * first, size_t first_len, const char * last, size_t last_len) {
+    uint32_t hash = query ? 1 : 0;
+    hash = hash * 31 + (first_len > 0 ? toupper((unsigned char) first[0]) : 0);
+    hash = hash * 31 + (first_len > 1 ? toupper((unsigned char) first[1]) : 0);
+    hash = hash * 31 + (last_len > 0 ? toupper((unsigned char) last[0]) : 0);
+    hash = hash * 31 + (last_len > 1 ? toupper((unsigned char) last[1]) : 0);
+    return hash % SCPI_COMMAND_INDEX_BUCKETS;
+}
+
+/**
+ * Find all the buckets command pattern belongs to. Header can start with
+ * any optional mnemonic up to the first mandatory one and can end with
+ * any mnemonic from the last mandatory one.
+ * @param pattern
+ * @param buckets - output array
+ * @return number of buckets or 0 if pattern can't be indexed
+ */
+static size_t commandIndexPatternBuckets(const char * pattern, uint16_t * buckets) {
+    const char * node[COMMAND_INDEX_MAX_NODES];
+    size_t node_len[COMMAND_INDEX_MAX_NODES];
+    size_t node_short_len[COMMAND_INDEX_MAX_NODES];
+    scpi_bool_t node_optional[COMMAND_INDEX_MAX_NODES];
+    size_t num_nodes = 0;
+    size_t len = strlen(pattern);
+    scpi_bool_t query = FALSE;
+    int brackets = 0;
+    size_t i, j, k;
+    size_t first_mandatory;
+    size_t last_mandatory;
+    size_t num_buckets = 0;
+
+    if (len > 0 && pattern[len - 1] == '?') {
+        query = TRUE;
+        len--;
+    }
+
+    for (i = 0; i < len;) {
+        if (pattern[i] == '[') {
+            brackets++;
+            i++;
+        } else if (pattern[i] == ']') {
+            brackets--;
+            i++;
+        } else if (pattern[i] == ':') {
+            i++;
+        } else {
+            size_t short_len = 0;
+
+            if (num_nodes == COMMAND_INDEX_MAX_NODES) {
+                return 0;
+            }
+
+            node[num_nodes] = pattern + i;
+            node_optional[num_nodes] = brackets > 0;
+            for (j = i; j < len && !strchr("[]:", pattern[j]); j++) {
+                if (short_len == j - i && !islower((unsigned char) pattern[j]) && pattern[j] != '#') {
+                    short_len++;
+                }
+            }
+            node_len[num_nodes] = j - i;
+            node_short_len[num_nodes] = short_len;
+
+            num_nodes++;
+            i = j;
         }
     }
-    return FALSE;
+
+    if (num_nodes == 0) {
+        return 0;
+    }
+
+    first_mandatory = num_nodes - 1;
+    for (i = 0; i < num_nodes; i++) {
+        if (!node_optional[i]) {
+            first_mandatory = i;
+            break;
+        }
+    }
+
+    last_mandatory = 0;
+    for (i = num_nodes; i > 0; i--) {
+        if (!node_optional[i - 1]) {
+            last_mandatory = i - 1;
+            break;
+        }
+    }
+
+    for (i = 0; i <= first_mandatory; i++) {
+        for (j = last_mandatory; j < num_nodes; j++) {
+            uint16_t bucket;
+            if (j < i) {
+                continue;
+            }
+            /* short form of the key mnemonics must have at least two characters */
+            if (node_short_len[i] < 2 || node_short_len[j] < 2) {
+                return 0;
+            }
+            bucket = commandIndexBucket(query, node[i], node_len[i], node[j], node_len[j]);
+            for (k = 0; k < num_buckets; k++) {
+                if (buckets[k] == bucket) {
+                    break;
+                }
+            }
+            if (k == num_buckets) {
+                if (num_buckets == COMMAND_INDEX_MAX_KEYS) {
+                    return 0;
+                }
+                buckets[num_buckets++] = bucket;
+            }
+        }
+    }
+
+    return num_buckets;
+}
+
+/**
+ * Find bucket of the command header
+ */
+static uint16_t commandIndexHeaderBucket(const char * header, int len) {
+    scpi_bool_t query = FALSE;
+    const char * first;
+    size_t first_len;
+    const char * last;
+    size_t last_len;
+    int i;
+
+    if (len > 0 && header[len - 1] == '?') {
+        query = TRUE;
+        len--;
+    }
+
+    if (len > 0 && header[0] == ':') {
+        header++;
+        len--;
+    }
+
+    first = header;
+    for (i = 0; i < len && header[i] != ':'; i++) {
+    }
+    first_len = i;
+
+    for (i = len; i > 0 && header[i - 1] != ':'; i--) {
+    }
+    last = header + i;
+    last_len = len - i;
+
+    return commandIndexBucket(query, first, first_len, last, last_len);
+}
+
+/**
+ * Build command lookup index
+ * @param index
+ * @param cmdlist - command list terminated with SCPI_CMD_LIST_END
+ * @param entries - storage for the index entries
+ * @param entries_len - number of entries in storage
+ * @return FALSE if storage is too small
+ */
+scpi_bool_t SCPI_CommandIndexInit(scpi_command_index_t * index, const scpi_command_t * cmdlist, uint16_t * entries, size_t entries_len) {
+    uint16_t buckets[COMMAND_INDEX_MAX_KEYS];
+    size_t num_buckets;
+    size_t i, j;
+    uint32_t total;
+
+    memset(index, 0, sizeof(*index));
+
+    /* count entries in each bucket */
+    for (i = 0; cmdlist[i].pattern != NULL; i++) {
+        if (i >= COMMAND_INDEX_NONE) {
+            return FALSE;
+        }
+
+        num_buckets = commandIndexPatternBuckets(cmdlist[i].pattern, buckets);
+        if (num_buckets == 0) {
+            buckets[0] = SCPI_COMMAND_INDEX_BUCKETS;
+            num_buckets = 1;
+        }
+
+        for (j = 0; j < num_buckets; j++) {
+            index->bucket[buckets[j]]++;
+        }
+    }
+
+    /* convert counts to bucket starts */
+    total = 0;
+    for (i = 0; i < SCPI_COMMAND_INDEX_BUCKETS + 2; i++) {
+        uint16_t count = index->bucket[i];
+        index->bucket[i] = total;
+        total += count;
+    }
+
+    if (total > entries_len || total >= COMMAND_INDEX_NONE) {
+        return FALSE;
+    }
+
+    /* fill entries, afterwards each bucket start points to the start of the next bucket */
+    for (i = 0; cmdlist[i].pattern != NULL; i++) {
+        num_buckets = commandIndexPatternBuckets(cmdlist[i].pattern, buckets);
+        if (num_buckets == 0) {
+            buckets[0] = SCPI_COMMAND_INDEX_BUCKETS;
+            num_buckets = 1;
+        }
+
+        for (j = 0; j < num_buckets; j++) {
+            entries[index->bucket[buckets[j]]++] = i;
+        }
+    }
+
+    for (i = SCPI_COMMAND_INDEX_BUCKETS + 1; i > 0; i--) {
+        index->bucket[i] = index->bucket[i - 1];
+    }
+    index->bucket[0] = 0;
+
+    index->cmdlist = cmdlist;
+    index->entries = entries;
+
+    return TRUE;
+}
+
+/**
+ * Use command index for the command lookup
+ * @param context
+ * @param index - index built with SCPI_CommandIndexInit from the context cmdlist or NULL
+ */
+void SCPI_SetCommandIndex(scpi_t * context, const scpi_command_index_t * index) {
+    context->cmdindex = index;
+}
+
+/**
+ * Find command matching the header, same as the first matching command in the cmdlist
+ * @param cmdlist
+ * @param index - lookup index or NULL for the linear search
+ * @param header
+ * @param len
+ * @return command or NULL if not found
+ */
+const scpi_command_t * SCPI_FindCommand(const scpi_command_t * cmdlist, const scpi_command_index_t * index, const char * header, int len) {
+    uint16_t bucket;
+    uint16_t found = COMMAND_INDEX_NONE;
+    uint16_t i;
+    int32_t cmd;
+
+    if (index == NULL) {
+        for (cmd = 0; cmdlist[cmd].pattern != NULL; cmd++) {
+            if (matchCommand(cmdlist[cmd].pattern, header, len, NULL, 0, 0)) {
+                return &cmdlist[cmd];
+            }
+        }
+        return NULL;
+    }
+
+    /* entries are sorted inside the bucket, so the first match has the lowest command index */
+    bucket = commandIndexHeaderBucket(header, len);
+    for (i = index->bucket[bucket]; i < index->bucket[bucket + 1]; i++) {
+        if (matchCommand(cmdlist[index->entries[i]].pattern, header, len, NULL, 0, 0)) {
+            found = index->entries[i];
+            break;
+        }
+    }
+
+    /* commands which are not indexed */
+    bucket = SCPI_COMMAND_INDEX_BUCKETS;
+    for (i = index->bucket[bucket]; i < index->bucket[bucket + 1] && index->entries[i] < found; i++) {
+        if (matchCommand(cmdlist[index->entries[i]].pattern, header, len, NULL, 0, 0)) {
+            found = index->entries[i];
+            break;
+        }
+    }
+
+    return found != COMMAND_INDEX_NONE ? &cmdlist[found] : NULL;
 }
 
 /**
@@ -626,19 +900,24 @@ size_t SCPI_ResultArbitraryBlockHeader(scpi_t * context, size_t len) {
  * @return
  */
 size_t SCPI_ResultArbitraryBlockData(scpi_t * context, const void * data, size_t len) {
+    size_t result;
 
     if (context->arbitrary_reminding < len) {
         SCPI_ErrorPush(context, SCPI_ERROR_SYSTEM_ERROR);
         return 0;
     }
 
+    /* arbitrary_reminding is decremented after the write, so interface can
+     * recognize (arbitrary_reminding > 0) that block data is written */
+    result = writeData(context, (const char *) data, len);
+
     context->arbitrary_reminding -= len;
 
     if (context->arbitrary_reminding == 0) {
         context->output_count++;
     }
 
-    return writeData(context, (const char *) data, len);
+    return result;
 }
 
 /**
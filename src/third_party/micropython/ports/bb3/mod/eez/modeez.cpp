@@ -167,6 +167,21 @@ mp_obj_t modeez_dlogTraceData(size_t n_args, const mp_obj_t *args) {
 
     if (n_args == 1 && mp_obj_is_type(args[0], &mp_type_list)) {
         mp_obj_get_array(args[0], &n_args, (mp_obj_t **)&args);
+    } else {
+        // bytes, bytearray or array('f') with one or more rows of packed floats
+        mp_buffer_info_t bufinfo;
+        if (n_args == 1 && mp_get_buffer(args[0], &bufinfo, MP_BUFFER_READ)) {
+            size_t rowSize = dlog_record::g_recording.parameters.numYAxes * sizeof(float);
+            if (bufinfo.len == 0 || bufinfo.len % rowSize != 0) {
+                mp_raise_ValueError("Buffer size is not multiple of row size");
+            }
+
+            if (!dlog_record::log(bufinfo.buf, bufinfo.len / rowSize, nullptr)) {
+                mp_raise_ValueError("DLOG buffer full");
+            }
+
+            return mp_const_none;
+        }
     }
 
     if (n_args < dlog_record::g_recording.parameters.numYAxes) {
@@ -130,6 +130,10 @@ void sntpSetSystemTimeUs(uint32_t t, uint32_t us);
 /*-----------------------------------------------------------------------------*/
 /* USER CODE BEGIN 1 */
 
+/* Several QoS 0 publishes are kept in flight by eez/mqtt.cpp */
+#define MQTT_REQ_MAX_IN_FLIGHT 8
+#define MQTT_OUTPUT_RINGBUF_SIZE 1024
+
 /* USER CODE END 1 */
 
 #ifdef __cplusplus